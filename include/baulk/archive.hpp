@@ -4,6 +4,7 @@
 #include <bela/base.hpp>
 #include <bela/time.hpp>
 #include <bela/io.hpp>
+#include <bela/bytes_view.hpp>
 #include <functional>
 #include <filesystem>
 #include "archive/format.hpp"
@@ -70,6 +71,8 @@ bool IsHarmfulPath(std::string_view child_path);
 std::optional<fs::path> JoinSanitizeFsPath(const fs::path &root, std::string_view child_path, bool always_utf8,
                                            std::wstring &encoded_path);
 
+// AnalyzeFormat detects the archive format from its leading bytes, it does not look into PE overlays
+file_format_t AnalyzeFormat(bela::bytes_view bv);
 //
 bool CheckFormat(bela::io::FD &fd, file_format_t &afmt, int64_t &offset, bela::error_code &ec);
 // OpenFile open file and detect archive file format and offset
@@ -3,6 +3,7 @@
 #define BAULK_ARCHIVE_EXTRACTOR_HPP
 #include <bela/base.hpp>
 #include <bela/io.hpp>
+#include <bela/fnmatch.hpp>
 #include <baulk/archive.hpp>
 #include <baulk/archive/zip.hpp>
 #include <baulk/archive/tar.hpp>
@@ -10,10 +11,39 @@
 
 namespace baulk::archive {
 namespace fs = std::filesystem;
+// Selection picks entries by their '/' separated names in the archive. A pattern ending with '/' selects everything
+// under that folder, any other pattern is matched by bela::FnMatch with '*' kept within one path component. An empty
+// selection picks every entry
+class Selection {
+public:
+  Selection() = default;
+  Selection(std::initializer_list<std::string_view> patterns_) {
+    for (const auto p : patterns_) {
+      patterns.emplace_back(p);
+    }
+  }
+  bool Empty() const { return patterns.empty(); }
+  bool Matched(std::string_view name) const {
+    if (patterns.empty()) {
+      return true;
+    }
+    for (const auto &p : patterns) {
+      if (p.ends_with('/') ? name.starts_with(p) : bela::FnMatch(p, name, bela::fnmatch::PathName)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+private:
+  std::vector<std::string> patterns;
+};
+
 // Options
 struct ExtractorOptions {
   bool ignore_error{false};
   bool overwrite_mode{true};
+  Selection selection; // zip entries outside the selection are skipped without being decompressed
 };
 
 namespace zip {
@@ -26,6 +56,9 @@ public:
   Extractor &operator=(const Extractor &) = delete;
   auto UncompressedSize() const { return reader.UncompressedSize(); }
   auto CompressedSize() const { return reader.CompressedSize(); }
+  // entries written and entries left out by the selection
+  auto Extracted() const { return extracted; }
+  auto Skipped() const { return skipped; }
   bool OpenReader(const fs::path &file, const fs::path &dest, bela::error_code &ec) {
     std::error_code e;
     if (destination = fs::absolute(dest, e); e) {
@@ -54,11 +87,17 @@ public:
       return false;
     }
     for (const auto &file : reader.Files()) {
+      if (!opts.selection.Matched(file.name)) {
+        skipped++;
+        continue;
+      }
       if (!extract_entry(file, filter, progress, ec)) {
         if (ec.code == bela::ErrCanceled || opts.ignore_error == false) {
           return false;
         }
+        continue;
       }
+      extracted++;
     }
     return true;
   }
@@ -67,6 +106,8 @@ private:
   ExtractorOptions opts;
   Reader reader;
   fs::path destination;
+  size_t extracted{0};
+  size_t skipped{0};
   bool create_symlink(const fs::path &_New_symlink, std::string_view linkname, bool always_utf8, bela::error_code &ec) {
     if (baulk::archive::IsHarmfulPath(linkname)) {
       ec = bela::make_error_code(bela::ErrGeneral, L"harmful path: ", bela::encode_into<char, wchar_t>(linkname));
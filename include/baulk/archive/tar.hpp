@@ -281,6 +281,8 @@ private:
   int64_t position{0};
 };
 std::shared_ptr<ExtractReader> MakeReader(FileReader &fd, int64_t offset, file_format_t afmt, bela::error_code &ec);
+// MakeReader stacks the decompressor of afmt on any source, e.g. a response body still being received
+std::shared_ptr<ExtractReader> MakeReader(ExtractReader *src, file_format_t afmt, bela::error_code &ec);
 
 class Reader {
 public:
@@ -0,0 +1,77 @@
+//
+#ifndef BAULK_BUNDLE_HPP
+#define BAULK_BUNDLE_HPP
+#include <bela/base.hpp>
+#include <span>
+#include "fs.hpp"
+
+struct ZSTD_DDict_s;
+
+namespace baulk::bundle {
+// A bundle keeps the manifests of a bucket in one file, each manifest a zstd frame compressed with a dictionary
+// trained on the manifests of the bucket. Manifests are small and alike, the dictionary carries what they share.
+// Layout, little endian: header | dictionary | frames | records sorted by name | wchar_t names. A manifest is found
+// by binary search and only its frame is decompressed
+constexpr uint32_t bundle_magic = 0x44424B42; // 'BKBD'
+constexpr uint32_t bundle_version = 1;
+constexpr size_t dictionary_capacity = 112 * 1024; // the zstd default, larger dictionaries stop paying off
+constexpr size_t dictionary_min_samples = 16;      // fewer manifests are compressed without a dictionary
+constexpr int compression_level = 12;
+constexpr uint32_t max_content_size = 16 * 1024 * 1024; // manifests are a few KB, larger records are damage
+
+struct bundle_header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t count;
+  uint32_t dictionary_size;
+  uint64_t dictionary; // byte offset
+  uint64_t records;    // byte offset, 8-byte aligned
+  uint64_t names;      // byte offset
+  uint64_t names_size; // in wchar_t
+};
+static_assert(sizeof(bundle_header) == 48);
+
+struct bundle_record {
+  uint64_t offset; // of the frame
+  uint32_t size;   // of the frame
+  uint32_t content_size;
+  uint32_t name; // offset in wchar_t
+  uint32_t name_size;
+};
+static_assert(sizeof(bundle_record) == 24);
+
+// names compare by ascii case, the way Windows finds the manifest files
+int compare_name(std::wstring_view a, std::wstring_view b);
+
+struct Manifest {
+  std::wstring name; // without '.json'
+  std::string content;
+};
+
+// Write lays manifests out as a bundle and writes it to file
+bool Write(std::vector<Manifest> &manifests, const std::filesystem::path &file, bela::error_code &ec);
+
+class Reader {
+public:
+  Reader() = default;
+  Reader(const Reader &) = delete;
+  Reader &operator=(const Reader &) = delete;
+  ~Reader();
+  // Open maps file and checks its layout
+  bool Open(const std::filesystem::path &file, bela::error_code &ec);
+  size_t Size() const { return records.size(); }
+  std::wstring_view Name(size_t i) const { return names.substr(records[i].name, records[i].name_size); }
+  // Find returns the position of the manifest of pkgName, ascii case ignored
+  std::optional<size_t> Find(std::wstring_view pkgName) const;
+  // Read decompresses the manifest at i, readers on several threads share the bundle
+  bool Read(size_t i, std::string &content, bela::error_code &ec) const;
+
+private:
+  fs::MappedFile mf;
+  std::span<const bundle_record> records;
+  std::wstring_view names;
+  ZSTD_DDict_s *ddict{nullptr};
+};
+} // namespace baulk::bundle
+
+#endif
@@ -0,0 +1,76 @@
+//
+#ifndef BAULK_DEPENDS_HPP
+#define BAULK_DEPENDS_HPP
+#include <bela/base.hpp>
+#include <bela/phmap.hpp>
+#include <functional>
+
+namespace baulk::depends {
+// A manifest lists its prerequisites in "depends": '[bucket/]name[op version]', op one of = != < <= > >=, for example
+// "7z", "main/git" or "python>=3.10.0". Versions compare the way upgrades compare them (bela::version). Resolve walks
+// the requirements of the requested packages across the buckets and lays the packages to install out in waves: a
+// package depends only on packages installed already or placed in earlier waves, the packages of one wave are
+// independent of each other. A name is installed from one bucket, requirements naming another bucket conflict
+enum class relation { any, eq, ne, lt, le, gt, ge };
+
+struct requirement {
+  std::wstring bucket; // empty: the newest of all buckets
+  std::wstring name;
+  relation op{relation::any};
+  std::wstring version;
+  bool Satisfied(std::wstring_view v) const;
+  std::wstring String() const;
+};
+
+bool ParseRequirement(std::wstring_view spec, requirement &r, bela::error_code &ec);
+
+// candidate: the package a bucket offers for a requirement
+struct candidate {
+  std::wstring name;
+  std::wstring bucket;
+  std::wstring version;
+  std::vector<std::wstring> depends;
+};
+
+// lookup_t finds the package for a requirement, nullopt with ec set when no bucket has it
+using lookup_t = std::function<std::optional<candidate>(const requirement &r, bela::error_code &ec)>;
+// installed_t returns the version of an installed package, nullopt when it is not installed
+using installed_t = std::function<std::optional<std::wstring>(std::wstring_view name)>;
+
+using waves_t = std::vector<std::vector<candidate>>;
+
+class Resolver {
+public:
+  Resolver(lookup_t lookup_, installed_t installed_) : lookup(std::move(lookup_)), installed(std::move(installed_)) {}
+  Resolver(const Resolver &) = delete;
+  Resolver &operator=(const Resolver &) = delete;
+  // Add requests a package, requested packages are installed (or upgraded) even when they are installed already
+  bool Add(std::wstring_view spec, bela::error_code &ec);
+  // Resolve returns the waves of packages to install, it fails on cycles and on unsatisfiable requirements
+  std::optional<waves_t> Resolve(bela::error_code &ec);
+
+private:
+  struct constraint {
+    requirement r;
+    std::wstring by; // the package requiring it, empty when requested
+  };
+  struct node {
+    candidate pkg;
+    std::vector<std::wstring> deps;  // lower case names of the prerequisites
+    std::vector<std::wstring> edges; // the prerequisites installed by this resolution, they go first
+  };
+  lookup_t lookup;
+  installed_t installed;
+  bela::flat_hash_map<std::wstring, node> nodes; // lower case name: package to install
+  bela::flat_hash_map<std::wstring, std::vector<constraint>> constraints;
+
+  // require records r and resolves the package to install for it, an installed prerequisite satisfying r is left
+  // alone
+  bool require(const requirement &r, std::wstring_view by, bool requested, bela::error_code &ec);
+  bool check_constraints(bela::error_code &ec);
+  // find_cycle follows unplaced prerequisites from an unplaced node until a node repeats
+  std::wstring find_cycle(const bela::flat_hash_map<std::wstring, size_t> &pending) const;
+};
+} // namespace baulk::depends
+
+#endif
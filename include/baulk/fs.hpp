@@ -5,6 +5,8 @@
 #include <optional>
 #include <string_view>
 #include <filesystem>
+#include <span>
+#include <utility>
 
 namespace baulk::fs {
 bool IsExecutablePath(const std::filesystem::path &p);
@@ -13,6 +15,9 @@ std::optional<std::filesystem::path> FindExecutablePath(const std::filesystem::p
 std::optional<std::filesystem::path> Flattened(const std::filesystem::path &d);
 // MakeFlattened: Flatten directories
 bool MakeFlattened(const std::filesystem::path &d, bela::error_code &ec);
+// MakeStripped: replace d by its only child folder, the top level of a source archive ('<repo>-<id>/'). Unlike
+// MakeFlattened it strips exactly one level, an empty d is left alone
+bool MakeStripped(const std::filesystem::path &d, bela::error_code &ec);
 
 inline std::wstring FileName(std::wstring_view p) { return std::filesystem::path(p).filename().wstring(); }
 
@@ -51,6 +56,40 @@ inline bool SymLink(const std::filesystem::path &_To, const std::filesystem::pat
 }
 
 std::optional<std::filesystem::path> NewTempFolder(bela::error_code &ec);
+
+// ReplaceContent writes content beside path, flushes it and renames it over path: readers see the old file or the
+// new one. A reader that opened path without FILE_SHARE_DELETE holds the rename up, it is retried for a while
+bool ReplaceContent(std::wstring_view path, std::string_view content, bela::error_code &ec);
+// ReadShared reads a whole file opened with FILE_SHARE_DELETE, ReplaceContent is not held up by the reader
+bool ReadShared(std::wstring_view path, std::string &content, bela::error_code &ec, uint64_t maxsize);
+
+// MappedFile maps a whole file read-only, the view stays valid until the MappedFile is closed or destroyed. Windows
+// refuses to replace a mapped file, writers close their own mappings first
+class MappedFile {
+public:
+  MappedFile() = default;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile(MappedFile &&o) noexcept { MoveFrom(std::move(o)); }
+  MappedFile &operator=(MappedFile &&o) noexcept {
+    MoveFrom(std::move(o));
+    return *this;
+  }
+  ~MappedFile() { Close(); }
+  bool Open(const std::filesystem::path &file, bela::error_code &ec);
+  void Close();
+  std::span<const uint8_t> Bytes() const { return {data, size}; }
+  explicit operator bool() const { return data != nullptr; }
+
+private:
+  void MoveFrom(MappedFile &&o) {
+    Close();
+    data = std::exchange(o.data, nullptr);
+    size = std::exchange(o.size, 0);
+  }
+  const uint8_t *data{nullptr};
+  size_t size{0};
+};
 } // namespace baulk::fs
 
 #endif
\ No newline at end of file
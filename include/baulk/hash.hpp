@@ -3,6 +3,7 @@
 #define BAULK_HASH_HPP
 #include <bela/base.hpp>
 #include <filesystem>
+#include <memory>
 
 namespace baulk::hash {
 enum class hash_t {
@@ -18,7 +19,26 @@ enum class hash_t {
   BLAKE3
 };
 bool HashEqual(const std::filesystem::path &file, std::wstring_view hash_value, bela::error_code &ec);
+// HashKey normalizes a 'METHOD:value' hash value into a file name safe key: 'sha256-<lowercase hex>'
+std::optional<std::wstring> HashKey(std::wstring_view hash_value, bela::error_code &ec);
 std::optional<std::wstring> FileHash(const std::filesystem::path &file, hash_t method, bela::error_code &ec);
+// Verifier checks a hash value against data fed to it piece by piece, e.g. a download while it is received
+class Verifier {
+public:
+  Verifier();
+  Verifier(const Verifier &) = delete;
+  Verifier &operator=(const Verifier &) = delete;
+  ~Verifier();
+  // Initialize accepts the same 'METHOD:value' forms as HashEqual
+  bool Initialize(std::wstring_view hash_value, bela::error_code &ec);
+  void Update(const void *data, size_t len);
+  // Equal finalizes the hash and compares it with the expected value
+  bool Equal(bela::error_code &ec);
+
+private:
+  struct state;
+  std::unique_ptr<state> st;
+};
 struct file_hash_sums {
   std::wstring sha256sum;
   std::wstring blake3sum;
@@ -0,0 +1,53 @@
+//
+#ifndef BAULK_INSTALLED_HPP
+#define BAULK_INSTALLED_HPP
+#include <bela/base.hpp>
+#include <bela/phmap.hpp>
+#include "json_utils.hpp"
+
+namespace baulk::installed {
+// The installed packages are recorded in AppLocks()\installed.jsonl, a log with one JSON object per line. A line puts
+// the record of a package ({"name", "version", "bucket", "date", "mask", "force_delete", "venv"}) or removes it
+// ({"name", "removed": true}), the last line of a package wins. A commit appends one line and flushes it to disk; a
+// line torn by a crash has no newline and is skipped, the next commit starts on a new line. Once the log holds more
+// than twice as many lines as packages it is compacted: rewritten beside the log and renamed over it.
+// Trees of earlier versions kept one lock file per package (AppLocks()\<name>.json), Load reads them as they are and
+// Open migrates them into the log
+std::wstring DatabasePath();
+
+class Database {
+public:
+  Database() = default;
+  Database(const Database &) = delete;
+  Database &operator=(const Database &) = delete;
+  // Load reads the installed packages without writing anything, readers do not need the baulk fs mutex
+  bool Load(bela::error_code &ec);
+  // Open loads the installed packages for writing and migrates lock files into the log. Writers hold the baulk fs
+  // mutex
+  bool Open(bela::error_code &ec);
+  // Find returns the record of an installed package, nullptr when it is not installed
+  const nlohmann::json *Find(std::wstring_view name) const;
+  bool Contains(std::wstring_view name) const { return Find(name) != nullptr; }
+  // Names returns the installed packages in lower case order
+  std::vector<std::wstring> Names() const;
+  // Put records an installed package, record must not carry another name
+  bool Put(std::wstring_view name, nlohmann::json record, bela::error_code &ec);
+  bool Remove(std::wstring_view name, bela::error_code &ec);
+  // Compact rewrites the log with one line per installed package
+  bool Compact(bela::error_code &ec);
+  auto Size() const { return records.size(); }
+
+private:
+  bela::flat_hash_map<std::wstring, nlohmann::json> records; // lower case name: record
+  size_t lines{0};
+  bool torn{false};
+  bool migrated{false};
+
+  void load_line(std::string_view line);
+  bool load_locks(bela::error_code &ec);
+  bool append(const nlohmann::json &record, bela::error_code &ec);
+  bool compact_if_needed(bela::error_code &ec);
+};
+} // namespace baulk::installed
+
+#endif
@@ -0,0 +1,149 @@
+// <baulk/json_lazy.hpp>
+#ifndef BAULK_JSON_LAZY_HPP
+#define BAULK_JSON_LAZY_HPP
+#include <bela/base.hpp>
+#include <charconv>
+#include "json_utils.hpp"
+#include "fs.hpp"
+
+namespace baulk {
+namespace json_internal {
+// unescape decodes the content of a string with escapes to UTF-8
+bool unescape(std::string_view raw, std::string &out);
+} // namespace json_internal
+
+// lazy_json_view answers the queries of json_view over the text of a JSON value without building a DOM. A query scans
+// the members of the object from its start, skips the values it does not ask for and converts only the value it
+// returns; strings without escapes are converted straight from the text. The first member of a name wins where the
+// DOM keeps the last, elements of another type in string arrays are skipped where the DOM throws
+class lazy_json_view {
+public:
+  lazy_json_view() = default;
+  explicit lazy_json_view(std::string_view text_) : text(text_) {}
+  // fecth string value
+  std::wstring fetch(const std::string_view key, std::wstring_view dv = L"") const;
+  // fetch string array value
+  template <typename T, typename Allocator = std::allocator<T>>
+  requires bela::u16_character<T> || bela::u8_character<T>
+  bool fetch_strings_checked(std::string_view name,
+                             std::vector<std::basic_string<T, std::char_traits<T>, Allocator>> &v) const {
+    auto value = find(name);
+    if (value.empty()) {
+      return false;
+    }
+    std::basic_string<T, std::char_traits<T>, Allocator> s;
+    if (value.front() == '"') {
+      if (decode(value, s)) {
+        v.emplace_back(std::move(s));
+      }
+      return true;
+    }
+    if (value.front() == '[') {
+      for (auto e : elements(value)) {
+        if (decode(e, s)) {
+          v.emplace_back(std::move(s));
+        }
+      }
+      return true;
+    }
+    return false;
+  }
+  // fetch integer value return details key exists
+  template <typename T>
+  requires std::integral<T>
+  bool fetch_integer_checked(std::string_view name, T &v) const { return decode_integer(find(name), v); }
+  // fetch integer value
+  template <typename T>
+  requires std::integral<T> T fetch_as_integer(std::string_view name, const T dv) const {
+    if (T v; decode_integer(find(name), v)) {
+      return v;
+    }
+    return dv;
+  }
+  // fetch path array
+  template <typename T> bool fetch_paths_checked(std::string_view name, std::vector<T> &paths) const {
+    auto value = find(name);
+    if (value.empty()) {
+      return false;
+    }
+    std::wstring s;
+    if (value.front() == '"') {
+      if (decode(value, s)) {
+        paths.emplace_back(FromSlash(std::move(s)));
+      }
+      return true;
+    }
+    if (value.front() == '[') {
+      for (auto e : elements(value)) {
+        if (decode(e, s)) {
+          paths.emplace_back(FromSlash(std::move(s)));
+        }
+      }
+    }
+    return true;
+  }
+  // check flags
+  bool fetch_as_boolean(std::string_view name, bool dv) const;
+  [[nodiscard]] std::optional<lazy_json_view> subview(std::string_view name) const;
+  [[nodiscard]] std::vector<lazy_json_view> subviews(std::string_view name) const;
+
+private:
+  std::string_view text;
+
+  // find returns the text of the value of member key, empty when the object has no such member
+  std::string_view find(std::string_view key) const;
+  // elements returns the text of every element of array
+  static std::vector<std::string_view> elements(std::string_view array);
+  template <typename T, typename Allocator>
+  static bool decode(std::string_view value, std::basic_string<T, std::char_traits<T>, Allocator> &s) {
+    if (value.size() < 2 || value.front() != '"') {
+      return false;
+    }
+    auto raw = value.substr(1, value.size() - 2);
+    std::string unescaped;
+    if (raw.find('\\') != std::string_view::npos) {
+      if (!json_internal::unescape(raw, unescaped)) {
+        return false;
+      }
+      raw = unescaped;
+    }
+    if constexpr (bela::u8_character<T>) {
+      s.assign(reinterpret_cast<const T *>(raw.data()), raw.size());
+    } else {
+      s = bela::encode_into<char, T>(raw);
+    }
+    return true;
+  }
+  template <typename T> static bool decode_integer(std::string_view value, T &v) {
+    if (value.empty() || value.find_first_of(".eE") != std::string_view::npos) {
+      return false;
+    }
+    auto convert = [&](auto n) {
+      auto end = value.data() + value.size();
+      if (auto r = std::from_chars(value.data(), end, n); r.ec != std::errc{} || r.ptr != end) {
+        return false;
+      }
+      v = static_cast<T>(n);
+      return true;
+    };
+    return value.front() == '-' ? convert(int64_t{0}) : convert(uint64_t{0});
+  }
+};
+
+// lazy_json_container keeps the file mapped while its views are used, text read elsewhere (a bundle) is owned
+struct lazy_json_container {
+  baulk::fs::MappedFile file;
+  std::string_view text;
+  std::string buffer;
+  lazy_json_view view() const { return lazy_json_view(file ? text : std::string_view(buffer)); }
+};
+
+// parse_json_file_lazy maps file and checks that it holds one well formed value, no value is decoded
+std::optional<lazy_json_container> parse_json_file_lazy(const std::wstring_view file, bela::error_code &ec);
+
+// parse_json_lazy takes over text, name is used in errors
+std::optional<lazy_json_container> parse_json_lazy(std::string &&text, std::wstring_view name, bela::error_code &ec);
+
+} // namespace baulk
+
+#endif
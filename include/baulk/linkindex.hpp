@@ -0,0 +1,92 @@
+//
+#ifndef BAULK_LINKINDEX_HPP
+#define BAULK_LINKINDEX_HPP
+#include <bela/base.hpp>
+#include "fs.hpp"
+
+namespace baulk::linkindex {
+// The link index is what baulk-lnk needs of baulk.linkmeta.json at launch, worked out when the metadata is written:
+// every alias with the full path of its target and whether the target runs in a console. baulk-lnk maps it and
+// finds its alias by binary search instead of parsing the metadata, resolving the target and reading its PE header.
+// The index records the identity of the metadata it was built from, an index older than the metadata is ignored.
+// Layout, little endian: header | records sorted by alias | wchar_t strings
+constexpr uint32_t index_magic = 0x584C4B42; // 'BKLX'
+constexpr uint32_t index_version = 1;
+constexpr uint32_t flag_console = 1;
+
+struct index_header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t count;
+  uint32_t reserved;
+  uint64_t meta_index; // identity of baulk.linkmeta.json
+  uint64_t meta_size;
+  uint64_t meta_mtime;
+  uint64_t records;      // byte offset, 8-byte aligned
+  uint64_t strings;      // byte offset
+  uint64_t strings_size; // in wchar_t
+};
+static_assert(sizeof(index_header) == 64);
+
+struct index_record {
+  uint32_t alias; // offset in wchar_t
+  uint32_t alias_size;
+  uint32_t target;
+  uint32_t target_size;
+  uint32_t flags;
+  uint32_t reserved;
+};
+static_assert(sizeof(index_record) == 24);
+
+std::wstring IndexPath(std::wstring_view folder);
+
+// identity tells one baulk.linkmeta.json from another, every commit renames a new file over it
+struct identity {
+  uint64_t index{0};
+  uint64_t size{0};
+  uint64_t mtime{0};
+  bool operator==(const identity &) const = default;
+};
+
+bool Identify(std::wstring_view file, identity &id, bela::error_code &ec);
+
+struct Link {
+  std::wstring alias;
+  std::wstring target; // full path
+  bool console{false};
+};
+
+// Resolve turns a link metadata entry ("7z@7z.exe@19.01") into a Link, the way baulk-lnk resolved it at launch
+std::optional<Link> Resolve(std::wstring_view alias, std::wstring_view meta, std::wstring_view packagesRoot);
+
+// Write lays links out as an index of the metadata identified by meta and writes it to file
+bool Write(std::vector<Link> &links, const identity &meta, std::wstring_view file, bela::error_code &ec);
+
+class Reader {
+public:
+  Reader() = default;
+  Reader(const Reader &) = delete;
+  Reader &operator=(const Reader &) = delete;
+  // Open maps the index of folder, it fails when the index is missing, damaged or older than the metadata. Close it
+  // soon: a mapped index cannot be replaced
+  bool Open(std::wstring_view folder, bela::error_code &ec);
+  void Close() {
+    mf.Close();
+    records = {};
+    strings = {};
+  }
+  size_t Size() const { return records.size(); }
+  std::wstring_view Alias(size_t i) const { return strings.substr(records[i].alias, records[i].alias_size); }
+  std::wstring_view Target(size_t i) const { return strings.substr(records[i].target, records[i].target_size); }
+  bool Console(size_t i) const { return (records[i].flags & flag_console) != 0; }
+  // Find returns the position of alias, compared as the metadata keys are
+  std::optional<size_t> Find(std::wstring_view alias) const;
+
+private:
+  fs::MappedFile mf;
+  std::span<const index_record> records;
+  std::wstring_view strings;
+};
+} // namespace baulk::linkindex
+
+#endif
@@ -0,0 +1,58 @@
+//
+#ifndef BAULK_LINKMETA_HPP
+#define BAULK_LINKMETA_HPP
+#include <bela/base.hpp>
+#include "json_utils.hpp"
+
+namespace baulk::linkmeta {
+// The links of AppLinks() are described by baulk.linkmeta.json: {"links": {alias: "package@path@version"},
+// "app_packages_root", "updated"}, baulk-lnk reads it on every launch. A Store keeps the file in memory for a whole
+// command and writes it once on Commit: beside the file, flushed, renamed over it, so readers see the old file or the
+// new one. Every change is first appended to baulk.linkmeta.journal ({"alias", "target"}, no target for a removal);
+// a command that dies before its commit leaves the journal behind and the next Open replays it. Replaying a change
+// twice is harmless, the journal is deleted once the file is replaced
+std::wstring MetaPath(std::wstring_view folder);
+std::wstring JournalPath(std::wstring_view folder);
+
+class Store {
+public:
+  Store() = default;
+  Store(const Store &) = delete;
+  Store &operator=(const Store &) = delete;
+  ~Store() { close_journal(); }
+  // Open loads the link metadata of folder and replays the journal of an interrupted command. Writers hold the baulk
+  // fs mutex
+  bool Open(std::wstring_view folder_, bela::error_code &ec);
+  // Target returns what alias points at, empty when there is no such link
+  std::wstring Target(std::wstring_view alias) const;
+  size_t Size() const { return links.size(); }
+  bool Dirty() const { return dirty; }
+  // Replayed is the number of changes Open recovered from the journal
+  size_t Replayed() const { return replayed; }
+  // Put points every alias at its target ("7z@7z.exe@19.01"), the changes are journaled with one write
+  bool Put(const std::vector<std::pair<std::wstring, std::wstring>> &aliases, bela::error_code &ec);
+  // Links returns every alias with its target
+  std::vector<std::pair<std::wstring, std::wstring>> Links() const;
+  // Remove drops the links of pkgName and returns their aliases, the link files are left to the caller
+  std::optional<std::vector<std::wstring>> Remove(std::wstring_view pkgName, bela::error_code &ec);
+  // Commit writes the metadata when it changed and deletes the journal
+  bool Commit(std::wstring_view packagesRoot, bela::error_code &ec);
+
+private:
+  std::wstring folder;
+  nlohmann::json obj;
+  nlohmann::json links;
+  HANDLE journalFd{INVALID_HANDLE_VALUE};
+  size_t replayed{0};
+  bool dirty{false};
+  bool torn{false}; // the journal ends in a line torn by a crash, the next change starts on a new line
+
+  void close_journal();
+  void apply_change(const nlohmann::json &change);
+  bool replay(bela::error_code &ec);
+  // apply journals changes with one write, then applies them
+  bool apply(const std::vector<nlohmann::json> &changes, bela::error_code &ec);
+};
+} // namespace baulk::linkmeta
+
+#endif
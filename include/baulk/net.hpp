@@ -6,7 +6,16 @@
 #include <baulk/net/tcp.hpp>
 
 namespace baulk::net {
+// BestUrl picks the mirror for the locale, else the one with the lowest recent latency (probing when unknown)
 std::wstring_view BestUrl(const std::vector<std::wstring> &urls, std::wstring_view locale);
-}
+// latency stats per host feed BestUrl across runs: LoadLatencyStats binds the cache file, SaveLatencyStats writes
+// it back when something was recorded
+bool LoadLatencyStats(const std::filesystem::path &file, bela::error_code &ec);
+bool SaveLatencyStats(bela::error_code &ec);
+// connect: TCP connect time, first_byte: from the request sent to the response head. Either may be zero when not
+// measured
+void RecordLatency(std::wstring_view host, std::chrono::nanoseconds connect, std::chrono::nanoseconds first_byte);
+void RecordFailure(std::wstring_view host);
+} // namespace baulk::net
 
 #endif
@@ -1,7 +1,9 @@
 #ifndef BAULK_NET_CLIENT_HPP
 #define BAULK_NET_CLIENT_HPP
 #include "types.hpp"
+#include "tcp.hpp"
 #include <filesystem>
+#include <functional>
 #include <bela/terminal.hpp>
 
 namespace baulk::net {
@@ -27,17 +29,51 @@ private:
   size_t size_{0};
 };
 
+// body_sink_t receives the response body in order while it is written to disk, returning false aborts the download
+using body_sink_t = std::function<bool(const void *data, size_t len, bela::error_code &ec)>;
+
 struct download_options {
   std::wstring hash_value;
   std::filesystem::path cwd;
   std::filesystem::path destination;
   bool force_overwrite{false};
+  uint32_t segments{0}; // > 1: fetch large files as this many parallel byte ranges (needs hash_value to resume)
+  bool quiet{false};     // no progress bar, several downloads share the terminal
+  body_sink_t sink;      // tee of the body from its first byte: part files are not resumed, no segments
   bool OverwriteExists() const { return force_overwrite || !destination.empty(); }
 };
 
+class response_cache;
+class peer_set;
+namespace http1 {
+class connections;
+}
+namespace native {
+class session_pool;
+}
+
+// keep-alive connection reuse across requests of one HttpClient
+struct pool_options {
+  uint32_t max_per_host{6};                                         // connections kept (and opened by WinHTTP) per host
+  std::chrono::milliseconds idle_timeout{std::chrono::seconds(90)}; // idle connections older than this are closed
+};
+
+struct pool_stats {
+  uint64_t hits{0};   // requests served by an existing connection
+  uint64_t misses{0}; // requests that had to connect
+};
+
+struct cache_stats {
+  uint64_t hits{0};   // 304 Not Modified, served from the response cache
+  uint64_t misses{0}; // full responses
+};
+
+// WinHTTP is the default transport; Socket is the portable HTTP/1.1 implementation over baulk::net::Conn
+enum class transport_t { WinHTTP, Socket };
+
 class HttpClient {
 public:
-  HttpClient() = default;
+  HttpClient();
   HttpClient(const HttpClient &) = delete;
   HttpClient &operator=(const HttpClient &) = delete;
   HttpClient &Set(std::wstring_view key, std::wstring_view value) {
@@ -69,7 +105,20 @@ public:
   void SetNoCache(bool n) { noCache = n; }
   void SetProxyURL(std::wstring_view url) { proxyURL = url; }
   bool InitializeProxyFromEnv();
-  
+  auto Transport() const { return transport; }
+  void SetTransport(transport_t t) { transport = t; }
+  // TLS for https:// URLs on the socket transport
+  void SetTlsHook(TlsHook hook) { tlsHook = std::move(hook); }
+  const pool_options &PoolOptions() const { return poolOptions; }
+  void SetPoolOptions(const pool_options &opts) { poolOptions = opts; }
+  pool_stats PoolStats() const;
+  // EnableResponseCache revalidates GET responses of WinRest with ETag/Last-Modified kept under dir
+  bool EnableResponseCache(const std::filesystem::path &dir, bela::error_code &ec);
+  // SetPeers lists LAN peers ('http://host:port' running baulk serve). WinGet asks them for downloads with a
+  // hash_value before the origin and keeps only what matches the hash
+  void SetPeers(const std::vector<std::wstring> &urls);
+  cache_stats CacheStats() const;
+
   static HttpClient &DefaultClient() {
     static HttpClient client;
     return client;
@@ -101,6 +150,17 @@ public:
   }
 
 private:
+  std::optional<Response> NativeRest(std::wstring_view method, std::wstring_view url, std::wstring_view content_type,
+                                     std::wstring_view body, const headers_t &extra, bela::error_code &ec);
+  std::optional<Response> SockRest(std::wstring_view method, std::wstring_view url, std::wstring_view content_type,
+                                   std::wstring_view body, const headers_t &extra, bela::error_code &ec);
+  std::optional<std::filesystem::path> SockGet(std::wstring_view url, const download_options &opts,
+                                               bela::error_code &ec);
+  std::optional<std::filesystem::path> OriginGet(std::wstring_view url, const download_options &opts,
+                                                 bela::error_code &ec);
+  // PeerGet downloads from the first peer holding the blob, fallback tells whether the origin may still be asked
+  std::optional<std::filesystem::path> PeerGet(std::wstring_view url, const download_options &opts, bool &fallback,
+                                               bela::error_code &ec);
   headers_t hkv;
   std::wstring userAgent{L"Wget/7.0 (Baulk)"};
   std::wstring proxyURL;
@@ -110,6 +170,13 @@ private:
   bool insecureMode{false};
   bool debugMode{false};
   bool noCache{false};
+  transport_t transport{transport_t::WinHTTP};
+  TlsHook tlsHook;
+  pool_options poolOptions;
+  std::shared_ptr<native::session_pool> sessions; // cached WinHTTP session and connect handles
+  std::shared_ptr<http1::connections> conns;      // idle keep-alive connections of the socket transport
+  std::shared_ptr<response_cache> cache;          // conditional GET cache, null unless enabled
+  std::shared_ptr<peer_set> peers;                // LAN peers asked before the origin, null unless set
 };
 
 // HTTP rest api
@@ -0,0 +1,48 @@
+// LAN peer cache: 'baulk serve' shares the blob store over HTTP, HttpClient asks its peers for a download by digest
+// before it goes to the origin
+#ifndef BAULK_NET_PEER_HPP
+#define BAULK_NET_PEER_HPP
+#include "tcp.hpp"
+#include <bela/phmap.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace baulk::net {
+// PeerServer serves the blobs of a directory, files named by digest ('sha256-<hex>'):
+//   GET /blobs/        one 'digest size' line per blob
+//   GET /blobs/digest  the blob, single byte ranges are honored (206)
+// HEAD works on both. Peers are trusted for nothing: clients verify every blob against their manifest hash
+class PeerServer {
+public:
+  explicit PeerServer(const std::filesystem::path &root_) : root(root_) {}
+  PeerServer(const PeerServer &) = delete;
+  PeerServer &operator=(const PeerServer &) = delete;
+  // Serve accepts connections on l until Stop is called, each connection is served by its own thread, at most 64
+  // at a time while later ones wait in the listen backlog. It returns once all connections are closed
+  void Serve(Listener &l);
+  // Stop ends Serve and waits until its connections are closed, an idle keep-alive connection within its idle timeout
+  void Stop();
+  uint64_t Requests() const { return requests.load(); }
+  uint64_t BytesServed() const { return served.load(); }
+
+private:
+  void serve_connection(Conn &&conn);
+  void reap(std::unique_lock<std::mutex> &lock);
+  std::filesystem::path root;
+  std::atomic_bool stopped{false};
+  std::atomic_uint64_t requests{0};
+  std::atomic_uint64_t served{0};
+  std::mutex mu;
+  std::condition_variable cv;
+  bela::flat_hash_map<uint64_t, std::thread> workers; // connection threads by id
+  std::vector<uint64_t> finished;                     // connections done, their threads are joined by Serve
+  uint64_t next_id{0};
+  bool serving{false};
+};
+} // namespace baulk::net
+
+#endif
@@ -3,6 +3,9 @@
 #define BAULK_TCP_HPP
 #include <bela/base.hpp>
 #include <chrono>
+#include <functional>
+#include <memory>
+#include <stop_token>
 
 namespace baulk::net {
 using BAULKSOCK = UINT_PTR;
@@ -36,6 +39,54 @@ private:
 // timeout milliseconds
 std::optional<Conn> DialTimeout(std::wstring_view address, int port, int timeout,
                                 bela::error_code &ec); // second
+// DialTimeout with stop gives up soon after stop is requested, name resolution included
+std::optional<Conn> DialTimeout(std::wstring_view address, int port, int timeout, std::stop_token stop,
+                                bela::error_code &ec);
+
+class Listener {
+public:
+  Listener() = default;
+  Listener(BAULKSOCK sock_, int port_) : sock(sock_), port(port_) {}
+  Listener(Listener &&other) { Move(std::move(other)); }
+  Listener &operator=(Listener &&other) {
+    Move(std::move(other));
+    return *this;
+  }
+  Listener(const Listener &) = delete;
+  Listener &operator=(const Listener &) = delete;
+  ~Listener() { Close(); }
+  void Close();
+  // Accept waits up to timeout milliseconds (-1 infinite) for a connection, the accepted socket is non-blocking
+  std::optional<Conn> Accept(int timeout, bela::error_code &ec);
+  // bound port, useful when Listen was asked for port 0
+  int Port() const { return port; }
+
+private:
+  BAULKSOCK sock{BAULK_INVALID_SOCKET};
+  int port{0};
+  void Move(Listener &&other) {
+    Close();
+    sock = other.sock;
+    port = other.port;
+    other.sock = BAULK_INVALID_SOCKET;
+  }
+};
+// address: L"127.0.0.1", L"::1", L"0.0.0.0" ...
+std::optional<Listener> Listen(std::wstring_view address, int port, bela::error_code &ec);
+
+// Stream is the byte stream used by the socket HTTP/1.1 transport: plain TCP or a TLS session on top of a Conn
+class Stream {
+public:
+  virtual ~Stream() = default;
+  // Read returns the number of bytes read, 0 when the peer closed the stream, -1 on error or timeout
+  virtual ssize_t Read(void *buf, size_t len, int timeout, bela::error_code &ec) = 0;
+  virtual bool WriteFull(const void *data, size_t len, int timeout, bela::error_code &ec) = 0;
+};
+std::unique_ptr<Stream> MakeTcpStream(Conn &&conn);
+// TlsHook wraps a connected socket in a TLS client session (SNI and certificate checks against host, insecure skips
+// verification). The socket transport has no TLS of its own, https:// URLs require a hook.
+using TlsHook =
+    std::function<std::unique_ptr<Stream>(Conn &&conn, std::wstring_view host, bool insecure, bela::error_code &ec)>;
 } // namespace baulk::net
 
-#endif
\ No newline at end of file
+#endif
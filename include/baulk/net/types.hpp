@@ -136,6 +136,23 @@ inline std::wstring url_path_name(std::wstring_view urlpath) {
   return std::wstring(pv.back());
 }
 
+// url_host returns the authority of an absolute url without userinfo and port, empty when there is none
+inline std::wstring url_host(std::wstring_view url) {
+  auto pos = url.find(L"://");
+  if (pos == std::wstring_view::npos) {
+    return L"";
+  }
+  url.remove_prefix(pos + 3);
+  url = url.substr(0, url.find_first_of(L"/?#"));
+  if (auto at = url.rfind(L'@'); at != std::wstring_view::npos) {
+    url.remove_prefix(at + 1);
+  }
+  if (url.starts_with(L'[')) {
+    return std::wstring(url.substr(0, url.find(L']') + 1));
+  }
+  return std::wstring(url.substr(0, url.find(L':')));
+}
+
 inline std::wstring decoded_url_path_name(std::wstring_view urlpath) {
   std::vector<std::wstring_view> pv = bela::SplitPath(urlpath);
   if (pv.empty()) {
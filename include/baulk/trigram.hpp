@@ -0,0 +1,59 @@
+//
+#ifndef BAULK_TRIGRAM_HPP
+#define BAULK_TRIGRAM_HPP
+#include <bela/base.hpp>
+#include <bela/phmap.hpp>
+#include <span>
+#include <vector>
+
+namespace baulk::trigram {
+// A trigram index maps every run of three characters (ascii case folded) to the sorted ids of the documents
+// containing it. A term of three or more characters can only occur in the documents listed under all of its trigrams,
+// so a search intersects a few short lists instead of scanning every document; candidates are still verified
+using key_t = uint64_t;
+
+// posting_list locates the document ids of one trigram in the postings array
+struct posting_list {
+  key_t key;
+  uint32_t offset;
+  uint32_t count;
+};
+static_assert(sizeof(posting_list) == 16);
+
+// Keys returns the distinct trigrams of text, sorted
+std::vector<key_t> Keys(std::wstring_view text);
+
+// ContainsIgnoreCase: needle occurs in haystack, ascii case ignored
+bool ContainsIgnoreCase(std::wstring_view haystack, std::wstring_view needle);
+
+// Score ranks a package for term: the name matching exactly, then as a prefix, then anywhere, then the description.
+// 0 means no match
+int Score(std::wstring_view name, std::wstring_view description, std::wstring_view term);
+
+// Builder collects the trigrams of documents added with increasing ids
+class Builder {
+public:
+  void Add(uint32_t doc, std::wstring_view text);
+  // Encode lays the index out as lists sorted by key and the document ids they point into
+  void Encode(std::vector<posting_list> &lists, std::vector<uint32_t> &docs) const;
+
+private:
+  bela::flat_hash_map<key_t, std::vector<uint32_t>> postings;
+};
+
+// Postings reads an encoded index, usually straight from a mapped file
+class Postings {
+public:
+  Postings() = default;
+  Postings(std::span<const posting_list> lists_, std::span<const uint32_t> docs_) : lists(lists_), docs(docs_) {}
+  // Candidates returns the sorted ids of the documents that may contain term, or false when term is too short for
+  // the index to narrow anything down and every document is a candidate
+  bool Candidates(std::wstring_view term, std::vector<uint32_t> &candidates) const;
+
+private:
+  std::span<const posting_list> lists;
+  std::span<const uint32_t> docs;
+};
+} // namespace baulk::trigram
+
+#endif
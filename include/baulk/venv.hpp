@@ -2,10 +2,13 @@
 #ifndef BAULK_VENV_HPP
 #define BAULK_VENV_HPP
 #include <bela/terminal.hpp>
+#include <bela/ascii.hpp>
+#include <bela/match.hpp>
 #include <bela/env.hpp>
 #include <bela/simulator.hpp>
 #include "json_utils.hpp"
 #include "vfs.hpp"
+#include "installed.hpp"
 
 namespace baulk::env {
 struct PackageEnv {
@@ -160,12 +163,17 @@ private:
     return true;
   }
   std::optional<PackageEnv> loadPackageEnv(std::wstring_view pkgName, bela::error_code &ec) {
-    auto jo = baulk::parse_json_file(bela::StringCat(baulk::vfs::AppLocks(), L"\\", pkgName, L".json"), ec);
-    if (!jo) {
+    if (!installedLoaded && !installed.Load(ec)) {
+      return std::nullopt;
+    }
+    installedLoaded = true;
+    auto record = installed.Find(pkgName);
+    if (record == nullptr) {
+      ec = bela::make_error_code(ERROR_NOT_FOUND, L"'", pkgName, L"' not installed");
       return std::nullopt;
     }
     PackageEnv pkgEnv{.name = std::wstring(pkgName)};
-    auto jv = jo->view();
+    auto jv = baulk::json_view(*record);
     if (auto sv = jv.subview("venv"); sv) {
       sv->fetch_paths_checked("path", pkgEnv.paths);
       sv->fetch_paths_checked("include", pkgEnv.includes);
@@ -265,6 +273,8 @@ private:
   }
   std::vector<PackageEnv> standardEnvs; // no package requires this
   std::list<PackageEnv> requiresEnvs;   // some package requires this
+  baulk::installed::Database installed; // loaded once by the first package env
+  bool installedLoaded{false};
   int depth{0};
   bool IsDebugMode{false};
 };
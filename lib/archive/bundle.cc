@@ -0,0 +1,171 @@
+// bucket bundles: manifests compressed with a shared zstd dictionary
+#include <bela/ascii.hpp>
+#include <bela/io.hpp>
+#include <baulk/bundle.hpp>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <zstd.h>
+#include <zdict.h>
+
+namespace baulk::bundle {
+int compare_name(std::wstring_view a, std::wstring_view b) {
+  auto n = (std::min)(a.size(), b.size());
+  for (size_t i = 0; i < n; i++) {
+    auto ca = bela::ascii_tolower(a[i]);
+    auto cb = bela::ascii_tolower(b[i]);
+    if (ca != cb) {
+      return ca < cb ? -1 : 1;
+    }
+  }
+  return a.size() == b.size() ? 0 : (a.size() < b.size() ? -1 : 1);
+}
+
+bool Write(std::vector<Manifest> &manifests, const std::filesystem::path &file, bela::error_code &ec) {
+  std::sort(manifests.begin(), manifests.end(),
+            [](const Manifest &a, const Manifest &b) { return compare_name(a.name, b.name) < 0; });
+  manifests.erase(std::unique(manifests.begin(), manifests.end(),
+                              [](const Manifest &a, const Manifest &b) { return compare_name(a.name, b.name) == 0; }),
+                  manifests.end());
+  std::string dictionary;
+  if (manifests.size() >= dictionary_min_samples) {
+    std::string samples;
+    std::vector<size_t> sizes;
+    for (const auto &m : manifests) {
+      samples.append(m.content);
+      sizes.emplace_back(m.content.size());
+    }
+    dictionary.resize((std::min)(dictionary_capacity, (std::max)(samples.size() / 10, static_cast<size_t>(4096))));
+    auto n = ZDICT_trainFromBuffer(dictionary.data(), dictionary.size(), samples.data(), sizes.data(),
+                                   static_cast<unsigned>(sizes.size()));
+    // training fails on too little or too uniform input, the frames then go without a dictionary
+    dictionary.resize(ZDICT_isError(n) ? 0 : n);
+  }
+  std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> cctx(ZSTD_createCCtx(), ZSTD_freeCCtx);
+  std::unique_ptr<ZSTD_CDict, decltype(&ZSTD_freeCDict)> cdict(
+      dictionary.empty() ? nullptr : ZSTD_createCDict(dictionary.data(), dictionary.size(), compression_level),
+      ZSTD_freeCDict);
+  if (!cctx || (!dictionary.empty() && !cdict)) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"zstd: out of memory");
+    return false;
+  }
+  bundle_header h{.magic = bundle_magic,
+                  .version = bundle_version,
+                  .count = static_cast<uint32_t>(manifests.size()),
+                  .dictionary_size = static_cast<uint32_t>(dictionary.size()),
+                  .dictionary = sizeof(bundle_header)};
+  std::string buffer(sizeof(bundle_header), '\0');
+  buffer.append(dictionary);
+  std::vector<bundle_record> records;
+  std::wstring names;
+  std::string frame;
+  for (const auto &m : manifests) {
+    if (m.content.size() > max_content_size) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"bundle ", m.name, L": manifest too large ", m.content.size());
+      return false;
+    }
+    frame.resize(ZSTD_compressBound(m.content.size()));
+    auto n = cdict ? ZSTD_compress_usingCDict(cctx.get(), frame.data(), frame.size(), m.content.data(),
+                                              m.content.size(), cdict.get())
+                   : ZSTD_compressCCtx(cctx.get(), frame.data(), frame.size(), m.content.data(), m.content.size(),
+                                       compression_level);
+    if (ZSTD_isError(n)) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"zstd compress ", m.name, L": ", ZSTD_getErrorName(n));
+      return false;
+    }
+    records.emplace_back(bundle_record{.offset = buffer.size(),
+                                       .size = static_cast<uint32_t>(n),
+                                       .content_size = static_cast<uint32_t>(m.content.size()),
+                                       .name = static_cast<uint32_t>(names.size()),
+                                       .name_size = static_cast<uint32_t>(m.name.size())});
+    buffer.append(frame.data(), n);
+    names.append(m.name);
+  }
+  buffer.resize((buffer.size() + 7) / 8 * 8, '\0');
+  h.records = buffer.size();
+  buffer.append(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(bundle_record));
+  h.names = buffer.size();
+  h.names_size = names.size();
+  buffer.append(reinterpret_cast<const char *>(names.data()), names.size() * sizeof(wchar_t));
+  memcpy(buffer.data(), &h, sizeof(h));
+  return bela::io::AtomicWriteText(file.native(), bela::io::as_bytes<char>(buffer), ec);
+}
+
+Reader::~Reader() { ZSTD_freeDDict(ddict); }
+
+bool Reader::Open(const std::filesystem::path &file, bela::error_code &ec) {
+  if (!mf.Open(file, ec)) {
+    return false;
+  }
+  auto bytes = mf.Bytes();
+  if (bytes.size() < sizeof(bundle_header)) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"bundle too short");
+    return false;
+  }
+  const auto *h = reinterpret_cast<const bundle_header *>(bytes.data());
+  if (h->magic != bundle_magic || h->version != bundle_version) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"bundle format ", h->version, L" not supported");
+    return false;
+  }
+  if (h->records % 8 != 0 || h->names % 2 != 0 || h->dictionary + h->dictionary_size > h->records ||
+      h->records + static_cast<uint64_t>(h->count) * sizeof(bundle_record) > h->names ||
+      h->names + h->names_size * sizeof(wchar_t) > bytes.size()) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"bundle damaged");
+    return false;
+  }
+  records = {reinterpret_cast<const bundle_record *>(bytes.data() + h->records), h->count};
+  names = {reinterpret_cast<const wchar_t *>(bytes.data() + h->names), static_cast<size_t>(h->names_size)};
+  for (const auto &r : records) {
+    if (r.offset + r.size > h->records || static_cast<uint64_t>(r.name) + r.name_size > names.size()) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"bundle damaged");
+      return false;
+    }
+    // Read allocates content_size bytes: it must be the size the frame declares and a manifest size
+    if (r.content_size > max_content_size ||
+        ZSTD_getFrameContentSize(bytes.data() + r.offset, r.size) != static_cast<unsigned long long>(r.content_size)) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"bundle ", names.substr(r.name, r.name_size),
+                                 L": bad content size ", r.content_size);
+      return false;
+    }
+  }
+  if (h->dictionary_size != 0 &&
+      (ddict = ZSTD_createDDict(bytes.data() + h->dictionary, h->dictionary_size)) == nullptr) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"bundle dictionary damaged");
+    return false;
+  }
+  return true;
+}
+
+std::optional<size_t> Reader::Find(std::wstring_view pkgName) const {
+  size_t lo = 0;
+  size_t hi = records.size();
+  while (lo < hi) {
+    auto mid = lo + (hi - lo) / 2;
+    auto c = compare_name(Name(mid), pkgName);
+    if (c == 0) {
+      return std::make_optional(mid);
+    }
+    if (c < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return std::nullopt;
+}
+
+bool Reader::Read(size_t i, std::string &content, bela::error_code &ec) const {
+  thread_local std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> dctx(ZSTD_createDCtx(), ZSTD_freeDCtx);
+  const auto &r = records[i];
+  const auto *frame = mf.Bytes().data() + r.offset;
+  content.resize(r.content_size);
+  auto n = ddict ? ZSTD_decompress_usingDDict(dctx.get(), content.data(), content.size(), frame, r.size, ddict)
+                 : ZSTD_decompressDCtx(dctx.get(), content.data(), content.size(), frame, r.size);
+  if (ZSTD_isError(n) || n != r.content_size) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"bundle ", Name(i), L": ",
+                               ZSTD_isError(n) ? ZSTD_getErrorName(n) : "size mismatch");
+    return false;
+  }
+  return true;
+}
+} // namespace baulk::bundle
@@ -178,6 +178,8 @@ file_format_t analyze_format_internal(bela::bytes_view bv) {
   return file_format_t::none;
 }
 
+file_format_t AnalyzeFormat(bela::bytes_view bv) { return analyze_format_internal(bv); }
+
 constexpr size_t magic_size = 1024;
 
 bool CheckFormat(bela::io::FD &fd, file_format_t &afmt, int64_t &offset, bela::error_code &ec) {
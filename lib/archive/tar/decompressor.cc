@@ -13,29 +13,33 @@ std::shared_ptr<ExtractReader> MakeReader(FileReader &fd, int64_t offset, file_f
   if (!fd.Seek(offset, ec)) {
     return nullptr;
   }
+  return MakeReader(&fd, afmt, ec);
+}
+
+std::shared_ptr<ExtractReader> MakeReader(ExtractReader *src, file_format_t afmt, bela::error_code &ec) {
   switch (afmt) {
   case file_format_t::gz:
-    if (auto r = std::make_shared<gzip::Reader>(&fd); r->Initialize(ec)) {
+    if (auto r = std::make_shared<gzip::Reader>(src); r->Initialize(ec)) {
       return r;
     }
     break;
   case file_format_t::bz2:
-    if (auto r = std::make_shared<bzip::Reader>(&fd); r->Initialize(ec)) {
+    if (auto r = std::make_shared<bzip::Reader>(src); r->Initialize(ec)) {
       return r;
     }
     break;
   case file_format_t::zstd:
-    if (auto r = std::make_shared<zstd::Reader>(&fd); r->Initialize(ec)) {
+    if (auto r = std::make_shared<zstd::Reader>(src); r->Initialize(ec)) {
       return r;
     }
     break;
   case file_format_t::xz:
-    if (auto r = std::make_shared<xz::Reader>(&fd); r->Initialize(ec)) {
+    if (auto r = std::make_shared<xz::Reader>(src); r->Initialize(ec)) {
       return r;
     }
     break;
   case file_format_t::brotli:
-    if (auto r = std::make_shared<brotli::Reader>(&fd); r->Initialize(ec)) {
+    if (auto r = std::make_shared<brotli::Reader>(src); r->Initialize(ec)) {
       return r;
     }
     break;
@@ -0,0 +1,241 @@
+//
+#include <bela/ascii.hpp>
+#include <bela/match.hpp>
+#include <bela/semver.hpp>
+#include <bela/str_join.hpp>
+#include <baulk/depends.hpp>
+#include <algorithm>
+
+namespace baulk::depends {
+bool requirement::Satisfied(std::wstring_view v) const {
+  bela::version have(v);
+  bela::version want(version);
+  switch (op) {
+  case relation::eq:
+    return have == want;
+  case relation::ne:
+    return have != want;
+  case relation::lt:
+    return have < want;
+  case relation::le:
+    return have <= want;
+  case relation::gt:
+    return have > want;
+  case relation::ge:
+    return have >= want;
+  default:
+    break;
+  }
+  return true;
+}
+
+std::wstring requirement::String() const {
+  constexpr std::wstring_view ops[] = {L"", L"=", L"!=", L"<", L"<=", L">", L">="};
+  auto s = bucket.empty() ? name : bela::StringCat(bucket, L"/", name);
+  if (op != relation::any) {
+    bela::StrAppend(&s, ops[static_cast<int>(op)], version);
+  }
+  return s;
+}
+
+bool ParseRequirement(std::wstring_view spec, requirement &r, bela::error_code &ec) {
+  auto s = bela::StripAsciiWhitespace(spec);
+  auto pos = s.find_first_of(L"=!<>");
+  auto name = bela::StripAsciiWhitespace(s.substr(0, pos));
+  r = requirement{};
+  if (pos != std::wstring_view::npos) {
+    auto rest = s.substr(pos);
+    constexpr std::pair<std::wstring_view, relation> relations[] = {
+        {L">=", relation::ge}, {L"<=", relation::le}, {L"!=", relation::ne}, {L"==", relation::eq},
+        {L">", relation::gt},  {L"<", relation::lt},  {L"=", relation::eq}};
+    for (const auto &[op, rel] : relations) {
+      if (bela::StartsWith(rest, op)) {
+        r.op = rel;
+        r.version = bela::StripAsciiWhitespace(rest.substr(op.size()));
+        break;
+      }
+    }
+    if (r.op == relation::any || r.version.empty()) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"bad requirement '", spec, L"'");
+      return false;
+    }
+  }
+  if (auto slash = name.find('/'); slash != std::wstring_view::npos) {
+    r.bucket = name.substr(0, slash);
+    name.remove_prefix(slash + 1);
+  }
+  if (name.empty() || name.find_first_of(L"/\\ ") != std::wstring_view::npos) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"bad requirement '", spec, L"'");
+    return false;
+  }
+  r.name = name;
+  return true;
+}
+
+bool Resolver::Add(std::wstring_view spec, bela::error_code &ec) {
+  requirement r;
+  if (!ParseRequirement(spec, r, ec)) {
+    return false;
+  }
+  // a package whose prerequisites cannot be resolved leaves nothing behind
+  auto savedNodes = nodes;
+  auto savedConstraints = constraints;
+  if (!require(r, L"", true, ec)) {
+    nodes = std::move(savedNodes);
+    constraints = std::move(savedConstraints);
+    return false;
+  }
+  return true;
+}
+
+std::optional<waves_t> Resolver::Resolve(bela::error_code &ec) {
+  if (!check_constraints(ec)) {
+    return std::nullopt;
+  }
+  // Kahn: a wave is every node whose prerequisites were all placed in earlier waves
+  bela::flat_hash_map<std::wstring, size_t> pending;
+  bela::flat_hash_map<std::wstring, std::vector<std::wstring>> dependents;
+  for (auto &[key, n] : nodes) {
+    n.edges.clear();
+    std::copy_if(n.deps.begin(), n.deps.end(), std::back_inserter(n.edges),
+                 [&](const std::wstring &d) { return nodes.contains(d); });
+    pending[key] += 0;
+    for (const auto &d : n.edges) {
+      pending[key]++;
+      dependents[d].emplace_back(key);
+    }
+  }
+  waves_t waves;
+  std::vector<std::wstring> ready;
+  for (const auto &[key, count] : pending) {
+    if (count == 0) {
+      ready.emplace_back(key);
+    }
+  }
+  size_t placed = 0;
+  while (!ready.empty()) {
+    std::sort(ready.begin(), ready.end());
+    auto &wave = waves.emplace_back();
+    std::vector<std::wstring> next;
+    for (const auto &key : ready) {
+      wave.emplace_back(nodes.at(key).pkg);
+      placed++;
+      if (auto it = dependents.find(key); it != dependents.end()) {
+        for (const auto &d : it->second) {
+          if (--pending[d] == 0) {
+            next.emplace_back(d);
+          }
+        }
+      }
+    }
+    ready = std::move(next);
+  }
+  if (placed != nodes.size()) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"dependency cycle: ", find_cycle(pending));
+    return std::nullopt;
+  }
+  return std::make_optional(std::move(waves));
+}
+
+bool Resolver::require(const requirement &r, std::wstring_view by, bool requested, bela::error_code &ec) {
+  auto key = bela::AsciiStrToLower(r.name);
+  constraints[key].emplace_back(constraint{.r = r, .by = std::wstring(by)});
+  if (nodes.contains(key)) {
+    return true; // checked against every constraint once the graph is complete
+  }
+  if (!requested) {
+    if (auto version = installed(r.name); version && r.Satisfied(*version)) {
+      return true;
+    }
+  }
+  auto pkg = lookup(r, ec);
+  if (!pkg) {
+    if (!by.empty()) {
+      ec = bela::make_error_code(ec.code, L"'", by, L"' requires ", r.String(), L": ", ec.message);
+    }
+    return false;
+  }
+  auto pkgName = pkg->name;
+  auto pkgDepends = pkg->depends;
+  nodes[key].pkg = std::move(*pkg);
+  std::vector<std::wstring> deps;
+  for (const auto &spec : pkgDepends) {
+    requirement d;
+    if (!ParseRequirement(spec, d, ec)) {
+      ec = bela::make_error_code(ec.code, L"'", pkgName, L"': ", ec.message);
+      return false;
+    }
+    if (!require(d, pkgName, false, ec)) {
+      return false;
+    }
+    deps.emplace_back(bela::AsciiStrToLower(d.name));
+  }
+  nodes[key].deps = std::move(deps); // require rehashes nodes, references do not survive it
+  return true;
+}
+
+bool Resolver::check_constraints(bela::error_code &ec) {
+  for (const auto &[key, cs] : constraints) {
+    std::wstring version;
+    std::wstring_view what = L"installed";
+    std::wstring_view bucket; // the bucket the package is installed from by this resolution
+    if (auto it = nodes.find(key); it != nodes.end()) {
+      version = it->second.pkg.version;
+      what = bucket = it->second.pkg.bucket;
+    } else if (auto v = installed(cs.front().r.name); v) {
+      version = std::move(*v);
+    } else {
+      continue;
+    }
+    auto requiredBy = [&] {
+      std::vector<std::wstring> by;
+      for (const auto &o : cs) {
+        by.emplace_back(bela::StringCat(o.by.empty() ? L"requested" : o.by, L": ", o.r.String()));
+      }
+      return bela::StrJoin(by, L", ");
+    };
+    for (const auto &c : cs) {
+      // 'main/git' and 'extras/git' are different packages, only one of them can be installed as 'git'
+      if (!bucket.empty() && !c.r.bucket.empty() && !bela::EqualsIgnoreCase(c.r.bucket, bucket)) {
+        ec = bela::make_error_code(bela::ErrGeneral, L"'", c.r.name, L"' from ", bucket, L" conflicts with ",
+                                   c.r.String(), L" [", requiredBy(), L"]");
+        return false;
+      }
+      if (c.r.Satisfied(version)) {
+        continue;
+      }
+      ec = bela::make_error_code(bela::ErrGeneral, L"'", c.r.name, L"' ", version, L" (", what,
+                                 L") does not satisfy ", c.r.String(), L" [", requiredBy(), L"]");
+      return false;
+    }
+  }
+  return true;
+}
+
+std::wstring Resolver::find_cycle(const bela::flat_hash_map<std::wstring, size_t> &pending) const {
+  std::vector<std::wstring> stack;
+  for (const auto &[key, count] : pending) {
+    if (count != 0) {
+      stack.emplace_back(key);
+      break;
+    }
+  }
+  while (!stack.empty()) {
+    const auto &n = nodes.at(stack.back());
+    auto it = std::find_if(n.edges.begin(), n.edges.end(), [&](const std::wstring &e) { return pending.at(e) != 0; });
+    if (it == n.edges.end()) {
+      break;
+    }
+    if (auto loop = std::find(stack.begin(), stack.end(), *it); loop != stack.end()) {
+      std::vector<std::wstring_view> names;
+      for (auto i = loop; i != stack.end(); i++) {
+        names.emplace_back(nodes.at(*i).pkg.name);
+      }
+      names.emplace_back(nodes.at(*it).pkg.name);
+      return bela::StrJoin(names, L" -> ");
+    }
+    stack.emplace_back(*it);
+  }
+  return L"unknown";
+}
+} // namespace baulk::depends
@@ -4,6 +4,10 @@
 #include <bela/ascii.hpp>
 #include <baulk/fs.hpp>
 #include <bela/terminal.hpp>
+#include <algorithm>
+#include <limits>
+#include <chrono>
+#include <thread>
 
 namespace baulk::fs {
 
@@ -116,6 +120,42 @@ bool MakeFlattened(const std::filesystem::path &d, bela::error_code &ec) {
   return true;
 }
 
+bool MakeStripped(const std::filesystem::path &d, bela::error_code &ec) {
+  std::error_code e;
+  std::filesystem::path top;
+  size_t entries = 0;
+  for (const auto &entry : std::filesystem::directory_iterator{d, e}) {
+    entries++;
+    top = entry.path();
+  }
+  if (e) {
+    ec = bela::make_error_code_from_std(e, L"read folder error: ");
+    return false;
+  }
+  if (entries == 0) {
+    return true;
+  }
+  if (entries != 1 || !std::filesystem::is_directory(top, e)) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"'", d.native(), L"' has no single top-level folder");
+    return false;
+  }
+  auto filename = bela::StringCat(d.filename().c_str(), L".", GetCurrentProcessId(), L".new");
+  auto newPath = d.parent_path() / filename;
+  if (std::filesystem::rename(top, newPath, e); e) {
+    ec = bela::make_error_code_from_std(e, L"move top-level folder error: ");
+    return false;
+  }
+  if (std::filesystem::remove_all(d, e); e) {
+    ec = bela::make_error_code_from_std(e, L"remove empty folder error: ");
+    return false;
+  }
+  if (std::filesystem::rename(newPath, d, e); e) {
+    ec = bela::make_error_code_from_std(e, L"move top-level folder error: ");
+    return false;
+  }
+  return true;
+}
+
 std::optional<std::filesystem::path> NewTempFolder(bela::error_code &ec) {
   std::error_code e;
   auto temp = std::filesystem::temp_directory_path(e);
@@ -136,4 +176,121 @@ std::optional<std::filesystem::path> NewTempFolder(bela::error_code &ec) {
   return std::nullopt;
 }
 
+constexpr int replace_attempts = 20;
+constexpr auto replace_backoff = std::chrono::milliseconds(25);
+
+bool ReplaceContent(std::wstring_view path, std::string_view content, bela::error_code &ec) {
+  auto newfile = bela::StringCat(path, L".", GetCurrentProcessId(), L".new");
+  auto fd = CreateFileW(newfile.data(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (fd == INVALID_HANDLE_VALUE) {
+    ec = bela::make_system_error_code(L"CreateFileW() ");
+    return false;
+  }
+  DWORD written = 0;
+  auto flushed = (content.empty() || (WriteFile(fd, content.data(), static_cast<DWORD>(content.size()), &written,
+                                                nullptr) == TRUE &&
+                                      written == content.size())) &&
+                 FlushFileBuffers(fd) == TRUE;
+  if (!flushed) {
+    ec = bela::make_system_error_code(L"WriteFile() ");
+  }
+  CloseHandle(fd);
+  if (!flushed) {
+    DeleteFileW(newfile.data());
+    return false;
+  }
+  auto target = std::wstring(path);
+  for (int i = 0;; i++) {
+    if (MoveFileExW(newfile.data(), target.data(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) == TRUE) {
+      return true;
+    }
+    auto e = GetLastError();
+    if ((e != ERROR_ACCESS_DENIED && e != ERROR_SHARING_VIOLATION) || i + 1 >= replace_attempts) {
+      ec = bela::make_system_error_code(L"MoveFileExW() ");
+      DeleteFileW(newfile.data());
+      return false;
+    }
+    std::this_thread::sleep_for(replace_backoff);
+  }
+}
+
+bool ReadShared(std::wstring_view path, std::string &content, bela::error_code &ec, uint64_t maxsize) {
+  auto file = std::wstring(path);
+  auto fd = CreateFileW(file.data(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (fd == INVALID_HANDLE_VALUE) {
+    ec = bela::make_system_error_code(L"CreateFileW() ");
+    return false;
+  }
+  auto closer = bela::finally([&] { CloseHandle(fd); });
+  LARGE_INTEGER li;
+  if (GetFileSizeEx(fd, &li) != TRUE) {
+    ec = bela::make_system_error_code(L"GetFileSizeEx() ");
+    return false;
+  }
+  if (static_cast<uint64_t>(li.QuadPart) > maxsize) {
+    ec = bela::make_error_code(bela::ErrGeneral, path, L" is too large, size: ", li.QuadPart);
+    return false;
+  }
+  content.resize(static_cast<size_t>(li.QuadPart));
+  size_t total = 0;
+  while (total < content.size()) {
+    DWORD n = 0;
+    if (::ReadFile(fd, content.data() + total, static_cast<DWORD>((std::min)(content.size() - total, size_t{1} << 30)),
+                   &n, nullptr) != TRUE) {
+      ec = bela::make_system_error_code(L"ReadFile() ");
+      return false;
+    }
+    if (n == 0) {
+      break; // truncated while read
+    }
+    total += n;
+  }
+  content.resize(total);
+  return true;
+}
+
+bool MappedFile::Open(const std::filesystem::path &file, bela::error_code &ec) {
+  Close();
+  auto fd = CreateFileW(file.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (fd == INVALID_HANDLE_VALUE) {
+    ec = bela::make_system_error_code(L"CreateFileW() ");
+    return false;
+  }
+  auto closer = bela::finally([&] { CloseHandle(fd); });
+  LARGE_INTEGER li;
+  if (GetFileSizeEx(fd, &li) != TRUE) {
+    ec = bela::make_system_error_code(L"GetFileSizeEx() ");
+    return false;
+  }
+  if (li.QuadPart == 0 || static_cast<uint64_t>(li.QuadPart) > (std::numeric_limits<size_t>::max)()) {
+    ec = bela::make_error_code(bela::ErrGeneral, file.native(), L" cannot be mapped, size: ", li.QuadPart);
+    return false;
+  }
+  // the mapping keeps the file open, the handles are not needed once the view exists
+  auto fm = CreateFileMappingW(fd, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (fm == nullptr) {
+    ec = bela::make_system_error_code(L"CreateFileMappingW() ");
+    return false;
+  }
+  auto view = MapViewOfFile(fm, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(fm);
+  if (view == nullptr) {
+    ec = bela::make_system_error_code(L"MapViewOfFile() ");
+    return false;
+  }
+  data = static_cast<const uint8_t *>(view);
+  size = static_cast<size_t>(li.QuadPart);
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data != nullptr) {
+    UnmapViewOfFile(data);
+  }
+  data = nullptr;
+  size = 0;
+}
+
 } // namespace baulk::fs
\ No newline at end of file
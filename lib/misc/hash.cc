@@ -5,97 +5,84 @@
 #include <bela/hash.hpp>
 #include <bela/ascii.hpp>
 #include <baulk/hash.hpp>
+#include <algorithm>
 
 namespace baulk::hash {
 
-template <typename Hasher> struct Sumizer {
+namespace {
+struct hasher_base {
+  virtual ~hasher_base() = default;
+  virtual void Update(const void *data, size_t len) = 0;
+  virtual std::wstring Finalize() = 0;
+};
+
+template <typename Hasher> struct hasher_impl final : hasher_base {
   Hasher hasher;
-  bool filechecksum(const std::filesystem::path &file, std::wstring &hv, bela::error_code &ec) {
-    HANDLE FileHandle = CreateFileW(file.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
-                                    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
-    if (FileHandle == INVALID_HANDLE_VALUE) {
-      ec = bela::make_system_error_code();
-      return false;
-    }
-    auto closer = bela::finally([&] { CloseHandle(FileHandle); });
-    uint8_t bytes[32678];
-    for (;;) {
-      DWORD dwread = 0;
-      if (ReadFile(FileHandle, bytes, sizeof(bytes), &dwread, nullptr) != TRUE) {
-        ec = bela::make_system_error_code();
-        return false;
-      }
-      hasher.Update(bytes, static_cast<size_t>(dwread));
-      if (dwread < sizeof(bytes)) {
-        break;
-      }
-    }
-    hv = hasher.Finalize();
-    return true;
-  }
-  std::optional<std::wstring> operator()(const std::filesystem::path &file, bela::error_code &ec) {
-    std::wstring hv;
-    if (filechecksum(file, hv, ec)) {
-      return std::make_optional(std::move(hv));
-    }
-    return std::nullopt;
-  }
+  void Update(const void *data, size_t len) override { hasher.Update(data, len); }
+  std::wstring Finalize() override { return hasher.Finalize(); }
 };
 
-std::optional<std::wstring> FileHash(const std::filesystem::path &file, hash_t method, bela::error_code &ec) {
+template <typename Hasher, typename... Args> std::unique_ptr<hasher_base> make_hasher_impl(Args... args) {
+  auto h = std::make_unique<hasher_impl<Hasher>>();
+  h->hasher.Initialize(args...);
+  return h;
+}
+
+std::unique_ptr<hasher_base> make_hasher(hash_t method, bela::error_code &ec) {
   switch (method) {
-  case hash_t::SHA224: {
-    Sumizer<bela::hash::sha256::Hasher> sumizer;
-    sumizer.hasher.Initialize(bela::hash::sha256::HashBits::SHA224);
-    return sumizer(file, ec);
-  }
-  case hash_t::SHA256: {
-    Sumizer<bela::hash::sha256::Hasher> sumizer;
-    sumizer.hasher.Initialize();
-    return sumizer(file, ec);
-  }
-  case hash_t::SHA384: {
-    Sumizer<bela::hash::sha512::Hasher> sumizer;
-    sumizer.hasher.Initialize(bela::hash::sha512::HashBits::SHA384);
-    return sumizer(file, ec);
-  }
-  case hash_t::SHA512: {
-    Sumizer<bela::hash::sha512::Hasher> sumizer;
-    sumizer.hasher.Initialize();
-    return sumizer(file, ec);
-  }
-  case hash_t::SHA3_224: {
-    Sumizer<bela::hash::sha3::Hasher> sumizer;
-    sumizer.hasher.Initialize(bela::hash::sha3::HashBits::SHA3224);
-    return sumizer(file, ec);
-  }
+  case hash_t::SHA224:
+    return make_hasher_impl<bela::hash::sha256::Hasher>(bela::hash::sha256::HashBits::SHA224);
+  case hash_t::SHA256:
+    return make_hasher_impl<bela::hash::sha256::Hasher>();
+  case hash_t::SHA384:
+    return make_hasher_impl<bela::hash::sha512::Hasher>(bela::hash::sha512::HashBits::SHA384);
+  case hash_t::SHA512:
+    return make_hasher_impl<bela::hash::sha512::Hasher>();
+  case hash_t::SHA3_224:
+    return make_hasher_impl<bela::hash::sha3::Hasher>(bela::hash::sha3::HashBits::SHA3224);
   case hash_t::SHA3_256:
     [[fallthrough]];
-  case hash_t::SHA3: {
-    Sumizer<bela::hash::sha3::Hasher> sumizer;
-    sumizer.hasher.Initialize();
-    return sumizer(file, ec);
-  }
-  case hash_t::SHA3_384: {
-    Sumizer<bela::hash::sha3::Hasher> sumizer;
-    sumizer.hasher.Initialize(bela::hash::sha3::HashBits::SHA3384);
-    return sumizer(file, ec);
-  }
-  case hash_t::SHA3_512: {
-    Sumizer<bela::hash::sha3::Hasher> sumizer;
-    sumizer.hasher.Initialize(bela::hash::sha3::HashBits::SHA3512);
-    return sumizer(file, ec);
-  }
-  case hash_t::BLAKE3: {
-    Sumizer<bela::hash::blake3::Hasher> sumizer;
-    sumizer.hasher.Initialize();
-    return sumizer(file, ec);
-  }
+  case hash_t::SHA3:
+    return make_hasher_impl<bela::hash::sha3::Hasher>();
+  case hash_t::SHA3_384:
+    return make_hasher_impl<bela::hash::sha3::Hasher>(bela::hash::sha3::HashBits::SHA3384);
+  case hash_t::SHA3_512:
+    return make_hasher_impl<bela::hash::sha3::Hasher>(bela::hash::sha3::HashBits::SHA3512);
+  case hash_t::BLAKE3:
+    return make_hasher_impl<bela::hash::blake3::Hasher>();
   default:
     break;
   }
   ec = bela::make_error_code(bela::ErrGeneral, L"unkown hash method: ", static_cast<int>(method));
-  return std::nullopt;
+  return nullptr;
+}
+} // namespace
+
+std::optional<std::wstring> FileHash(const std::filesystem::path &file, hash_t method, bela::error_code &ec) {
+  auto hasher = make_hasher(method, ec);
+  if (!hasher) {
+    return std::nullopt;
+  }
+  HANDLE FileHandle = CreateFileW(file.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (FileHandle == INVALID_HANDLE_VALUE) {
+    ec = bela::make_system_error_code();
+    return std::nullopt;
+  }
+  auto closer = bela::finally([&] { CloseHandle(FileHandle); });
+  uint8_t bytes[32678];
+  for (;;) {
+    DWORD dwread = 0;
+    if (ReadFile(FileHandle, bytes, sizeof(bytes), &dwread, nullptr) != TRUE) {
+      ec = bela::make_system_error_code();
+      return std::nullopt;
+    }
+    hasher->Update(bytes, static_cast<size_t>(dwread));
+    if (dwread < sizeof(bytes)) {
+      break;
+    }
+  }
+  return std::make_optional(hasher->Finalize());
 }
 
 struct HashPrefix {
@@ -114,37 +101,94 @@ constexpr HashPrefix hnmaps[] = {
     {L"SHA3-512", hash_t::SHA3_512}, // SHA3-512
     {L"SHA3", hash_t::SHA3},         // SHA3 alias for SHA3-256
 };
-bool HashEqual(const std::filesystem::path &file, std::wstring_view hash_value, bela::error_code &ec) {
-  std::wstring_view value = hash_value;
-  auto m = hash_t::SHA256;
+namespace {
+// parse_hash_value splits 'METHOD:value', a value without a method prefix is SHA256
+bool parse_hash_value(std::wstring_view hash_value, hash_t &m, std::wstring_view &value, bela::error_code &ec) {
+  value = hash_value;
+  m = hash_t::SHA256;
   if (auto pos = hash_value.find(':'); pos != std::wstring_view::npos) {
     value = hash_value.substr(pos + 1);
     auto prefix = bela::AsciiStrToUpper(hash_value.substr(0, pos));
-    auto fn = [&]() {
-      for (const auto &h : hnmaps) {
-        if (h.prefix == prefix) {
-          m = h.method;
-          return true;
-        }
+    for (const auto &h : hnmaps) {
+      if (h.prefix == prefix) {
+        m = h.method;
+        return true;
       }
-      return false;
-    };
-    if (!fn()) {
-      ec = bela::make_error_code(bela::ErrGeneral, L"unsupported hash method '", prefix, L"'");
-      return false;
     }
+    ec = bela::make_error_code(bela::ErrGeneral, L"unsupported hash method '", prefix, L"'");
+    return false;
+  }
+  return true;
+}
+
+bool hash_value_equal(std::wstring_view actual, std::wstring_view value, bela::error_code &ec) {
+  if (!bela::EndsWithIgnoreCase(actual, value)) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"checksum mismatch expected ", value, L" actual ", actual);
+    return false;
+  }
+  return true;
+}
+} // namespace
+
+bool HashEqual(const std::filesystem::path &file, std::wstring_view hash_value, bela::error_code &ec) {
+  auto m = hash_t::SHA256;
+  std::wstring_view value;
+  if (!parse_hash_value(hash_value, m, value, ec)) {
+    return false;
   }
   auto ha = FileHash(file, m, ec);
   if (!ha) {
     return false;
   }
-  if (!bela::EndsWithIgnoreCase(*ha, value)) {
-    ec = bela::make_error_code(bela::ErrGeneral, L"checksum mismatch expected ", value, L" actual ", *ha);
+  return hash_value_equal(*ha, value, ec);
+}
+
+std::optional<std::wstring> HashKey(std::wstring_view hash_value, bela::error_code &ec) {
+  auto m = hash_t::SHA256;
+  std::wstring_view value;
+  if (!parse_hash_value(hash_value, m, value, ec)) {
+    return std::nullopt;
+  }
+  value = bela::StripAsciiWhitespace(value);
+  if (value.empty() || !std::all_of(value.begin(), value.end(), [](wchar_t c) { return bela::ascii_isxdigit(c); })) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"hash value '", value, L"' is not hexadecimal");
+    return std::nullopt;
+  }
+  for (const auto &h : hnmaps) {
+    if (h.method == m) {
+      return std::make_optional(bela::StringCat(bela::AsciiStrToLower(h.prefix), L"-", bela::AsciiStrToLower(value)));
+    }
+  }
+  ec = bela::make_error_code(bela::ErrGeneral, L"unkown hash method: ", static_cast<int>(m));
+  return std::nullopt;
+}
+
+struct Verifier::state {
+  std::unique_ptr<hasher_base> hasher;
+  std::wstring value;
+};
+
+Verifier::Verifier() = default;
+Verifier::~Verifier() = default;
+
+bool Verifier::Initialize(std::wstring_view hash_value, bela::error_code &ec) {
+  auto m = hash_t::SHA256;
+  std::wstring_view value;
+  if (!parse_hash_value(hash_value, m, value, ec)) {
+    return false;
+  }
+  auto hasher = make_hasher(m, ec);
+  if (!hasher) {
     return false;
   }
+  st = std::make_unique<state>(state{.hasher = std::move(hasher), .value = std::wstring(value)});
   return true;
 }
 
+void Verifier::Update(const void *data, size_t len) { st->hasher->Update(data, len); }
+
+bool Verifier::Equal(bela::error_code &ec) { return hash_value_equal(st->hasher->Finalize(), st->value, ec); }
+
 std::optional<file_hash_sums> HashSums(const std::filesystem::path &file, bela::error_code &ec) {
   HANDLE FileHandle = CreateFileW(file.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
                                   OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
@@ -152,7 +152,8 @@ bool ProgressBar::Execute() {
   return true;
 }
 void ProgressBar::Finish() {
-  if (state == ProgressState::Uninitialized) {
+  // MarkFault/MarkCompleted change the state of a bar that never ran
+  if (!worker) {
     return;
   }
   {
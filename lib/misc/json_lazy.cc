@@ -0,0 +1,362 @@
+// lazy JSON view over the text of a manifest
+#include <bela/path.hpp>
+#include <baulk/json_lazy.hpp>
+
+namespace baulk {
+namespace json_internal {
+constexpr size_t npos = std::string_view::npos;
+constexpr int max_depth = 256;
+
+// skip_space skips white space and comments, npos when a comment is not closed
+size_t skip_space(std::string_view text, size_t pos) {
+  while (pos < text.size()) {
+    auto c = text[pos];
+    if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+      pos++;
+      continue;
+    }
+    if (c != '/' || pos + 1 >= text.size()) {
+      return pos;
+    }
+    if (text[pos + 1] == '/') {
+      auto end = text.find('\n', pos + 2);
+      pos = end == npos ? text.size() : end + 1;
+      continue;
+    }
+    if (text[pos + 1] != '*') {
+      return pos;
+    }
+    auto end = text.find("*/", pos + 2);
+    if (end == npos) {
+      return npos;
+    }
+    pos = end + 2;
+  }
+  return pos;
+}
+
+// skip_string returns the position after the string starting at pos, escaped tells whether it has escapes
+size_t skip_string(std::string_view text, size_t pos, bool &escaped) {
+  for (pos++; pos < text.size(); pos++) {
+    auto c = text[pos];
+    if (c == '"') {
+      return pos + 1;
+    }
+    if (c == '\\') {
+      escaped = true;
+      pos++;
+      continue;
+    }
+    if (static_cast<unsigned char>(c) < 0x20) {
+      return npos;
+    }
+  }
+  return npos;
+}
+
+constexpr bool is_literal_char(char c) {
+  return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '-' || c == '+' ||
+         c == '.';
+}
+
+size_t skip_value(std::string_view text, size_t pos, int depth);
+
+size_t skip_container(std::string_view text, size_t pos, int depth) {
+  if (depth > max_depth) {
+    return npos;
+  }
+  auto object = text[pos] == '{';
+  auto close = object ? '}' : ']';
+  pos = skip_space(text, pos + 1);
+  if (pos < text.size() && text[pos] == close) {
+    return pos + 1;
+  }
+  for (;;) {
+    if (pos >= text.size()) {
+      return npos;
+    }
+    if (object) {
+      bool escaped = false;
+      if (text[pos] != '"' || (pos = skip_space(text, skip_string(text, pos, escaped))) >= text.size() ||
+          text[pos] != ':') {
+        return npos;
+      }
+      pos = skip_space(text, pos + 1);
+    }
+    if ((pos = skip_space(text, skip_value(text, pos, depth + 1))) >= text.size()) {
+      return npos;
+    }
+    if (text[pos] == close) {
+      return pos + 1;
+    }
+    if (text[pos] != ',') {
+      return npos;
+    }
+    pos = skip_space(text, pos + 1);
+  }
+}
+
+// skip_value returns the position after the value starting at pos, npos when the value is malformed
+size_t skip_value(std::string_view text, size_t pos, int depth) {
+  if (pos >= text.size()) {
+    return npos;
+  }
+  switch (auto c = text[pos]; c) {
+  case '"': {
+    bool escaped = false;
+    return skip_string(text, pos, escaped);
+  }
+  case '{':
+    [[fallthrough]];
+  case '[':
+    return skip_container(text, pos, depth);
+  default:
+    break;
+  }
+  auto start = pos;
+  while (pos < text.size() && is_literal_char(text[pos])) {
+    pos++;
+  }
+  auto literal = text.substr(start, pos - start);
+  if (literal.empty()) {
+    return npos;
+  }
+  if (literal == "true" || literal == "false" || literal == "null" || literal[0] == '-' ||
+      (literal[0] >= '0' && literal[0] <= '9')) {
+    return pos;
+  }
+  return npos;
+}
+
+void append_utf8(std::string &out, char32_t rune) {
+  if (rune < 0x80) {
+    out.push_back(static_cast<char>(rune));
+    return;
+  }
+  if (rune < 0x800) {
+    out.push_back(static_cast<char>(0xC0 | (rune >> 6)));
+  } else if (rune < 0x10000) {
+    out.push_back(static_cast<char>(0xE0 | (rune >> 12)));
+    out.push_back(static_cast<char>(0x80 | ((rune >> 6) & 0x3F)));
+  } else {
+    out.push_back(static_cast<char>(0xF0 | (rune >> 18)));
+    out.push_back(static_cast<char>(0x80 | ((rune >> 12) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | ((rune >> 6) & 0x3F)));
+  }
+  out.push_back(static_cast<char>(0x80 | (rune & 0x3F)));
+}
+
+bool parse_hex4(std::string_view raw, size_t pos, char32_t &v) {
+  if (pos + 4 > raw.size()) {
+    return false;
+  }
+  v = 0;
+  for (size_t i = pos; i < pos + 4; i++) {
+    auto c = raw[i];
+    v <<= 4;
+    if (c >= '0' && c <= '9') {
+      v |= static_cast<char32_t>(c - '0');
+    } else if (c >= 'a' && c <= 'f') {
+      v |= static_cast<char32_t>(c - 'a' + 10);
+    } else if (c >= 'A' && c <= 'F') {
+      v |= static_cast<char32_t>(c - 'A' + 10);
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+// unescape decodes the content of a string with escapes to UTF-8
+bool unescape(std::string_view raw, std::string &out) {
+  out.clear();
+  out.reserve(raw.size());
+  for (size_t i = 0; i < raw.size(); i++) {
+    if (raw[i] != '\\') {
+      out.push_back(raw[i]);
+      continue;
+    }
+    if (++i >= raw.size()) {
+      return false;
+    }
+    switch (raw[i]) {
+    case '"':
+    case '\\':
+    case '/':
+      out.push_back(raw[i]);
+      break;
+    case 'b':
+      out.push_back('\b');
+      break;
+    case 'f':
+      out.push_back('\f');
+      break;
+    case 'n':
+      out.push_back('\n');
+      break;
+    case 'r':
+      out.push_back('\r');
+      break;
+    case 't':
+      out.push_back('\t');
+      break;
+    case 'u': {
+      char32_t rune = 0;
+      if (!parse_hex4(raw, i + 1, rune)) {
+        return false;
+      }
+      i += 4;
+      if (rune >= 0xD800 && rune <= 0xDBFF) {
+        char32_t low = 0;
+        if (i + 2 >= raw.size() || raw[i + 1] != '\\' || raw[i + 2] != 'u' || !parse_hex4(raw, i + 3, low) ||
+            low < 0xDC00 || low > 0xDFFF) {
+          return false;
+        }
+        i += 6;
+        rune = 0x10000 + ((rune - 0xD800) << 10) + (low - 0xDC00);
+      } else if (rune >= 0xDC00 && rune <= 0xDFFF) {
+        return false;
+      }
+      append_utf8(out, rune);
+    } break;
+    default:
+      return false;
+    }
+  }
+  return true;
+}
+
+bool well_formed(std::string_view text) {
+  auto end = skip_value(text, skip_space(text, 0), 0);
+  return end <= text.size() && skip_space(text, end) == text.size();
+}
+} // namespace json_internal
+
+std::wstring lazy_json_view::fetch(const std::string_view key, std::wstring_view dv) const {
+  std::wstring s;
+  if (decode(find(key), s)) {
+    return s;
+  }
+  return std::wstring(dv);
+}
+
+bool lazy_json_view::fetch_as_boolean(std::string_view name, bool dv) const {
+  if (auto value = find(name); value == "true" || value == "false") {
+    return value == "true";
+  }
+  return dv;
+}
+
+std::optional<lazy_json_view> lazy_json_view::subview(std::string_view name) const {
+  auto value = find(name);
+  if (value.empty() || value.front() != '{') {
+    return std::nullopt;
+  }
+  return std::make_optional<lazy_json_view>(value);
+}
+
+std::vector<lazy_json_view> lazy_json_view::subviews(std::string_view name) const {
+  std::vector<lazy_json_view> jvs;
+  auto value = find(name);
+  if (value.empty()) {
+    return jvs;
+  }
+  if (value.front() == '{') {
+    jvs.emplace_back(value);
+    return jvs;
+  }
+  if (value.front() == '[') {
+    for (auto e : elements(value)) {
+      jvs.emplace_back(e);
+    }
+  }
+  return jvs;
+}
+
+std::string_view lazy_json_view::find(std::string_view key) const {
+  using namespace json_internal;
+  auto pos = skip_space(text, 0);
+  if (pos >= text.size() || text[pos] != '{') {
+    return {};
+  }
+  if ((pos = skip_space(text, pos + 1)) < text.size() && text[pos] == '}') {
+    return {};
+  }
+  std::string unescaped;
+  for (;;) {
+    if (pos >= text.size() || text[pos] != '"') {
+      return {};
+    }
+    bool escaped = false;
+    auto end = skip_string(text, pos, escaped);
+    if (end >= text.size()) {
+      return {};
+    }
+    auto name = text.substr(pos + 1, end - pos - 2);
+    if ((pos = skip_space(text, end)) >= text.size() || text[pos] != ':') {
+      return {};
+    }
+    pos = skip_space(text, pos + 1);
+    auto vend = skip_value(text, pos, 1);
+    if (vend > text.size()) {
+      return {};
+    }
+    if (escaped ? (unescape(name, unescaped) && unescaped == key) : name == key) {
+      return text.substr(pos, vend - pos);
+    }
+    if ((pos = skip_space(text, vend)) >= text.size() || text[pos] != ',') {
+      return {};
+    }
+    pos = skip_space(text, pos + 1);
+  }
+}
+
+std::vector<std::string_view> lazy_json_view::elements(std::string_view array) {
+  using namespace json_internal;
+  std::vector<std::string_view> es;
+  auto pos = skip_space(array, 1);
+  while (pos < array.size() && array[pos] != ']') {
+    auto end = skip_value(array, pos, 1);
+    if (end > array.size()) {
+      return es;
+    }
+    es.emplace_back(array.substr(pos, end - pos));
+    if ((pos = skip_space(array, end)) >= array.size() || array[pos] != ',') {
+      return es;
+    }
+    pos = skip_space(array, pos + 1);
+  }
+  return es;
+}
+
+std::optional<lazy_json_container> parse_json_file_lazy(const std::wstring_view file, bela::error_code &ec) {
+  lazy_json_container jc;
+  if (!jc.file.Open(std::filesystem::path(file), ec)) {
+    ec = bela::make_error_code(ec.code, L"open json file '", bela::BaseName(file), L"' ", ec.message);
+    return std::nullopt;
+  }
+  auto bytes = jc.file.Bytes();
+  jc.text = std::string_view(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+  if (jc.text.starts_with("\xEF\xBB\xBF")) {
+    jc.text.remove_prefix(3);
+  }
+  if (!json_internal::well_formed(jc.text)) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"parse json file '", bela::BaseName(file), L"' error: malformed");
+    return std::nullopt;
+  }
+  return std::make_optional(std::move(jc));
+}
+
+std::optional<lazy_json_container> parse_json_lazy(std::string &&text, std::wstring_view name, bela::error_code &ec) {
+  lazy_json_container jc;
+  jc.buffer = std::move(text);
+  if (jc.buffer.starts_with("\xEF\xBB\xBF")) {
+    jc.buffer.erase(0, 3);
+  }
+  if (!json_internal::well_formed(jc.buffer)) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"parse json '", name, L"' error: malformed");
+    return std::nullopt;
+  }
+  return std::make_optional(std::move(jc));
+}
+} // namespace baulk
@@ -0,0 +1,137 @@
+//
+#include <bela/path.hpp>
+#include <bela/pe.hpp>
+#include <bela/str_split.hpp>
+#include <baulk/linkindex.hpp>
+#include <baulk/linkmeta.hpp>
+#include <algorithm>
+#include <cstring>
+
+namespace baulk::linkindex {
+std::wstring IndexPath(std::wstring_view folder) { return bela::StringCat(folder, L"\\baulk.linkmeta.index"); }
+
+bool Identify(std::wstring_view file, identity &id, bela::error_code &ec) {
+  auto path = std::wstring(file);
+  auto fd = CreateFileW(path.data(), FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (fd == INVALID_HANDLE_VALUE) {
+    ec = bela::make_system_error_code(L"CreateFileW() ");
+    return false;
+  }
+  BY_HANDLE_FILE_INFORMATION fi;
+  auto ok = GetFileInformationByHandle(fd, &fi) == TRUE;
+  if (!ok) {
+    ec = bela::make_system_error_code(L"GetFileInformationByHandle() ");
+  }
+  CloseHandle(fd);
+  if (!ok) {
+    return false;
+  }
+  auto u64 = [](DWORD high, DWORD low) { return (static_cast<uint64_t>(high) << 32) | low; };
+  id.index = u64(fi.nFileIndexHigh, fi.nFileIndexLow);
+  id.size = u64(fi.nFileSizeHigh, fi.nFileSizeLow);
+  id.mtime = u64(fi.ftLastWriteTime.dwHighDateTime, fi.ftLastWriteTime.dwLowDateTime);
+  return true;
+}
+
+std::optional<Link> Resolve(std::wstring_view alias, std::wstring_view meta, std::wstring_view packagesRoot) {
+  std::vector<std::wstring_view> tv = bela::StrSplit(meta, bela::ByChar('@'), bela::SkipEmpty());
+  if (tv.size() < 2) {
+    return std::nullopt;
+  }
+  Link link{.alias = std::wstring(alias), .target = bela::StringCat(packagesRoot, L"\\", tv[0], L"\\", tv[1])};
+  bela::error_code ec;
+  if (auto realexe = bela::RealPathEx(link.target, ec); realexe) {
+    link.console = bela::pe::IsSubsystemConsole(*realexe);
+  }
+  return std::make_optional(std::move(link));
+}
+
+bool Write(std::vector<Link> &links, const identity &meta, std::wstring_view file, bela::error_code &ec) {
+  std::sort(links.begin(), links.end(), [](const Link &a, const Link &b) { return a.alias < b.alias; });
+  links.erase(std::unique(links.begin(), links.end(), [](const Link &a, const Link &b) { return a.alias == b.alias; }),
+              links.end());
+  index_header h{.magic = index_magic,
+                 .version = index_version,
+                 .count = static_cast<uint32_t>(links.size()),
+                 .meta_index = meta.index,
+                 .meta_size = meta.size,
+                 .meta_mtime = meta.mtime,
+                 .records = sizeof(index_header)};
+  std::vector<index_record> records;
+  std::wstring strings;
+  for (const auto &l : links) {
+    records.emplace_back(index_record{.alias = static_cast<uint32_t>(strings.size()),
+                                      .alias_size = static_cast<uint32_t>(l.alias.size()),
+                                      .target = static_cast<uint32_t>(strings.size() + l.alias.size()),
+                                      .target_size = static_cast<uint32_t>(l.target.size()),
+                                      .flags = l.console ? flag_console : 0});
+    strings.append(l.alias).append(l.target);
+  }
+  h.strings = h.records + records.size() * sizeof(index_record);
+  h.strings_size = strings.size();
+  std::string buffer(sizeof(index_header), '\0');
+  memcpy(buffer.data(), &h, sizeof(h));
+  buffer.append(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(index_record));
+  buffer.append(reinterpret_cast<const char *>(strings.data()), strings.size() * sizeof(wchar_t));
+  return fs::ReplaceContent(file, buffer, ec);
+}
+
+bool Reader::Open(std::wstring_view folder, bela::error_code &ec) {
+  if (!mf.Open(IndexPath(folder), ec)) {
+    return false;
+  }
+  auto bytes = mf.Bytes();
+  if (bytes.size() < sizeof(index_header)) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"link index too short");
+    return false;
+  }
+  const auto *h = reinterpret_cast<const index_header *>(bytes.data());
+  if (h->magic != index_magic || h->version != index_version) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"link index format ", h->version, L" not supported");
+    return false;
+  }
+  if (h->records % 8 != 0 || h->strings % 2 != 0 ||
+      h->records + static_cast<uint64_t>(h->count) * sizeof(index_record) > h->strings ||
+      h->strings + h->strings_size * sizeof(wchar_t) > bytes.size()) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"link index damaged");
+    return false;
+  }
+  records = {reinterpret_cast<const index_record *>(bytes.data() + h->records), h->count};
+  strings = {reinterpret_cast<const wchar_t *>(bytes.data() + h->strings), static_cast<size_t>(h->strings_size)};
+  for (const auto &r : records) {
+    if (static_cast<uint64_t>(r.alias) + r.alias_size > strings.size() ||
+        static_cast<uint64_t>(r.target) + r.target_size > strings.size()) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"link index damaged");
+      return false;
+    }
+  }
+  identity id;
+  if (!Identify(linkmeta::MetaPath(folder), id, ec)) {
+    return false;
+  }
+  if (id != identity{h->meta_index, h->meta_size, h->meta_mtime}) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"link index older than link metadata");
+    return false;
+  }
+  return true;
+}
+
+std::optional<size_t> Reader::Find(std::wstring_view alias) const {
+  size_t lo = 0;
+  size_t hi = records.size();
+  while (lo < hi) {
+    auto mid = lo + (hi - lo) / 2;
+    auto c = Alias(mid).compare(alias);
+    if (c == 0) {
+      return std::make_optional(mid);
+    }
+    if (c < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return std::nullopt;
+}
+} // namespace baulk::linkindex
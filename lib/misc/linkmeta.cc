@@ -0,0 +1,192 @@
+//
+#include <bela/io.hpp>
+#include <bela/datetime.hpp>
+#include <bela/str_split.hpp>
+#include <baulk/fs.hpp>
+#include <baulk/linkmeta.hpp>
+
+namespace baulk::linkmeta {
+std::wstring MetaPath(std::wstring_view folder) { return bela::StringCat(folder, L"\\baulk.linkmeta.json"); }
+
+std::wstring JournalPath(std::wstring_view folder) { return bela::StringCat(folder, L"\\baulk.linkmeta.journal"); }
+
+bool Store::Open(std::wstring_view folder_, bela::error_code &ec) {
+  close_journal();
+  folder = folder_;
+  obj = nlohmann::json::object();
+  links = nlohmann::json::object();
+  dirty = false;
+  torn = false;
+  replayed = 0;
+  if (auto jo = parse_json_file(MetaPath(folder), ec); jo && jo->obj.is_object()) {
+    obj = std::move(jo->obj);
+    if (auto it = obj.find("links"); it != obj.end() && it->is_object()) {
+      for (const auto &item : it->items()) {
+        if (item.value().is_string()) {
+          links[item.key()] = item.value();
+        }
+      }
+    }
+  }
+  // a missing or damaged file starts empty, as writing over it always did
+  ec.clear();
+  return replay(ec);
+}
+
+std::wstring Store::Target(std::wstring_view alias) const {
+  if (auto it = links.find(bela::encode_into<wchar_t, char>(alias)); it != links.end()) {
+    return bela::encode_into<char, wchar_t>(it->get<std::string_view>());
+  }
+  return L"";
+}
+
+bool Store::Put(const std::vector<std::pair<std::wstring, std::wstring>> &aliases, bela::error_code &ec) {
+  if (aliases.empty()) {
+    return true;
+  }
+  std::vector<nlohmann::json> changes;
+  for (const auto &[alias, target] : aliases) {
+    changes.emplace_back(nlohmann::json{{"alias", bela::encode_into<wchar_t, char>(alias)},
+                                        {"target", bela::encode_into<wchar_t, char>(target)}});
+  }
+  return apply(changes, ec);
+}
+
+std::vector<std::pair<std::wstring, std::wstring>> Store::Links() const {
+  std::vector<std::pair<std::wstring, std::wstring>> aliases;
+  for (const auto &item : links.items()) {
+    aliases.emplace_back(bela::encode_into<char, wchar_t>(item.key()),
+                         bela::encode_into<char, wchar_t>(item.value().get<std::string_view>()));
+  }
+  return aliases;
+}
+
+std::optional<std::vector<std::wstring>> Store::Remove(std::wstring_view pkgName, bela::error_code &ec) {
+  std::vector<std::wstring> aliases;
+  std::vector<nlohmann::json> changes;
+  for (const auto &item : links.items()) {
+    auto target = bela::encode_into<char, wchar_t>(item.value().get<std::string_view>());
+    std::vector<std::wstring_view> mv = bela::StrSplit(target, bela::ByChar('@'), bela::SkipEmpty());
+    if (mv.size() < 2 || mv[0] != pkgName) {
+      continue;
+    }
+    aliases.emplace_back(bela::encode_into<char, wchar_t>(item.key()));
+    changes.emplace_back(nlohmann::json{{"alias", item.key()}});
+  }
+  if (!apply(changes, ec)) {
+    return std::nullopt;
+  }
+  return std::make_optional(std::move(aliases));
+}
+
+bool Store::Commit(std::wstring_view packagesRoot, bela::error_code &ec) {
+  if (!dirty) {
+    return true;
+  }
+  std::string content;
+  try {
+    obj["links"] = links;
+    obj["updated"] = bela::FormatTime<char>(bela::Now());
+    obj["app_packages_root"] = bela::encode_into<wchar_t, char>(packagesRoot);
+    content = obj.dump(4);
+  } catch (const std::exception &e) {
+    ec = bela::make_error_code(bela::ErrGeneral, bela::encode_into<char, wchar_t>(e.what()));
+    return false;
+  }
+  if (!fs::ReplaceContent(MetaPath(folder), content, ec)) {
+    return false;
+  }
+  close_journal();
+  auto journal = JournalPath(folder);
+  DeleteFileW(journal.data());
+  dirty = false;
+  torn = false;
+  return true;
+}
+
+void Store::close_journal() {
+  if (journalFd != INVALID_HANDLE_VALUE) {
+    CloseHandle(journalFd);
+    journalFd = INVALID_HANDLE_VALUE;
+  }
+}
+
+void Store::apply_change(const nlohmann::json &change) {
+  auto alias = change.find("alias");
+  if (alias == change.end() || !alias->is_string()) {
+    return;
+  }
+  if (auto target = change.find("target"); target != change.end() && target->is_string()) {
+    links[alias->get<std::string>()] = *target;
+  } else {
+    links.erase(alias->get<std::string>());
+  }
+  dirty = true;
+}
+
+bool Store::replay(bela::error_code &ec) {
+  std::string content;
+  if (!bela::io::ReadFile(JournalPath(folder), content, ec, 64 * 1024 * 1024)) {
+    if (ec.code == ERROR_FILE_NOT_FOUND || ec.code == ERROR_PATH_NOT_FOUND || ec.code == ENOENT) {
+      ec.clear();
+      return true;
+    }
+    return false;
+  }
+  std::string_view sv(content);
+  for (auto pos = sv.find('\n'); pos != std::string_view::npos; pos = sv.find('\n')) {
+    try {
+      apply_change(nlohmann::json::parse(sv.substr(0, pos)));
+      replayed++;
+    } catch (const std::exception &) {
+      // a line torn by a crash before a later change
+    }
+    sv.remove_prefix(pos + 1);
+  }
+  torn = !sv.empty();
+  return true;
+}
+
+bool Store::apply(const std::vector<nlohmann::json> &changes, bela::error_code &ec) {
+  if (changes.empty()) {
+    return true;
+  }
+  std::string lines;
+  if (torn) {
+    lines.push_back('\n');
+  }
+  try {
+    for (const auto &c : changes) {
+      lines.append(c.dump()).push_back('\n');
+    }
+  } catch (const std::exception &e) {
+    ec = bela::make_error_code(bela::ErrGeneral, bela::encode_into<char, wchar_t>(e.what()));
+    return false;
+  }
+  if (journalFd == INVALID_HANDLE_VALUE) {
+    auto journal = JournalPath(folder);
+    journalFd = CreateFileW(journal.data(), FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                            OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (journalFd == INVALID_HANDLE_VALUE) {
+      ec = bela::make_system_error_code(L"CreateFileW() ");
+      return false;
+    }
+  }
+  DWORD written = 0;
+  if (WriteFile(journalFd, lines.data(), static_cast<DWORD>(lines.size()), &written, nullptr) != TRUE ||
+      written != lines.size()) {
+    ec = bela::make_system_error_code(L"WriteFile() ");
+    torn = true;
+    return false;
+  }
+  if (FlushFileBuffers(journalFd) != TRUE) {
+    ec = bela::make_system_error_code(L"FlushFileBuffers() ");
+    return false;
+  }
+  torn = false;
+  for (const auto &c : changes) {
+    apply_change(c);
+  }
+  return true;
+}
+} // namespace baulk::linkmeta
@@ -0,0 +1,101 @@
+//
+#include <bela/ascii.hpp>
+#include <bela/match.hpp>
+#include <baulk/trigram.hpp>
+#include <algorithm>
+
+namespace baulk::trigram {
+namespace {
+constexpr key_t make_key(wchar_t a, wchar_t b, wchar_t c) {
+  return (static_cast<key_t>(bela::ascii_tolower(a)) << 32) | (static_cast<key_t>(bela::ascii_tolower(b)) << 16) |
+         static_cast<key_t>(bela::ascii_tolower(c));
+}
+} // namespace
+
+std::vector<key_t> Keys(std::wstring_view text) {
+  std::vector<key_t> keys;
+  for (size_t i = 0; i + 3 <= text.size(); i++) {
+    keys.emplace_back(make_key(text[i], text[i + 1], text[i + 2]));
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  return keys;
+}
+
+bool ContainsIgnoreCase(std::wstring_view haystack, std::wstring_view needle) {
+  return std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end(), [](wchar_t a, wchar_t b) {
+           return bela::ascii_tolower(a) == bela::ascii_tolower(b);
+         }) != haystack.end();
+}
+
+int Score(std::wstring_view name, std::wstring_view description, std::wstring_view term) {
+  if (term.empty()) {
+    return 0;
+  }
+  if (bela::EqualsIgnoreCase(name, term)) {
+    return 100;
+  }
+  if (bela::StartsWithIgnoreCase(name, term)) {
+    return 80;
+  }
+  if (ContainsIgnoreCase(name, term)) {
+    return 60;
+  }
+  if (ContainsIgnoreCase(description, term)) {
+    return 20;
+  }
+  return 0;
+}
+
+void Builder::Add(uint32_t doc, std::wstring_view text) {
+  for (auto k : Keys(text)) {
+    auto &docs = postings[k];
+    if (docs.empty() || docs.back() != doc) {
+      docs.emplace_back(doc);
+    }
+  }
+}
+
+void Builder::Encode(std::vector<posting_list> &lists, std::vector<uint32_t> &docs) const {
+  lists.clear();
+  docs.clear();
+  lists.reserve(postings.size());
+  for (const auto &[k, v] : postings) {
+    lists.emplace_back(posting_list{.key = k, .offset = 0, .count = static_cast<uint32_t>(v.size())});
+  }
+  std::sort(lists.begin(), lists.end(), [](const posting_list &a, const posting_list &b) { return a.key < b.key; });
+  for (auto &l : lists) {
+    l.offset = static_cast<uint32_t>(docs.size());
+    const auto &v = postings.at(l.key);
+    docs.insert(docs.end(), v.begin(), v.end());
+  }
+}
+
+bool Postings::Candidates(std::wstring_view term, std::vector<uint32_t> &candidates) const {
+  candidates.clear();
+  auto keys = Keys(term);
+  if (keys.empty()) {
+    return false;
+  }
+  std::vector<std::span<const uint32_t>> found;
+  for (auto k : keys) {
+    auto it = std::lower_bound(lists.begin(), lists.end(), k,
+                               [](const posting_list &l, key_t key) { return l.key < key; });
+    if (it == lists.end() || it->key != k || static_cast<uint64_t>(it->offset) + it->count > docs.size()) {
+      return true; // a trigram no document has
+    }
+    found.emplace_back(docs.subspan(it->offset, it->count));
+  }
+  // the shortest list bounds the result, intersect the rest into it
+  std::sort(found.begin(), found.end(), [](const auto &a, const auto &b) { return a.size() < b.size(); });
+  candidates.assign(found[0].begin(), found[0].end());
+  std::vector<uint32_t> next;
+  for (size_t i = 1; i < found.size() && !candidates.empty(); i++) {
+    next.clear();
+    std::set_intersection(candidates.begin(), candidates.end(), found[i].begin(), found[i].end(),
+                          std::back_inserter(next));
+    candidates.swap(next);
+  }
+  return true;
+}
+} // namespace baulk::trigram
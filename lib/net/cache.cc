@@ -0,0 +1,175 @@
+//
+#include <bela/io.hpp>
+#include <bela/time.hpp>
+#include <json.hpp>
+#include "cache.hpp"
+
+namespace baulk::net {
+namespace {
+// body file names: FNV-1a of the url, an entry whose url collides is evicted
+std::wstring body_name(std::wstring_view url) {
+  uint64_t h = 14695981039346656037ULL;
+  for (auto c : url) {
+    h ^= static_cast<uint64_t>(c);
+    h *= 1099511628211ULL;
+  }
+  constexpr std::wstring_view digits = L"0123456789abcdef";
+  std::wstring name(16, L'0');
+  for (size_t i = 0; i < 16; i++) {
+    name[15 - i] = digits[(h >> (i * 4)) & 0xF];
+  }
+  return name.append(L".body");
+}
+
+inline std::wstring header_value(const headers_t &headers, std::wstring_view key) {
+  if (auto it = headers.find(key); it != headers.end()) {
+    return it->second;
+  }
+  return L"";
+}
+} // namespace
+
+bool response_cache::Load(const std::filesystem::path &dir_, bela::error_code &ec) {
+  std::scoped_lock lock(mu);
+  dir = dir_;
+  entries.clear();
+  FILE *fd = nullptr;
+  if (auto eo = _wfopen_s(&fd, (dir / L"index.json").c_str(), L"rb"); eo != 0) {
+    if (eo == ENOENT) {
+      return true;
+    }
+    ec = bela::make_error_code_from_errno(eo);
+    return false;
+  }
+  auto closer = bela::finally([&] { fclose(fd); });
+  try {
+    auto j = nlohmann::json::parse(fd, nullptr, true, true);
+    for (const auto &[url, o] : j.at("entries").items()) {
+      entries.insert_or_assign(bela::encode_into<char, wchar_t>(url),
+                               entry{.etag = bela::encode_into<char, wchar_t>(o.value("etag", "")),
+                                     .last_modified = bela::encode_into<char, wchar_t>(o.value("last_modified", "")),
+                                     .content_type = bela::encode_into<char, wchar_t>(o.value("content_type", "")),
+                                     .body = bela::encode_into<char, wchar_t>(o.value("body", "")),
+                                     .updated = o.value("updated", static_cast<int64_t>(0))});
+    }
+  } catch (const std::exception &e) {
+    // a damaged index only costs full downloads
+    entries.clear();
+    ec = bela::make_error_code(bela::ErrGeneral, bela::encode_into<char, wchar_t>(e.what()));
+    return false;
+  }
+  return true;
+}
+
+// save writes the index and sweeps stale entries, the caller holds mu
+bool response_cache::save(bela::error_code &ec) {
+  auto now = bela::ToUnixSeconds(bela::Now());
+  std::error_code e;
+  for (auto it = entries.begin(); it != entries.end();) {
+    if (now - it->second.updated > cache_expire_after) {
+      std::filesystem::remove(dir / it->second.body, e);
+      entries.erase(it++);
+      continue;
+    }
+    ++it;
+  }
+  try {
+    nlohmann::json ej = nlohmann::json::object();
+    for (const auto &[url, o] : entries) {
+      ej[bela::encode_into<wchar_t, char>(url)] = {{"etag", bela::encode_into<wchar_t, char>(o.etag)},
+                                                   {"last_modified", bela::encode_into<wchar_t, char>(o.last_modified)},
+                                                   {"content_type", bela::encode_into<wchar_t, char>(o.content_type)},
+                                                   {"body", bela::encode_into<wchar_t, char>(o.body)},
+                                                   {"updated", o.updated}};
+    }
+    nlohmann::json j{{"version", 1}, {"entries", std::move(ej)}};
+    return bela::io::AtomicWriteText((dir / L"index.json").native(), bela::io::as_bytes<char>(j.dump(4)), ec);
+  } catch (const std::exception &e) {
+    ec = bela::make_error_code(bela::ErrGeneral, bela::encode_into<char, wchar_t>(e.what()));
+  }
+  return false;
+}
+
+std::optional<std::vector<char>> response_cache::read_body(const entry &e) {
+  bela::error_code ec;
+  auto fd = bela::io::NewFile((dir / e.body).native(), ec);
+  if (!fd) {
+    return std::nullopt;
+  }
+  auto size = fd->Size(ec);
+  if (size == bela::SizeUnInitialized || size > static_cast<int64_t>(cache_max_body_size)) {
+    return std::nullopt;
+  }
+  std::vector<char> body(static_cast<size_t>(size));
+  if (size != 0 && !fd->ReadFull({reinterpret_cast<uint8_t *>(body.data()), body.size()}, ec)) {
+    return std::nullopt;
+  }
+  return std::make_optional(std::move(body));
+}
+
+headers_t response_cache::Conditional(std::wstring_view url) {
+  std::scoped_lock lock(mu);
+  headers_t headers;
+  auto it = entries.find(std::wstring(url));
+  if (it == entries.end()) {
+    return headers;
+  }
+  if (!it->second.etag.empty()) {
+    headers.emplace(L"If-None-Match", it->second.etag);
+  }
+  if (!it->second.last_modified.empty()) {
+    headers.emplace(L"If-Modified-Since", it->second.last_modified);
+  }
+  return headers;
+}
+
+Response response_cache::Resolve(std::wstring_view url, Response &&resp) {
+  std::scoped_lock lock(mu);
+  auto key = std::wstring(url);
+  bela::error_code ec;
+  if (resp.StatusCode() == 304) {
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+      return std::move(resp);
+    }
+    auto body = read_body(it->second);
+    if (!body) {
+      // the body file is gone, the next request fetches it again
+      entries.erase(it);
+      save(ec);
+      return std::move(resp);
+    }
+    stats.hits++;
+    it->second.updated = bela::ToUnixSeconds(bela::Now());
+    minimal_response mr{.status_code = 200, .status_text = L"OK"};
+    mr.headers = resp.Headers();
+    if (!it->second.content_type.empty()) {
+      mr.headers.insert_or_assign(L"Content-Type", it->second.content_type);
+    }
+    auto size = body->size();
+    return Response(std::move(mr), std::move(*body), size);
+  }
+  stats.misses++;
+  if (resp.StatusCode() != 200 || resp.Content().size() > cache_max_body_size) {
+    return std::move(resp);
+  }
+  entry e{.etag = header_value(resp.Headers(), L"ETag"),
+          .last_modified = header_value(resp.Headers(), L"Last-Modified"),
+          .content_type = header_value(resp.Headers(), L"Content-Type"),
+          .body = body_name(url),
+          .updated = bela::ToUnixSeconds(bela::Now())};
+  if (e.etag.empty() && e.last_modified.empty()) {
+    return std::move(resp);
+  }
+  if (std::error_code e; std::filesystem::create_directories(dir, e), e) {
+    return std::move(resp);
+  }
+  std::erase_if(entries, [&](const auto &kv) { return kv.second.body == e.body && kv.first != key; });
+  if (!bela::io::AtomicWriteText((dir / e.body).native(), bela::io::as_bytes<char>(resp.Content()), ec)) {
+    return std::move(resp);
+  }
+  entries.insert_or_assign(key, std::move(e));
+  save(ec);
+  return std::move(resp);
+}
+} // namespace baulk::net
@@ -0,0 +1,40 @@
+// conditional HTTP caching of GET responses: ETag/Last-Modified validators and bodies kept on disk, keyed by URL
+#ifndef BAULK_NET_CACHE_HPP
+#define BAULK_NET_CACHE_HPP
+#include <baulk/net/client.hpp>
+#include <mutex>
+
+namespace baulk::net {
+constexpr size_t cache_max_body_size = 16 * 1024 * 1024;  // larger responses are not cached
+constexpr int64_t cache_expire_after = 30 * 24 * 3600; // seconds, entries not revalidated this long are swept
+
+class response_cache {
+public:
+  bool Load(const std::filesystem::path &dir_, bela::error_code &ec);
+  // Conditional returns If-None-Match/If-Modified-Since for a cached url, empty when there is nothing to revalidate
+  headers_t Conditional(std::wstring_view url);
+  // Resolve turns a 304 into the cached response (a hit) and stores a 200 that carries validators (a miss)
+  Response Resolve(std::wstring_view url, Response &&resp);
+  cache_stats Stats() const {
+    std::scoped_lock lock(mu);
+    return stats;
+  }
+
+private:
+  struct entry {
+    std::wstring etag;
+    std::wstring last_modified;
+    std::wstring content_type;
+    std::wstring body; // file name in dir
+    int64_t updated{0};
+  };
+  bool save(bela::error_code &ec);
+  std::optional<std::vector<char>> read_body(const entry &e);
+  mutable std::mutex mu;
+  std::filesystem::path dir;
+  bela::flat_hash_map<std::wstring, entry> entries;
+  cache_stats stats;
+};
+} // namespace baulk::net
+
+#endif
@@ -1,11 +1,34 @@
 //
 #include <bela/env.hpp>
-#include <baulk/net/client.hpp>
+#include <baulk/net.hpp>
 #include <baulk/indicators.hpp>
 #include "native.hpp"
 #include "file.hpp"
+#include "http1.hpp"
+#include "segments.hpp"
+#include "cache.hpp"
+#include "encoding.hpp"
 
 namespace baulk::net {
+namespace native {
+// request_source reads the body of a WinHTTP request
+class request_source final : public net_internal::body_source {
+public:
+  request_source(HINTERNET h_) : h(h_) {}
+  bela::ssize_t Read(void *buffer, size_t len, bela::error_code &ec) override {
+    DWORD dwSize = 0;
+    if (WinHttpReadData(h, buffer, static_cast<DWORD>(len), &dwSize) != TRUE) {
+      ec = make_net_error_code();
+      return -1;
+    }
+    consumed += dwSize;
+    return static_cast<bela::ssize_t>(dwSize);
+  }
+
+private:
+  HINTERNET h{nullptr};
+};
+} // namespace native
 
 inline std::optional<std::wstring> query_remote_address(HINTERNET hRequest) {
   WINHTTP_CONNECTION_INFO coninfo;
@@ -68,6 +91,26 @@ void response_trace(minimal_response &resp) {
 }
 
 using baulk::net::native::make_net_error_code;
+
+HttpClient::HttpClient()
+    : sessions(std::make_shared<native::session_pool>()), conns(std::make_shared<http1::connections>()) {}
+
+pool_stats HttpClient::PoolStats() const {
+  auto a = sessions->stats();
+  auto b = conns->Stats();
+  return pool_stats{.hits = a.hits + b.hits, .misses = a.misses + b.misses};
+}
+
+bool HttpClient::EnableResponseCache(const std::filesystem::path &dir, bela::error_code &ec) {
+  auto c = std::make_shared<response_cache>();
+  // a damaged index still leaves an empty, usable cache
+  auto result = c->Load(dir, ec);
+  cache = std::move(c);
+  return result;
+}
+
+cache_stats HttpClient::CacheStats() const { return cache ? cache->Stats() : cache_stats{}; }
+
 bool HttpClient::IsNoProxy(std::wstring_view host) const {
   for (const auto &u : noProxy) {
     if (bela::EqualsIgnoreCase(u, host)) {
@@ -96,22 +139,40 @@ bool HttpClient::InitializeProxyFromEnv() {
 std::optional<Response> HttpClient::WinRest(std::wstring_view method, std::wstring_view url,
                                             std::wstring_view content_type, std::wstring_view body,
                                             bela::error_code &ec) {
+  auto cacheable = cache && method == L"GET" && body.empty() && !noCache;
+  auto conditional = cacheable ? cache->Conditional(url) : headers_t{};
+  auto resp = transport == transport_t::Socket ? SockRest(method, url, content_type, body, conditional, ec)
+                                               : NativeRest(method, url, content_type, body, conditional, ec);
+  if (!resp || !cacheable) {
+    return resp;
+  }
+  auto notModified = resp->StatusCode() == 304;
+  auto resolved = cache->Resolve(url, std::move(*resp));
+  if (notModified) {
+    auto stats = cache->Stats();
+    DbgPrint(L"%s not modified (cache hits: %d misses: %d)", url, stats.hits, stats.misses);
+  }
+  return std::make_optional(std::move(resolved));
+}
+
+std::optional<Response> HttpClient::NativeRest(std::wstring_view method, std::wstring_view url,
+                                               std::wstring_view content_type, std::wstring_view body,
+                                               const headers_t &extra, bela::error_code &ec) {
   auto u = native::crack_url(url, ec);
   if (!u) {
     return std::nullopt;
   }
-  auto session = native::make_session(userAgent, ec);
-  if (!session) {
+  auto lease = sessions->acquire(userAgent, IsNoProxy(u->host) ? std::wstring_view{} : std::wstring_view{proxyURL}, *u,
+                                 poolOptions, ec);
+  if (!lease) {
     return std::nullopt;
   }
-  if (!IsNoProxy(u->host)) {
-    session->set_proxy_url(proxyURL);
-  }
-  session->protocol_enable();
-  auto conn = session->connect(u->host, u->nPort, ec);
-  if (!conn) {
-    return std::nullopt;
+  if (debugMode) {
+    auto stats = sessions->stats();
+    DbgPrint(L"%s %s:%d (pool hits: %d misses: %d)", lease->reused ? L"Re-using session to" : L"New session to",
+             u->host, u->nPort, stats.hits, stats.misses);
   }
+  auto &conn = lease->conn;
   auto flags = u->TlsFlag();
   if (noCache) {
     DbgPrint(L"Indicates that the request should be forwarded to the originating server");
@@ -124,7 +185,15 @@ std::optional<Response> HttpClient::WinRest(std::wstring_view method, std::wstri
   if (insecureMode) {
     req->set_insecure_mode();
   }
-  if (!req->write_headers(hkv, cookies, 0, 0, ec)) {
+  const auto *headers = &hkv;
+  headers_t merged;
+  if (!extra.empty() || !hkv.contains(L"Accept-Encoding")) {
+    merged = hkv;
+    merged.insert(extra.begin(), extra.end());
+    merged.try_emplace(L"Accept-Encoding", net_internal::accept_encoding);
+    headers = &merged;
+  }
+  if (!req->write_headers(*headers, cookies, 0, 0, ec)) {
     return std::nullopt;
   }
   if (!req->write_body(body, content_type, ec)) {
@@ -150,7 +219,11 @@ std::optional<Response> HttpClient::WinRest(std::wstring_view method, std::wstri
   if (recv_size = req->recv_completely(content_length, buffer, max_body_size, ec); recv_size < 0) {
     return std::nullopt;
   }
-  return std::make_optional<Response>(std::move(*mr), std::move(buffer), static_cast<size_t>(recv_size));
+  auto size = static_cast<size_t>(recv_size);
+  if (!net_internal::decode_body(*mr, buffer, size, max_body_size, ec)) {
+    return std::nullopt;
+  }
+  return std::make_optional<Response>(std::move(*mr), std::move(buffer), size);
 }
 
 inline std::filesystem::path make_destination(const download_options &opts, const baulk::net::native::url &u) {
@@ -160,7 +233,7 @@ inline std::filesystem::path make_destination(const download_options &opts, cons
   return opts.cwd / u.filename;
 }
 
-inline bool make_destination_decorous(std::filesystem::path &destination, bool force_overwrite, bela::error_code &ec) {
+bool make_destination_decorous(std::filesystem::path &destination, bool force_overwrite, bela::error_code &ec) {
   if (!std::filesystem::exists(destination)) {
     return true;
   }
@@ -193,22 +266,36 @@ void WINAPI status_context_callback(HINTERNET hInternet, DWORD_PTR dwContext, DW
 
 std::optional<std::filesystem::path> HttpClient::WinGet(std::wstring_view url, const download_options &opts,
                                                         bela::error_code &ec) {
+  if (peers && !opts.hash_value.empty()) {
+    bool fallback = true;
+    if (auto file = PeerGet(url, opts, fallback, ec); file || !fallback) {
+      return file;
+    }
+    ec = bela::error_code{};
+  }
+  return OriginGet(url, opts, ec);
+}
+
+std::optional<std::filesystem::path> HttpClient::OriginGet(std::wstring_view url, const download_options &opts,
+                                                           bela::error_code &ec) {
+  if (transport == transport_t::Socket) {
+    return SockGet(url, opts, ec);
+  }
   auto u = native::crack_url(url, ec);
   if (!u) {
     return std::nullopt;
   }
-  auto session = native::make_session(userAgent, ec);
-  if (!session) {
+  auto lease = sessions->acquire(userAgent, IsNoProxy(u->host) ? std::wstring_view{} : std::wstring_view{proxyURL}, *u,
+                                 poolOptions, ec);
+  if (!lease) {
     return std::nullopt;
   }
-  if (!IsNoProxy(u->host)) {
-    session->set_proxy_url(proxyURL);
-  }
-  session->protocol_enable();
-  auto conn = session->connect(u->host, u->nPort, ec);
-  if (!conn) {
-    return std::nullopt;
+  if (debugMode) {
+    auto stats = sessions->stats();
+    DbgPrint(L"%s %s:%d (pool hits: %d misses: %d)", lease->reused ? L"Re-using session to" : L"New session to",
+             u->host, u->nPort, stats.hits, stats.misses);
   }
+  auto &conn = lease->conn;
   auto flags = u->TlsFlag();
   if (noCache) {
     DbgPrint(L"Indicates that the request should be forwarded to the originating server");
@@ -226,14 +313,31 @@ std::optional<std::filesystem::path> HttpClient::WinGet(std::wstring_view url, c
   if (!filePart) {
     return std::nullopt;
   }
-  // detect part download
-  if (!req->write_headers(hkv, cookies, filePart->CurrentBytes(), filePart->FileSize(), ec)) {
+  // the sink has to see the body from its first byte
+  if (opts.sink && (filePart->CurrentBytes() != 0 || filePart->Segmented()) && !filePart->Truncated(ec)) {
+    return std::nullopt;
+  }
+  // detect part download, a segmented part file resumes from its first missing range
+  auto range_from = filePart->Segmented() ? filePart->Ranges().front().from : filePart->CurrentBytes();
+  // only a download from the first byte may be encoded, ranges address bytes of the file itself
+  const auto *headers = &hkv;
+  headers_t merged;
+  if (range_from == 0 && !hkv.contains(L"Accept-Encoding")) {
+    merged = hkv;
+    merged.try_emplace(L"Accept-Encoding", net_internal::accept_encoding);
+    headers = &merged;
+  }
+  if (!req->write_headers(*headers, cookies, range_from, 0, ec)) {
     return std::nullopt;
   }
   native::status_context sc(debugMode);
   if (!req->write_body(L"", L"", status_context_callback, sc.addressof(), ec)) {
+    RecordFailure(u->host);
     return std::nullopt;
   }
+  // WinHttpSendRequest returns once the connection and TLS are set up and the request is sent, the first-byte timer
+  // starts here
+  auto request_sent = std::chrono::steady_clock::now();
   if (debugMode) {
     if (auto addr = query_remote_address(req->addressof()); addr) {
       bela::FPrintF(stderr, L"\x1b[33mConnecting to %s (%s) %s|:%d connected.\x1b[0m\n", u->host, u->host, *addr,
@@ -243,13 +347,17 @@ std::optional<std::filesystem::path> HttpClient::WinGet(std::wstring_view url, c
   }
   auto mr = req->recv_minimal_response(ec);
   if (!mr) {
+    RecordFailure(u->host);
     return std::nullopt;
   }
+  // first-byte latency of the mirror, BestUrl prefers fast hosts next time
+  RecordLatency(u->host, std::chrono::nanoseconds{0}, std::chrono::steady_clock::now() - request_sent);
   if (debugMode) {
     response_trace(*mr);
   }
-  if (auto nu = sc.crack_location_url(); nu) {
-    destination = opts.cwd / nu->filename;
+  auto location = sc.crack_location_url();
+  if (location) {
+    destination = opts.cwd / location->filename;
   }
   if (opts.destination.empty()) {
     if (auto dispositionName = native::extract_filename(mr->headers); dispositionName) {
@@ -269,6 +377,96 @@ std::optional<std::filesystem::path> HttpClient::WinGet(std::wstring_view url, c
     ec = bela::make_error_code(bela::ErrGeneral, L"response: ", mr->status_code, L" status: ", mr->status_text);
     return std::nullopt;
   }
+  // an encoded body is no byte range of the file: it is neither resumed nor segmented
+  auto afmt = net_internal::file_format_t::none;
+  if (!net_internal::content_encoding(mr->headers, afmt, ec)) {
+    return std::nullopt;
+  }
+  auto encoded = afmt != net_internal::file_format_t::none;
+  if (encoded && net_internal::keep_encoding(destination.filename().native(), afmt)) {
+    DbgPrint(L"%s keeps its Content-Encoding: %s", u->filename, mr->headers[L"Content-Encoding"]);
+    afmt = net_internal::file_format_t::none;
+  }
+  part_support = part_support && !encoded;
+  // segmented download: the rest of an interrupted segmented download, or a large file from a server that accepts
+  // ranges when opts.segments asks for it. The response received so far carries the first missing range
+  std::vector<net_internal::part_range> missing;
+  if (filePart->Segmented()) {
+    if (auto cr = native::parse_content_range(mr->headers); mr->status_code == 206 && cr &&
+                                                            cr->start == filePart->Ranges().front().from &&
+                                                            cr->total == filePart->FileSize()) {
+      missing = filePart->Ranges();
+    } else if (mr->status_code == 206) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"server resumed from an unexpected range");
+      return std::nullopt;
+    }
+  } else if (opts.segments > 1 && !opts.sink && !encoded && mr->status_code == 200 &&
+             native::enable_part_download(mr->headers) &&
+             total_size >= 2 * native::min_segment_size) {
+    if (!filePart->Truncated(ec) || !filePart->Preallocate(total_size, ec)) {
+      return std::nullopt;
+    }
+    missing = native::split_ranges(total_size, opts.segments);
+  }
+  if (!missing.empty()) {
+    const auto &target = location ? *location : *u;
+    auto targetLease = sessions->acquire(
+        userAgent, IsNoProxy(target.host) ? std::wstring_view{} : std::wstring_view{proxyURL}, target, poolOptions, ec);
+    if (!targetLease) {
+      return std::nullopt;
+    }
+    auto targetFlags = target.TlsFlag() | (noCache ? WINHTTP_FLAG_REFRESH : 0);
+    native::open_range_t open_range = [&](int64_t from, int64_t to,
+                                          bela::error_code &rec) -> std::optional<native::handle> {
+      auto r = targetLease->conn->open_request(L"GET", target.uri, targetFlags, rec);
+      if (!r) {
+        return std::nullopt;
+      }
+      if (insecureMode) {
+        r->set_insecure_mode();
+      }
+      if (!r->write_headers(hkv, cookies, from, to, rec) || !r->write_body(L"", L"", rec)) {
+        return std::nullopt;
+      }
+      auto rmr = r->recv_minimal_response(rec);
+      if (!rmr) {
+        return std::nullopt;
+      }
+      if (auto cr = native::parse_content_range(rmr->headers); rmr->status_code != 206 || !cr || cr->start != from) {
+        rec = bela::make_error_code(bela::ErrGeneral, L"range request response: ", rmr->status_code, L" status: ",
+                                    rmr->status_text);
+        return std::nullopt;
+      }
+      return r;
+    };
+    auto workers = (std::max)(opts.segments, 1u);
+    DbgPrint(L"%s segmented download: %d ranges over %d connections", u->filename, missing.size(), workers);
+    baulk::ProgressBar bar;
+    bar.Maximum(static_cast<uint64_t>(filePart->FileSize()));
+    bar.Update(static_cast<uint64_t>(filePart->CurrentBytes()));
+    bar.FileName(destination.filename().native());
+    if (!opts.quiet) {
+      bar.Execute();
+    }
+    auto finish = bela::finally([&] {
+      // finish progressbar
+      bar.Finish();
+    });
+    if (!native::download_segments(missing, std::move(*req), workers, open_range, *filePart, bar, ec)) {
+      bar.MarkFault();
+      if (!opts.hash_value.empty()) {
+        bela::error_code discard_ec;
+        filePart->SaveSegmentsOverlay(opts.hash_value, missing, discard_ec);
+        DbgPrint(L"%s segmented download broken, %d ranges left", u->filename, missing.size());
+      }
+      return std::nullopt;
+    }
+    if (!filePart->Solidified(ec)) {
+      return std::nullopt;
+    }
+    bar.MarkCompleted();
+    return std::make_optional(std::move(destination));
+  }
   if (mr->status_code != 206) {
     if (!filePart->Truncated(ec)) {
       return std::nullopt;
@@ -284,7 +482,9 @@ std::optional<std::filesystem::path> HttpClient::WinGet(std::wstring_view url, c
     bar.Maximum(static_cast<uint64_t>(total_size));
   }
   bar.FileName(destination.filename().native());
-  bar.Execute();
+  if (!opts.quiet) {
+    bar.Execute();
+  }
   auto finish = bela::finally([&] {
     // finish progressbar
     bar.Finish();
@@ -299,31 +499,38 @@ std::optional<std::filesystem::path> HttpClient::WinGet(std::wstring_view url, c
     filePart->SaveOverlayData(opts.hash_value, total_size, current_bytes, discard_ec);
     DbgPrint(L"%s download broken for bytes: %d-%d", u->filename, current_bytes, total_size);
   };
-  // recv data
-  std::vector<char> buffer;
-  buffer.reserve(64 * 1024);
-  DWORD dwSize = 0;
-  do {
-    DWORD downloaded_size = 0;
-    if (WinHttpQueryDataAvailable(req->addressof(), &dwSize) != TRUE) {
-      ec = bela::make_system_error_code();
+  // recv data, progress counts the received (encoded) bytes against Content-Length
+  native::request_source src(req->addressof());
+  net_internal::body_decoder body(src);
+  if (!body.Initialize(afmt, ec)) {
+    bar.MarkFault();
+    return std::nullopt;
+  }
+  auto start_bytes = current_bytes;
+  std::vector<char> buffer(256 * 1024);
+  for (;;) {
+    auto n = body.Read(buffer.data(), buffer.size(), ec);
+    if (n < 0) {
+      current_bytes = start_bytes + src.Consumed();
       save_part_overlay();
       bar.MarkFault();
       return std::nullopt;
     }
-    if (buffer.size() < dwSize) {
-      buffer.resize(static_cast<size_t>(dwSize) * 2);
+    if (n == 0) {
+      break;
     }
-    if (WinHttpReadData(req->addressof(), (LPVOID)buffer.data(), dwSize, &downloaded_size) != TRUE) {
-      ec = make_net_error_code();
-      save_part_overlay();
+    if (!filePart->WriteFull(buffer.data(), static_cast<size_t>(n), ec)) {
       bar.MarkFault();
       return std::nullopt;
     }
-    filePart->WriteFull(buffer.data(), static_cast<size_t>(downloaded_size), ec);
-    current_bytes += dwSize;
+    if (opts.sink && !opts.sink(buffer.data(), static_cast<size_t>(n), ec)) {
+      bar.MarkFault();
+      return std::nullopt;
+    }
+    current_bytes = start_bytes + src.Consumed();
     bar.Update(current_bytes);
-  } while (dwSize > 0);
+  }
+  current_bytes = start_bytes + src.Consumed();
 
   if (total_size != 0 && current_bytes < total_size) {
     bar.MarkFault();
@@ -0,0 +1,157 @@
+//
+#include <bela/strip.hpp>
+#include <bela/ascii.hpp>
+#include "encoding.hpp"
+
+namespace baulk::net::net_internal {
+
+bool content_encoding(const headers_t &hkv, file_format_t &afmt, bela::error_code &ec) {
+  afmt = file_format_t::none;
+  auto it = hkv.find(L"Content-Encoding");
+  if (it == hkv.end()) {
+    return true;
+  }
+  auto coding = bela::StripAsciiWhitespace(it->second);
+  if (coding.empty() || bela::EqualsIgnoreCase(coding, L"identity")) {
+    return true;
+  }
+  if (bela::EqualsIgnoreCase(coding, L"gzip") || bela::EqualsIgnoreCase(coding, L"x-gzip")) {
+    afmt = file_format_t::gz;
+    return true;
+  }
+  if (bela::EqualsIgnoreCase(coding, L"br")) {
+    afmt = file_format_t::brotli;
+    return true;
+  }
+  if (bela::EqualsIgnoreCase(coding, L"zstd")) {
+    afmt = file_format_t::zstd;
+    return true;
+  }
+  // stacked codings ('gzip, br') and deflate are never requested
+  ec = bela::make_error_code(bela::ErrGeneral, L"unsupported Content-Encoding '", coding, L"'");
+  return false;
+}
+
+bool keep_encoding(std::wstring_view filename, file_format_t afmt) {
+  switch (afmt) {
+  case file_format_t::gz:
+    return bela::EndsWithIgnoreCase(filename, L".gz") || bela::EndsWithIgnoreCase(filename, L".tgz");
+  case file_format_t::brotli:
+    return bela::EndsWithIgnoreCase(filename, L".br");
+  case file_format_t::zstd:
+    return bela::EndsWithIgnoreCase(filename, L".zst") || bela::EndsWithIgnoreCase(filename, L".tzst");
+  default:
+    break;
+  }
+  return false;
+}
+
+bool body_source::Discard(int64_t len, bela::error_code &ec) {
+  char buffer[8192];
+  while (len > 0) {
+    auto n = Read(buffer, static_cast<size_t>((std::min)(len, static_cast<int64_t>(sizeof(buffer)))), ec);
+    if (n <= 0) {
+      if (n == 0) {
+        ec = bela::make_error_code(bela::ErrEnded, L"End of file");
+      }
+      return false;
+    }
+    len -= n;
+  }
+  return true;
+}
+
+bool body_source::WriteTo(const baulk::archive::tar::Writer &w, int64_t filesize, int64_t &extracted,
+                          bela::error_code &ec) {
+  char buffer[8192];
+  while (filesize > 0) {
+    auto n = Read(buffer, static_cast<size_t>((std::min)(filesize, static_cast<int64_t>(sizeof(buffer)))), ec);
+    if (n <= 0) {
+      if (n == 0) {
+        ec = bela::make_error_code(bela::ErrEnded, L"End of file");
+      }
+      return false;
+    }
+    filesize -= n;
+    extracted += n;
+    if (!w(buffer, static_cast<size_t>(n), ec)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bela::ssize_t memory_source::Read(void *buffer, size_t len, bela::error_code &ec) {
+  auto n = (std::min)(len, data.size());
+  memcpy(buffer, data.data(), n);
+  data.remove_prefix(n);
+  consumed += static_cast<int64_t>(n);
+  return static_cast<bela::ssize_t>(n);
+}
+
+bool body_decoder::Initialize(file_format_t afmt, bela::error_code &ec) {
+  if (afmt == file_format_t::none) {
+    return true;
+  }
+  decoder = baulk::archive::tar::MakeReader(&src, afmt, ec);
+  return decoder != nullptr;
+}
+
+bela::ssize_t body_decoder::Read(void *buffer, size_t len, bela::error_code &ec) {
+  if (!decoder) {
+    return src.Read(buffer, len, ec);
+  }
+  auto n = decoder->Read(buffer, len, ec);
+  if (n < 0) {
+    // the decompressors report the end of their source as a read failure without error
+    return ec ? -1 : 0;
+  }
+  decoded += n;
+  if (decoded > (std::max)(decode_floor, src.Consumed() * decode_ratio)) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"response body expands beyond ", decode_ratio,
+                               L" times its encoded size, refusing to decode it");
+    return -1;
+  }
+  return n;
+}
+
+bool decode_body(minimal_response &mr, std::vector<char> &buffer, size_t &size, size_t limit, bela::error_code &ec) {
+  file_format_t afmt{file_format_t::none};
+  if (!content_encoding(mr.headers, afmt, ec)) {
+    return false;
+  }
+  if (afmt == file_format_t::none || size == 0) {
+    return true;
+  }
+  memory_source src(std::string_view{buffer.data(), size});
+  body_decoder decoder(src);
+  if (!decoder.Initialize(afmt, ec)) {
+    return false;
+  }
+  std::vector<char> decoded((std::min)((std::max)(size * 4, static_cast<size_t>(64 * 1024)), limit));
+  size_t decoded_size = 0;
+  for (;;) {
+    if (decoded_size == decoded.size()) {
+      if (decoded_size == limit) {
+        ec = bela::make_error_code(bela::ErrGeneral, L"decoded response body exceeds ", limit, L" bytes");
+        return false;
+      }
+      decoded.resize((std::min)(decoded_size * 2, limit));
+    }
+    auto n = decoder.Read(decoded.data() + decoded_size, decoded.size() - decoded_size, ec);
+    if (n < 0) {
+      return false;
+    }
+    if (n == 0) {
+      break;
+    }
+    decoded_size += static_cast<size_t>(n);
+  }
+  buffer = std::move(decoded);
+  size = decoded_size;
+  mr.headers.erase(L"Content-Encoding");
+  mr.headers.erase(L"Content-Length");
+  return true;
+}
+
+} // namespace baulk::net::net_internal
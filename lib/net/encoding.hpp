@@ -0,0 +1,66 @@
+// Content-Encoding: gzip, br and zstd bodies are decoded by the decompressors of baulk.archive
+#ifndef BAULK_NET_ENCODING_HPP
+#define BAULK_NET_ENCODING_HPP
+#include <baulk/net/types.hpp>
+#include <baulk/archive/tar.hpp>
+
+namespace baulk::net::net_internal {
+using baulk::archive::file_format_t;
+constexpr std::wstring_view accept_encoding = L"gzip, br, zstd";
+// decompression bomb guard: a body may always decode to decode_floor bytes, beyond that to at most decode_ratio
+// times the encoded bytes received so far
+constexpr int64_t decode_floor = 16 * 1024 * 1024;
+constexpr int64_t decode_ratio = 1024;
+
+// content_encoding resolves the Content-Encoding of a response to a decompressor, file_format_t::none is identity
+bool content_encoding(const headers_t &hkv, file_format_t &afmt, bela::error_code &ec);
+// keep_encoding: a server that labels a .tar.gz with 'Content-Encoding: gzip' (Apache AddEncoding) means the file
+// itself, downloads keep such bodies as they are so their hash still matches
+bool keep_encoding(std::wstring_view filename, file_format_t afmt);
+
+// body_source is an encoded response body as pull stream, Read returns 0 once the body is complete
+class body_source : public baulk::archive::tar::ExtractReader {
+public:
+  bool Discard(int64_t len, bela::error_code &ec) override;
+  bool WriteTo(const baulk::archive::tar::Writer &w, int64_t filesize, int64_t &extracted,
+               bela::error_code &ec) override;
+  int64_t Consumed() const { return consumed; }
+
+protected:
+  int64_t consumed{0};
+};
+
+class memory_source final : public body_source {
+public:
+  memory_source(std::string_view data_) : data(data_) {}
+  bela::ssize_t Read(void *buffer, size_t len, bela::error_code &ec) override;
+
+private:
+  std::string_view data;
+};
+
+// body_decoder reads the decoded body of a source, identity bodies pass through
+class body_decoder {
+public:
+  body_decoder(body_source &src_) : src(src_) {}
+  body_decoder(const body_decoder &) = delete;
+  body_decoder &operator=(const body_decoder &) = delete;
+  bool Initialize(file_format_t afmt, bela::error_code &ec);
+  // Read returns the number of bytes read, 0 once the body is complete, -1 on error
+  bela::ssize_t Read(void *buffer, size_t len, bela::error_code &ec);
+  int64_t Decoded() const { return decoded; }
+  bool Encoded() const { return decoder != nullptr; }
+
+private:
+  body_source &src;
+  std::shared_ptr<baulk::archive::tar::ExtractReader> decoder;
+  int64_t decoded{0};
+};
+
+// decode_body replaces a completely received body by its decoding, limit caps the decoded size. Content-Encoding and
+// Content-Length of the response are dropped, they described the encoded body
+bool decode_body(minimal_response &mr, std::vector<char> &buffer, size_t &size, size_t limit, bela::error_code &ec);
+
+} // namespace baulk::net::net_internal
+
+#endif
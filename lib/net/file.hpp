@@ -1,10 +1,13 @@
 //
+#ifndef BAULK_NET_FILE_HPP
+#define BAULK_NET_FILE_HPP
 #include <bela/base.hpp>
 #include <bela/path.hpp>
 #include <bela/time.hpp>
 #include <bela/ascii.hpp>
 #include <bela/io.hpp>
 #include <filesystem>
+#include <vector>
 #include <baulk/allocate.hpp>
 #include <baulk/net/types.hpp>
 
@@ -35,7 +38,25 @@ struct part_overlay_data {
   int64_t current_bytes{0};
   int64_t laste_time{0};
 };
+// segmented downloads preallocate the whole file, the byte ranges still missing are stored after the data:
+// [total_bytes][part_range...][part_segments_overlay]
+constexpr uint8_t segments_magic[] = {'P', 'S', 'E', 'G'};
+constexpr int64_t max_part_ranges = 4096;
+struct part_range {
+  int64_t from{0};
+  int64_t to{0}; // exclusive
+};
+struct part_segments_overlay {
+  uint8_t magic[4];
+  hash_t method{hash_t::NONE};
+  uint16_t hashsz{0};
+  uint8_t hash[64];
+  int64_t total_bytes{0};
+  int64_t ranges{0};
+  int64_t laste_time{0};
+};
 #pragma pack(pop)
+static_assert(sizeof(part_segments_overlay) == sizeof(part_overlay_data));
 
 struct HashPrefix {
   const std::wstring_view prefix;
@@ -55,7 +76,8 @@ constexpr HashPrefix hnmaps[] = {
     {L"SHA3", hash_t::SHA3, 32},         // SHA3 alias for SHA3-256
 };
 
-inline bool hash_construct(std::wstring_view hash_value, part_overlay_data &overlay_data, bela::error_code &ec) {
+template <typename Overlay>
+inline bool hash_construct(std::wstring_view hash_value, Overlay &overlay_data, bela::error_code &ec) {
   std::wstring_view value = hash_value;
   overlay_data.method = hash_t::SHA256;
   overlay_data.hashsz = 32;
@@ -141,8 +163,9 @@ inline bool truncated_file(HANDLE fd, int64_t pos, bela::error_code &ec) {
 class FilePart {
 public:
   FilePart(HANDLE fd_, const std::filesystem::path &fsPath_, int64_t total_bytes_, int64_t current_bytes_,
-           int64_t recent_)
-      : fd(fd_), fsPath(fsPath_), total_bytes(total_bytes_), current_bytes(current_bytes_), laste_time(recent_) {}
+           int64_t recent_, std::vector<part_range> &&ranges_ = {})
+      : fd(fd_), fsPath(fsPath_), total_bytes(total_bytes_), current_bytes(current_bytes_), laste_time(recent_),
+        ranges(std::move(ranges_)) {}
   FilePart(const FilePart &) = delete;
   FilePart &operator=(const FilePart &) = delete;
   ~FilePart() noexcept { file_discard(); }
@@ -156,6 +179,74 @@ public:
     }
     current_bytes = 0;
     total_bytes = 0;
+    ranges.clear();
+    return true;
+  }
+  // Segmented: the part file was left by a segmented download, Ranges are the byte ranges still missing
+  bool Segmented() const { return !ranges.empty(); }
+  const auto &Ranges() const { return ranges; }
+  // Preallocate sizes the part file for positional writes of a segmented download
+  bool Preallocate(int64_t size, bela::error_code &ec) {
+    if (!truncated_file(fd, size, ec)) {
+      return false;
+    }
+    total_bytes = size;
+    current_bytes = 0;
+    ranges.clear();
+    return true;
+  }
+  // SaveSegmentsOverlay records the missing ranges of a preallocated part file so the next attempt resumes them
+  bool SaveSegmentsOverlay(std::wstring_view hash_value, const std::vector<part_range> &missing, bela::error_code &ec) {
+    if (!discard_file_handle) {
+      ec = bela::make_error_code(L"FilePart not a discard file");
+      return false;
+    }
+    if (missing.empty() || static_cast<int64_t>(missing.size()) > max_part_ranges) {
+      ec = bela::make_error_code(L"Current download not support part download");
+      return false;
+    }
+    part_segments_overlay overlay_data{
+        .magic = {'P', 'S', 'E', 'G'},
+        .method = hash_t::NONE,
+        .hashsz = {0},
+        .hash = {0},
+        .total_bytes = total_bytes,
+        .ranges = static_cast<int64_t>(missing.size()),
+        .laste_time = bela::ToUnixSeconds(bela::Now()),
+    };
+    if (!hash_construct(hash_value, overlay_data, ec)) {
+      return false;
+    }
+    if (auto fileSize = bela::io::Size(fd, ec); fileSize != total_bytes) {
+      ec = bela::make_error_code(L"FilePart size not equal total_bytes size");
+      return false;
+    }
+    if (!bela::io::Seek(fd, total_bytes, ec)) {
+      return false;
+    }
+    if (!WriteFull(missing.data(), missing.size() * sizeof(part_range), ec) || !WriteFull(overlay_data, ec)) {
+      return false;
+    }
+    discard_file_handle = false;
+    return true;
+  }
+  // WriteAt is a positional write, segments of a segmented download call it from several threads
+  bool WriteAt(const void *data, size_t bytes, int64_t offset, bela::error_code &ec) {
+    auto u8d = reinterpret_cast<const uint8_t *>(data);
+    while (bytes > 0) {
+      OVERLAPPED ov{};
+      ov.Offset = static_cast<DWORD>(offset);
+      ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+      DWORD dwSize = 0;
+      auto len = static_cast<DWORD>((std::min)(bytes, static_cast<size_t>(1024 * 1024 * 1024)));
+      if (WriteFile(fd, u8d, len, &dwSize, &ov) != TRUE) {
+        ec = bela::make_system_error_code(L"WriteFile() ");
+        return false;
+      }
+      u8d += dwSize;
+      bytes -= dwSize;
+      offset += dwSize;
+    }
     return true;
   }
   bool SaveOverlayData(std::wstring_view hash_value, int64_t total_bytes, int64_t current_bytes, bela::error_code &ec) {
@@ -298,6 +389,15 @@ public:
       }
       return std::make_optional<FilePart>(fd, fsPath, 0, 0, 0);
     }
+    if (bytes_equal(overlayDisk.magic, segments_magic)) {
+      if (auto fp = make_segmented_part(fd, fsPath, overlayInput, overlayDisk, seekTo, ec); fp) {
+        return fp;
+      }
+      if (!local_truncated()) {
+        return std::nullopt;
+      }
+      return std::make_optional<FilePart>(fd, fsPath, 0, 0, 0);
+    }
     if (!bytes_equal(overlayDisk.magic, part_magic) || !bytes_equal(overlayInput.hash, overlayDisk.hash) ||
         overlayDisk.method != overlayInput.method || overlayDisk.hashsz != overlayInput.hashsz) {
       if (!local_truncated()) {
@@ -319,7 +419,38 @@ private:
   int64_t total_bytes{0};
   int64_t current_bytes{0};
   int64_t laste_time{0};
+  std::vector<part_range> ranges;
   bool discard_file_handle{true};
+  static std::optional<FilePart> make_segmented_part(HANDLE fd, const std::filesystem::path &fsPath,
+                                                     const part_overlay_data &overlayInput,
+                                                     const part_overlay_data &overlayDisk, int64_t seekTo,
+                                                     bela::error_code &ec) {
+    part_segments_overlay so;
+    memcpy(&so, &overlayDisk, sizeof(so));
+    if (!bytes_equal(overlayInput.hash, so.hash) || so.method != overlayInput.method ||
+        so.hashsz != overlayInput.hashsz || so.ranges <= 0 || so.ranges > max_part_ranges ||
+        so.total_bytes + so.ranges * static_cast<int64_t>(sizeof(part_range)) != seekTo) {
+      return std::nullopt;
+    }
+    std::vector<part_range> missing(static_cast<size_t>(so.ranges));
+    size_t outSize = 0;
+    if (!bela::io::ReadAt(fd, missing.data(), missing.size() * sizeof(part_range), so.total_bytes, outSize, ec) ||
+        outSize != missing.size() * sizeof(part_range)) {
+      return std::nullopt;
+    }
+    int64_t missing_bytes = 0;
+    for (const auto &r : missing) {
+      if (r.from < 0 || r.from >= r.to || r.to > so.total_bytes) {
+        return std::nullopt;
+      }
+      missing_bytes += r.to - r.from;
+    }
+    if (!truncated_file(fd, so.total_bytes, ec)) {
+      return std::nullopt;
+    }
+    return std::make_optional<FilePart>(fd, fsPath, so.total_bytes, so.total_bytes - missing_bytes, so.laste_time,
+                                        std::move(missing));
+  }
   void file_discard() noexcept {
     if (fd != INVALID_HANDLE_VALUE) {
       if (discard_file_handle) {
@@ -330,4 +461,6 @@ private:
   }
 };
 
-} // namespace baulk::net::net_internal
\ No newline at end of file
+} // namespace baulk::net::net_internal
+
+#endif
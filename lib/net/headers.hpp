@@ -0,0 +1,111 @@
+// response header helpers shared by the WinHTTP and socket transports
+#ifndef BAULK_NET_HEADERS_HPP
+#define BAULK_NET_HEADERS_HPP
+#include <bela/strip.hpp>
+#include <bela/str_split.hpp>
+#include <baulk/net/types.hpp>
+
+namespace baulk::net::net_internal {
+
+inline std::optional<std::wstring> resolve_filename(std::wstring_view es) {
+  constexpr std::wstring_view fns = L"filename";
+  constexpr std::wstring_view fnsu = L"filename*";
+  constexpr std::wstring_view utf8 = L"UTF-8";
+  auto s = bela::StripAsciiWhitespace(es);
+  auto pos = s.find('=');
+  if (pos == std::wstring_view::npos) {
+    return std::nullopt;
+  }
+  auto field = bela::StripAsciiWhitespace(s.substr(0, pos));
+  auto v = bela::StripAsciiWhitespace(s.substr(pos + 1));
+  if (field == fns) {
+    bela::ConsumePrefix(&v, L"\"");
+    bela::ConsumeSuffix(&v, L"\"");
+    return std::make_optional<>(std::wstring(v));
+  }
+  if (field != fnsu) {
+    return std::nullopt;
+  }
+  if (pos = v.find(L"''"); pos == std::wstring_view::npos) {
+    bela::ConsumePrefix(&v, L"\"");
+    bela::ConsumeSuffix(&v, L"\"");
+    return std::make_optional<>(std::wstring(v));
+  }
+  if (bela::EqualsIgnoreCase(v.substr(0, pos), utf8)) {
+    auto name = v.substr(pos + 2);
+    return std::make_optional<>(bela::encode_into<char, wchar_t>(url_decode(name)));
+  }
+  // unsupported encoding
+  return std::nullopt;
+}
+
+// https://developer.mozilla.org/en-US/docs/Web/HTTP/Headers/Content-Disposition
+// https://www.rfc-editor.org/rfc/rfc6266#section-5
+inline std::optional<std::wstring> extract_filename(const headers_t &hkv) {
+  auto it = hkv.find(L"Content-Disposition");
+  if (it == hkv.end()) {
+    return std::nullopt;
+  }
+  std::vector<std::wstring_view> pvv = bela::StrSplit(it->second, bela::ByChar(';'), bela::SkipEmpty());
+  for (auto e : pvv) {
+    if (auto result = resolve_filename(e); result) {
+      return result;
+    }
+  }
+  return std::nullopt;
+}
+
+// content_length
+inline int64_t content_length(const headers_t &hkv) {
+  if (auto it = hkv.find(L"Content-Length"); it != hkv.end()) {
+    if (int64_t len = 0; bela::SimpleAtoi(bela::StripAsciiWhitespace(it->second), &len)) {
+      return len;
+    }
+  }
+  return -1;
+}
+
+inline bool enable_part_download(const headers_t &hkv) {
+  if (auto it = hkv.find(L"Accept-Ranges"); it != hkv.end()) {
+    return bela::EqualsIgnoreCase(bela::StripAsciiWhitespace(it->second), L"bytes");
+  }
+  return false;
+}
+
+struct content_range {
+  int64_t start{-1};
+  int64_t end{-1};   // inclusive
+  int64_t total{-1}; // -1: unknown ('*')
+};
+
+// parse 'Content-Range: bytes 100-999/1000'
+inline std::optional<content_range> parse_content_range(const headers_t &hkv) {
+  auto it = hkv.find(L"Content-Range");
+  if (it == hkv.end()) {
+    return std::nullopt;
+  }
+  std::wstring_view sv = bela::StripAsciiWhitespace(it->second);
+  if (!bela::ConsumePrefix(&sv, L"bytes ")) {
+    return std::nullopt;
+  }
+  auto dash = sv.find('-');
+  auto slash = sv.find('/');
+  if (dash == std::wstring_view::npos || slash == std::wstring_view::npos || dash > slash) {
+    return std::nullopt;
+  }
+  content_range cr;
+  if (!bela::SimpleAtoi(bela::StripAsciiWhitespace(sv.substr(0, dash)), &cr.start) ||
+      !bela::SimpleAtoi(bela::StripAsciiWhitespace(sv.substr(dash + 1, slash - dash - 1)), &cr.end)) {
+    return std::nullopt;
+  }
+  if (auto total = bela::StripAsciiWhitespace(sv.substr(slash + 1)); total != L"*") {
+    if (!bela::SimpleAtoi(total, &cr.total)) {
+      return std::nullopt;
+    }
+  }
+  return std::make_optional(cr);
+}
+
+} // namespace baulk::net::net_internal
+
+#endif
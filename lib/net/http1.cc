@@ -0,0 +1,816 @@
+//
+#include <bela/strip.hpp>
+#include <bela/ascii.hpp>
+#include <bela/str_split.hpp>
+#include <bela/str_join.hpp>
+#include <baulk/indicators.hpp>
+#include "http1.hpp"
+#include "file.hpp"
+#include "headers.hpp"
+#include "encoding.hpp"
+
+namespace baulk::net::http1 {
+
+std::optional<endpoint> parse_url(std::wstring_view url, bela::error_code &ec) {
+  endpoint ep;
+  std::wstring_view rest = url;
+  if (bela::StartsWithIgnoreCase(rest, L"https://")) {
+    rest.remove_prefix(8);
+    ep.tls = true;
+    ep.port = 443;
+  } else if (bela::StartsWithIgnoreCase(rest, L"http://")) {
+    rest.remove_prefix(7);
+  } else {
+    ec = bela::make_error_code(bela::ErrGeneral, L"unsupported url '", url, L"'");
+    return std::nullopt;
+  }
+  auto authority = rest.substr(0, rest.find_first_of(L"/?#"));
+  rest.remove_prefix(authority.size());
+  if (auto pos = authority.rfind('@'); pos != std::wstring_view::npos) {
+    authority.remove_prefix(pos + 1);
+  }
+  if (authority.empty()) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"url '", url, L"' missing host");
+    return std::nullopt;
+  }
+  ep.authority = authority;
+  auto host = authority;
+  // [::1]:8080
+  auto portsep = authority.rfind(':');
+  if (auto bracket = authority.rfind(']'); bracket != std::wstring_view::npos && portsep < bracket) {
+    portsep = std::wstring_view::npos;
+  }
+  if (portsep != std::wstring_view::npos) {
+    host = authority.substr(0, portsep);
+    if (int port = 0; !bela::SimpleAtoi(authority.substr(portsep + 1), &port) || port <= 0 || port > 65535) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"url '", url, L"' invalid port");
+      return std::nullopt;
+    } else {
+      ep.port = port;
+    }
+  }
+  bela::ConsumePrefix(&host, L"[");
+  bela::ConsumeSuffix(&host, L"]");
+  ep.host = host;
+  if (auto pos = rest.find('#'); pos != std::wstring_view::npos) {
+    rest = rest.substr(0, pos);
+  }
+  ep.uri = rest.empty() || rest.front() == '?' ? bela::StringCat(L"/", rest) : std::wstring(rest);
+  ep.filename = decoded_url_path_name(std::wstring_view(ep.uri).substr(0, ep.uri.find('?')));
+  return std::make_optional(std::move(ep));
+}
+
+std::optional<endpoint> resolve_location(const endpoint &base, std::wstring_view location, bela::error_code &ec) {
+  if (location.find(L"://") != std::wstring_view::npos) {
+    return parse_url(location, ec);
+  }
+  if (bela::StartsWith(location, L"//")) {
+    return parse_url(bela::StringCat(base.tls ? L"https:" : L"http:", location), ec);
+  }
+  if (bela::StartsWith(location, L"/")) {
+    return parse_url(bela::StringCat(base.tls ? L"https://" : L"http://", base.authority, location), ec);
+  }
+  std::wstring_view dir = base.uri;
+  dir = dir.substr(0, dir.find('?'));
+  dir = dir.substr(0, dir.rfind('/') + 1);
+  return parse_url(bela::StringCat(base.tls ? L"https://" : L"http://", base.authority, dir, location), ec);
+}
+
+bool connection::fill(bela::error_code &ec) {
+  if (pos == end) {
+    pos = end = 0;
+  } else if (pos > 0) {
+    memmove(buffer.data(), buffer.data() + pos, end - pos);
+    end -= pos;
+    pos = 0;
+  }
+  if (buffer.empty()) {
+    buffer.resize(64 * 1024);
+  }
+  if (end == buffer.size()) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"response header too large");
+    return false;
+  }
+  auto n = stream->Read(buffer.data() + end, buffer.size() - end, io_timeout, ec);
+  if (n < 0) {
+    return false;
+  }
+  if (n == 0) {
+    ec = bela::make_error_code(bela::ErrEnded, L"connection closed by peer");
+    return false;
+  }
+  end += static_cast<size_t>(n);
+  return true;
+}
+
+ssize_t connection::Read(void *buf, size_t len, bela::error_code &ec) {
+  if (pos < end) {
+    auto n = (std::min)(len, end - pos);
+    memcpy(buf, buffer.data() + pos, n);
+    pos += n;
+    return static_cast<ssize_t>(n);
+  }
+  return stream->Read(buf, len, io_timeout, ec);
+}
+
+bool connection::ReadLine(std::string &line, bela::error_code &ec) {
+  for (;;) {
+    std::string_view sv{buffer.data() + pos, end - pos};
+    if (auto lf = sv.find('\n'); lf != std::string_view::npos) {
+      auto l = sv.substr(0, lf);
+      bela::ConsumeSuffix(&l, "\r");
+      line.assign(l);
+      pos += lf + 1;
+      return true;
+    }
+    if (end - pos > max_header_bytes) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"response header line too long");
+      return false;
+    }
+    if (!fill(ec)) {
+      return false;
+    }
+  }
+}
+
+bool connection::ReadHead(minimal_response &mr, bela::error_code &ec) {
+  std::string line;
+  closed_before_response = false;
+  if (pos == end) {
+    if (!fill(ec)) {
+      closed_before_response = (ec.code == bela::ErrEnded);
+      return false;
+    }
+  }
+  if (!ReadLine(line, ec)) {
+    return false;
+  }
+  // HTTP/1.1 200 OK
+  std::string_view sl = line;
+  if (!bela::StartsWith(sl, "HTTP/1.")) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"malformed status line: ", bela::encode_into<char, wchar_t>(sl));
+    return false;
+  }
+  peer_http10 = bela::StartsWith(sl, "HTTP/1.0");
+  auto sp = sl.find(' ');
+  if (sp == std::string_view::npos) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"malformed status line: ", bela::encode_into<char, wchar_t>(sl));
+    return false;
+  }
+  sl.remove_prefix(sp + 1);
+  auto codestr = sl.substr(0, sl.find(' '));
+  if (uint32_t code = 0; bela::SimpleAtoi(codestr, &code) && code >= 100 && code < 1000) {
+    mr.status_code = code;
+  } else {
+    ec = bela::make_error_code(bela::ErrGeneral, L"malformed status code: ", bela::encode_into<char, wchar_t>(codestr));
+    return false;
+  }
+  sl.remove_prefix(codestr.size());
+  mr.status_text = bela::encode_into<char, wchar_t>(bela::StripAsciiWhitespace(sl));
+  mr.version = protocol_version::HTTP11;
+  mr.headers.clear();
+  size_t header_bytes = 0;
+  std::wstring last;
+  for (;;) {
+    if (!ReadLine(line, ec)) {
+      return false;
+    }
+    if (line.empty()) {
+      break;
+    }
+    if (header_bytes += line.size(); header_bytes > max_header_bytes) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"response header too large");
+      return false;
+    }
+    // obsolete line folding
+    if ((line.front() == ' ' || line.front() == '\t') && !last.empty()) {
+      if (auto it = mr.headers.find(last); it != mr.headers.end()) {
+        bela::StrAppend(&it->second, L" ", bela::encode_into<char, wchar_t>(bela::StripAsciiWhitespace(line)));
+      }
+      continue;
+    }
+    std::string_view hl = line;
+    auto colon = hl.find(':');
+    if (colon == std::string_view::npos) {
+      continue;
+    }
+    auto k = bela::encode_into<char, wchar_t>(bela::StripAsciiWhitespace(hl.substr(0, colon)));
+    auto v = bela::encode_into<char, wchar_t>(bela::StripAsciiWhitespace(hl.substr(colon + 1)));
+    if (auto it = mr.headers.find(k); it != mr.headers.end()) {
+      bela::StrAppend(&it->second, L", ", v);
+    } else {
+      mr.headers.emplace(k, std::move(v));
+    }
+    last = std::move(k);
+  }
+  return true;
+}
+
+inline bool header_has_token(const headers_t &hkv, std::wstring_view name, std::wstring_view token) {
+  auto it = hkv.find(name);
+  if (it == hkv.end()) {
+    return false;
+  }
+  std::vector<std::wstring_view> tokens = bela::StrSplit(it->second, bela::ByChar(','), bela::SkipEmpty());
+  for (auto t : tokens) {
+    if (bela::EqualsIgnoreCase(bela::StripAsciiWhitespace(t), token)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+body_reader::body_reader(connection &conn_, const minimal_response &mr, bool head_request) : conn(conn_) {
+  keep_alive = conn.PeerHTTP10() ? header_has_token(mr.headers, L"Connection", L"keep-alive")
+                                 : !header_has_token(mr.headers, L"Connection", L"close");
+  if (head_request || mr.status_code < 200 || mr.status_code == 204 || mr.status_code == 304) {
+    mode = body_mode::length;
+    length = 0;
+    completed = true;
+    return;
+  }
+  if (header_has_token(mr.headers, L"Transfer-Encoding", L"chunked")) {
+    mode = body_mode::chunked;
+    return;
+  }
+  if (auto it = mr.headers.find(L"Content-Length"); it != mr.headers.end()) {
+    if (int64_t len = 0; bela::SimpleAtoi(bela::StripAsciiWhitespace(it->second), &len) && len >= 0) {
+      mode = body_mode::length;
+      length = len;
+      remaining = len;
+      completed = (len == 0);
+      return;
+    }
+  }
+  mode = body_mode::close_delimited;
+}
+
+bool body_reader::read_chunk_size(bela::error_code &ec) {
+  std::string line;
+  if (chunk_crlf) {
+    if (!conn.ReadLine(line, ec)) {
+      return false;
+    }
+    chunk_crlf = false;
+  }
+  if (!conn.ReadLine(line, ec)) {
+    return false;
+  }
+  std::string_view sv = line;
+  sv = bela::StripAsciiWhitespace(sv.substr(0, sv.find(';')));
+  if (sv.empty() || sv.size() > 15) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"invalid chunk size");
+    return false;
+  }
+  int64_t size = 0;
+  for (auto c : sv) {
+    auto v = net_internal::hexval_table[static_cast<uint8_t>(c)];
+    if (v < 0) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"invalid chunk size");
+      return false;
+    }
+    size = (size << 4) | v;
+  }
+  if (size == 0) {
+    // trailer section
+    do {
+      if (!conn.ReadLine(line, ec)) {
+        return false;
+      }
+    } while (!line.empty());
+    completed = true;
+    return true;
+  }
+  remaining = size;
+  chunk_crlf = true;
+  return true;
+}
+
+ssize_t body_reader::Read(void *buf, size_t len, bela::error_code &ec) {
+  if (completed) {
+    return 0;
+  }
+  switch (mode) {
+  case body_mode::length: {
+    auto n = conn.Read(buf, static_cast<size_t>((std::min)(static_cast<int64_t>(len), remaining)), ec);
+    if (n <= 0) {
+      if (n == 0) {
+        ec = bela::make_error_code(bela::ErrGeneral, L"connection has been disconnected");
+      }
+      return -1;
+    }
+    if (remaining -= n; remaining == 0) {
+      completed = true;
+    }
+    return n;
+  }
+  case body_mode::chunked: {
+    if (remaining == 0) {
+      if (!read_chunk_size(ec)) {
+        return -1;
+      }
+      if (completed) {
+        return 0;
+      }
+    }
+    auto n = conn.Read(buf, static_cast<size_t>((std::min)(static_cast<int64_t>(len), remaining)), ec);
+    if (n <= 0) {
+      if (n == 0) {
+        ec = bela::make_error_code(bela::ErrGeneral, L"connection has been disconnected");
+      }
+      return -1;
+    }
+    remaining -= n;
+    return n;
+  }
+  default:
+    break;
+  }
+  auto n = conn.Read(buf, len, ec);
+  if (n == 0) {
+    completed = true;
+  }
+  return n;
+}
+
+bool body_reader::Discard(int64_t limit, bela::error_code &ec) {
+  char buffer[8192];
+  int64_t discarded = 0;
+  while (!completed) {
+    if (discarded > limit) {
+      return false;
+    }
+    auto n = Read(buffer, sizeof(buffer), ec);
+    if (n < 0) {
+      return false;
+    }
+    discarded += n;
+  }
+  return true;
+}
+
+struct client_context {
+  HttpClient &client;
+  const headers_t &hkv;
+  const std::vector<std::wstring> &cookies;
+  std::wstring_view user_agent;
+  std::wstring_view proxy; // empty: direct
+  const TlsHook &tls_hook;
+  connections &pool;
+  const pool_options &pool_opts;
+  bool insecure{false};
+  bool no_cache{false};
+  std::wstring ConnectionKey(const endpoint &ep) const {
+    auto key = bela::StringCat(ep.tls ? L"https://" : L"http://", ep.authority);
+    if (!proxy.empty()) {
+      bela::StrAppend(&key, L" via ", proxy);
+    }
+    return key;
+  }
+};
+
+struct exchange_options {
+  std::wstring_view method{L"GET"};
+  std::wstring_view content_type;
+  std::string_view body;
+  int64_t range_from{0};
+  const headers_t *headers{nullptr}; // per request headers, e.g. conditional ones
+  bool accept_encoding{false};       // advertise the content codings body_decoder understands
+};
+
+struct exchange {
+  std::unique_ptr<connection> conn;
+  minimal_response mr;
+  endpoint ep; // final endpoint after redirects
+  bool redirected{false};
+};
+
+std::string make_request_head(const client_context &ctx, const endpoint &ep, const exchange_options &opts) {
+  std::wstring head;
+  // absolute-form through a plain http proxy, https goes through a CONNECT tunnel
+  bela::StrAppend(&head, opts.method, L" ", !ctx.proxy.empty() && !ep.tls ? ep.URL() : ep.uri, L" HTTP/1.1\r\nHost: ",
+                  ep.authority, L"\r\n");
+  if (!ctx.hkv.contains(L"User-Agent")) {
+    bela::StrAppend(&head, L"User-Agent: ", ctx.user_agent, L"\r\n");
+  }
+  if (!ctx.hkv.contains(L"Accept")) {
+    head.append(L"Accept: */*\r\n");
+  }
+  if (opts.accept_encoding && !ctx.hkv.contains(L"Accept-Encoding")) {
+    bela::StrAppend(&head, L"Accept-Encoding: ", net_internal::accept_encoding, L"\r\n");
+  }
+  head.append(L"Connection: keep-alive\r\n");
+  if (ctx.no_cache) {
+    head.append(L"Cache-Control: no-cache\r\nPragma: no-cache\r\n");
+  }
+  for (const auto &[key, value] : ctx.hkv) {
+    bela::StrAppend(&head, key, L": ", value, L"\r\n");
+  }
+  if (opts.headers != nullptr) {
+    for (const auto &[key, value] : *opts.headers) {
+      bela::StrAppend(&head, key, L": ", value, L"\r\n");
+    }
+  }
+  if (opts.range_from > 0) {
+    bela::StrAppend(&head, L"Range: bytes=", opts.range_from, L"-\r\n");
+  }
+  if (!ctx.cookies.empty()) {
+    bela::StrAppend(&head, L"Cookie: ", bela::StrJoin(ctx.cookies, L"; "), L"\r\n");
+  }
+  if (!opts.body.empty()) {
+    bela::StrAppend(&head, L"Content-Type: ", opts.content_type.empty() ? L"text/plain" : opts.content_type,
+                    L"\r\nContent-Length: ", opts.body.size(), L"\r\n");
+  }
+  head.append(L"\r\n");
+  return bela::encode_into<wchar_t, char>(head);
+}
+
+// connect_tunnel asks an http proxy for a CONNECT tunnel. The response is read byte by byte up to the empty line so
+// nothing after it is consumed
+bool connect_tunnel(Conn &conn, const endpoint &ep, bela::error_code &ec) {
+  auto req = bela::encode_into<wchar_t, char>(bela::StringCat(L"CONNECT ", ep.authority, L" HTTP/1.1\r\nHost: ",
+                                                               ep.authority, L"\r\n\r\n"));
+  std::string_view sv = req;
+  while (!sv.empty()) {
+    auto n = conn.WriteTimeout(sv.data(), static_cast<uint32_t>(sv.size()), io_timeout);
+    if (n <= 0) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"proxy CONNECT: send failed");
+      return false;
+    }
+    sv.remove_prefix(static_cast<size_t>(n));
+  }
+  std::string resp;
+  char ch = 0;
+  while (!resp.ends_with("\r\n\r\n")) {
+    if (resp.size() > max_header_bytes) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"proxy CONNECT: response too large");
+      return false;
+    }
+    if (conn.ReadTimeout(&ch, 1, io_timeout) != 1) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"proxy CONNECT: connection closed");
+      return false;
+    }
+    resp.push_back(ch);
+  }
+  sv = resp;
+  sv = sv.substr(0, sv.find("\r\n"));
+  if (sv.size() < 12 || sv.substr(9, 3) != "200") {
+    ec = bela::make_error_code(bela::ErrGeneral, L"proxy CONNECT failed: ", bela::encode_into<char, wchar_t>(sv));
+    return false;
+  }
+  return true;
+}
+
+std::unique_ptr<connection> open_connection(const client_context &ctx, const endpoint &ep, bela::error_code &ec) {
+  std::wstring_view host = ep.host;
+  int port = ep.port;
+  std::optional<endpoint> pu;
+  if (!ctx.proxy.empty()) {
+    // HTTPS_PROXY=127.0.0.1:8080 is common, proxies are plain http either way
+    auto proxy = ctx.proxy.find(L"://") == std::wstring_view::npos ? bela::StringCat(L"http://", ctx.proxy)
+                                                                    : std::wstring(ctx.proxy);
+    if (pu = parse_url(proxy, ec); !pu) {
+      return nullptr;
+    }
+    host = pu->host;
+    port = pu->port;
+  }
+  auto conn = DialTimeout(host, port, dial_timeout, ec);
+  if (!conn) {
+    return nullptr;
+  }
+  ctx.client.DbgPrint(L"Connecting to %s:%d connected.", host, port);
+  if (!ep.tls) {
+    return std::make_unique<connection>(MakeTcpStream(std::move(*conn)), ctx.ConnectionKey(ep));
+  }
+  if (!ctx.tls_hook) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"socket transport: no TLS hook installed for ", ep.URL());
+    return nullptr;
+  }
+  if (pu && !connect_tunnel(*conn, ep, ec)) {
+    return nullptr;
+  }
+  auto stream = ctx.tls_hook(std::move(*conn), ep.host, ctx.insecure, ec);
+  if (!stream) {
+    return nullptr;
+  }
+  return std::make_unique<connection>(std::move(stream), ctx.ConnectionKey(ep));
+}
+
+inline bool is_redirect(unsigned long code) {
+  return code == 301 || code == 302 || code == 303 || code == 307 || code == 308;
+}
+
+// do_exchange sends one request and reads the response head, following redirects. A reused keep-alive connection
+// that turns out to be closed by the server is retried once on a new connection
+std::optional<exchange> do_exchange(const client_context &ctx, endpoint ep, exchange_options opts,
+                                    bela::error_code &ec) {
+  exchange ex;
+  for (int redirects = 0; redirects <= max_redirects; redirects++) {
+    std::unique_ptr<connection> conn;
+    bool received = false;
+    for (int attempt = 0; attempt < 2 && !received; attempt++) {
+      auto key = ctx.ConnectionKey(ep);
+      bool reused = false;
+      conn = ctx.pool.Take(key, ctx.pool_opts);
+      if (ctx.client.IsDebugMode()) {
+        auto stats = ctx.pool.Stats();
+        ctx.client.DbgPrint(L"%s %s (pool hits: %d misses: %d)",
+                            conn ? L"Re-using existing connection to" : L"No idle connection to", key, stats.hits,
+                            stats.misses);
+      }
+      if (conn) {
+        reused = true;
+      } else if (conn = open_connection(ctx, ep, ec); !conn) {
+        return std::nullopt;
+      }
+      auto request = make_request_head(ctx, ep, opts);
+      if (ctx.client.IsDebugMode()) {
+        bela::FPrintF(stderr, L"\x1b[33m> %s %s\x1b[0m\n", opts.method, ep.URL());
+      }
+      conn->MarkRequest();
+      if (!conn->WriteFull(request, ec) || (!opts.body.empty() && !conn->WriteFull(opts.body, ec))) {
+        if (reused) {
+          continue;
+        }
+        return std::nullopt;
+      }
+      // skip interim responses (100 Continue ...)
+      bool head = false;
+      do {
+        if (head = conn->ReadHead(ex.mr, ec); !head) {
+          break;
+        }
+      } while (ex.mr.status_code < 200 && ex.mr.status_code != 101);
+      if (head && ex.mr.status_code == 101) {
+        // the connection now speaks another protocol, requests never ask for an upgrade
+        ec = bela::make_error_code(bela::ErrGeneral, L"unsupported response: 101 Switching Protocols");
+        return std::nullopt;
+      }
+      // a head cut off after its status line is an error even though the status code is already set
+      if (!head) {
+        if (reused && conn->ClosedBeforeResponse()) {
+          ex.mr = minimal_response{};
+          continue;
+        }
+        return std::nullopt;
+      }
+      received = true;
+    }
+    if (!received) {
+      return std::nullopt;
+    }
+    if (ctx.client.IsDebugMode()) {
+      response_trace(ex.mr);
+    }
+    auto it = ex.mr.headers.find(L"Location");
+    if (!is_redirect(ex.mr.status_code) || it == ex.mr.headers.end()) {
+      ex.conn = std::move(conn);
+      ex.ep = std::move(ep);
+      return std::make_optional(std::move(ex));
+    }
+    auto next = resolve_location(ep, it->second, ec);
+    if (!next) {
+      return std::nullopt;
+    }
+    ctx.client.DbgPrint(L"Location: %s [following]", next->URL());
+    body_reader br(*conn, ex.mr, opts.method == L"HEAD");
+    if (bela::error_code discard_ec; br.Discard(64 * 1024, discard_ec) && br.Reusable()) {
+      ctx.pool.Put(std::move(conn), ctx.pool_opts);
+    }
+    if (ex.mr.status_code == 303 || (opts.method == L"POST" && ex.mr.status_code <= 302)) {
+      opts.method = L"GET";
+      opts.body = {};
+    }
+    ep = std::move(*next);
+    ex.redirected = true;
+    ex.mr = minimal_response{};
+  }
+  ec = bela::make_error_code(bela::ErrGeneral, L"stopped after ", max_redirects, L" redirects");
+  return std::nullopt;
+}
+
+// reader_source adapts a body_reader to the decompressors
+class reader_source final : public net_internal::body_source {
+public:
+  reader_source(body_reader &br_) : br(br_) {}
+  ssize_t Read(void *buffer, size_t len, bela::error_code &ec) override {
+    auto n = br.Read(buffer, len, ec);
+    if (n > 0) {
+      consumed += n;
+    }
+    return n;
+  }
+
+private:
+  body_reader &br;
+};
+
+} // namespace baulk::net::http1
+
+namespace baulk::net {
+
+std::optional<Response> HttpClient::SockRest(std::wstring_view method, std::wstring_view url,
+                                             std::wstring_view content_type, std::wstring_view body,
+                                             const headers_t &extra, bela::error_code &ec) {
+  auto ep = http1::parse_url(url, ec);
+  if (!ep) {
+    return std::nullopt;
+  }
+  http1::client_context ctx{.client = *this,
+                            .hkv = hkv,
+                            .cookies = cookies,
+                            .user_agent = userAgent,
+                            .proxy = IsNoProxy(ep->host) ? std::wstring_view{} : std::wstring_view{proxyURL},
+                            .tls_hook = tlsHook,
+                            .pool = *conns,
+                            .pool_opts = poolOptions,
+                            .insecure = insecureMode,
+                            .no_cache = noCache};
+  auto u8body = bela::encode_into<wchar_t, char>(body);
+  auto ex = http1::do_exchange(
+      ctx, std::move(*ep),
+      http1::exchange_options{
+          .method = method, .content_type = content_type, .body = u8body, .headers = &extra, .accept_encoding = true},
+      ec);
+  if (!ex) {
+    return std::nullopt;
+  }
+  http1::body_reader br(*ex->conn, ex->mr, method == L"HEAD");
+  std::vector<char> buffer;
+  size_t size = 0;
+  if (auto len = br.Length(); len > 0) {
+    buffer.resize(static_cast<size_t>((std::min)(static_cast<uint64_t>(len), static_cast<uint64_t>(max_body_size))));
+  }
+  while (size < max_body_size) {
+    if (buffer.size() == size) {
+      buffer.resize((std::min)((std::max)(size * 2, static_cast<size_t>(64 * 1024)), max_body_size));
+    }
+    auto n = br.Read(buffer.data() + size, buffer.size() - size, ec);
+    if (n < 0) {
+      return std::nullopt;
+    }
+    if (n == 0) {
+      break;
+    }
+    size += static_cast<size_t>(n);
+  }
+  if (br.Reusable()) {
+    conns->Put(std::move(ex->conn), poolOptions);
+  }
+  if (!net_internal::decode_body(ex->mr, buffer, size, max_body_size, ec)) {
+    return std::nullopt;
+  }
+  return std::make_optional<Response>(std::move(ex->mr), std::move(buffer), size);
+}
+
+std::optional<std::filesystem::path> HttpClient::SockGet(std::wstring_view url, const download_options &opts,
+                                                         bela::error_code &ec) {
+  auto ep = http1::parse_url(url, ec);
+  if (!ep) {
+    return std::nullopt;
+  }
+  http1::client_context ctx{.client = *this,
+                            .hkv = hkv,
+                            .cookies = cookies,
+                            .user_agent = userAgent,
+                            .proxy = IsNoProxy(ep->host) ? std::wstring_view{} : std::wstring_view{proxyURL},
+                            .tls_hook = tlsHook,
+                            .pool = *conns,
+                            .pool_opts = poolOptions,
+                            .insecure = insecureMode,
+                            .no_cache = noCache};
+  auto destination = opts.destination.empty() ? opts.cwd / ep->filename : opts.destination;
+  auto filePart = net_internal::FilePart::MakeFilePart(destination, opts.hash_value, ec);
+  if (!filePart) {
+    return std::nullopt;
+  }
+  // segmented part files are resumed by the WinHTTP transport only, the sink has to see the body from its first byte
+  if ((filePart->Segmented() || (opts.sink && filePart->CurrentBytes() != 0)) && !filePart->Truncated(ec)) {
+    return std::nullopt;
+  }
+  // only a download from the first byte may be encoded, ranges address bytes of the file itself
+  auto ex = http1::do_exchange(ctx, std::move(*ep),
+                               http1::exchange_options{.range_from = filePart->CurrentBytes(),
+                                                       .accept_encoding = filePart->CurrentBytes() == 0},
+                               ec);
+  if (!ex) {
+    return std::nullopt;
+  }
+  if (opts.destination.empty()) {
+    if (ex->redirected) {
+      destination = opts.cwd / ex->ep.filename;
+    }
+    if (auto dispositionName = net_internal::extract_filename(ex->mr.headers); dispositionName) {
+      DbgPrint(L"filename from 'Content-Disposition': %v", *dispositionName);
+      destination = opts.cwd / *dispositionName;
+    }
+  }
+  if (!make_destination_decorous(destination, opts.OverwriteExists(), ec)) {
+    return std::nullopt;
+  }
+  filePart->RenameTo(destination);
+  if (!ex->mr.IsSuccessStatusCode()) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"response: ", ex->mr.status_code, L" status: ", ex->mr.status_text);
+    return std::nullopt;
+  }
+  const auto &filename = ex->ep.filename;
+  // an encoded body is no byte range of the file, it cannot be resumed
+  auto afmt = net_internal::file_format_t::none;
+  if (!net_internal::content_encoding(ex->mr.headers, afmt, ec)) {
+    return std::nullopt;
+  }
+  auto encoded = afmt != net_internal::file_format_t::none;
+  if (encoded && net_internal::keep_encoding(destination.filename().native(), afmt)) {
+    DbgPrint(L"%s keeps its Content-Encoding: %s", filename, ex->mr.headers[L"Content-Encoding"]);
+    afmt = net_internal::file_format_t::none;
+  }
+  int64_t total_size = net_internal::content_length(ex->mr.headers);
+  bool part_support = !opts.hash_value.empty() && !encoded && net_internal::enable_part_download(ex->mr.headers) &&
+                      total_size > 0;
+  DbgPrint(L"%s support part download: %v", filename, part_support);
+  if (ex->mr.status_code != 206) {
+    if (!filePart->Truncated(ec)) {
+      return std::nullopt;
+    }
+  } else {
+    if (auto cr = net_internal::parse_content_range(ex->mr.headers); !cr || cr->start != filePart->CurrentBytes()) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"server resumed from byte ", cr ? cr->start : -1, L" expected ",
+                                 filePart->CurrentBytes());
+      return std::nullopt;
+    }
+    total_size += filePart->CurrentBytes();
+    part_support = !opts.hash_value.empty() && total_size > 0;
+    DbgPrint(L"%s download from bytes: %d", filename, filePart->CurrentBytes());
+  }
+  baulk::ProgressBar bar;
+  if (total_size > 0) {
+    bar.Maximum(static_cast<uint64_t>(total_size));
+  }
+  bar.FileName(destination.filename().native());
+  if (!opts.quiet) {
+    bar.Execute();
+  }
+  auto finish = bela::finally([&] {
+    // finish progressbar
+    bar.Finish();
+  });
+  int64_t current_bytes = filePart->CurrentBytes();
+  auto save_part_overlay = [&] {
+    if (!part_support) {
+      return;
+    }
+    bela::error_code discard_ec;
+    filePart->SaveOverlayData(opts.hash_value, total_size, current_bytes, discard_ec);
+    DbgPrint(L"%s download broken for bytes: %d-%d", filename, current_bytes, total_size);
+  };
+  http1::body_reader br(*ex->conn, ex->mr, false);
+  http1::reader_source src(br);
+  net_internal::body_decoder body(src);
+  if (!body.Initialize(afmt, ec)) {
+    bar.MarkFault();
+    return std::nullopt;
+  }
+  // progress counts the received (encoded) bytes against Content-Length
+  auto start_bytes = current_bytes;
+  std::vector<char> buffer(256 * 1024);
+  for (;;) {
+    auto n = body.Read(buffer.data(), buffer.size(), ec);
+    if (n < 0) {
+      current_bytes = start_bytes + src.Consumed();
+      save_part_overlay();
+      bar.MarkFault();
+      return std::nullopt;
+    }
+    if (n == 0) {
+      break;
+    }
+    if (!filePart->WriteFull(buffer.data(), static_cast<size_t>(n), ec)) {
+      bar.MarkFault();
+      return std::nullopt;
+    }
+    if (opts.sink && !opts.sink(buffer.data(), static_cast<size_t>(n), ec)) {
+      bar.MarkFault();
+      return std::nullopt;
+    }
+    current_bytes = start_bytes + src.Consumed();
+    bar.Update(current_bytes);
+  }
+  current_bytes = start_bytes + src.Consumed();
+  if (total_size > 0 && current_bytes < total_size) {
+    bar.MarkFault();
+    ec = bela::make_error_code(bela::ErrGeneral, L"connection has been disconnected");
+    save_part_overlay();
+    return std::nullopt;
+  }
+  if (br.Reusable()) {
+    conns->Put(std::move(ex->conn), poolOptions);
+  }
+  if (!filePart->Solidified(ec)) {
+    return std::nullopt;
+  }
+  bar.MarkCompleted();
+  return std::make_optional(std::move(destination));
+}
+
+} // namespace baulk::net
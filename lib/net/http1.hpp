@@ -0,0 +1,146 @@
+// HTTP/1.1 over baulk::net::Conn: the socket transport of HttpClient
+#ifndef BAULK_NET_HTTP1_HPP
+#define BAULK_NET_HTTP1_HPP
+#include <baulk/net/client.hpp>
+#include <baulk/net/tcp.hpp>
+#include <mutex>
+
+namespace baulk::net {
+// shared with the WinHTTP transport (client.cc)
+void response_trace(minimal_response &resp);
+bool make_destination_decorous(std::filesystem::path &destination, bool force_overwrite, bela::error_code &ec);
+} // namespace baulk::net
+
+namespace baulk::net::http1 {
+constexpr int dial_timeout = 15 * 1000; // milliseconds
+constexpr int io_timeout = 30 * 1000;   // milliseconds
+constexpr int max_redirects = 10;
+constexpr size_t max_header_bytes = 64 * 1024;
+
+struct endpoint {
+  std::wstring authority; // Host header: host[:port]
+  std::wstring host;      // name or address passed to DialTimeout
+  std::wstring uri;       // origin-form request target: path and query
+  std::wstring filename;  // decoded last path segment
+  int port{80};
+  bool tls{false};
+  std::wstring URL() const { return bela::StringCat(tls ? L"https://" : L"http://", authority, uri); }
+};
+std::optional<endpoint> parse_url(std::wstring_view url, bela::error_code &ec);
+// resolve_location resolves a Location header against the endpoint it was received from
+std::optional<endpoint> resolve_location(const endpoint &base, std::wstring_view location, bela::error_code &ec);
+
+// connection is a stream plus its read buffer. It is owned by one exchange at a time and parked in connections
+// between requests when the server allows keep-alive
+class connection {
+public:
+  connection(std::unique_ptr<Stream> &&stream_, std::wstring_view key_) : stream(std::move(stream_)), key(key_) {}
+  connection(const connection &) = delete;
+  connection &operator=(const connection &) = delete;
+  const std::wstring &Key() const { return key; }
+  bool WriteFull(std::string_view data, bela::error_code &ec) {
+    return stream->WriteFull(data.data(), data.size(), io_timeout, ec);
+  }
+  // Read serves buffered bytes first and then reads the stream directly
+  ssize_t Read(void *buf, size_t len, bela::error_code &ec);
+  // ReadLine reads a CRLF (or LF) terminated line, the terminator is stripped
+  bool ReadLine(std::string &line, bela::error_code &ec);
+  // ReadHead reads the status line and headers
+  bool ReadHead(minimal_response &mr, bela::error_code &ec);
+  // the peer closed the connection before sending any byte of the response: a stale keep-alive connection
+  bool ClosedBeforeResponse() const { return closed_before_response; }
+  bool PeerHTTP10() const { return peer_http10; }
+  uint32_t Requests() const { return requests; }
+  void MarkRequest() { requests++; }
+
+private:
+  bool fill(bela::error_code &ec);
+  std::unique_ptr<Stream> stream;
+  std::wstring key;
+  std::vector<char> buffer;
+  size_t pos{0};
+  size_t end{0};
+  uint32_t requests{0};
+  bool closed_before_response{false};
+  bool peer_http10{false};
+};
+
+// body_reader decodes a response body: Content-Length, chunked or delimited by connection close
+class body_reader {
+public:
+  body_reader(connection &conn_, const minimal_response &mr, bool head_request);
+  // Read returns the number of bytes read, 0 once the body is complete, -1 on error
+  ssize_t Read(void *buf, size_t len, bela::error_code &ec);
+  // Discard drains up to limit bytes so the connection can be reused
+  bool Discard(int64_t limit, bela::error_code &ec);
+  bool Completed() const { return completed; }
+  // Reusable reports whether the connection may carry another request
+  bool Reusable() const { return completed && keep_alive && mode != body_mode::close_delimited; }
+  int64_t Length() const { return mode == body_mode::length ? length : -1; }
+
+private:
+  enum class body_mode { length, chunked, close_delimited };
+  bool read_chunk_size(bela::error_code &ec);
+  connection &conn;
+  body_mode mode{body_mode::close_delimited};
+  int64_t length{-1};
+  int64_t remaining{0};
+  bool chunk_crlf{false};
+  bool completed{false};
+  bool keep_alive{true};
+};
+
+// connections keeps idle keep-alive connections by endpoint. At most max_per_host idle connections are kept per
+// endpoint (the oldest is closed first) and connections idle longer than idle_timeout are closed on the next Take
+class connections {
+public:
+  std::unique_ptr<connection> Take(const std::wstring &key, const pool_options &opts) {
+    std::scoped_lock lock(mu);
+    auto it = idle.find(key);
+    if (it == idle.end()) {
+      misses++;
+      return nullptr;
+    }
+    auto &v = it->second;
+    auto now = std::chrono::steady_clock::now();
+    std::erase_if(v, [&](const idle_connection &ic) { return now - ic.since > opts.idle_timeout; });
+    if (v.empty()) {
+      idle.erase(it);
+      misses++;
+      return nullptr;
+    }
+    auto conn = std::move(v.back().conn);
+    v.pop_back();
+    hits++;
+    return conn;
+  }
+  void Put(std::unique_ptr<connection> &&conn, const pool_options &opts) {
+    if (opts.max_per_host == 0) {
+      return;
+    }
+    std::scoped_lock lock(mu);
+    auto &v = idle[conn->Key()];
+    while (v.size() >= opts.max_per_host) {
+      v.erase(v.begin());
+    }
+    v.emplace_back(idle_connection{.conn = std::move(conn), .since = std::chrono::steady_clock::now()});
+  }
+  pool_stats Stats() const {
+    std::scoped_lock lock(mu);
+    return pool_stats{.hits = hits, .misses = misses};
+  }
+
+private:
+  struct idle_connection {
+    std::unique_ptr<connection> conn;
+    std::chrono::steady_clock::time_point since;
+  };
+  mutable std::mutex mu;
+  bela::flat_hash_map<std::wstring, std::vector<idle_connection>> idle;
+  uint64_t hits{0};
+  uint64_t misses{0};
+};
+
+} // namespace baulk::net::http1
+
+#endif
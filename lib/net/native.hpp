@@ -2,7 +2,11 @@
 #define BAULK_NET_NATIVE_HPP
 #include <bela/env.hpp>
 #include <bela/strip.hpp>
+#include <bela/phmap.hpp>
 #include <baulk/net/types.hpp>
+#include <baulk/net/client.hpp>
+#include "headers.hpp"
+#include <mutex>
 #include <schannel.h>
 #include <ws2tcpip.h>
 #include <winhttp.h>
@@ -143,75 +147,15 @@ private:
   }
 };
 
-inline std::optional<std::wstring> resolve_filename(std::wstring_view es) {
-  constexpr std::wstring_view fns = L"filename";
-  constexpr std::wstring_view fnsu = L"filename*";
-  constexpr std::wstring_view utf8 = L"UTF-8";
-  auto s = bela::StripAsciiWhitespace(es);
-  auto pos = s.find('=');
-  if (pos == std::wstring_view::npos) {
-    return std::nullopt;
-  }
-  auto field = bela::StripAsciiWhitespace(s.substr(0, pos));
-  auto v = bela::StripAsciiWhitespace(s.substr(pos + 1));
-  if (field == fns) {
-    bela::ConsumePrefix(&v, L"\"");
-    bela::ConsumeSuffix(&v, L"\"");
-    return std::make_optional<>(std::wstring(v));
-  }
-  if (field != fnsu) {
-    return std::nullopt;
-  }
-  if (pos = v.find(L"''"); pos == std::wstring_view::npos) {
-    bela::ConsumePrefix(&v, L"\"");
-    bela::ConsumeSuffix(&v, L"\"");
-    return std::make_optional<>(std::wstring(v));
-  }
-  if (bela::EqualsIgnoreCase(v.substr(0, pos), utf8)) {
-    auto name = v.substr(pos + 2);
-    return std::make_optional<>(bela::encode_into<char, wchar_t>(url_decode(name)));
-  }
-  // unsupported encoding
-  return std::nullopt;
-}
-
-// https://developer.mozilla.org/en-US/docs/Web/HTTP/Headers/Content-Disposition
-// https://www.rfc-editor.org/rfc/rfc6266#section-5
-inline std::optional<std::wstring> extract_filename(const headers_t &hkv) {
-  auto it = hkv.find(L"Content-Disposition");
-  if (it == hkv.end()) {
-    return std::nullopt;
-  }
-  std::vector<std::wstring_view> pvv = bela::StrSplit(it->second, bela::ByChar(';'), bela::SkipEmpty());
-  for (auto e : pvv) {
-    if (auto result = resolve_filename(e); result) {
-      return result;
-    }
-  }
-  return std::nullopt;
-}
-
-// content_length
-inline int64_t content_length(const headers_t &hkv) {
-  if (auto it = hkv.find(L"Content-Length"); it != hkv.end()) {
-    if (int64_t len = 0; bela::SimpleAtoi(bela::StripAsciiWhitespace(it->second), &len)) {
-      return len;
-    }
-  }
-  return -1;
-}
-
-inline bool enable_part_download(const headers_t &hkv) {
-  if (auto it = hkv.find(L"Accept-Ranges"); it != hkv.end()) {
-    return bela::EqualsIgnoreCase(bela::StripAsciiWhitespace(it->second), L"bytes");
-  }
-  return false;
-}
+using net_internal::content_length;
+using net_internal::enable_part_download;
+using net_internal::extract_filename;
 
 class handle {
 public:
   handle() = default;
   handle(HINTERNET h_) : h(h_) {}
+  handle(handle &&other) noexcept : h(std::exchange(other.h, nullptr)) {}
   handle(const handle &) = delete;
   handle &operator=(const handle &) = delete;
   ~handle() {
@@ -241,6 +185,20 @@ public:
       WinHttpSetOption(h, WINHTTP_OPTION_ENABLE_HTTP_PROTOCOL, &all_protocols, sizeof(all_protocols));
     }
   }
+  void set_max_conns_per_server(uint32_t n) {
+    // limit WinHTTP's keep-alive sockets per server, 0 keeps the WinHTTP default
+    if (n == 0) {
+      return;
+    }
+    DWORD dwValue = n;
+    WinHttpSetOption(h, WINHTTP_OPTION_MAX_CONNS_PER_SERVER, &dwValue, sizeof(dwValue));
+    WinHttpSetOption(h, WINHTTP_OPTION_MAX_CONNS_PER_1_0_SERVER, &dwValue, sizeof(dwValue));
+  }
+  void set_receive_timeout(int timeout) {
+    // milliseconds, a receive that waits longer fails with ERROR_WINHTTP_TIMEOUT
+    DWORD dwValue = static_cast<DWORD>(timeout);
+    WinHttpSetOption(h, WINHTTP_OPTION_RECEIVE_TIMEOUT, &dwValue, sizeof(dwValue));
+  }
   void set_insecure_mode() {
     // Ignore check tls
     DWORD dwFlags = SECURITY_FLAG_IGNORE_UNKNOWN_CA | SECURITY_FLAG_IGNORE_CERT_WRONG_USAGE |
@@ -249,16 +207,18 @@ public:
   }
 
   // fill header
-  bool write_headers(const headers_t &hkv, const std::vector<std::wstring> &cookies, int64_t position, int64_t length,
+  // part download: position > 0 requests 'bytes=position-', end > 0 requests the closed range [position, end)
+  bool write_headers(const headers_t &hkv, const std::vector<std::wstring> &cookies, int64_t position, int64_t end,
                      bela::error_code &ec) {
     std::wstring flattened_headers;
     for (const auto &[key, value] : hkv) {
       bela::StrAppend(&flattened_headers, key, L": ", value, L"\r\n");
     }
-    // part download
-    if (position > 0) {
-      // https://developer.mozilla.org/zh-CN/docs/Web/HTTP/Headers/Range
-      bela::StrAppend(&flattened_headers, L"Range: bytes=", position, L"-");
+    // https://developer.mozilla.org/zh-CN/docs/Web/HTTP/Headers/Range
+    if (end > 0) {
+      bela::StrAppend(&flattened_headers, L"Range: bytes=", position, L"-", end - 1, L"\r\n");
+    } else if (position > 0) {
+      bela::StrAppend(&flattened_headers, L"Range: bytes=", position, L"-\r\n");
     }
     if (!cookies.empty()) {
       bela::StrAppend(&flattened_headers, L"Cookie: ", bela::StrJoin(cookies, L"; "), L"\r\n");
@@ -451,6 +411,70 @@ inline std::optional<handle> make_session(std::wstring_view ua, bela::error_code
   return std::make_optional<handle>(hSession);
 }
 
+// session_pool caches session and connect handles across requests. WinHTTP keeps idle keep-alive sockets (and their
+// TLS sessions) inside the session handle, so requests to the same host skip DNS, TCP and TLS handshakes. A session
+// that has been idle longer than pool_options::idle_timeout is replaced, which closes its sockets.
+class session_pool {
+public:
+  struct lease {
+    std::shared_ptr<handle> session;
+    std::shared_ptr<handle> conn; // released before session
+    bool reused{false};
+  };
+  std::optional<lease> acquire(std::wstring_view ua, std::wstring_view proxy, const url &u, const pool_options &opts,
+                               bela::error_code &ec) {
+    std::scoped_lock lock(mu);
+    auto now = std::chrono::steady_clock::now();
+    auto &se = sessions[bela::StringCat(ua, L"|", proxy)];
+    if (se.session && now - se.last_used > opts.idle_timeout) {
+      se.conns.clear();
+      se.session.reset();
+    }
+    if (!se.session) {
+      auto session = make_session(ua, ec);
+      if (!session) {
+        return std::nullopt;
+      }
+      if (!proxy.empty()) {
+        std::wstring proxyURL(proxy);
+        session->set_proxy_url(proxyURL);
+      }
+      session->protocol_enable();
+      session->set_max_conns_per_server(opts.max_per_host);
+      se.session = std::make_shared<handle>(std::move(*session));
+    }
+    se.last_used = now;
+    auto key = bela::StringCat(u.host, L":", u.nPort);
+    if (auto it = se.conns.find(key); it != se.conns.end()) {
+      hits++;
+      return std::make_optional(lease{.session = se.session, .conn = it->second, .reused = true});
+    }
+    auto conn = se.session->connect(u.host, u.nPort, ec);
+    if (!conn) {
+      return std::nullopt;
+    }
+    misses++;
+    auto sc = std::make_shared<handle>(std::move(*conn));
+    se.conns.emplace(std::move(key), sc);
+    return std::make_optional(lease{.session = se.session, .conn = std::move(sc), .reused = false});
+  }
+  pool_stats stats() const {
+    std::scoped_lock lock(mu);
+    return pool_stats{.hits = hits, .misses = misses};
+  }
+
+private:
+  struct session_entry {
+    std::shared_ptr<handle> session;
+    bela::flat_hash_map<std::wstring, std::shared_ptr<handle>> conns; // destroyed before session
+    std::chrono::steady_clock::time_point last_used;
+  };
+  mutable std::mutex mu;
+  bela::flat_hash_map<std::wstring, session_entry> sessions; // by user agent and proxy
+  uint64_t hits{0};
+  uint64_t misses{0};
+};
+
 } // namespace baulk::net::native
 
 #endif
\ No newline at end of file
@@ -0,0 +1,401 @@
+//
+#include <bela/ascii.hpp>
+#include <bela/match.hpp>
+#include <bela/str_split_narrow.hpp>
+#include <baulk/net/peer.hpp>
+#include <baulk/hash.hpp>
+#include <algorithm>
+#include <charconv>
+#include <mutex>
+#include <thread>
+#include "native.hpp"
+
+namespace baulk::net {
+namespace {
+constexpr int peer_io_timeout = 30 * 1000;  // milliseconds
+constexpr int peer_idle_timeout = 5 * 1000; // milliseconds a keep-alive connection waits for its next request
+constexpr int peer_probe_timeout = 1000;    // milliseconds, dial deadline of a peer before it is asked
+constexpr size_t peer_max_head = 16 * 1024;
+constexpr size_t peer_buffer_size = 256 * 1024;
+constexpr size_t peer_max_connections = 64;
+constexpr int peer_accept_timeout = 200; // milliseconds, how often Serve looks at stopped
+
+inline bool valid_key(std::string_view key) {
+  return !key.empty() && std::all_of(key.begin(), key.end(), [](char c) {
+    return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-';
+  });
+}
+
+inline bool parse_int(std::string_view s, int64_t &v) {
+  auto r = std::from_chars(s.data(), s.data() + s.size(), v);
+  return r.ec == std::errc{} && r.ptr == s.data() + s.size();
+}
+
+// parse_range resolves a single 'bytes=' range against size, false when it cannot be satisfied
+bool parse_range(std::string_view range, int64_t size, int64_t &from, int64_t &last) {
+  constexpr std::string_view unit = "bytes=";
+  if (!range.starts_with(unit) || range.find(',') != std::string_view::npos) {
+    return false;
+  }
+  range.remove_prefix(unit.size());
+  auto dash = range.find('-');
+  if (dash == std::string_view::npos) {
+    return false;
+  }
+  auto first = range.substr(0, dash);
+  auto second = range.substr(dash + 1);
+  last = size - 1;
+  if (first.empty()) {
+    // suffix range: the last n bytes
+    int64_t n = 0;
+    if (!parse_int(second, n) || n <= 0 || size == 0) {
+      return false;
+    }
+    from = (std::max)(size - n, static_cast<int64_t>(0));
+    return true;
+  }
+  if (!parse_int(first, from) || from >= size) {
+    return false;
+  }
+  if (!second.empty()) {
+    int64_t l = 0;
+    if (!parse_int(second, l) || l < from) {
+      return false;
+    }
+    last = (std::min)(l, size - 1);
+  }
+  return true;
+}
+
+struct peer_request {
+  std::string head;
+  std::string_view method;
+  std::string_view path;
+  std::string_view range;
+  bool keep_alive{true};
+};
+
+// read_request reads the next request head of a connection, false when the peer closed it, went idle or misbehaved
+bool read_request(Stream &stream, std::string &inbuf, peer_request &req, bela::error_code &ec) {
+  char buffer[4096];
+  size_t headend = 0;
+  auto timeout = inbuf.empty() ? peer_idle_timeout : peer_io_timeout;
+  while ((headend = inbuf.find("\r\n\r\n")) == std::string::npos) {
+    if (inbuf.size() > peer_max_head) {
+      return false;
+    }
+    auto n = stream.Read(buffer, sizeof(buffer), timeout, ec);
+    if (n <= 0) {
+      return false;
+    }
+    inbuf.append(buffer, static_cast<size_t>(n));
+    timeout = peer_io_timeout;
+  }
+  req.head = inbuf.substr(0, headend);
+  inbuf.erase(0, headend + 4);
+  std::vector<std::string_view> lines = bela::narrow::StrSplit(req.head, bela::narrow::ByString("\r\n"));
+  std::vector<std::string_view> rl = bela::narrow::StrSplit(lines[0], bela::narrow::ByChar(' '));
+  if (rl.size() != 3) {
+    return false;
+  }
+  req.method = rl[0];
+  req.path = rl[1].substr(0, rl[1].find('?'));
+  req.keep_alive = rl[2] != "HTTP/1.0";
+  for (size_t i = 1; i < lines.size(); i++) {
+    auto line = lines[i];
+    auto colon = line.find(':');
+    if (colon == std::string_view::npos) {
+      continue;
+    }
+    auto name = bela::StripAsciiWhitespace(line.substr(0, colon));
+    auto value = bela::StripAsciiWhitespace(line.substr(colon + 1));
+    if (bela::EqualsIgnoreCase(name, "Range")) {
+      req.range = value;
+    } else if (bela::EqualsIgnoreCase(name, "Connection")) {
+      req.keep_alive = !bela::EqualsIgnoreCase(value, "close");
+    }
+  }
+  return true;
+}
+
+inline bool write_head(Stream &stream, std::wstring_view status, std::wstring_view headers, int64_t length,
+                       bool keep_alive, bela::error_code &ec) {
+  auto head = bela::encode_into<wchar_t, char>(bela::StringCat(L"HTTP/1.1 ", status, L"\r\nServer: baulk\r\n", headers,
+                                                               L"Content-Length: ", length, L"\r\n",
+                                                               keep_alive ? L"" : L"Connection: close\r\n", L"\r\n"));
+  return stream.WriteFull(head.data(), head.size(), peer_io_timeout, ec);
+}
+} // namespace
+
+// reap joins the threads of finished connections, lock is held on entry and on return
+void PeerServer::reap(std::unique_lock<std::mutex> &lock) {
+  while (!finished.empty()) {
+    auto id = finished.back();
+    finished.pop_back();
+    auto it = workers.find(id);
+    if (it == workers.end()) {
+      continue;
+    }
+    auto t = std::move(it->second);
+    workers.erase(it);
+    lock.unlock();
+    t.join();
+    lock.lock();
+  }
+}
+
+void PeerServer::Serve(Listener &l) {
+  {
+    std::scoped_lock lock(mu);
+    serving = true;
+  }
+  while (!stopped) {
+    {
+      std::unique_lock lock(mu);
+      reap(lock);
+      if (workers.size() >= peer_max_connections) {
+        cv.wait_for(lock, std::chrono::milliseconds(peer_accept_timeout),
+                    [&] { return !finished.empty() || stopped.load(); });
+        continue;
+      }
+    }
+    bela::error_code ec;
+    auto conn = l.Accept(peer_accept_timeout, ec);
+    if (!conn) {
+      continue;
+    }
+    std::scoped_lock lock(mu);
+    auto id = next_id++;
+    workers.emplace(id, std::thread([this, id, c = std::move(*conn)]() mutable {
+                      serve_connection(std::move(c));
+                      std::scoped_lock lock(mu);
+                      finished.emplace_back(id);
+                      cv.notify_all();
+                    }));
+  }
+  std::unique_lock lock(mu);
+  while (!workers.empty()) {
+    cv.wait(lock, [&] { return !finished.empty(); });
+    reap(lock);
+  }
+  serving = false;
+  cv.notify_all();
+}
+
+void PeerServer::Stop() {
+  std::unique_lock lock(mu);
+  stopped = true;
+  cv.notify_all();
+  cv.wait(lock, [&] { return !serving; });
+}
+
+void PeerServer::serve_connection(Conn &&conn) {
+  auto stream = MakeTcpStream(std::move(conn));
+  std::string inbuf;
+  std::vector<char> buffer;
+  while (!stopped) {
+    bela::error_code ec;
+    peer_request req;
+    if (!read_request(*stream, inbuf, req, ec)) {
+      return;
+    }
+    requests++;
+    auto head_only = req.method == "HEAD";
+    if (req.method != "GET" && !head_only) {
+      if (!write_head(*stream, L"405 Method Not Allowed", L"Allow: GET, HEAD\r\n", 0, req.keep_alive, ec) ||
+          !req.keep_alive) {
+        return;
+      }
+      continue;
+    }
+    constexpr std::string_view prefix = "/blobs/";
+    if (!req.path.starts_with(prefix)) {
+      if (!write_head(*stream, L"404 Not Found", L"", 0, req.keep_alive, ec) || !req.keep_alive) {
+        return;
+      }
+      continue;
+    }
+    auto key = req.path.substr(prefix.size());
+    if (key.empty()) {
+      // listing: one 'digest size' line per blob
+      std::string listing;
+      std::error_code e;
+      for (const auto &p : std::filesystem::directory_iterator{root, e}) {
+        auto name = bela::encode_into<wchar_t, char>(p.path().filename().native());
+        if (!valid_key(name) || !p.is_regular_file(e)) {
+          continue;
+        }
+        listing.append(name).append(" ").append(std::to_string(p.file_size(e))).append("\n");
+      }
+      if (!write_head(*stream, L"200 OK", L"Content-Type: text/plain; charset=utf-8\r\n",
+                      static_cast<int64_t>(listing.size()), req.keep_alive, ec) ||
+          (!head_only && !stream->WriteFull(listing.data(), listing.size(), peer_io_timeout, ec)) || !req.keep_alive) {
+        return;
+      }
+      continue;
+    }
+    FILE *fd = nullptr;
+    // the key alphabet keeps requests inside root: no dots, no separators
+    if (!valid_key(key) ||
+        _wfopen_s(&fd, (root / bela::encode_into<char, wchar_t>(key)).c_str(), L"rb") != 0 || fd == nullptr) {
+      if (!write_head(*stream, L"404 Not Found", L"", 0, req.keep_alive, ec) || !req.keep_alive) {
+        return;
+      }
+      continue;
+    }
+    auto closer = bela::finally([&] { fclose(fd); });
+    _fseeki64(fd, 0, SEEK_END);
+    auto size = _ftelli64(fd);
+    int64_t from = 0;
+    int64_t last = size - 1;
+    std::wstring_view status = L"200 OK";
+    std::wstring headers = L"Accept-Ranges: bytes\r\nContent-Type: application/octet-stream\r\n";
+    if (!req.range.empty()) {
+      if (!parse_range(req.range, size, from, last)) {
+        if (!write_head(*stream, L"416 Range Not Satisfiable", bela::StringCat(L"Content-Range: bytes */", size, L"\r\n"),
+                        0, req.keep_alive, ec) ||
+            !req.keep_alive) {
+          return;
+        }
+        continue;
+      }
+      status = L"206 Partial Content";
+      bela::StrAppend(&headers, L"Content-Range: bytes ", from, L"-", last, L"/", size, L"\r\n");
+    }
+    auto length = size == 0 ? 0 : last + 1 - from;
+    if (!write_head(*stream, status, headers, length, req.keep_alive, ec)) {
+      return;
+    }
+    if (!head_only && length > 0) {
+      buffer.resize(peer_buffer_size);
+      _fseeki64(fd, from, SEEK_SET);
+      while (length > 0) {
+        auto n = fread(buffer.data(), 1, static_cast<size_t>((std::min)(length, static_cast<int64_t>(buffer.size()))),
+                       fd);
+        if (n == 0) {
+          // the blob shrank underneath us, the client sees a short body
+          return;
+        }
+        if (!stream->WriteFull(buffer.data(), n, peer_io_timeout, ec)) {
+          return;
+        }
+        length -= static_cast<int64_t>(n);
+        served += n;
+      }
+    }
+    if (!req.keep_alive) {
+      return;
+    }
+  }
+}
+
+// peer_set remembers which peers answer, a peer that fails or returns a corrupt blob is not asked again
+class peer_set {
+public:
+  explicit peer_set(const std::vector<std::wstring> &urls) {
+    for (const auto &u : urls) {
+      std::wstring_view url(u);
+      while (url.ends_with(L'/')) {
+        url.remove_suffix(1);
+      }
+      if (!url.empty()) {
+        peers.emplace_back(peer{.url = std::wstring(url)});
+      }
+    }
+  }
+  size_t Size() const { return peers.size(); }
+  const std::wstring &URL(size_t i) const { return peers[i].url; }
+  // Usable dials an unprobed peer once, an offline peer costs one short connect per client
+  bool Usable(size_t i) {
+    {
+      std::scoped_lock lock(mu);
+      if (peers[i].state != peer_state::unknown) {
+        return peers[i].state == peer_state::reachable;
+      }
+    }
+    bela::error_code ec;
+    auto reachable = false;
+    if (auto u = native::crack_url(peers[i].url, ec); u) {
+      reachable = DialTimeout(u->host, u->nPort, peer_probe_timeout, ec).has_value();
+    }
+    std::scoped_lock lock(mu);
+    if (peers[i].state == peer_state::unknown) {
+      peers[i].state = reachable ? peer_state::reachable : peer_state::failed;
+    }
+    return peers[i].state == peer_state::reachable;
+  }
+  void Fail(size_t i) {
+    std::scoped_lock lock(mu);
+    peers[i].state = peer_state::failed;
+  }
+
+private:
+  enum class peer_state { unknown, reachable, failed };
+  struct peer {
+    std::wstring url;
+    peer_state state{peer_state::unknown};
+  };
+  std::mutex mu;
+  std::vector<peer> peers;
+};
+
+void HttpClient::SetPeers(const std::vector<std::wstring> &urls) {
+  peers.reset();
+  if (auto ps = std::make_shared<peer_set>(urls); ps->Size() != 0) {
+    peers = std::move(ps);
+  }
+}
+
+std::optional<std::filesystem::path> HttpClient::PeerGet(std::wstring_view url, const download_options &opts,
+                                                         bool &fallback, bela::error_code &ec) {
+  fallback = true;
+  auto key = baulk::hash::HashKey(opts.hash_value, ec);
+  if (!key) {
+    return std::nullopt;
+  }
+  auto po = opts;
+  if (po.destination.empty()) {
+    po.destination = opts.cwd / url_path_name(url);
+  }
+  for (size_t i = 0; i < peers->Size(); i++) {
+    if (!peers->Usable(i)) {
+      continue;
+    }
+    auto peerURL = bela::StringCat(peers->URL(i), L"/blobs/", *key);
+    baulk::hash::Verifier verifier;
+    if (!verifier.Initialize(opts.hash_value, ec)) {
+      return std::nullopt;
+    }
+    size_t forwarded = 0;
+    po.sink = [&](const void *data, size_t len, bela::error_code &sec) {
+      verifier.Update(data, len);
+      if (!opts.sink) {
+        return true;
+      }
+      forwarded += len;
+      return opts.sink(data, len, sec);
+    };
+    DbgPrint(L"peer: try %s", peerURL);
+    auto file = OriginGet(peerURL, po, ec);
+    if (file && verifier.Equal(ec)) {
+      DbgPrint(L"peer: %s served by %s", po.destination.filename(), peers->URL(i));
+      return file;
+    }
+    peers->Fail(i);
+    if (file) {
+      // whatever the peer had, it is not what the manifest names
+      std::error_code e;
+      std::filesystem::remove(*file, e);
+      ec = bela::make_error_code(bela::ErrGeneral, L"peer ", peers->URL(i), L" returned a corrupt blob: ", ec.message);
+    }
+    DbgPrint(L"peer: %s: %s", peers->URL(i), ec);
+    if (forwarded != 0) {
+      // the caller's sink has seen part of a bad body, it has to start over
+      fallback = false;
+      return std::nullopt;
+    }
+  }
+  return std::nullopt;
+}
+
+} // namespace baulk::net
@@ -0,0 +1,231 @@
+//
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "segments.hpp"
+
+namespace baulk::net::native {
+
+std::vector<net_internal::part_range> split_ranges(int64_t total, uint32_t segments) {
+  std::vector<net_internal::part_range> ranges;
+  auto n = (std::max)(static_cast<int64_t>(1), (std::min)(static_cast<int64_t>(segments), total / min_segment_size));
+  auto step = (total + n - 1) / n;
+  for (int64_t from = 0; from < total; from += step) {
+    ranges.emplace_back(net_internal::part_range{.from = from, .to = (std::min)(from + step, total)});
+  }
+  return ranges;
+}
+
+namespace {
+constexpr size_t segment_buffer_size = 256 * 1024;
+
+class segment_scheduler {
+public:
+  segment_scheduler(const std::vector<net_internal::part_range> &missing, int64_t total_) : total(total_) {
+    for (const auto &r : missing) {
+      segments.emplace_back(segment{.current = r.from, .end = r.to});
+      remaining += r.to - r.from;
+    }
+  }
+  // Acquire hands an idle worker a segment: an unclaimed one first, otherwise the upper half of the largest segment
+  // in flight. It waits while the work left is too small to split and returns false once everything is downloaded
+  // or the download failed
+  bool Acquire(size_t &index) {
+    std::unique_lock lock(mu);
+    for (;;) {
+      if (failed) {
+        return false;
+      }
+      size_t active = 0;
+      size_t largest = 0;
+      int64_t largest_remaining = 0;
+      for (size_t i = 0; i < segments.size(); i++) {
+        auto &s = segments[i];
+        if (s.current >= s.end) {
+          continue;
+        }
+        if (!s.active) {
+          s.active = true;
+          index = i;
+          return true;
+        }
+        active++;
+        if (auto r = s.end - s.current; r > largest_remaining) {
+          largest_remaining = r;
+          largest = i;
+        }
+      }
+      if (active == 0) {
+        return false;
+      }
+      // the split point stays more than one read buffer ahead of the victim, so no byte is written twice
+      if (largest_remaining >= 2 * min_segment_size) {
+        auto mid = segments[largest].current + largest_remaining / 2;
+        auto end = segments[largest].end;
+        segments[largest].end = mid;
+        segments.emplace_back(segment{.current = mid, .end = end, .active = true});
+        index = segments.size() - 1;
+        return true;
+      }
+      cv.wait(lock);
+    }
+  }
+  // Clip returns the write offset and how many of n received bytes still belong to the segment
+  int64_t Clip(size_t index, int64_t n, int64_t &offset) {
+    std::scoped_lock lock(mu);
+    auto &s = segments[index];
+    offset = s.current;
+    return (std::min)(n, s.end - s.current);
+  }
+  // Advance records n written bytes and returns the bytes downloaded in total, 'more' is false once the segment is
+  // complete
+  int64_t Advance(size_t index, int64_t n, bool &more) {
+    std::scoped_lock lock(mu);
+    auto &s = segments[index];
+    s.current += n;
+    remaining -= n;
+    more = s.current < s.end;
+    return total - remaining;
+  }
+  void Release(size_t index, bool ok, const bela::error_code &ec) {
+    std::scoped_lock lock(mu);
+    segments[index].active = false;
+    if (!ok) {
+      lastError = ec;
+      if (++failures > segment_max_failures) {
+        failed = true;
+      }
+    }
+    cv.notify_all();
+  }
+  // Abort stops all workers, used for errors a retry cannot fix (disk full ...)
+  void Abort(const bela::error_code &ec) {
+    std::scoped_lock lock(mu);
+    lastError = ec;
+    failed = true;
+    cv.notify_all();
+  }
+  bool Completed(bela::error_code &ec) const {
+    std::scoped_lock lock(mu);
+    if (remaining == 0) {
+      return true;
+    }
+    ec = lastError ? lastError : bela::make_error_code(bela::ErrGeneral, L"segmented download incomplete");
+    return false;
+  }
+  std::vector<net_internal::part_range> Missing() const {
+    std::scoped_lock lock(mu);
+    std::vector<net_internal::part_range> missing;
+    for (const auto &s : segments) {
+      if (s.current < s.end) {
+        missing.emplace_back(net_internal::part_range{.from = s.current, .to = s.end});
+      }
+    }
+    std::sort(missing.begin(), missing.end(), [](const auto &a, const auto &b) { return a.from < b.from; });
+    return missing;
+  }
+
+private:
+  struct segment {
+    int64_t current{0};
+    int64_t end{0};
+    bool active{false};
+  };
+  mutable std::mutex mu;
+  std::condition_variable cv;
+  std::vector<segment> segments;
+  bela::error_code lastError;
+  int64_t total{0};
+  int64_t remaining{0};
+  int failures{0};
+  bool failed{false};
+};
+
+struct segment_worker {
+  segment_scheduler &scheduler;
+  const open_range_t &open_range;
+  net_internal::FilePart &filePart;
+  baulk::ProgressBar &bar;
+  std::vector<char> buffer;
+
+  // fetch downloads one segment, req is the response already received for it (the first segment) or null
+  bool fetch(size_t index, handle *req, bela::error_code &ec) {
+    std::optional<handle> owned;
+    if (req == nullptr) {
+      int64_t from = 0;
+      auto length = scheduler.Clip(index, INT64_MAX, from);
+      if (owned = open_range(from, from + length, ec); !owned) {
+        return false;
+      }
+      req = &*owned;
+    }
+    req->set_receive_timeout(segment_receive_timeout);
+    buffer.resize(segment_buffer_size);
+    for (;;) {
+      DWORD dwSize = 0;
+      if (WinHttpReadData(req->addressof(), buffer.data(), static_cast<DWORD>(buffer.size()), &dwSize) != TRUE) {
+        ec = make_net_error_code();
+        return false;
+      }
+      if (dwSize == 0) {
+        ec = bela::make_error_code(bela::ErrGeneral, L"connection has been disconnected");
+        return false;
+      }
+      int64_t offset = 0;
+      auto n = scheduler.Clip(index, static_cast<int64_t>(dwSize), offset);
+      if (n > 0 && !filePart.WriteAt(buffer.data(), static_cast<size_t>(n), offset, ec)) {
+        scheduler.Abort(ec);
+        return false;
+      }
+      bool more = false;
+      bar.Update(static_cast<uint64_t>(scheduler.Advance(index, n, more)));
+      if (!more) {
+        // a shrunk segment leaves unread bytes behind, closing the request drops that connection
+        return true;
+      }
+    }
+  }
+
+  void run(size_t index, handle *first) {
+    do {
+      bela::error_code ec;
+      auto ok = fetch(index, first, ec);
+      first = nullptr;
+      scheduler.Release(index, ok, ec);
+    } while (scheduler.Acquire(index));
+  }
+};
+} // namespace
+
+bool download_segments(std::vector<net_internal::part_range> &missing, handle &&first, uint32_t workers,
+                       const open_range_t &open_range, net_internal::FilePart &filePart, baulk::ProgressBar &bar,
+                       bela::error_code &ec) {
+  segment_scheduler scheduler(missing, filePart.FileSize());
+  // the calling thread claims the first range, it has a response in flight for it already
+  size_t index = 0;
+  if (!scheduler.Acquire(index)) {
+    return true;
+  }
+  handle firstRequest(std::move(first));
+  std::vector<std::thread> threads;
+  for (uint32_t i = 1; i < workers; i++) {
+    threads.emplace_back([&] {
+      if (size_t next = 0; scheduler.Acquire(next)) {
+        segment_worker{scheduler, open_range, filePart, bar, {}}.run(next, nullptr);
+      }
+    });
+  }
+  segment_worker{scheduler, open_range, filePart, bar, {}}.run(index, &firstRequest);
+  for (auto &t : threads) {
+    t.join();
+  }
+  if (scheduler.Completed(ec)) {
+    missing.clear();
+    return true;
+  }
+  missing = scheduler.Missing();
+  return false;
+}
+
+} // namespace baulk::net::native
@@ -0,0 +1,29 @@
+// segmented downloads: one file fetched as byte ranges over parallel WinHTTP requests
+#ifndef BAULK_NET_SEGMENTS_HPP
+#define BAULK_NET_SEGMENTS_HPP
+#include <baulk/indicators.hpp>
+#include <functional>
+#include "native.hpp"
+#include "file.hpp"
+
+namespace baulk::net::native {
+constexpr int64_t min_segment_size = 2 * 1024 * 1024; // smaller files are not split, nor are segments below this
+constexpr int segment_receive_timeout = 15 * 1000;    // milliseconds, a stalled segment request fails after this
+constexpr int segment_max_failures = 8;               // failed segment requests tolerated before giving up
+
+// open_range_t sends 'Range: bytes=from-(to-1)' and returns the request once a matching 206 response is received
+using open_range_t = std::function<std::optional<handle>(int64_t from, int64_t to, bela::error_code &ec)>;
+
+// split_ranges divides [0, total) into at most segments ranges of at least min_segment_size
+std::vector<net_internal::part_range> split_ranges(int64_t total, uint32_t segments);
+
+// download_segments fetches the missing ranges of a preallocated part file over up to workers parallel requests.
+// first is the already received response for missing.front(). Idle workers take unclaimed ranges and then split the
+// largest range still in flight, so a slow or stalled connection is relieved by the others. On failure missing
+// holds the ranges still to be downloaded
+bool download_segments(std::vector<net_internal::part_range> &missing, handle &&first, uint32_t workers,
+                       const open_range_t &open_range, net_internal::FilePart &filePart, baulk::ProgressBar &bar,
+                       bela::error_code &ec);
+} // namespace baulk::net::native
+
+#endif
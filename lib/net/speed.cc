@@ -1,10 +1,24 @@
 //
+#include <bela/time.hpp>
+#include <bela/io.hpp>
 #include <baulk/net.hpp>
 #include <baulk/net/tcp.hpp>
+#include <json.hpp>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <stop_token>
+#include <thread>
 #include "native.hpp"
 
 namespace baulk::net {
 constexpr auto MaximumTime = (std::numeric_limits<std::uint64_t>::max)();
+constexpr int probe_timeout = 3000;                          // milliseconds, dial deadline of a mirror probe
+constexpr size_t probe_winners = 2;                          // the first responders compete
+constexpr auto probe_grace = std::chrono::milliseconds(150); // how long later responders may join the race
+constexpr int64_t latency_half_life = 24 * 3600;             // seconds, an old measurement's weight halves per day
+constexpr int64_t latency_stale_after = 3 * 24 * 3600;       // seconds, older stats trigger probing again
+constexpr double failure_penalty = 1000.0;                   // milliseconds per consecutive failure
 
 std::uint64_t UrlResponseTime(std::wstring_view url) {
   bela::error_code ec;
@@ -13,13 +27,171 @@ std::uint64_t UrlResponseTime(std::wstring_view url) {
     return MaximumTime;
   }
   auto begin = std::chrono::steady_clock::now();
-  if (auto conn = baulk::net::DialTimeout(u->host, u->nPort, 10000, ec); !conn) {
+  if (auto conn = baulk::net::DialTimeout(u->host, u->nPort, probe_timeout, ec); !conn) {
     return MaximumTime;
   }
   auto cur = std::chrono::steady_clock::now();
   return std::chrono::duration_cast<std::chrono::nanoseconds>(cur - begin).count();
 }
 
+namespace {
+struct host_latency {
+  double connect{0};    // milliseconds, 0: never measured
+  double first_byte{0}; // milliseconds, 0: never measured
+  int64_t updated{0};   // unix seconds
+  uint32_t failures{0};
+};
+
+// merge folds a sample into an exponentially weighted average whose old part decays with its age
+inline double merge(double old, double sample, int64_t age) {
+  if (old <= 0) {
+    return sample;
+  }
+  auto w = 0.7 * std::exp2(-static_cast<double>(age) / static_cast<double>(latency_half_life));
+  return old * w + sample * (1 - w);
+}
+
+inline double to_milliseconds(std::chrono::nanoseconds d) {
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+class latency_stats {
+public:
+  static latency_stats &Instance() {
+    static latency_stats stats;
+    return stats;
+  }
+  bool Load(const std::filesystem::path &file_, bela::error_code &ec) {
+    std::scoped_lock lock(mu);
+    file = file_;
+    FILE *fd = nullptr;
+    if (auto eo = _wfopen_s(&fd, file.c_str(), L"rb"); eo != 0) {
+      if (eo == ENOENT) {
+        return true;
+      }
+      ec = bela::make_error_code_from_errno(eo);
+      return false;
+    }
+    auto closer = bela::finally([&] { fclose(fd); });
+    try {
+      auto j = nlohmann::json::parse(fd, nullptr, true, true);
+      for (const auto &[host, o] : j.at("hosts").items()) {
+        hosts.insert_or_assign(bela::encode_into<char, wchar_t>(host),
+                               host_latency{.connect = o.value("connect", 0.0),
+                                            .first_byte = o.value("first_byte", 0.0),
+                                            .updated = o.value("updated", static_cast<int64_t>(0)),
+                                            .failures = o.value("failures", static_cast<uint32_t>(0))});
+      }
+    } catch (const std::exception &e) {
+      // a damaged cache is only a cache
+      hosts.clear();
+      ec = bela::make_error_code(bela::ErrGeneral, bela::encode_into<char, wchar_t>(e.what()));
+      return false;
+    }
+    return true;
+  }
+  bool Save(bela::error_code &ec) {
+    std::scoped_lock lock(mu);
+    if (!modified || file.empty()) {
+      return true;
+    }
+    auto now = bela::ToUnixSeconds(bela::Now());
+    try {
+      nlohmann::json hj = nlohmann::json::object();
+      for (const auto &[host, h] : hosts) {
+        // drop hosts nobody asked about for a long time
+        if (now - h.updated > 10 * latency_stale_after) {
+          continue;
+        }
+        hj[bela::encode_into<wchar_t, char>(host)] = {{"connect", h.connect},
+                                                      {"first_byte", h.first_byte},
+                                                      {"updated", h.updated},
+                                                      {"failures", h.failures}};
+      }
+      nlohmann::json j{{"version", 1}, {"hosts", std::move(hj)}};
+      if (!bela::io::AtomicWriteText(file.native(), bela::io::as_bytes<char>(j.dump(4)), ec)) {
+        return false;
+      }
+    } catch (const std::exception &e) {
+      ec = bela::make_error_code(bela::ErrGeneral, bela::encode_into<char, wchar_t>(e.what()));
+      return false;
+    }
+    modified = false;
+    return true;
+  }
+  void Record(std::wstring_view host, double connect, double first_byte) {
+    std::scoped_lock lock(mu);
+    auto now = bela::ToUnixSeconds(bela::Now());
+    auto &h = hosts[std::wstring(host)];
+    auto age = (std::max)(now - h.updated, static_cast<int64_t>(0));
+    if (connect > 0) {
+      h.connect = merge(h.connect, connect, age);
+    }
+    if (first_byte > 0) {
+      h.first_byte = merge(h.first_byte, first_byte, age);
+    }
+    h.failures = 0;
+    h.updated = now;
+    modified = true;
+  }
+  void Failure(std::wstring_view host) {
+    std::scoped_lock lock(mu);
+    auto &h = hosts[std::wstring(host)];
+    h.failures++;
+    h.updated = bela::ToUnixSeconds(bela::Now());
+    modified = true;
+  }
+  // Score is the expected latency of a host in milliseconds, nullopt when its stats are missing or stale
+  std::optional<double> Score(std::wstring_view host, int64_t now) const {
+    std::scoped_lock lock(mu);
+    auto it = hosts.find(std::wstring(host));
+    if (it == hosts.end() || it->second.connect <= 0 || now - it->second.updated > latency_stale_after) {
+      return std::nullopt;
+    }
+    const auto &h = it->second;
+    return std::make_optional(h.connect + h.first_byte + h.failures * failure_penalty);
+  }
+  double FirstByte(std::wstring_view host) const {
+    std::scoped_lock lock(mu);
+    if (auto it = hosts.find(std::wstring(host)); it != hosts.end()) {
+      return it->second.first_byte;
+    }
+    return 0;
+  }
+
+private:
+  mutable std::mutex mu;
+  std::filesystem::path file;
+  bela::flat_hash_map<std::wstring, host_latency> hosts;
+  bool modified{false};
+};
+
+struct probe_result {
+  size_t index{0};
+  double connect{0}; // milliseconds
+};
+
+// probe_race collects the probes of BestUrl, probes still dialing when the race is decided are stopped and joined
+struct probe_race {
+  std::mutex mu;
+  std::condition_variable cv;
+  std::vector<probe_result> responded;
+  size_t finished{0};
+};
+} // namespace
+
+bool LoadLatencyStats(const std::filesystem::path &file, bela::error_code &ec) {
+  return latency_stats::Instance().Load(file, ec);
+}
+
+bool SaveLatencyStats(bela::error_code &ec) { return latency_stats::Instance().Save(ec); }
+
+void RecordLatency(std::wstring_view host, std::chrono::nanoseconds connect, std::chrono::nanoseconds first_byte) {
+  latency_stats::Instance().Record(host, to_milliseconds(connect), to_milliseconds(first_byte));
+}
+
+void RecordFailure(std::wstring_view host) { latency_stats::Instance().Failure(host); }
+
 std::wstring_view BestUrlInternal(const std::vector<std::wstring> &urls, std::wstring_view locale) {
   if (urls.empty()) {
     return L"";
@@ -27,8 +199,6 @@ std::wstring_view BestUrlInternal(const std::vector<std::wstring> &urls, std::ws
   if (urls.size() == 1) {
     return urls[0];
   }
-  auto elapsed = MaximumTime;
-  size_t pos = 0;
   auto suffix = bela::StringCat(L"#", locale);
   // The first round to determine whether there is a mirror image of the area
   for (const auto &u : urls) {
@@ -39,15 +209,87 @@ std::wstring_view BestUrlInternal(const std::vector<std::wstring> &urls, std::ws
       return url;
     }
   }
-  // Second round of analysis of network connection establishment time
+  std::vector<native::url> targets;
+  std::vector<size_t> indexes;
   for (size_t i = 0; i < urls.size(); i++) {
-    // connect url to get elapsed timeout
-    auto resptime = UrlResponseTime(urls[i]);
-    if (resptime < elapsed) {
-      pos = i;
+    bela::error_code ec;
+    if (auto u = native::crack_url(urls[i], ec); u) {
+      targets.emplace_back(std::move(*u));
+      indexes.emplace_back(i);
     }
   }
-  return urls[pos];
+  if (targets.empty()) {
+    return urls[0];
+  }
+  auto &stats = latency_stats::Instance();
+  // Second round: recent latency stats of every mirror, no probing needed
+  auto now = bela::ToUnixSeconds(bela::Now());
+  std::optional<size_t> best;
+  double bestScore = 0;
+  bool complete = true;
+  for (size_t i = 0; i < targets.size() && complete; i++) {
+    auto score = stats.Score(targets[i].host, now);
+    if (!score) {
+      complete = false;
+      break;
+    }
+    if (!best || *score < bestScore) {
+      best = indexes[i];
+      bestScore = *score;
+    }
+  }
+  if (complete && best) {
+    return urls[*best];
+  }
+  // Third round: race connection establishment to all mirrors, the first responders compete on connect time plus
+  // their known first-byte latency, slow or dead mirrors are not waited for
+  probe_race race;
+  std::stop_source stop;
+  std::vector<std::thread> probes;
+  for (size_t i = 0; i < targets.size(); i++) {
+    probes.emplace_back([&race, i, token = stop.get_token(), host = targets[i].host, port = targets[i].nPort] {
+      bela::error_code ec;
+      auto begin = std::chrono::steady_clock::now();
+      auto conn = baulk::net::DialTimeout(host, port, probe_timeout, token, ec);
+      auto elapsed = std::chrono::steady_clock::now() - begin;
+      if (conn) {
+        latency_stats::Instance().Record(host, to_milliseconds(elapsed), 0);
+      } else if (!token.stop_requested()) {
+        // a probe stopped because the race was decided says nothing about the mirror
+        latency_stats::Instance().Failure(host);
+      }
+      std::scoped_lock lock(race.mu);
+      if (conn) {
+        race.responded.emplace_back(probe_result{.index = i, .connect = to_milliseconds(elapsed)});
+      }
+      race.finished++;
+      race.cv.notify_all();
+    });
+  }
+  std::vector<probe_result> responded;
+  {
+    std::unique_lock lock(race.mu);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(probe_timeout);
+    race.cv.wait_until(lock, deadline, [&] { return !race.responded.empty() || race.finished == targets.size(); });
+    if (!race.responded.empty()) {
+      auto grace = (std::min)(deadline, std::chrono::steady_clock::now() + probe_grace);
+      race.cv.wait_until(lock, grace, [&] {
+        return race.responded.size() >= probe_winners || race.finished == targets.size();
+      });
+    }
+    responded = race.responded;
+  }
+  stop.request_stop();
+  for (auto &t : probes) {
+    t.join();
+  }
+  if (responded.empty()) {
+    return urls[indexes.front()];
+  }
+  auto score = [&](const probe_result &r) { return r.connect + stats.FirstByte(targets[r.index].host); };
+  auto it = std::min_element(responded.begin(), responded.end(),
+                             [&](const auto &a, const auto &b) { return score(a) < score(b); });
+  return urls[indexes[it->index]];
 }
 
 std::wstring_view BestUrl(const std::vector<std::wstring> &urls, std::wstring_view locale) {
@@ -57,4 +299,4 @@ std::wstring_view BestUrl(const std::vector<std::wstring> &urls, std::wstring_vi
   }
   return url;
 }
-} // namespace baulk::net
\ No newline at end of file
+} // namespace baulk::net
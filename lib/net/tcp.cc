@@ -61,11 +61,19 @@ void WINAPI QueryCompleteCallback(_In_ DWORD Error, _In_ DWORD Bytes, _In_ LPOVE
   //
   SetEvent(QueryContext->CompleteEvent);
 }
+// a stoppable dial waits in slices of dial_stop_slice milliseconds and gives up once stop is requested
+constexpr int dial_stop_slice = 50;
+
+inline int wait_slice(int remaining, const std::stop_token &stop) {
+  return stop.stop_possible() ? (std::min)(remaining, dial_stop_slice) : remaining;
+}
+
 // query dns timeout use IOCP
 // https://docs.microsoft.com/en-us/windows/win32/api/ws2def/ns-ws2def-ADDRINFOEX4
 // https://github.com/microsoft/Windows-Classic-Samples/blob/master/Samples/DNSAsyncNetworkNameResolution/cpp/ResolveName.cpp
 // ADDRINFOEX6 support Windows 11 sdk or later
-bool ResolveName(std::wstring_view host, int port, PADDRINFOEX4 *rhints, bela::error_code &ec) {
+bool ResolveName(std::wstring_view host, int port, PADDRINFOEX4 *rhints, const std::stop_token &stop,
+                 bela::error_code &ec) {
   ADDRINFOEX4 hints = {0};
   hints.ai_family = AF_UNSPEC;
   hints.ai_flags = AI_EXTENDED | AI_FQDN | AI_CANONNAME | AI_RESOLUTION_HANDLE;
@@ -87,13 +95,22 @@ bool ResolveName(std::wstring_view host, int port, PADDRINFOEX4 *rhints, bela::e
     QueryCompleteCallback(error, 0, &QueryContext.QueryOverlapped);
     return false;
   }
-  if (WaitForSingleObject(QueryContext.CompleteEvent, QueryTimeout) == WAIT_TIMEOUT) {
+  DWORD waited = WAIT_TIMEOUT;
+  for (auto remaining = static_cast<int>(QueryTimeout); remaining > 0 && !stop.stop_requested();) {
+    auto slice = wait_slice(remaining, stop);
+    if (waited = WaitForSingleObject(QueryContext.CompleteEvent, slice); waited != WAIT_TIMEOUT) {
+      break;
+    }
+    remaining -= slice;
+  }
+  if (waited == WAIT_TIMEOUT) {
     GetAddrInfoExCancel(&CancelHandle);
     WaitForSingleObject(QueryContext.CompleteEvent, INFINITE);
     if (QueryContext.QueryResults != nullptr) {
       FreeAddrInfoExW(QueryContext.QueryResults);
     }
-    ec = bela::make_error_code(bela::ErrGeneral, L"GetAddrInfoEx() timeout");
+    ec = bela::make_error_code(bela::ErrGeneral, L"GetAddrInfoEx() ",
+                               stop.stop_requested() ? L"canceled" : L"timeout");
     return false;
   }
   if (QueryContext.QueryResults == nullptr) {
@@ -139,7 +156,7 @@ ssize_t Conn::ReadTimeout(char *buf, size_t len, int timeout) {
   if (auto rv = WSARecv(sock, &wsabuf, 1, &dwbytes, &flags, nullptr, nullptr); rv != SOCKET_ERROR) {
     return dwbytes;
   }
-  if (auto rv = WSAGetLastError(); InProgress(rv)) {
+  if (auto rv = WSAGetLastError(); !InProgress(rv)) {
     return -1;
   }
   WSAPOLLFD pfd;
@@ -154,7 +171,8 @@ ssize_t Conn::ReadTimeout(char *buf, size_t len, int timeout) {
   return -1;
 }
 
-bool DialTimeoutInternal(BAULKSOCK sock, const ADDRINFOEX4 *hi, int timeout, bela::error_code &ec) {
+bool DialTimeoutInternal(BAULKSOCK sock, const ADDRINFOEX4 *hi, int timeout, const std::stop_token &stop,
+                         bela::error_code &ec) {
   ULONG flags = 1;
   if (ioctlsocket(sock, FIONBIO, &flags) == SOCKET_ERROR) {
     ec = make_wsa_error_code(WSAGetLastError(), L"ioctlsocket() ");
@@ -171,42 +189,67 @@ bool DialTimeoutInternal(BAULKSOCK sock, const ADDRINFOEX4 *hi, int timeout, bel
   WSAPOLLFD pfd;
   pfd.fd = sock;
   pfd.events = POLLOUT;
-  auto rc = WSAPoll(&pfd, 1, timeout);
-  if (rc == 0) {
-    // timeout error DialTimeout make it
-    return false;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+  int rc = 0;
+  for (;;) {
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+    if (remaining.count() <= 0 || stop.stop_requested()) {
+      // timeout error DialTimeout make it
+      return false;
+    }
+    if (rc = WSAPoll(&pfd, 1, wait_slice(static_cast<int>(remaining.count()), stop)); rc != 0) {
+      break;
+    }
   }
   if (rc < 0) {
     ec = make_wsa_error_code(WSAGetLastError(), L"connect() ");
     return false;
   }
+  // refused or unreachable: poll reports POLLERR/POLLHUP, the reason is in SO_ERROR
+  int soerr = 0;
+  int solen = sizeof(soerr);
+  if (getsockopt(sock, SOL_SOCKET, SO_ERROR, reinterpret_cast<char *>(&soerr), &solen) == SOCKET_ERROR) {
+    ec = make_wsa_error_code(WSAGetLastError(), L"getsockopt() ");
+    return false;
+  }
+  if (soerr != 0) {
+    ec = make_wsa_error_code(soerr, L"connect() ");
+    return false;
+  }
   return true;
 }
 
 std::optional<Conn> DialTimeout(std::wstring_view address, int port, int timeout, bela::error_code &ec) {
+  return DialTimeout(address, port, timeout, std::stop_token{}, ec);
+}
+
+std::optional<Conn> DialTimeout(std::wstring_view address, int port, int timeout, std::stop_token stop,
+                                bela::error_code &ec) {
   static winsock_initializer initializer_;
   PADDRINFOEX4 rhints = nullptr;
-  if (!ResolveName(address, port, &rhints, ec)) {
+  if (!ResolveName(address, port, &rhints, stop, ec)) {
     bela::FPrintF(stderr, L"GetAddrInfoExW %s\n", ec);
     return std::nullopt;
   }
   auto hi = rhints;
   SOCKET sock{BAULK_INVALID_SOCKET};
   do {
-    sock = socket(rhints->ai_family, SOCK_STREAM, 0);
+    sock = socket(hi->ai_family, SOCK_STREAM, 0);
     if (sock == BAULK_INVALID_SOCKET) {
       ec = make_wsa_error_code(WSAGetLastError(), L"socket() ");
       continue;
     }
-    if (DialTimeoutInternal(sock, hi, timeout, ec)) {
+    if (DialTimeoutInternal(sock, hi, timeout, stop, ec)) {
       break;
     }
     closesocket(sock);
     sock = BAULK_INVALID_SOCKET;
-  } while ((hi = hi->ai_next) != nullptr);
+  } while ((hi = hi->ai_next) != nullptr && !stop.stop_requested());
 
   if (sock == BAULK_INVALID_SOCKET) {
-    if (ec) {
+    if (stop.stop_requested()) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"connect to ", address, L" canceled");
+    } else if (!ec) {
       ec = bela::make_error_code(bela::ErrGeneral, L"connect to ", address, L" timeout");
     }
     FreeAddrInfoExW(reinterpret_cast<ADDRINFOEXW *>(rhints)); /// Release
@@ -215,4 +258,124 @@ std::optional<Conn> DialTimeout(std::wstring_view address, int port, int timeout
   FreeAddrInfoExW(reinterpret_cast<ADDRINFOEXW *>(rhints)); /// Release
   return std::make_optional<baulk::net::Conn>(sock);
 }
+
+void Listener::Close() {
+  if (sock != BAULK_INVALID_SOCKET) {
+    closesocket(sock);
+    sock = BAULK_INVALID_SOCKET;
+  }
+}
+
+std::optional<Conn> Listener::Accept(int timeout, bela::error_code &ec) {
+  WSAPOLLFD pfd;
+  pfd.fd = sock;
+  pfd.events = POLLIN;
+  auto rc = WSAPoll(&pfd, 1, timeout);
+  if (rc == 0) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"accept() timeout");
+    return std::nullopt;
+  }
+  if (rc < 0) {
+    ec = make_wsa_error_code(WSAGetLastError(), L"WSAPoll() ");
+    return std::nullopt;
+  }
+  auto conn = accept(sock, nullptr, nullptr);
+  if (conn == INVALID_SOCKET) {
+    ec = make_wsa_error_code(WSAGetLastError(), L"accept() ");
+    return std::nullopt;
+  }
+  ULONG flags = 1;
+  if (ioctlsocket(conn, FIONBIO, &flags) == SOCKET_ERROR) {
+    ec = make_wsa_error_code(WSAGetLastError(), L"ioctlsocket() ");
+    closesocket(conn);
+    return std::nullopt;
+  }
+  return std::make_optional<Conn>(conn);
+}
+
+std::optional<Listener> Listen(std::wstring_view address, int port, bela::error_code &ec) {
+  static winsock_initializer initializer_;
+  sockaddr_storage ss{0};
+  int sslen = sizeof(ss);
+  std::wstring addr(address);
+  if (WSAStringToAddressW(addr.data(), AF_INET, nullptr, reinterpret_cast<sockaddr *>(&ss), &sslen) != 0) {
+    sslen = sizeof(ss);
+    if (WSAStringToAddressW(addr.data(), AF_INET6, nullptr, reinterpret_cast<sockaddr *>(&ss), &sslen) != 0) {
+      ec = make_wsa_error_code(WSAGetLastError(), L"WSAStringToAddressW() ");
+      return std::nullopt;
+    }
+  }
+  if (ss.ss_family == AF_INET) {
+    reinterpret_cast<sockaddr_in *>(&ss)->sin_port = htons(static_cast<u_short>(port));
+  } else {
+    reinterpret_cast<sockaddr_in6 *>(&ss)->sin6_port = htons(static_cast<u_short>(port));
+  }
+  auto sock = socket(ss.ss_family, SOCK_STREAM, IPPROTO_TCP);
+  if (sock == INVALID_SOCKET) {
+    ec = make_wsa_error_code(WSAGetLastError(), L"socket() ");
+    return std::nullopt;
+  }
+  auto closer = bela::finally([&] {
+    if (sock != INVALID_SOCKET) {
+      closesocket(sock);
+    }
+  });
+  if (bind(sock, reinterpret_cast<sockaddr *>(&ss), sslen) == SOCKET_ERROR) {
+    ec = make_wsa_error_code(WSAGetLastError(), L"bind() ");
+    return std::nullopt;
+  }
+  if (listen(sock, SOMAXCONN) == SOCKET_ERROR) {
+    ec = make_wsa_error_code(WSAGetLastError(), L"listen() ");
+    return std::nullopt;
+  }
+  sslen = sizeof(ss);
+  if (getsockname(sock, reinterpret_cast<sockaddr *>(&ss), &sslen) == SOCKET_ERROR) {
+    ec = make_wsa_error_code(WSAGetLastError(), L"getsockname() ");
+    return std::nullopt;
+  }
+  auto bound = ss.ss_family == AF_INET ? ntohs(reinterpret_cast<sockaddr_in *>(&ss)->sin_port)
+                                       : ntohs(reinterpret_cast<sockaddr_in6 *>(&ss)->sin6_port);
+  auto l = std::make_optional<Listener>(sock, static_cast<int>(bound));
+  sock = INVALID_SOCKET;
+  return l;
+}
+
+class tcp_stream : public Stream {
+public:
+  tcp_stream(Conn &&conn_) : conn(std::move(conn_)) {}
+  ssize_t Read(void *buf, size_t len, int timeout, bela::error_code &ec) override {
+    auto n = conn.ReadTimeout(reinterpret_cast<char *>(buf), len, timeout);
+    if (n < 0) {
+      if (auto code = WSAGetLastError(); code != 0 && !InProgress(code)) {
+        ec = make_wsa_error_code(code, L"recv() ");
+      } else {
+        ec = bela::make_error_code(bela::ErrGeneral, L"recv() timeout");
+      }
+    }
+    return n;
+  }
+  bool WriteFull(const void *data, size_t len, int timeout, bela::error_code &ec) override {
+    auto p = reinterpret_cast<const uint8_t *>(data);
+    while (len > 0) {
+      auto chunk = static_cast<uint32_t>((std::min)(len, static_cast<size_t>(1024 * 1024)));
+      auto n = conn.WriteTimeout(p, chunk, timeout);
+      if (n <= 0) {
+        if (auto code = WSAGetLastError(); code != 0 && !InProgress(code)) {
+          ec = make_wsa_error_code(code, L"send() ");
+        } else {
+          ec = bela::make_error_code(bela::ErrGeneral, L"send() timeout");
+        }
+        return false;
+      }
+      p += n;
+      len -= static_cast<size_t>(n);
+    }
+    return true;
+  }
+
+private:
+  Conn conn;
+};
+
+std::unique_ptr<Stream> MakeTcpStream(Conn &&conn) { return std::make_unique<tcp_stream>(std::move(conn)); }
 } // namespace baulk::net
@@ -0,0 +1,231 @@
+//
+#include <bela/ascii.hpp>
+#include <bela/fs.hpp>
+#include <bela/match.hpp>
+#include <baulk/installed.hpp>
+#include <baulk/fs.hpp>
+#include <baulk/vfs.hpp>
+#include <algorithm>
+
+namespace baulk::installed {
+namespace {
+constexpr size_t compaction_slack = 32; // lines of a small log never worth compacting
+
+std::wstring record_name(const nlohmann::json &record) {
+  if (auto it = record.find("name"); it != record.end() && it->is_string()) {
+    return bela::encode_into<char, wchar_t>(it->get<std::string_view>());
+  }
+  return L"";
+}
+
+bool make_locks(bela::error_code &ec) {
+  std::error_code e;
+  if (std::filesystem::create_directories(vfs::AppLocks(), e); e) {
+    ec = bela::make_error_code_from_std(e, L"create directories: ");
+    return false;
+  }
+  return true;
+}
+} // namespace
+
+std::wstring DatabasePath() { return bela::StringCat(vfs::AppLocks(), L"\\installed.jsonl"); }
+
+bool Database::Load(bela::error_code &ec) {
+  records.clear();
+  lines = 0;
+  torn = false;
+  migrated = false;
+  std::string content;
+  // a shared read: another process compacting the log is not held up
+  if (!fs::ReadShared(DatabasePath(), content, ec, 256 * 1024 * 1024)) {
+    if (ec.code != ERROR_FILE_NOT_FOUND && ec.code != ERROR_PATH_NOT_FOUND && ec.code != ENOENT) {
+      return false;
+    }
+    ec.clear();
+    return load_locks(ec);
+  }
+  migrated = true;
+  std::string_view sv(content);
+  for (auto pos = sv.find('\n'); pos != std::string_view::npos; pos = sv.find('\n')) {
+    load_line(sv.substr(0, pos));
+    sv.remove_prefix(pos + 1);
+  }
+  torn = !sv.empty();
+  return true;
+}
+
+bool Database::Open(bela::error_code &ec) {
+  if (!Load(ec)) {
+    return false;
+  }
+  if (migrated) {
+    return true;
+  }
+  if (!Compact(ec)) {
+    return false;
+  }
+  // the log is complete, the lock files are no longer read
+  for (const auto &[_, record] : records) {
+    auto lockfile = bela::StringCat(vfs::AppLocks(), L"\\", record_name(record), L".json");
+    DeleteFileW(lockfile.data());
+  }
+  migrated = true;
+  return true;
+}
+
+const nlohmann::json *Database::Find(std::wstring_view name) const {
+  if (auto it = records.find(bela::AsciiStrToLower(name)); it != records.end()) {
+    return &it->second;
+  }
+  return nullptr;
+}
+
+std::vector<std::wstring> Database::Names() const {
+  std::vector<std::pair<std::wstring_view, std::wstring>> sorted;
+  for (const auto &[k, record] : records) {
+    sorted.emplace_back(k, record_name(record));
+  }
+  std::sort(sorted.begin(), sorted.end());
+  std::vector<std::wstring> names;
+  for (auto &[_, name] : sorted) {
+    names.emplace_back(std::move(name));
+  }
+  return names;
+}
+
+bool Database::Put(std::wstring_view name, nlohmann::json record, bela::error_code &ec) {
+  try {
+    record["name"] = bela::encode_into<wchar_t, char>(name);
+  } catch (const std::exception &e) {
+    ec = bela::make_error_code(bela::ErrGeneral, bela::encode_into<char, wchar_t>(e.what()));
+    return false;
+  }
+  if (!append(record, ec)) {
+    return false;
+  }
+  records.insert_or_assign(bela::AsciiStrToLower(name), std::move(record));
+  return compact_if_needed(ec);
+}
+
+bool Database::Remove(std::wstring_view name, bela::error_code &ec) {
+  auto it = records.find(bela::AsciiStrToLower(name));
+  if (it == records.end()) {
+    return true;
+  }
+  nlohmann::json line{{"name", bela::encode_into<wchar_t, char>(name)}, {"removed", true}};
+  if (!append(line, ec)) {
+    return false;
+  }
+  records.erase(it);
+  return compact_if_needed(ec);
+}
+
+bool Database::Compact(bela::error_code &ec) {
+  std::string content;
+  try {
+    for (const auto &name : Names()) {
+      content.append(Find(name)->dump()).push_back('\n');
+    }
+  } catch (const std::exception &e) {
+    ec = bela::make_error_code(bela::ErrGeneral, bela::encode_into<char, wchar_t>(e.what()));
+    return false;
+  }
+  if (!make_locks(ec) || !fs::ReplaceContent(DatabasePath(), content, ec)) {
+    return false;
+  }
+  lines = records.size();
+  torn = false;
+  return true;
+}
+
+void Database::load_line(std::string_view line) {
+  lines++;
+  try {
+    auto record = nlohmann::json::parse(line);
+    auto name = record_name(record);
+    if (name.empty()) {
+      return;
+    }
+    if (auto it = record.find("removed"); it != record.end() && it->is_boolean() && it->get<bool>()) {
+      records.erase(bela::AsciiStrToLower(name));
+      return;
+    }
+    records.insert_or_assign(bela::AsciiStrToLower(name), std::move(record));
+  } catch (const std::exception &) {
+    // a line torn by a crash before a later commit
+  }
+}
+
+bool Database::load_locks(bela::error_code &ec) {
+  bela::fs::Finder finder;
+  if (!finder.First(vfs::AppLocks(), L"*.json", ec)) {
+    ec.clear(); // nothing installed
+    return true;
+  }
+  do {
+    if (finder.Ignore() || finder.IsDir()) {
+      continue;
+    }
+    auto name = finder.Name();
+    if (!bela::EndsWithIgnoreCase(name, L".json")) {
+      continue;
+    }
+    name.remove_suffix(5);
+    bela::error_code lec;
+    auto jo = parse_json_file(bela::StringCat(vfs::AppLocks(), L"\\", finder.Name()), lec);
+    if (!jo || !jo->obj.is_object()) {
+      continue;
+    }
+    jo->obj["name"] = bela::encode_into<wchar_t, char>(name);
+    records.insert_or_assign(bela::AsciiStrToLower(name), std::move(jo->obj));
+  } while (finder.Next());
+  return true;
+}
+
+bool Database::append(const nlohmann::json &record, bela::error_code &ec) {
+  std::string line;
+  try {
+    line = record.dump();
+  } catch (const std::exception &e) {
+    ec = bela::make_error_code(bela::ErrGeneral, bela::encode_into<char, wchar_t>(e.what()));
+    return false;
+  }
+  if (torn) {
+    line.insert(line.begin(), '\n');
+  }
+  line.push_back('\n');
+  if (!make_locks(ec)) {
+    return false;
+  }
+  auto path = DatabasePath();
+  auto fd = CreateFileW(path.data(), FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_ALWAYS,
+                        FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (fd == INVALID_HANDLE_VALUE) {
+    ec = bela::make_system_error_code(L"CreateFileW() ");
+    return false;
+  }
+  auto closer = bela::finally([&] { CloseHandle(fd); });
+  DWORD written = 0;
+  if (WriteFile(fd, line.data(), static_cast<DWORD>(line.size()), &written, nullptr) != TRUE ||
+      written != line.size()) {
+    ec = bela::make_system_error_code(L"WriteFile() ");
+    torn = true;
+    return false;
+  }
+  // the commit is durable before the caller goes on
+  if (FlushFileBuffers(fd) != TRUE) {
+    ec = bela::make_system_error_code(L"FlushFileBuffers() ");
+    return false;
+  }
+  torn = false;
+  lines++;
+  return true;
+}
+
+bool Database::compact_if_needed(bela::error_code &ec) {
+  if (lines <= records.size() * 2 + compaction_slack) {
+    return true;
+  }
+  return Compact(ec);
+}
+} // namespace baulk::installed
@@ -0,0 +1,145 @@
+// Checks that extracting 'bucket\*.json' from a GitHub source archive and stripping the '<repo>-<id>/' folder leaves
+// the manifests under 'bucket\', with one manifest or several. Also checks that an archive with no manifest extracts
+// nothing and that an archive with two top-level folders is refused
+#include <bela/terminal.hpp>
+#include <baulk/archive/extractor.hpp>
+#include <baulk/fs.hpp>
+#include <array>
+#include "testing.hpp"
+
+uint32_t crc32(std::string_view data) {
+  static const auto table = [] {
+    std::array<uint32_t, 256> t{};
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) {
+        c = (c & 1) != 0 ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+      }
+      t[i] = c;
+    }
+    return t;
+  }();
+  uint32_t c = 0xFFFFFFFFU;
+  for (auto ch : data) {
+    c = table[(c ^ static_cast<uint8_t>(ch)) & 0xFF] ^ (c >> 8);
+  }
+  return c ^ 0xFFFFFFFFU;
+}
+
+// stored_zip writes entries without compression, names ending with '/' are folders
+std::string stored_zip(const std::vector<std::pair<std::string, std::string>> &entries) {
+  std::string out;
+  std::string central;
+  auto le = [](std::string &s, uint32_t v, int n) {
+    for (int i = 0; i < n; i++) {
+      s.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+    }
+  };
+  constexpr uint32_t dos_time = 0;
+  constexpr uint32_t dos_date = (44 << 9) | (1 << 5) | 1; // 2024-01-01
+  for (const auto &[name, data] : entries) {
+    auto offset = static_cast<uint32_t>(out.size());
+    auto crc = crc32(data);
+    auto size = static_cast<uint32_t>(data.size());
+    le(out, 0x04034b50, 4);
+    le(out, 20, 2);
+    le(out, 0x0800, 2); // utf-8 names
+    le(out, 0, 2);      // stored
+    le(out, dos_time, 2);
+    le(out, dos_date, 2);
+    le(out, crc, 4);
+    le(out, size, 4);
+    le(out, size, 4);
+    le(out, static_cast<uint32_t>(name.size()), 2);
+    le(out, 0, 2);
+    out.append(name).append(data);
+    le(central, 0x02014b50, 4);
+    le(central, 20, 2);
+    le(central, 20, 2);
+    le(central, 0x0800, 2);
+    le(central, 0, 2);
+    le(central, dos_time, 2);
+    le(central, dos_date, 2);
+    le(central, crc, 4);
+    le(central, size, 4);
+    le(central, size, 4);
+    le(central, static_cast<uint32_t>(name.size()), 2);
+    le(central, 0, 2);
+    le(central, 0, 2);
+    le(central, 0, 2);
+    le(central, 0, 2);
+    le(central, name.ends_with('/') ? 0x10 : 0x20, 4); // FILE_ATTRIBUTE_DIRECTORY or ARCHIVE
+    le(central, offset, 4);
+    central.append(name);
+  }
+  auto centralOffset = static_cast<uint32_t>(out.size());
+  out.append(central);
+  le(out, 0x06054b50, 4);
+  le(out, 0, 2);
+  le(out, 0, 2);
+  le(out, static_cast<uint32_t>(entries.size()), 2);
+  le(out, static_cast<uint32_t>(entries.size()), 2);
+  le(out, static_cast<uint32_t>(central.size()), 4);
+  le(out, centralOffset, 4);
+  le(out, 0, 2);
+  return out;
+}
+
+bool extract_manifests(const std::filesystem::path &zipfile, const std::filesystem::path &dest, bela::error_code &ec) {
+  // the selection and the stripping of bucket.cc BucketFetch
+  baulk::archive::ExtractorOptions opts{.selection = {"*/bucket/*.json"}};
+  baulk::archive::zip::Extractor extractor(opts);
+  return extractor.OpenReader(zipfile, dest, ec) && extractor.Extract(nullptr, nullptr, ec) &&
+         baulk::fs::MakeStripped(dest, ec);
+}
+
+int wmain() {
+  std::error_code e;
+  auto root = std::filesystem::temp_directory_path(e) / L"baulk-bucketzip-test";
+  std::filesystem::remove_all(root, e);
+  std::filesystem::create_directories(root, e);
+  auto zipfile = root / L"master.zip";
+  auto write = [&](const std::string &content) {
+    FILE *fd = nullptr;
+    if (_wfopen_s(&fd, zipfile.c_str(), L"wb") != 0 || fd == nullptr) {
+      return false;
+    }
+    auto n = fwrite(content.data(), 1, content.size(), fd);
+    fclose(fd);
+    return n == content.size();
+  };
+  bela::error_code ec;
+  // bucket\x.json is the only manifest: every level above it is a single folder
+  auto ok = write(stored_zip({{"bucket-master/", ""},
+                              {"bucket-master/README.md", "# bucket\n"},
+                              {"bucket-master/bucket/", ""},
+                              {"bucket-master/bucket/x.json", R"({"version": "1.0.0"})"},
+                              {"bucket-master/scripts/check.json", "{}"}}));
+  auto single = root / L"single";
+  ok = ok && extract_manifests(zipfile, single, ec);
+  expect(L"single manifest", ok && std::filesystem::is_regular_file(single / L"bucket" / L"x.json", e) &&
+                                 !std::filesystem::exists(single / L"x.json", e) &&
+                                 !std::filesystem::exists(single / L"README.md", e) &&
+                                 !std::filesystem::exists(single / L"scripts", e),
+         ec.message);
+
+  ok = write(stored_zip({{"bucket-0123abc/bucket/x.json", "{}"}, {"bucket-0123abc/bucket/y.json", "{}"}}));
+  auto several = root / L"several";
+  ok = ok && extract_manifests(zipfile, several, ec);
+  expect(L"several manifests", ok && std::filesystem::is_regular_file(several / L"bucket" / L"x.json", e) &&
+                                   std::filesystem::is_regular_file(several / L"bucket" / L"y.json", e),
+         ec.message);
+
+  // no manifest selected: nothing to strip
+  ok = write(stored_zip({{"bucket-master/README.md", "# bucket\n"}}));
+  auto empty = root / L"empty";
+  expect(L"no manifests", ok && extract_manifests(zipfile, empty, ec) && std::filesystem::is_empty(empty, e),
+         ec.message);
+
+  // entries beside the top-level folder are not a source archive
+  ok = write(stored_zip({{"a/bucket/x.json", "{}"}, {"b/bucket/y.json", "{}"}}));
+  expect(L"two top-level folders", ok && !extract_manifests(zipfile, root / L"two", ec), ec.message);
+
+  std::filesystem::remove_all(root, e);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+// Checks that every manifest written to a bundle reads back byte for byte, that a lookup ignores the case of the
+// name and that a missing name or a prefix is not found. Also checks that Open rejects a truncated bundle and a record
+// whose content size differs from the size of its zstd frame. Prints lookup time and disk use of the bundle and of
+// loose files
+#include <bela/terminal.hpp>
+#include <bela/str_cat.hpp>
+#include <bela/ascii.hpp>
+#include <bela/numbers.hpp>
+#include <bela/io.hpp>
+#include <bela/fs.hpp>
+#include <baulk/bundle.hpp>
+#include <json.hpp>
+#include <chrono>
+#include <cstring>
+#include "testing.hpp"
+
+std::string random_hash(xorshift &rng) {
+  constexpr std::string_view hex = "0123456789abcdef";
+  std::string h;
+  for (int i = 0; i < 64; i++) {
+    h.push_back(hex[rng() % 16]);
+  }
+  return h;
+}
+
+// synthetic_manifest: the shape of a baulk bucket manifest, alike in keys and urls and unlike in versions and hashes
+std::string synthetic_manifest(size_t i, xorshift &rng) {
+  auto name = "tool" + std::to_string(i);
+  auto version = std::to_string(rng() % 4) + "." + std::to_string(rng() % 12) + "." + std::to_string(rng() % 30);
+  nlohmann::json j{
+      {"description", "A synthetic tool number " + std::to_string(i)},
+      {"version", version},
+      {"homepage", "https://example.com/" + name},
+      {"license", i % 3 == 0 ? "MIT" : "Apache-2.0"},
+      {"url64", {"https://github.com/example/" + name + "/releases/download/v" + version + "/" + name + "-x64.zip"}},
+      {"url64.hash", "SHA256:" + random_hash(rng)},
+      {"urlarm64",
+       {"https://github.com/example/" + name + "/releases/download/v" + version + "/" + name + "-arm64.zip"}},
+      {"urlarm64.hash", "SHA256:" + random_hash(rng)},
+      {"links64", {"bin/" + name + ".exe"}},
+  };
+  if (i % 3 == 0) {
+    j["venv"] = {{"category", "dev"}, {"path", {"bin"}}, {"env", {"TOOL_HOME=${BAULK_PACKAGE_FOLDER}"}}};
+  }
+  return j.dump(4);
+}
+
+uint64_t cluster_size(const std::filesystem::path &root) {
+  DWORD sectorsPerCluster = 0;
+  DWORD bytesPerSector = 0;
+  DWORD freeClusters = 0;
+  DWORD totalClusters = 0;
+  auto volume = root.root_path().wstring();
+  if (GetDiskFreeSpaceW(volume.data(), &sectorsPerCluster, &bytesPerSector, &freeClusters, &totalClusters) != TRUE) {
+    return 4096;
+  }
+  return static_cast<uint64_t>(sectorsPerCluster) * bytesPerSector;
+}
+
+uint64_t allocated(uint64_t size, uint64_t cluster) { return (size + cluster - 1) / cluster * cluster; }
+
+int wmain(int argc, wchar_t **argv) {
+  size_t count = 3000;
+  if (argc >= 2 && !bela::SimpleAtoi(argv[1], &count)) {
+    count = 3000;
+  }
+  std::error_code e;
+  auto root = std::filesystem::temp_directory_path(e) / L"baulk-bundle-test";
+  std::filesystem::remove_all(root, e);
+  std::filesystem::create_directories(root / L"bucket", e);
+  auto cluster = cluster_size(root);
+  xorshift rng;
+  std::vector<baulk::bundle::Manifest> manifests;
+  uint64_t looseBytes = 0;
+  uint64_t looseAllocated = 0;
+  bela::error_code ec;
+  for (size_t i = 0; i < count; i++) {
+    auto &m = manifests.emplace_back(
+        baulk::bundle::Manifest{.name = bela::StringCat(L"tool", i), .content = synthetic_manifest(i, rng)});
+    auto file = (root / L"bucket" / bela::StringCat(m.name, L".json")).wstring();
+    if (!bela::io::WriteText(file, bela::io::as_bytes<char>(m.content), ec)) {
+      bela::FPrintF(stderr, L"write %s error: %s\n", file, ec);
+      return 1;
+    }
+    looseBytes += m.content.size();
+    looseAllocated += allocated(m.content.size(), cluster);
+  }
+  auto bundleFile = root / L"synthetic.bundle";
+  auto written = manifests;
+  auto t0 = std::chrono::steady_clock::now();
+  if (!baulk::bundle::Write(written, bundleFile, ec)) {
+    bela::FPrintF(stderr, L"write bundle error: %s\n", ec);
+    return 1;
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  auto reader = std::make_unique<baulk::bundle::Reader>();
+  if (!reader->Open(bundleFile, ec)) {
+    bela::FPrintF(stderr, L"open bundle error: %s\n", ec);
+    return 1;
+  }
+  auto bundleBytes = std::filesystem::file_size(bundleFile, e);
+  // every manifest reads back, names are found whatever their case
+  bool ok = reader->Size() == manifests.size();
+  std::string content;
+  for (const auto &m : manifests) {
+    auto i = reader->Find(bela::AsciiStrToUpper(m.name));
+    ok = ok && i && reader->Read(*i, content, ec) && content == m.content;
+  }
+  expect(L"read back", ok && !reader->Find(L"missing") && !reader->Find(L"tool"), ec.message);
+  // lookups: the same random names from the loose files and from the bundle
+  std::vector<std::wstring> names;
+  for (size_t i = 0; i < count; i++) {
+    names.emplace_back(manifests[rng() % manifests.size()].name);
+  }
+  size_t checksum[2] = {0, 0};
+  auto t2 = std::chrono::steady_clock::now();
+  for (const auto &name : names) {
+    if (bela::io::ReadFile((root / L"bucket" / bela::StringCat(name, L".json")).wstring(), content, ec)) {
+      checksum[0] += content.size();
+    }
+  }
+  auto t3 = std::chrono::steady_clock::now();
+  for (const auto &name : names) {
+    if (auto i = reader->Find(name); i && reader->Read(*i, content, ec)) {
+      checksum[1] += content.size();
+    }
+  }
+  auto t4 = std::chrono::steady_clock::now();
+  // listing: what 'baulk search' walks without an index
+  size_t listed[2] = {0, 0};
+  bela::fs::Finder finder;
+  if (finder.First((root / L"bucket").wstring(), L"*.json", ec)) {
+    do {
+      listed[0] += finder.Ignore() || finder.IsDir() ? 0 : 1;
+    } while (finder.Next());
+  }
+  auto t5 = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < reader->Size(); i++) {
+    listed[1] += reader->Name(i).empty() ? 0 : 1;
+  }
+  auto t6 = std::chrono::steady_clock::now();
+  expect(L"lookups", checksum[0] == checksum[1] && listed[0] == listed[1] && listed[0] == count);
+  // a truncated bundle is rejected
+  auto damaged = root / L"damaged.bundle";
+  std::filesystem::copy_file(bundleFile, damaged, e);
+  std::filesystem::resize_file(damaged, bundleBytes - 16, e);
+  {
+    baulk::bundle::Reader broken;
+    expect(L"truncated", !broken.Open(damaged, ec), ec.message);
+  }
+  // a record whose content size is not the size its frame declares is rejected, Read would allocate it
+  for (bool huge : {false, true}) {
+    auto title = huge ? L"huge content size" : L"wrong content size";
+    std::string content;
+    if (!bela::io::ReadFile(bundleFile.wstring(), content, ec)) {
+      expect(title, false, ec.message);
+      continue;
+    }
+    baulk::bundle::bundle_header h;
+    baulk::bundle::bundle_record r;
+    memcpy(&h, content.data(), sizeof(h));
+    memcpy(&r, content.data() + h.records, sizeof(r));
+    r.content_size = huge ? 0x7FFFFFFF : r.content_size + 1;
+    memcpy(content.data() + h.records, &r, sizeof(r));
+    baulk::bundle::Reader broken;
+    auto inflated = root / L"inflated.bundle";
+    expect(title, bela::io::WriteText(inflated.wstring(), bela::io::as_bytes<char>(content), ec) &&
+                      !broken.Open(inflated, ec),
+           ec.message);
+  }
+  auto ms = [](auto d) { return std::chrono::duration<double, std::milli>(d).count(); };
+  bela::FPrintF(stderr,
+                L"%d manifests, %d bytes, cluster %d\n"
+                L"loose:  %d bytes on disk, %d files, lookups %.1fms, listing %.1fms\n"
+                L"bundle: %d bytes on disk, 1 file, lookups %.1fms, listing %.3fms, written in %.1fms\n",
+                count, looseBytes, cluster, looseAllocated, count, ms(t3 - t2), ms(t5 - t4),
+                allocated(bundleBytes, cluster), ms(t4 - t3), ms(t6 - t5), ms(t1 - t0));
+  reader.reset(); // a mapped file cannot be deleted
+  std::filesystem::remove_all(root, e);
+  return failures == 0 ? 0 : 1;
+}
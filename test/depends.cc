@@ -0,0 +1,189 @@
+// Checks the install waves of the resolver: prerequisites before dependents, installed versions that satisfy a
+// requirement skipped, outdated ones upgraded and bucket-qualified requirements honoured. Also checks that cycles,
+// missing packages, malformed requirements and constraints that no version satisfies are reported, including one
+// name required from two buckets. On a random graph, every prerequisite must be in an earlier wave or installed
+#include <bela/terminal.hpp>
+#include <bela/str_cat.hpp>
+#include <bela/numbers.hpp>
+#include <bela/semver.hpp>
+#include <baulk/depends.hpp>
+#include <chrono>
+#include "testing.hpp"
+
+using baulk::depends::candidate;
+using baulk::depends::requirement;
+
+struct synthetic {
+  std::vector<std::pair<std::wstring, std::vector<candidate>>> buckets; // ordered by weights
+  bela::flat_hash_map<std::wstring, std::wstring> installed;
+  size_t lookups{0};
+
+  void Add(std::wstring_view bucket, candidate c) {
+    c.bucket = bucket;
+    for (auto &[name, pkgs] : buckets) {
+      if (name == bucket) {
+        pkgs.emplace_back(std::move(c));
+        return;
+      }
+    }
+    buckets.emplace_back(std::wstring(bucket), std::vector<candidate>{std::move(c)});
+  }
+  // lookup: the newest version of all buckets, the way PackageMetaEx picks it
+  std::optional<candidate> Lookup(const requirement &r, bela::error_code &ec) {
+    lookups++;
+    const candidate *newest = nullptr;
+    for (const auto &[name, pkgs] : buckets) {
+      if (!r.bucket.empty() && name != r.bucket) {
+        continue;
+      }
+      for (const auto &p : pkgs) {
+        if (p.name == r.name && (newest == nullptr || bela::version(p.version) > bela::version(newest->version))) {
+          newest = &p;
+        }
+      }
+    }
+    if (newest == nullptr) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"'", r.name, L"' not yet ported.");
+      return std::nullopt;
+    }
+    return std::make_optional(*newest);
+  }
+  std::optional<std::wstring> Installed(std::wstring_view name) const {
+    if (auto it = installed.find(std::wstring(name)); it != installed.end()) {
+      return std::make_optional(it->second);
+    }
+    return std::nullopt;
+  }
+  std::optional<baulk::depends::waves_t> Resolve(const std::vector<std::wstring_view> &specs, bela::error_code &ec) {
+    baulk::depends::Resolver resolver([&](const requirement &r, bela::error_code &ec_) { return Lookup(r, ec_); },
+                                      [&](std::wstring_view name) { return Installed(name); });
+    for (auto spec : specs) {
+      if (!resolver.Add(spec, ec)) {
+        return std::nullopt;
+      }
+    }
+    return resolver.Resolve(ec);
+  }
+};
+
+std::wstring waves_string(const baulk::depends::waves_t &waves) {
+  std::wstring s;
+  for (const auto &w : waves) {
+    s.push_back('[');
+    for (size_t i = 0; i < w.size(); i++) {
+      bela::StrAppend(&s, i == 0 ? L"" : L" ", w[i].name, L"@", w[i].bucket);
+    }
+    s.push_back(']');
+  }
+  return s;
+}
+
+void expect_waves(std::wstring_view title, synthetic &s, const std::vector<std::wstring_view> &specs,
+                  std::wstring_view expected) {
+  bela::error_code ec;
+  auto waves = s.Resolve(specs, ec);
+  auto got = waves ? waves_string(*waves) : bela::StringCat(L"error: ", ec);
+  if (!expect(title, got == expected, got)) {
+    bela::FPrintF(stderr, L"     expected: %s\n", expected);
+  }
+}
+
+void expect_error(std::wstring_view title, synthetic &s, const std::vector<std::wstring_view> &specs,
+                  std::wstring_view contains) {
+  bela::error_code ec;
+  auto waves = s.Resolve(specs, ec);
+  expect(title, !waves && ec.message.find(contains) != std::wstring::npos, waves ? waves_string(*waves) : ec.message);
+}
+
+// large: a random DAG of count packages, every prerequisite must land in an earlier wave
+void large_graph(size_t count) {
+  xorshift rng;
+  synthetic s;
+  std::vector<std::wstring> roots;
+  for (size_t i = 0; i < count; i++) {
+    candidate c{.name = bela::StringCat(L"pkg", i), .version = L"1.0.0"};
+    for (size_t k = 0, n = i == 0 ? 0 : rng() % 4; k < n; k++) {
+      c.depends.emplace_back(bela::StringCat(L"pkg", rng() % i, L">=1.0.0"));
+    }
+    if (rng() % 10 == 0) {
+      s.installed.emplace(c.name, L"1.0.0");
+    }
+    if (rng() % 5 == 0) {
+      roots.emplace_back(c.name);
+    }
+    s.Add(L"main", std::move(c));
+  }
+  std::vector<std::wstring_view> specs(roots.begin(), roots.end());
+  bela::error_code ec;
+  auto t0 = std::chrono::steady_clock::now();
+  auto waves = s.Resolve(specs, ec);
+  auto t1 = std::chrono::steady_clock::now();
+  bool ok = waves.has_value();
+  size_t packages = 0;
+  if (waves) {
+    bela::flat_hash_map<std::wstring, size_t> placed;
+    for (size_t i = 0; i < waves->size(); i++) {
+      for (const auto &c : (*waves)[i]) {
+        placed.emplace(c.name, i);
+        packages++;
+      }
+    }
+    for (size_t i = 0; i < waves->size(); i++) {
+      for (const auto &c : (*waves)[i]) {
+        for (const auto &spec : c.depends) {
+          requirement r;
+          baulk::depends::ParseRequirement(spec, r, ec);
+          if (auto it = placed.find(r.name); it != placed.end() && it->second >= i) {
+            ok = false;
+          } else if (it == placed.end() && !s.installed.contains(r.name)) {
+            ok = false;
+          }
+        }
+      }
+    }
+  }
+  expect(L"large graph", ok,
+         bela::StrFormat(L"%d packages, %d requested: %d to install in %d waves, %d lookups, %.1fms", count,
+                         roots.size(), packages, waves ? waves->size() : 0, s.lookups,
+                         std::chrono::duration<double, std::milli>(t1 - t0).count()));
+}
+
+int wmain(int argc, wchar_t **argv) {
+  size_t count = 5000;
+  if (argc >= 2 && !bela::SimpleAtoi(argv[1], &count)) {
+    count = 5000;
+  }
+  synthetic s;
+  s.Add(L"main", {.name = L"app", .version = L"1.0.0", .depends = {L"libb", L"libc"}});
+  s.Add(L"main", {.name = L"libb", .version = L"2.0.0", .depends = {L"libd>=1.2.0"}});
+  s.Add(L"main", {.name = L"libc", .version = L"1.0.0", .depends = {L"libd"}});
+  s.Add(L"main", {.name = L"libd", .version = L"1.2.0"});
+  s.Add(L"extras", {.name = L"libd", .version = L"1.5.0"});
+  s.Add(L"main", {.name = L"tool", .version = L"3.0.0", .depends = {L"main/libd"}});
+  s.Add(L"main", {.name = L"plugin", .version = L"1.0.0", .depends = {L"extras/libd"}});
+  s.Add(L"main", {.name = L"old", .version = L"1.0.0", .depends = {L"libd<1.3.0"}});
+  s.Add(L"main", {.name = L"cyc1", .version = L"1.0.0", .depends = {L"cyc2"}});
+  s.Add(L"main", {.name = L"cyc2", .version = L"1.0.0", .depends = {L"cyc3"}});
+  s.Add(L"main", {.name = L"cyc3", .version = L"1.0.0", .depends = {L"cyc1"}});
+  s.Add(L"main", {.name = L"broken", .version = L"1.0.0", .depends = {L"missing"}});
+
+  expect_waves(L"diamond", s, {L"app"}, L"[libd@extras][libb@main libc@main][app@main]");
+  expect_waves(L"bucket qualified", s, {L"tool"}, L"[libd@main][tool@main]");
+  expect_waves(L"requested twice", s, {L"libc", L"app"}, L"[libd@extras][libb@main libc@main][app@main]");
+  s.installed.emplace(L"libd", L"1.3.0");
+  expect_waves(L"installed prerequisite", s, {L"app"}, L"[libb@main libc@main][app@main]");
+  s.installed[L"libd"] = L"1.0.0";
+  expect_waves(L"outdated prerequisite", s, {L"app"}, L"[libd@extras][libb@main libc@main][app@main]");
+  s.installed.clear();
+  expect_error(L"conflict", s, {L"app", L"old"}, L"does not satisfy libd<1.3.0");
+  // one name from two buckets: whichever is looked up first, the other requirement must not be dropped
+  expect_error(L"bucket conflict", s, {L"tool", L"plugin"}, L"'libd' from main conflicts with extras/libd");
+  expect_error(L"requested from two buckets", s, {L"extras/libd", L"main/libd"},
+               L"'libd' from extras conflicts with main/libd");
+  expect_error(L"bucket conflict with newest", s, {L"app", L"tool"}, L"'libd' from extras conflicts with main/libd");
+  expect_error(L"cycle", s, {L"cyc1"}, L"dependency cycle");
+  expect_error(L"missing", s, {L"broken"}, L"'broken' requires missing");
+  expect_error(L"bad requirement", s, {L"app>="}, L"bad requirement");
+  large_graph(count);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,506 @@
+// loopback HTTP/1.1 server for the socket transport
+//  httpd_test serve dir [port]  serve files under dir on 127.0.0.1
+//  httpd_test bench [size_mb]   download a synthetic payload over loopback and report throughput, keep-alive reuse,
+//                               chunked, redirect, torn response head, resume (Range/206), streaming tee,
+//                               conditional GET (ETag/304), Content-Encoding and LAN peer (PeerServer) behavior
+#include <bela/terminal.hpp>
+#include <bela/hash.hpp>
+#include <bela/str_split_narrow.hpp>
+#include <baulk/net/client.hpp>
+#include <baulk/net/tcp.hpp>
+#include <baulk/net/peer.hpp>
+#include <baulk/hash.hpp>
+#include <array>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <format>
+
+struct server_stats {
+  std::atomic_uint32_t connections{0};
+  std::atomic_uint32_t requests{0};
+  std::atomic_uint32_t partials{0};
+  std::atomic_uint32_t not_modified{0};
+  std::atomic_uint32_t encoded{0};
+};
+
+// gzip_stored wraps data in a gzip member of stored deflate blocks, the client decodes it like any gzip body
+std::string gzip_stored(std::string_view data) {
+  static const auto table = [] {
+    std::array<uint32_t, 256> t{};
+    for (uint32_t i = 0; i < 256; i++) {
+      auto c = i;
+      for (int k = 0; k < 8; k++) {
+        c = (c & 1) != 0 ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+      }
+      t[i] = c;
+    }
+    return t;
+  }();
+  uint32_t crc = 0xFFFFFFFFU;
+  for (auto c : data) {
+    crc = table[(crc ^ static_cast<uint8_t>(c)) & 0xFF] ^ (crc >> 8);
+  }
+  crc ^= 0xFFFFFFFFU;
+  auto isize = static_cast<uint32_t>(data.size());
+  auto le32 = [](std::string &out, uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+      out.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+    }
+  };
+  std::string out("\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\xff", 10);
+  do {
+    auto n = (std::min)(data.size(), static_cast<size_t>(65535));
+    out.push_back(n == data.size() ? 1 : 0);
+    out.push_back(static_cast<char>(n & 0xFF));
+    out.push_back(static_cast<char>(n >> 8));
+    out.push_back(static_cast<char>(~n & 0xFF));
+    out.push_back(static_cast<char>((~n >> 8) & 0xFF));
+    out.append(data.substr(0, n));
+    data.remove_prefix(n);
+  } while (!data.empty());
+  le32(out, crc);
+  le32(out, isize);
+  return out;
+}
+
+struct http_server {
+  std::filesystem::path root;
+  std::string payload;
+  server_stats stats;
+  std::atomic_bool stopped{false};
+
+  bool lookup(std::string_view path, std::string &body) {
+    if (path == "/payload.bin") {
+      body = payload;
+      return true;
+    }
+    if (path == "/feed.xml") {
+      body = payload.substr(0, 64 * 1024);
+      return true;
+    }
+    if (root.empty()) {
+      return false;
+    }
+    auto p = root / bela::encode_into<char, wchar_t>(path.substr(1));
+    FILE *fd = nullptr;
+    if (_wfopen_s(&fd, p.c_str(), L"rb") != 0) {
+      return false;
+    }
+    auto closer = bela::finally([&] { fclose(fd); });
+    char buffer[65536];
+    body.clear();
+    for (;;) {
+      auto n = fread(buffer, 1, sizeof(buffer), fd);
+      body.append(buffer, n);
+      if (n < sizeof(buffer)) {
+        break;
+      }
+    }
+    return true;
+  }
+
+  // serve one connection until the client closes it or asks for Connection: close
+  void serve(baulk::net::Conn &&conn) {
+    stats.connections++;
+    auto stream = baulk::net::MakeTcpStream(std::move(conn));
+    std::string inbuf;
+    char buffer[16384];
+    for (;;) {
+      bela::error_code ec;
+      size_t headend = 0;
+      while ((headend = inbuf.find("\r\n\r\n")) == std::string::npos) {
+        auto n = stream->Read(buffer, sizeof(buffer), 30000, ec);
+        if (n <= 0) {
+          return;
+        }
+        inbuf.append(buffer, static_cast<size_t>(n));
+      }
+      std::string head = inbuf.substr(0, headend);
+      inbuf.erase(0, headend + 4);
+      stats.requests++;
+      std::vector<std::string_view> lines = bela::narrow::StrSplit(head, bela::narrow::ByString("\r\n"));
+      std::vector<std::string_view> rl = bela::narrow::StrSplit(lines[0], bela::narrow::ByChar(' '));
+      if (rl.size() < 3) {
+        return;
+      }
+      auto target = rl[1];
+      auto path = target.substr(0, target.find('?'));
+      auto query = target.size() > path.size() ? target.substr(path.size() + 1) : std::string_view{};
+      int64_t range_from = -1;
+      int64_t range_last = -1;
+      bool keep_alive = true;
+      bool accept_gzip = false;
+      std::string_view if_none_match;
+      for (size_t i = 1; i < lines.size(); i++) {
+        auto line = lines[i];
+        if (bela::StartsWithIgnoreCase(line, "Range: bytes=")) {
+          auto v = line.substr(13);
+          auto dash = v.find('-');
+          if (dash == std::string_view::npos || !bela::SimpleAtoi(v.substr(0, dash), &range_from)) {
+            range_from = -1;
+          } else if (!bela::SimpleAtoi(v.substr(dash + 1), &range_last)) {
+            range_last = -1;
+          }
+        } else if (bela::StartsWithIgnoreCase(line, "Accept-Encoding:")) {
+          accept_gzip = line.find("gzip") != std::string_view::npos;
+        } else if (bela::StartsWithIgnoreCase(line, "If-None-Match:")) {
+          if_none_match = bela::StripAsciiWhitespace(line.substr(14));
+        } else if (bela::StartsWithIgnoreCase(line, "Connection:") &&
+                   bela::EqualsIgnoreCase(bela::StripAsciiWhitespace(line.substr(11)), "close")) {
+          keep_alive = false;
+        }
+      }
+      bool chunked = query.find("chunked") != std::string_view::npos;
+      int64_t drop = -1;
+      if (auto pos = query.find("drop="); pos != std::string_view::npos) {
+        auto v = query.substr(pos + 5);
+        if (!bela::SimpleAtoi(v.substr(0, v.find('&')), &drop)) {
+          drop = -1;
+        }
+      }
+      std::string out;
+      if (path == "/redirect") {
+        out = "HTTP/1.1 302 Found\r\nLocation: /payload.bin\r\nContent-Length: 0\r\n\r\n";
+        if (!stream->WriteFull(out.data(), out.size(), 30000, ec)) {
+          return;
+        }
+        continue;
+      }
+      if (path == "/torn-head") {
+        // the connection drops after the status line and part of the headers
+        out = "HTTP/1.1 200 OK\r\nContent-Length: 5\r\nContent-Ty";
+        stream->WriteFull(out.data(), out.size(), 30000, ec);
+        return;
+      }
+      std::string body;
+      if (!lookup(path, body)) {
+        out = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+        if (!stream->WriteFull(out.data(), out.size(), 30000, ec)) {
+          return;
+        }
+        continue;
+      }
+      // weak validator: good enough for a payload that does not change while the server runs
+      auto etag = std::format("\"{:x}\"", body.size());
+      if (if_none_match == etag) {
+        stats.not_modified++;
+        out = std::format("HTTP/1.1 304 Not Modified\r\nETag: {}\r\n\r\n", etag);
+        if (!stream->WriteFull(out.data(), out.size(), 30000, ec)) {
+          return;
+        }
+        continue;
+      }
+      // ?gzip: the body goes out gzip encoded when the client accepts it
+      bool gzipped = query.find("gzip") != std::string_view::npos && accept_gzip && range_from < 0;
+      if (gzipped) {
+        stats.encoded++;
+        body = gzip_stored(body);
+      }
+      std::string_view sv = body;
+      if (range_from >= 0 && range_from < static_cast<int64_t>(body.size())) {
+        stats.partials++;
+        auto last = range_last >= range_from && range_last < static_cast<int64_t>(body.size())
+                        ? static_cast<size_t>(range_last)
+                        : body.size() - 1;
+        out = std::format("HTTP/1.1 206 Partial Content\r\nContent-Range: bytes {}-{}/{}\r\n", range_from, last,
+                          body.size());
+        sv = sv.substr(static_cast<size_t>(range_from), last + 1 - static_cast<size_t>(range_from));
+      } else {
+        out = "HTTP/1.1 200 OK\r\n";
+      }
+      out.append(std::format("Accept-Ranges: bytes\r\nContent-Type: application/octet-stream\r\nETag: {}\r\n", etag));
+      if (gzipped) {
+        out.append("Content-Encoding: gzip\r\n");
+      }
+      if (!keep_alive) {
+        out.append("Connection: close\r\n");
+      }
+      if (chunked) {
+        out.append("Transfer-Encoding: chunked\r\n\r\n");
+      } else {
+        out.append(std::format("Content-Length: {}\r\n\r\n", sv.size()));
+      }
+      if (!stream->WriteFull(out.data(), out.size(), 30000, ec)) {
+        return;
+      }
+      if (drop >= 0 && drop < static_cast<int64_t>(sv.size())) {
+        // simulate a broken transfer
+        stream->WriteFull(sv.data(), static_cast<size_t>(drop), 30000, ec);
+        return;
+      }
+      if (chunked) {
+        constexpr size_t chunk_size = 32 * 1024;
+        while (!sv.empty()) {
+          auto n = (std::min)(sv.size(), chunk_size);
+          auto hdr = std::format("{:x}\r\n", n);
+          if (!stream->WriteFull(hdr.data(), hdr.size(), 30000, ec) || !stream->WriteFull(sv.data(), n, 30000, ec) ||
+              !stream->WriteFull("\r\n", 2, 30000, ec)) {
+            return;
+          }
+          sv.remove_prefix(n);
+        }
+        if (!stream->WriteFull("0\r\n\r\n", 5, 30000, ec)) {
+          return;
+        }
+      } else if (!stream->WriteFull(sv.data(), sv.size(), 30000, ec)) {
+        return;
+      }
+      if (!keep_alive) {
+        return;
+      }
+    }
+  }
+
+  void run(baulk::net::Listener &l) {
+    while (!stopped) {
+      bela::error_code ec;
+      auto conn = l.Accept(200, ec);
+      if (!conn) {
+        continue;
+      }
+      std::thread([this, c = std::move(*conn)]() mutable { serve(std::move(c)); }).detach();
+    }
+  }
+};
+
+std::wstring payload_sha256(const std::string &payload) {
+  bela::hash::sha256::Hasher h;
+  h.Initialize();
+  h.Update(payload.data(), payload.size());
+  return bela::StringCat(L"SHA256:", h.Finalize());
+}
+
+bool download(baulk::net::HttpClient &client, std::wstring_view url, const std::filesystem::path &dest,
+              std::wstring_view hash_value, bela::error_code &ec) {
+  baulk::net::download_options opts{.hash_value = std::wstring(hash_value), .destination = dest};
+  auto file = client.WinGet(url, opts, ec);
+  if (!file) {
+    return false;
+  }
+  return baulk::hash::HashEqual(*file, hash_value, ec);
+}
+
+int bench(int size_mb) {
+  http_server server;
+  server.payload.resize(static_cast<size_t>(size_mb) * 1024 * 1024);
+  uint32_t x = 2463534242;
+  for (auto &c : server.payload) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    c = static_cast<char>(x);
+  }
+  bela::error_code ec;
+  auto l = baulk::net::Listen(L"127.0.0.1", 0, ec);
+  if (!l) {
+    bela::FPrintF(stderr, L"listen: %s\n", ec);
+    return 1;
+  }
+  std::thread acceptor([&] { server.run(*l); });
+  auto closer = bela::finally([&] {
+    server.stopped = true;
+    acceptor.join();
+  });
+  auto base = bela::StringCat(L"http://127.0.0.1:", l->Port());
+  auto hash_value = payload_sha256(server.payload);
+  std::error_code e;
+  auto tmp = std::filesystem::temp_directory_path(e) / L"baulk-httpd-test";
+  std::filesystem::create_directories(tmp, e);
+  auto dest = tmp / L"payload.bin";
+  int failures = 0;
+  auto check = [&](std::wstring_view name, bool ok) {
+    bela::FPrintF(stderr, L"%s %s\n", ok ? L"\x1b[32mPASS\x1b[0m" : L"\x1b[31mFAIL\x1b[0m", name);
+    if (!ok) {
+      bela::FPrintF(stderr, L"  %s\n", ec);
+      failures++;
+    }
+  };
+  baulk::net::HttpClient client;
+  client.SetTransport(baulk::net::transport_t::Socket);
+  auto measure = [&](baulk::net::HttpClient &c, std::wstring_view name, int rounds) {
+    auto begin = std::chrono::steady_clock::now();
+    bool ok = true;
+    for (int i = 0; i < rounds && ok; i++) {
+      ok = download(c, bela::StringCat(base, L"/payload.bin"), dest, hash_value, ec);
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    check(name, ok);
+    bela::FPrintF(stderr, L"  %d x %d MB in %.3fs: %.1f MB/s\n", rounds, size_mb, elapsed,
+                  static_cast<double>(rounds) * size_mb / elapsed);
+  };
+
+  auto connections = server.stats.connections.load();
+  measure(client, L"socket transport", 5);
+  check(L"keep-alive reuse", server.stats.connections.load() - connections == 1);
+  check(L"chunked", download(client, bela::StringCat(base, L"/payload.bin?chunked"), dest, hash_value, ec));
+  check(L"redirect", download(client, bela::StringCat(base, L"/redirect"), dest, hash_value, ec));
+  // a head cut off after its status line is an error, not a 200 with some of its headers
+  check(L"torn response head", [&] {
+    auto resp = client.Get(bela::StringCat(base, L"/torn-head"), ec);
+    return !resp && ec.code != 0;
+  }());
+  // resume: the first transfer breaks halfway, FilePart keeps the .part overlay, the retry asks for the rest
+  auto partials = server.stats.partials.load();
+  check(L"broken transfer fails",
+        !download(client, bela::StringCat(base, L"/payload.bin?drop=", server.payload.size() / 2), dest, hash_value,
+                  ec));
+  check(L"resume with Range/206", download(client, bela::StringCat(base, L"/payload.bin"), dest, hash_value, ec) &&
+                                      server.stats.partials.load() - partials == 1);
+
+  // tee: the sink sees the whole body even when a part file is left over, a zip package is only hashed this way
+  auto tee = [&](baulk::net::HttpClient &c) {
+    baulk::hash::Verifier verifier;
+    size_t teed = 0;
+    if (!verifier.Initialize(hash_value, ec)) {
+      return false;
+    }
+    download(c, bela::StringCat(base, L"/payload.bin?drop=", server.payload.size() / 3), dest, hash_value, ec);
+    auto file = c.WinGet(bela::StringCat(base, L"/payload.bin"),
+                         {.hash_value = hash_value,
+                          .destination = dest,
+                          .sink =
+                              [&](const void *data, size_t len, bela::error_code &) {
+                                verifier.Update(data, len);
+                                teed += len;
+                                return true;
+                              }},
+                         ec);
+    return file && teed == server.payload.size() && verifier.Equal(ec);
+  };
+  check(L"streaming tee (socket)", tee(client));
+
+  // content coding: REST responses and downloads are decoded while they are received
+  auto decode = [&](baulk::net::HttpClient &c) {
+    auto encoded = server.stats.encoded.load();
+    auto resp = c.Get(bela::StringCat(base, L"/feed.xml?gzip"), ec);
+    if (!resp || resp->Content() != std::string_view(server.payload).substr(0, 64 * 1024)) {
+      return false;
+    }
+    return download(c, bela::StringCat(base, L"/payload.bin?gzip"), dest, hash_value, ec) &&
+           server.stats.encoded.load() - encoded == 2;
+  };
+  check(L"Content-Encoding gzip (socket)", decode(client));
+
+  // conditional GET: the second request is answered with 304 and served from the response cache
+  auto revalidate = [&](baulk::net::HttpClient &c) {
+    auto not_modified = server.stats.not_modified.load();
+    if (!c.EnableResponseCache(tmp / L"httpcache", ec)) {
+      return false;
+    }
+    auto first = c.Get(bela::StringCat(base, L"/feed.xml"), ec);
+    auto second = c.Get(bela::StringCat(base, L"/feed.xml"), ec);
+    auto stats = c.CacheStats();
+    return first && second && second->StatusCode() == 200 && second->Content() == first->Content() &&
+           server.stats.not_modified.load() - not_modified == 1 && stats.hits == 1;
+  };
+  check(L"conditional GET (socket)", revalidate(client));
+
+  auto stats = client.PoolStats();
+  bela::FPrintF(stderr, L"socket pool hits: %d misses: %d\n", stats.hits, stats.misses);
+
+  baulk::net::HttpClient winhttp;
+  measure(winhttp, L"WinHTTP transport (reference)", 5);
+  stats = winhttp.PoolStats();
+  check(L"WinHTTP session reuse", stats.misses == 1);
+  check(L"streaming tee (WinHTTP)", tee(winhttp));
+  check(L"Content-Encoding gzip (WinHTTP)", decode(winhttp));
+  std::filesystem::remove_all(tmp / L"httpcache", e);
+  check(L"conditional GET (WinHTTP)", revalidate(winhttp));
+  // segmented: the first response serves range 0, three more ranged requests run in parallel
+  partials = server.stats.partials.load();
+  {
+    auto begin = std::chrono::steady_clock::now();
+    auto file = winhttp.WinGet(bela::StringCat(base, L"/payload.bin"),
+                               {.hash_value = hash_value, .destination = dest, .segments = 4}, ec);
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    check(L"segmented download", file && baulk::hash::HashEqual(*file, hash_value, ec) &&
+                                     server.stats.partials.load() - partials >= 3);
+    bela::FPrintF(stderr, L"  1 x %d MB in %.3fs: %.1f MB/s\n", size_mb, elapsed, size_mb / elapsed);
+  }
+
+  // peers: a blob of the peer is preferred over the origin, a blob that does not match the hash is not
+  {
+    auto blobs = tmp / L"blobs";
+    std::filesystem::create_directories(blobs, e);
+    auto key = baulk::hash::HashKey(hash_value, ec);
+    auto store = [&](std::string_view data) {
+      FILE *fd = nullptr;
+      if (!key || _wfopen_s(&fd, (blobs / *key).c_str(), L"wb") != 0) {
+        return false;
+      }
+      auto n = fwrite(data.data(), 1, data.size(), fd);
+      fclose(fd);
+      return n == data.size();
+    };
+    auto pl = baulk::net::Listen(L"127.0.0.1", 0, ec);
+    if (!pl || !store(server.payload)) {
+      check(L"peer server", false);
+    } else {
+      baulk::net::PeerServer peer(blobs);
+      std::thread pt([&] { peer.Serve(*pl); });
+      auto stop = bela::finally([&] {
+        peer.Stop();
+        pt.join();
+      });
+      auto peer_base = bela::StringCat(L"http://127.0.0.1:", pl->Port());
+      auto listing = client.Get(bela::StringCat(peer_base, L"/blobs/"), ec);
+      check(L"peer listing", listing && listing->Content().find(bela::encode_into<wchar_t, char>(*key)) !=
+                                             std::string_view::npos);
+      auto peered = [&](baulk::net::HttpClient &c) {
+        auto requests = server.stats.requests.load();
+        c.SetPeers({peer_base});
+        return download(c, bela::StringCat(base, L"/payload.bin"), dest, hash_value, ec) &&
+               server.stats.requests.load() == requests;
+      };
+      baulk::net::HttpClient sp;
+      sp.SetTransport(baulk::net::transport_t::Socket);
+      check(L"peer download (socket)", peered(sp));
+      baulk::net::HttpClient wp;
+      check(L"peer download (WinHTTP)", peered(wp));
+      // a corrupt blob: the peer is dropped and the origin serves the download
+      auto corrupt = server.payload;
+      corrupt[corrupt.size() / 2] ^= 0x5a;
+      baulk::net::HttpClient cp;
+      cp.SetTransport(baulk::net::transport_t::Socket);
+      cp.SetPeers({peer_base});
+      auto requests = server.stats.requests.load();
+      check(L"corrupt peer blob falls back to origin",
+            store(corrupt) && download(cp, bela::StringCat(base, L"/payload.bin"), dest, hash_value, ec) &&
+                server.stats.requests.load() - requests == 1);
+    }
+  }
+  std::filesystem::remove_all(tmp, e);
+  bela::FPrintF(stderr, L"connections: %d requests: %d\n", server.stats.connections.load(),
+                server.stats.requests.load());
+  return failures == 0 ? 0 : 1;
+}
+
+int wmain(int argc, wchar_t **argv) {
+  if (argc >= 2 && wcscmp(argv[1], L"bench") == 0) {
+    int size_mb = 64;
+    if (argc >= 3 && (!bela::SimpleAtoi(argv[2], &size_mb) || size_mb <= 0)) {
+      size_mb = 64;
+    }
+    return bench(size_mb);
+  }
+  if (argc < 3 || wcscmp(argv[1], L"serve") != 0) {
+    bela::FPrintF(stderr, L"usage: %s serve dir [port]\n       %s bench [size_mb]\n", argv[0], argv[0]);
+    return 1;
+  }
+  http_server server;
+  server.root = argv[2];
+  int port = 8080;
+  if (argc >= 4 && !bela::SimpleAtoi(argv[3], &port)) {
+    port = 8080;
+  }
+  bela::error_code ec;
+  auto l = baulk::net::Listen(L"127.0.0.1", port, ec);
+  if (!l) {
+    bela::FPrintF(stderr, L"listen: %s\n", ec);
+    return 1;
+  }
+  bela::FPrintF(stderr, L"serving %s on http://127.0.0.1:%d/\n", server.root.native(), l->Port());
+  server.run(*l);
+  return 0;
+}
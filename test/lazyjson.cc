@@ -0,0 +1,191 @@
+// Checks that the fields PackageMeta reads (strings, string arrays, paths, the architecture and venv objects) come out
+// of parse_json_file_lazy exactly as out of parse_json_file, for native and scoop manifests. Also checks that a
+// manifest cut off inside an array is rejected
+#include <bela/terminal.hpp>
+#include <bela/str_cat.hpp>
+#include <bela/numbers.hpp>
+#include <bela/io.hpp>
+#include <baulk/json_lazy.hpp>
+#include <chrono>
+#include "testing.hpp"
+
+struct manifest_fields {
+  std::wstring description;
+  std::wstring version;
+  std::wstring homepage;
+  std::wstring license;
+  std::wstring url;
+  std::wstring hash;
+  std::wstring category;
+  std::vector<std::wstring> urls;
+  std::vector<std::wstring> links;
+  std::vector<std::wstring> launchers;
+  std::vector<std::wstring> paths;
+  std::vector<std::wstring> envs;
+  std::vector<std::wstring> suggest;
+  bool operator==(const manifest_fields &) const = default;
+};
+
+// the fields PackageMeta reads from a native or a scoop manifest
+template <typename View> manifest_fields read_fields(View &jv) {
+  manifest_fields f{
+      .description = jv.fetch("description"),
+      .version = jv.fetch("version"),
+      .homepage = jv.fetch("homepage"),
+      .license = jv.fetch("license"),
+  };
+  jv.fetch_strings_checked("suggest", f.suggest);
+  if (auto sv = jv.subview("architecture"); sv) {
+    if (auto av = sv->subview("64bit"); av) {
+      f.url = av->fetch("url");
+      f.hash = av->fetch("hash");
+    }
+  }
+  jv.fetch_strings_checked("url64", f.urls);
+  if (f.hash.empty()) {
+    f.hash = jv.fetch("url64.hash");
+  }
+  jv.fetch_paths_checked("links64", f.links);
+  jv.fetch_paths_checked("launchers", f.launchers);
+  jv.fetch_paths_checked("bin", f.launchers);
+  if (auto sv = jv.subview("venv"); sv) {
+    f.category = sv->fetch("category");
+    sv->fetch_paths_checked("path", f.paths);
+    sv->fetch_strings_checked("env", f.envs);
+  }
+  return f;
+}
+
+std::string random_hash(xorshift &rng) {
+  constexpr std::string_view hex = "0123456789abcdef";
+  std::string h;
+  for (int i = 0; i < 64; i++) {
+    h.push_back(hex[rng() % 16]);
+  }
+  return h;
+}
+
+// native_manifest: the shape of a baulk bucket manifest
+std::string native_manifest(size_t i, xorshift &rng) {
+  auto version = bela::encode_into<wchar_t, char>(bela::StringCat(rng() % 4, L".", rng() % 12, L".", rng() % 30));
+  nlohmann::json j{
+      {"description", "A synthetic tool, \"quoted\" and ü-encoded été"},
+      {"version", version},
+      {"homepage", "https://example.com/tool"},
+      {"license", "MIT"},
+      {"notes", "Please run tool --init after the first installation"},
+      {"url64", {"https://example.com/download/v" + version + "/tool-x64.zip"}},
+      {"url64.hash", "SHA256:" + random_hash(rng)},
+      {"urlarm64", {"https://example.com/download/v" + version + "/tool-arm64.zip"}},
+      {"urlarm64.hash", "SHA256:" + random_hash(rng)},
+      {"links64", {"bin/tool.exe", "bin/tool-helper.exe"}},
+      {"launchers", {"tool-gui.exe"}},
+  };
+  if (i % 3 == 0) {
+    j["venv"] = {{"category", "dev"},
+                 {"path", {"bin", "lib/tool/bin"}},
+                 {"env", {"TOOL_HOME=${BAULK_PACKAGE_FOLDER}"}},
+                 {"dependencies", {"7z"}}};
+  }
+  if (i % 5 == 0) {
+    j["suggest"] = {"git", "7z"};
+  }
+  auto text = j.dump(2, ' ', i % 4 == 0); // some with \u escapes
+  if (i % 7 == 0) {
+    text.insert(1, "\n  // comments are allowed in manifests");
+  }
+  return text;
+}
+
+// scoop_manifest: the shape of a scoop bucket manifest, most of it is never read by baulk
+std::string scoop_manifest(size_t i, xorshift &rng) {
+  auto version = bela::encode_into<wchar_t, char>(bela::StringCat(rng() % 9, L".", rng() % 20, L".", i % 100));
+  auto arch = [&](std::string_view name) {
+    return nlohmann::json{{"url", bela::encode_into<wchar_t, char>(bela::StringCat(
+                                      L"https://example.com/tool-", version, L"-", name, L".zip"))},
+                          {"hash", random_hash(rng)},
+                          {"extract_dir", bela::encode_into<wchar_t, char>(bela::StringCat(L"tool-", version))}};
+  };
+  nlohmann::json lines = nlohmann::json::array();
+  for (int k = 0; k < 24; k++) {
+    lines.push_back("if (!(Test-Path \"$persist_dir\\\\config\")) { New-Item \"$dir\\\\config\" -ItemType Directory }");
+  }
+  nlohmann::json j{
+      {"##", "synthetic scoop manifest"},
+      {"version", version},
+      {"description", "A synthetic scoop tool"},
+      {"homepage", "https://example.com"},
+      {"license", {{"identifier", "Freeware"}, {"url", "https://example.com/license"}}},
+      {"architecture", {{"64bit", arch("x64")}, {"32bit", arch("x86")}, {"arm64", arch("arm64")}}},
+      {"pre_install", lines},
+      {"post_install", lines},
+      {"bin", {"tool.exe", "tool-cli.exe"}},
+      {"persist", {"config", "data"}},
+      {"checkver", {{"github", "https://github.com/example/tool"}, {"regex", "v([\\d.]+)\\.zip"}}},
+      {"autoupdate",
+       {{"architecture",
+         {{"64bit", {{"url", "https://example.com/tool-$version-x64.zip"}}},
+          {"32bit", {{"url", "https://example.com/tool-$version-x86.zip"}}}}},
+        {"hash", {{"url", "$url.sha256"}}}}},
+  };
+  return j.dump(4);
+}
+
+int wmain(int argc, wchar_t **argv) {
+  size_t count = 2000;
+  if (argc >= 2 && !bela::SimpleAtoi(argv[1], &count)) {
+    count = 2000;
+  }
+  std::error_code e;
+  auto root = std::filesystem::temp_directory_path(e) / L"baulk-lazyjson-test";
+  std::filesystem::remove_all(root, e);
+  std::filesystem::create_directories(root, e);
+  xorshift rng;
+  std::vector<std::wstring> files;
+  bela::error_code ec;
+  for (size_t i = 0; i < count; i++) {
+    auto file = (root / bela::StringCat(L"package", i, L".json")).wstring();
+    auto text = i % 2 == 0 ? native_manifest(i, rng) : scoop_manifest(i, rng);
+    if (!bela::io::WriteText(file, bela::io::as_bytes<char>(text), ec)) {
+      bela::FPrintF(stderr, L"write %s error: %s\n", file, ec);
+      return 1;
+    }
+    files.emplace_back(std::move(file));
+  }
+  std::vector<manifest_fields> expected;
+  std::vector<manifest_fields> lazy;
+  expected.reserve(files.size());
+  lazy.reserve(files.size());
+  auto t0 = std::chrono::steady_clock::now();
+  for (const auto &file : files) {
+    auto jo = baulk::parse_json_file(file, ec);
+    if (!jo) {
+      bela::FPrintF(stderr, L"parse %s error: %s\n", file, ec);
+      return 1;
+    }
+    auto jv = jo->view();
+    expected.emplace_back(read_fields(jv));
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  for (const auto &file : files) {
+    auto jo = baulk::parse_json_file_lazy(file, ec);
+    if (!jo) {
+      bela::FPrintF(stderr, L"lazy parse %s error: %s\n", file, ec);
+      return 1;
+    }
+    auto jv = jo->view();
+    lazy.emplace_back(read_fields(jv));
+  }
+  auto t2 = std::chrono::steady_clock::now();
+  // malformed manifests are still reported
+  auto broken = (root / L"broken.json").wstring();
+  bela::io::WriteText(broken, bela::io::as_bytes<char>(std::string_view(R"({"version": "1.0", "url": [)")), ec);
+  auto rejected = !baulk::parse_json_file_lazy(broken, ec);
+  std::filesystem::remove_all(root, e);
+  expect(L"lazy reads", lazy == expected,
+         bela::StrFormat(L"%d manifests, dom %.1fms, lazy %.1fms", files.size(),
+                         std::chrono::duration<double, std::milli>(t1 - t0).count(),
+                         std::chrono::duration<double, std::milli>(t2 - t1).count()));
+  expect(L"malformed manifest", rejected);
+  return failures == 0 ? 0 : 1;
+}
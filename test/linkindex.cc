@@ -0,0 +1,152 @@
+// Checks that every alias resolves from the link index to the target and console flag that baulk.linkmeta.json
+// gives. Also checks that an index older than the metadata or truncated is refused, and that writing it again makes
+// it usable. Prints the launcher lookup time through the index and through the metadata
+#include <bela/terminal.hpp>
+#include <bela/str_cat.hpp>
+#include <bela/numbers.hpp>
+#include <bela/path.hpp>
+#include <bela/pe.hpp>
+#include <bela/str_split.hpp>
+#include <baulk/linkmeta.hpp>
+#include <baulk/linkindex.hpp>
+#include <chrono>
+#include "testing.hpp"
+
+// resolve_json: the metadata path of baulk-lnk, parse the whole file, look the alias up, read the PE header
+std::optional<baulk::linkindex::Link> resolve_json(std::wstring_view folder, std::wstring_view alias) {
+  bela::error_code ec;
+  auto jo = baulk::parse_json_file(baulk::linkmeta::MetaPath(folder), ec);
+  if (!jo) {
+    return std::nullopt;
+  }
+  auto jv = jo->view();
+  auto sv = jv.subview("links");
+  if (!sv) {
+    return std::nullopt;
+  }
+  auto linkTarget = sv->fetch(bela::encode_into<wchar_t, char>(alias));
+  std::vector<std::wstring_view> tv = bela::StrSplit(linkTarget, bela::ByChar('@'), bela::SkipEmpty());
+  if (tv.size() < 2) {
+    return std::nullopt;
+  }
+  baulk::linkindex::Link link{.alias = std::wstring(alias),
+                              .target = bela::StringCat(jv.fetch("app_packages_root"), L"\\", tv[0], L"\\", tv[1])};
+  if (auto realexe = bela::RealPathEx(link.target, ec); realexe) {
+    link.console = bela::pe::IsSubsystemConsole(*realexe);
+  }
+  return std::make_optional(std::move(link));
+}
+
+std::optional<baulk::linkindex::Link> resolve_index(std::wstring_view folder, std::wstring_view alias) {
+  bela::error_code ec;
+  baulk::linkindex::Reader index;
+  if (!index.Open(folder, ec)) {
+    return std::nullopt;
+  }
+  auto i = index.Find(alias);
+  if (!i) {
+    return std::nullopt;
+  }
+  return std::make_optional(baulk::linkindex::Link{
+      .alias = std::wstring(alias), .target = std::wstring(index.Target(*i)), .console = index.Console(*i)});
+}
+
+bool write_index(baulk::linkmeta::Store &store, std::wstring_view folder, std::wstring_view packagesRoot,
+                 bela::error_code &ec) {
+  baulk::linkindex::identity id;
+  if (!baulk::linkindex::Identify(baulk::linkmeta::MetaPath(folder), id, ec)) {
+    return false;
+  }
+  std::vector<baulk::linkindex::Link> links;
+  for (const auto &[alias, meta] : store.Links()) {
+    if (auto link = baulk::linkindex::Resolve(alias, meta, packagesRoot); link) {
+      links.emplace_back(std::move(*link));
+    }
+  }
+  return baulk::linkindex::Write(links, id, baulk::linkindex::IndexPath(folder), ec);
+}
+
+int wmain(int argc, wchar_t **argv) {
+  size_t count = 500;
+  size_t launches = 1000;
+  if (argc >= 2 && !bela::SimpleAtoi(argv[1], &count)) {
+    count = 500;
+  }
+  if (argc >= 3 && !bela::SimpleAtoi(argv[2], &launches)) {
+    launches = 1000;
+  }
+  std::error_code e;
+  auto root = std::filesystem::temp_directory_path(e) / L"baulk-linkindex-test";
+  std::filesystem::remove_all(root, e);
+  std::filesystem::create_directories(root / L"links", e);
+  std::filesystem::create_directories(root / L"packages" / L"bench", e);
+  auto folder = (root / L"links").wstring();
+  auto packagesRoot = (root / L"packages").wstring();
+  bela::error_code ec;
+  // one real console program among count links to missing files, the benchmark launches it
+  auto self = bela::Executable(ec);
+  if (!self) {
+    bela::FPrintF(stderr, L"executable path: %s\n", ec);
+    return 1;
+  }
+  std::filesystem::copy_file(*self, root / L"packages" / L"bench" / L"bench.exe", e);
+  baulk::linkmeta::Store store;
+  store.Open(folder, ec);
+  std::vector<std::pair<std::wstring, std::wstring>> aliases{{L"bench.exe", L"bench@bench.exe@1.0.0"}};
+  for (size_t i = 0; i < count; i++) {
+    aliases.emplace_back(bela::StringCat(L"tool", i, L".exe"),
+                         bela::StringCat(L"pkg", i, L"@bin\\tool", i, L".exe@1.0"));
+  }
+  auto ok = store.Put(aliases, ec) && store.Commit(packagesRoot, ec) && write_index(store, folder, packagesRoot, ec);
+  expect(L"write", ok, ec.message);
+
+  // every alias resolves alike from the index and from the metadata
+  ok = true;
+  for (const auto &[alias, meta] : aliases) {
+    auto a = resolve_json(folder, alias);
+    auto b = resolve_index(folder, alias);
+    ok = ok && a && b && a->target == b->target && a->console == b->console;
+  }
+  ok = ok && !resolve_index(folder, L"missing.exe") && !resolve_index(folder, L"BENCH.EXE");
+  auto bench = resolve_index(folder, L"bench.exe");
+  expect(L"resolve", ok && bench && bench->console,
+         bench ? bela::StringCat(bench->target, L" console: ", bench->console ? L"yes" : L"no") : L"");
+
+  // the metadata moves on, the index is refused until it is written again
+  store.Put({{L"late.exe", L"late@late.exe@1.0"}}, ec);
+  store.Commit(packagesRoot, ec);
+  baulk::linkindex::Reader stale;
+  ok = !stale.Open(folder, ec);
+  expect(L"stale", ok, ec.message);
+  ok = write_index(store, folder, packagesRoot, ec) && resolve_index(folder, L"late.exe");
+  expect(L"rewritten", ok, ec.message);
+
+  // a truncated index is refused
+  auto indexPath = baulk::linkindex::IndexPath(folder);
+  auto indexSize = std::filesystem::file_size(indexPath, e);
+  std::filesystem::copy_file(indexPath, root / L"index.bak", e);
+  std::filesystem::resize_file(indexPath, indexSize - 8, e);
+  baulk::linkindex::Reader damaged;
+  expect(L"damaged", !damaged.Open(folder, ec), ec.message);
+  damaged.Close();
+  std::filesystem::copy_file(root / L"index.bak", indexPath, std::filesystem::copy_options::overwrite_existing, e);
+
+  // startup: what a launcher does before CreateProcess, launches times
+  auto t0 = std::chrono::steady_clock::now();
+  size_t hits[2] = {0, 0};
+  for (size_t i = 0; i < launches; i++) {
+    hits[0] += resolve_json(folder, L"bench.exe") ? 1 : 0;
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < launches; i++) {
+    hits[1] += resolve_index(folder, L"bench.exe") ? 1 : 0;
+  }
+  auto t2 = std::chrono::steady_clock::now();
+  auto us = [&](auto d) { return std::chrono::duration<double, std::micro>(d).count() / launches; };
+  expect(L"startup", hits[0] == launches && hits[1] == launches,
+         bela::StringCat(count + 2, L" links, ", launches, L" launches: metadata ",
+                         static_cast<int64_t>(us(t1 - t0)), L"us, index ", static_cast<int64_t>(us(t2 - t1)),
+                         L"us per launch"));
+  std::filesystem::remove_all(root, e);
+  return failures == 0 ? 0 : 1;
+}
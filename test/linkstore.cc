@@ -0,0 +1,117 @@
+// Checks that a batch of link changes reaches baulk.linkmeta.json in one commit and leaves no journal behind. Also
+// checks that the next Store replays the changes of a command that died before its commit, that a torn last journal
+// line is skipped, and that a reader parsing the metadata during commits never sees a partial file
+#include <bela/terminal.hpp>
+#include <bela/str_cat.hpp>
+#include <bela/numbers.hpp>
+#include <bela/io.hpp>
+#include <baulk/linkmeta.hpp>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "testing.hpp"
+
+std::vector<std::pair<std::wstring, std::wstring>> package_links(std::wstring_view pkg, size_t n) {
+  std::vector<std::pair<std::wstring, std::wstring>> aliases;
+  for (size_t i = 0; i < n; i++) {
+    aliases.emplace_back(bela::StringCat(pkg, L"-", i, L".exe"), bela::StringCat(pkg, L"@bin\\", i, L".exe@1.0.0"));
+  }
+  return aliases;
+}
+
+int wmain(int argc, wchar_t **argv) {
+  size_t count = 200;
+  if (argc >= 2 && !bela::SimpleAtoi(argv[1], &count)) {
+    count = 200;
+  }
+  std::error_code e;
+  auto root = std::filesystem::temp_directory_path(e) / L"baulk-linkmeta-test";
+  std::filesystem::remove_all(root, e);
+  std::filesystem::create_directories(root, e);
+  auto folder = root.wstring();
+  auto metaPath = baulk::linkmeta::MetaPath(folder);
+  auto journalPath = baulk::linkmeta::JournalPath(folder);
+  bela::error_code ec;
+
+  // a batch: count packages installed, one uninstalled, one write of the metadata
+  {
+    baulk::linkmeta::Store store;
+    expect(L"open empty", store.Open(folder, ec) && store.Size() == 0, ec.message);
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; i++) {
+      store.Put(package_links(bela::StringCat(L"pkg", i), 3), ec);
+    }
+    auto removed = store.Remove(L"pkg0", ec);
+    auto ok = store.Commit(L"C:\\baulk\\packages", ec);
+    auto t1 = std::chrono::steady_clock::now();
+    expect(L"batch", ok && removed && removed->size() == 3 && store.Size() == (count - 1) * 3 && !store.Dirty() &&
+                         !bela::PathExists(journalPath),
+           bela::StringCat(count, L" packages in ",
+                           std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count(), L"us"));
+  }
+  {
+    auto jo = baulk::parse_json_file(metaPath, ec);
+    expect(L"written", jo && jo->obj["links"].size() == (count - 1) * 3 &&
+                           jo->obj["links"]["pkg1-2.exe"].get<std::string>() == "pkg1@bin\\2.exe@1.0.0");
+  }
+
+  // a command dies before its commit: the journal is replayed by the next store
+  {
+    baulk::linkmeta::Store store;
+    store.Open(folder, ec);
+    store.Put(package_links(L"crashed", 2), ec);
+    store.Remove(L"pkg1", ec);
+  }
+  {
+    baulk::linkmeta::Store store;
+    auto ok = store.Open(folder, ec) && store.Dirty() &&
+              store.Target(L"crashed-1.exe") == L"crashed@bin\\1.exe@1.0.0" && store.Target(L"pkg1-0.exe").empty() &&
+              store.Commit(L"C:\\baulk\\packages", ec);
+    expect(L"replay", ok && !bela::PathExists(journalPath), ec.message);
+  }
+
+  // a torn last line is skipped, the next change starts a line of its own
+  {
+    std::string journal = R"({"alias":"torn-0.exe","target":"torn@0.exe@1.0"})"
+                          "\n"
+                          R"({"alias":"torn-1.exe","tar)";
+    bela::io::WriteText(journalPath, bela::io::as_bytes<char>(journal), ec);
+    baulk::linkmeta::Store store;
+    auto ok = store.Open(folder, ec) && store.Target(L"torn-0.exe") == L"torn@0.exe@1.0" &&
+              store.Target(L"torn-1.exe").empty() && store.Put({{L"after.exe", L"after@after.exe@1.0"}}, ec);
+    baulk::linkmeta::Store replayed;
+    ok = ok && replayed.Open(folder, ec) && replayed.Target(L"after.exe") == L"after@after.exe@1.0";
+    expect(L"torn journal", ok && store.Commit(L"C:\\baulk\\packages", ec), ec.message);
+  }
+
+  // readers parse the metadata while it is committed over and over, every read is a whole file
+  {
+    std::atomic_bool done{false};
+    std::atomic_size_t reads{0};
+    std::atomic_size_t partial{0};
+    std::thread reader([&] {
+      while (!done) {
+        bela::error_code rec;
+        if (auto jo = baulk::parse_json_file(metaPath, rec); jo) {
+          reads++;
+          continue;
+        }
+        if (rec.code != ERROR_FILE_NOT_FOUND && rec.code != ERROR_SHARING_VIOLATION) {
+          partial++;
+        }
+      }
+    });
+    baulk::linkmeta::Store store;
+    store.Open(folder, ec);
+    bool ok = true;
+    for (size_t i = 0; i < 100 && ok; i++) {
+      ok = store.Put(package_links(bela::StringCat(L"round", i), 3), ec) && store.Commit(L"C:\\baulk\\packages", ec);
+    }
+    done = true;
+    reader.join();
+    expect(L"concurrent readers", ok && partial == 0,
+           bela::StringCat(reads.load(), L" reads, ", partial.load(), L" partial ", ec.message));
+  }
+  std::filesystem::remove_all(root, e);
+  return failures == 0 ? 0 : 1;
+}
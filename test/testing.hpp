@@ -0,0 +1,31 @@
+//
+#ifndef BAULK_TEST_TESTING_HPP
+#define BAULK_TEST_TESTING_HPP
+#include <bela/terminal.hpp>
+#include <cstdint>
+
+// xorshift32 with a fixed seed: every run builds the same synthetic buckets
+class xorshift {
+public:
+  uint32_t operator()() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+
+private:
+  uint32_t state{2463534242};
+};
+
+// failures counts the checks that did not hold, a test exits with 1 when there is any
+inline int failures = 0;
+
+// expect prints one PASS or FAIL line for a check, detail follows the title
+inline bool expect(std::wstring_view title, bool ok, std::wstring_view detail = L"") {
+  failures += ok ? 0 : 1;
+  bela::FPrintF(stderr, L"%s %s %s\n", ok ? L"\x1b[32mPASS\x1b[0m" : L"\x1b[31mFAIL\x1b[0m", title, detail);
+  return ok;
+}
+
+#endif
@@ -0,0 +1,110 @@
+// Checks that a search through trigram candidates finds the same synthetic packages as a case-insensitive scan of
+// every name and description, for short, long, mixed case and absent terms. Also checks that an exact name scores
+// above a name prefix, a prefix above a description hit, and an unrelated package scores 0
+#include <bela/terminal.hpp>
+#include <bela/str_cat.hpp>
+#include <bela/numbers.hpp>
+#include <baulk/trigram.hpp>
+#include <chrono>
+#include "testing.hpp"
+
+struct package {
+  std::wstring name;
+  std::wstring description;
+};
+
+std::vector<package> synthetic_bucket(size_t count) {
+  constexpr std::wstring_view syllables[] = {L"ba", L"ul", L"k", L"zip", L"tar", L"win", L"git", L"go", L"rust",
+                                             L"py", L"node", L"vim", L"lua", L"ssl", L"curl", L"x", L"net", L"cli"};
+  constexpr std::wstring_view words[] = {
+      L"fast",    L"compression", L"tool",     L"library", L"terminal", L"editor",   L"language", L"runtime",
+      L"server",  L"client",      L"download", L"archive", L"secure",   L"portable", L"modern",   L"debugger",
+      L"package", L"manager",     L"network",  L"image",   L"viewer",   L"database", L"shell",    L"build"};
+  xorshift rng;
+  std::vector<package> packages;
+  packages.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    package p;
+    auto parts = 1 + rng() % 3;
+    for (uint32_t j = 0; j < parts; j++) {
+      p.name.append(syllables[rng() % std::size(syllables)]);
+    }
+    bela::StrAppend(&p.name, L"-", i);
+    auto n = 4 + rng() % 8;
+    for (uint32_t j = 0; j < n; j++) {
+      if (j != 0) {
+        p.description.push_back(L' ');
+      }
+      p.description.append(words[rng() % std::size(words)]);
+    }
+    packages.emplace_back(std::move(p));
+  }
+  return packages;
+}
+
+bool contains(const package &p, std::wstring_view term) {
+  return baulk::trigram::ContainsIgnoreCase(p.name, term) || baulk::trigram::ContainsIgnoreCase(p.description, term);
+}
+
+int wmain(int argc, wchar_t **argv) {
+  size_t count = 20000;
+  if (argc >= 2 && !bela::SimpleAtoi(argv[1], &count)) {
+    count = 20000;
+  }
+  auto packages = synthetic_bucket(count);
+  auto begin = std::chrono::steady_clock::now();
+  baulk::trigram::Builder builder;
+  for (size_t i = 0; i < packages.size(); i++) {
+    builder.Add(static_cast<uint32_t>(i), bela::StringCat(packages[i].name, L"\n", packages[i].description));
+  }
+  std::vector<baulk::trigram::posting_list> lists;
+  std::vector<uint32_t> docs;
+  builder.Encode(lists, docs);
+  auto built = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+  bela::FPrintF(stderr, L"%d packages, %d trigrams, %d postings, built in %.1fms\n", packages.size(), lists.size(),
+                docs.size(), built);
+
+  baulk::trigram::Postings postings(lists, docs);
+  constexpr std::wstring_view terms[] = {L"rust",   L"DEBUGGER", L"zipgit", L"compression tool", L"ssl-12",
+                                         L"viewer", L"nothing",  L"go",     L"win-1999"};
+  constexpr int rounds = 20;
+  for (auto term : terms) {
+    std::vector<uint32_t> indexed;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+      indexed.clear();
+      std::vector<uint32_t> candidates;
+      if (!postings.Candidates(term, candidates)) {
+        for (uint32_t i = 0; i < packages.size(); i++) {
+          candidates.emplace_back(i);
+        }
+      }
+      for (auto i : candidates) {
+        if (contains(packages[i], term)) {
+          indexed.emplace_back(i);
+        }
+      }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    std::vector<uint32_t> scanned;
+    for (int r = 0; r < rounds; r++) {
+      scanned.clear();
+      for (uint32_t i = 0; i < packages.size(); i++) {
+        if (contains(packages[i], term)) {
+          scanned.emplace_back(i);
+        }
+      }
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    expect(bela::StringCat(L"'", term, L"':"), indexed == scanned,
+           bela::StrFormat(L"%d hits, trigram %.3fms scan %.3fms", indexed.size(),
+                           std::chrono::duration<double, std::milli>(t1 - t0).count() / rounds,
+                           std::chrono::duration<double, std::milli>(t2 - t1).count() / rounds));
+  }
+  // the exact name outranks a prefix, a prefix outranks a description hit
+  using baulk::trigram::Score;
+  expect(L"ranking", Score(L"curl", L"", L"curl") > Score(L"curlie", L"", L"curl") &&
+                         Score(L"curlie", L"", L"curl") > Score(L"wget", L"like curl", L"curl") &&
+                         Score(L"wget", L"retriever", L"curl") == 0);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,240 @@
+// Checks that PackageUpgradable reports the same upgrades as parsing every manifest of every bucket. The buckets are
+// plain, indexed and bundled. Installed packages may come from a bucket that is no longer configured or may be absent
+// from every bucket. The scan needs a baulk tree, which vfs finds by a baulk.exe next to the executable, so the test
+// copies itself into a portable tree that holds an empty baulk.exe and runs the copy
+#include <bela/terminal.hpp>
+#include <bela/str_cat.hpp>
+#include <bela/numbers.hpp>
+#include <bela/semver.hpp>
+#include <bela/path.hpp>
+#include <bela/process.hpp>
+#include <bela/io.hpp>
+#include <baulk/vfs.hpp>
+#include <algorithm>
+#include <chrono>
+#include "baulk.hpp"
+#include "bucket.hpp"
+#include "bundled.hpp"
+#include "index.hpp"
+#include "localdb.hpp"
+#include "testing.hpp"
+
+namespace baulk {
+bool IsDebugMode = false;
+bool IsForceMode = false;
+bool IsForceDelete = false;
+bool IsQuietMode = true;
+bool IsTraceMode = false;
+std::wstring ListenAddress;
+} // namespace baulk
+
+struct synthetic_bucket {
+  std::wstring name;
+  int weights{0};
+  bool indexed{false};
+  bool bundled{false};
+  bela::flat_hash_map<std::wstring, std::string> manifests; // name: json
+};
+
+struct upgrade {
+  std::wstring name;
+  std::wstring bucket;
+  std::wstring version;
+  bool operator==(const upgrade &) const = default;
+};
+
+std::wstring random_version(xorshift &rng) { return bela::StringCat(rng() % 4, L".", rng() % 12, L".", rng() % 30); }
+
+std::vector<synthetic_bucket> synthetic_buckets(size_t packages, xorshift &rng) {
+  std::vector<synthetic_bucket> buckets{
+      {.name = L"main", .weights = 100},
+      {.name = L"extras", .weights = 90},
+      {.name = L"indexed", .weights = 80, .indexed = true},
+      {.name = L"bundled", .weights = 100, .bundled = true}, // ties with main, main comes first
+  };
+  for (auto &b : buckets) {
+    for (size_t j = 0; j < packages; j++) {
+      if (rng() % 3 == 0) {
+        continue; // not every bucket has every package
+      }
+      nlohmann::json j_{{"description", "a synthetic package of a synthetic bucket"},
+                        {"version", bela::encode_into<wchar_t, char>(random_version(rng))},
+                        {"url", "https://example.com/package.zip"},
+                        {"hash", "SHA256:0000000000000000000000000000000000000000000000000000000000000000"}};
+      b.manifests.emplace(bela::StringCat(L"package", j), j_.dump(2));
+    }
+  }
+  return buckets;
+}
+
+bool write_file(const std::filesystem::path &file, std::string_view content, bela::error_code &ec) {
+  std::error_code e;
+  if (std::filesystem::create_directories(file.parent_path(), e); e) {
+    ec = bela::make_error_code_from_std(e, L"create_directories: ");
+    return false;
+  }
+  return bela::io::WriteText(file.native(), bela::io::as_bytes<char>(content), ec);
+}
+
+// make_tree writes the profile, the bucket folders, the index and the bundle, the context is initialized in between:
+// indexes and bundles are written for configured buckets
+bool make_tree(const std::vector<synthetic_bucket> &buckets, bela::error_code &ec) {
+  if (!baulk::vfs::InitializePathFs(ec)) {
+    return false;
+  }
+  std::filesystem::path bucketsRoot(baulk::vfs::AppBuckets());
+  nlohmann::json profile;
+  nlohmann::json lockfile = nlohmann::json::array();
+  for (const auto &b : buckets) {
+    auto name = bela::encode_into<wchar_t, char>(b.name);
+    profile["bucket"].push_back({{"description", "synthetic bucket"},
+                                 {"name", name},
+                                 {"url", "https://github.com/baulk/bucket"},
+                                 {"weights", b.weights},
+                                 {"bundle", b.bundled}});
+    if (b.indexed) {
+      lockfile.push_back({{"name", name}, {"latest", "0123456789abcdef"}, {"time", "2024-01-01T00:00:00Z"}});
+    }
+    // a bundled bucket is packed from the folder of an extracted archive
+    auto folder = b.bundled ? bucketsRoot / bela::StringCat(b.name, L".staging") : bucketsRoot / b.name;
+    for (const auto &[pkgName, manifest] : b.manifests) {
+      if (!write_file(folder / L"bucket" / bela::StringCat(pkgName, L".json"), manifest, ec)) {
+        return false;
+      }
+    }
+  }
+  if (!write_file(baulk::vfs::AppDefaultProfile(), profile.dump(4), ec) ||
+      !write_file(bucketsRoot / L"buckets.lock.json", lockfile.dump(4), ec) || !baulk::InitializeContext(L"", ec)) {
+    return false;
+  }
+  for (const auto &bucket : baulk::LoadedBuckets()) {
+    if (bucket.bundled) {
+      if (!baulk::bundle::Pack(bucket, (bucketsRoot / bela::StringCat(bucket.name, L".staging")).native(), ec)) {
+        return false;
+      }
+      continue;
+    }
+    if (bela::EqualsIgnoreCase(bucket.name, L"indexed") && !baulk::index::Compile(bucket, L"0123456789abcdef", ec)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// sequential_scan parses every manifest of every bucket for every installed package, the rule of PackageNewest: a
+// newer version or the same version from a bucket of higher weights, the installed weights are those of its bucket
+std::vector<upgrade> sequential_scan(const std::vector<synthetic_bucket> &buckets,
+                                     const std::vector<std::pair<std::wstring, nlohmann::json>> &installed) {
+  std::vector<upgrade> upgrades;
+  for (const auto &[pkgName, record] : installed) {
+    bela::version version(bela::encode_into<char, wchar_t>(record["version"].get<std::string_view>()));
+    auto weights = baulk::BucketWeights(bela::encode_into<char, wchar_t>(record["bucket"].get<std::string_view>()));
+    const synthetic_bucket *newest = nullptr;
+    std::wstring newestVersion;
+    for (const auto &b : buckets) {
+      auto it = b.manifests.find(pkgName);
+      if (it == b.manifests.end()) {
+        continue;
+      }
+      auto vs = bela::encode_into<char, wchar_t>(nlohmann::json::parse(it->second)["version"].get<std::string_view>());
+      if (bela::version v(vs); v > version || (v == version && weights < b.weights)) {
+        newest = &b;
+        newestVersion = std::move(vs);
+        version = v;
+        weights = b.weights;
+      }
+    }
+    if (newest != nullptr) {
+      upgrades.emplace_back(upgrade{pkgName, newest->name, std::move(newestVersion)});
+    }
+  }
+  std::sort(upgrades.begin(), upgrades.end(), [](const upgrade &a, const upgrade &b) { return a.name < b.name; });
+  return upgrades;
+}
+
+int run_scan(size_t count) {
+  constexpr size_t bucket_packages = 2000;
+  xorshift rng;
+  auto buckets = synthetic_buckets(bucket_packages, rng);
+  bela::error_code ec;
+  if (!make_tree(buckets, ec)) {
+    expect(L"make baulk tree", false, ec.message);
+    return 1;
+  }
+  // installed from any bucket, from a bucket no longer configured or absent from every bucket
+  std::vector<std::pair<std::wstring, nlohmann::json>> installed;
+  for (size_t i = 0; i < count; i++) {
+    auto source = rng() % (buckets.size() + 1);
+    auto pkgName = bela::StringCat(rng() % 16 == 0 ? L"orphan" : L"package", rng() % bucket_packages);
+    nlohmann::json record{
+        {"version", bela::encode_into<wchar_t, char>(random_version(rng))},
+        {"bucket", source < buckets.size() ? bela::encode_into<wchar_t, char>(buckets[source].name) : "removed"}};
+    if (!baulk::localdb::Put(pkgName, record, ec)) {
+      expect(bela::StringCat(L"install ", pkgName), false, ec.message);
+      return 1;
+    }
+    installed.emplace_back(std::move(pkgName), std::move(record));
+  }
+  // the last record of a package wins
+  std::reverse(installed.begin(), installed.end());
+  std::stable_sort(installed.begin(), installed.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+  installed.erase(std::unique(installed.begin(), installed.end(),
+                              [](const auto &a, const auto &b) { return a.first == b.first; }),
+                  installed.end());
+
+  auto t0 = std::chrono::steady_clock::now();
+  auto expected = sequential_scan(buckets, installed);
+  auto t1 = std::chrono::steady_clock::now();
+  std::vector<upgrade> upgrades;
+  for (const auto &u : baulk::PackageUpgradable()) {
+    upgrades.emplace_back(upgrade{u.local.name, u.newest.bucket, u.newest.version});
+  }
+  auto t2 = std::chrono::steady_clock::now();
+  auto ok = expect(L"upgrades", upgrades == expected,
+                   bela::StrFormat(L"%d installed, %d buckets: %d upgrades, sequential %.1fms, scan %.1fms",
+                                   installed.size(), buckets.size(), expected.size(),
+                                   std::chrono::duration<double, std::milli>(t1 - t0).count(),
+                                   std::chrono::duration<double, std::milli>(t2 - t1).count()));
+  for (size_t i = 0; !ok && i < (std::max)(upgrades.size(), expected.size()); i++) {
+    if (i >= upgrades.size() || i >= expected.size() || !(upgrades[i] == expected[i])) {
+      bela::FPrintF(stderr, L"first difference at %d: %s\n", i,
+                    i < upgrades.size() ? bela::StringCat(upgrades[i].name, L" ", upgrades[i].bucket, L" ",
+                                                          upgrades[i].version)
+                                        : L"(none)");
+      break;
+    }
+  }
+  return ok ? 0 : 1;
+}
+
+int wmain(int argc, wchar_t **argv) {
+  size_t count = 300;
+  if (argc >= 2 && !bela::SimpleAtoi(argv[1], &count)) {
+    count = 300;
+  }
+  if (argc >= 3 && std::wstring_view(argv[2]) == L"--scan") {
+    return run_scan(count);
+  }
+  bela::error_code ec;
+  auto self = bela::Executable(ec);
+  if (!self) {
+    bela::FPrintF(stderr, L"executable path: %s\n", ec);
+    return 1;
+  }
+  std::error_code e;
+  auto root = std::filesystem::temp_directory_path(e) / L"baulk-upgradable-test";
+  std::filesystem::remove_all(root, e);
+  std::filesystem::create_directories(root, e);
+  auto copy = root / L"upgradable_test.exe";
+  std::filesystem::copy_file(*self, copy, e);
+  // vfs only checks that baulk.exe exists
+  if (e || !write_file(root / L"baulk.exe", "", ec) ||
+      !write_file(root / L"baulk.env", R"({"mode": "Portable"})", ec)) {
+    bela::FPrintF(stderr, L"make portable baulk: %s\n", e ? bela::encode_into<char, wchar_t>(e.message()) : ec.message);
+    return 1;
+  }
+  bela::process::Process process;
+  auto exitcode = process.Execute(copy.native(), bela::StringCat(count), L"--scan");
+  std::filesystem::remove_all(root, e);
+  return exitcode;
+}
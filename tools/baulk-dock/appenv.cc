@@ -11,6 +11,7 @@
 #include <bela/io.hpp>
 #include <baulk/vfs.hpp>
 #include <baulk/json_utils.hpp>
+#include <baulk/installed.hpp>
 #include <filesystem>
 
 namespace baulk::dock {
@@ -25,52 +26,13 @@ std::optional<std::wstring> FindWindowsTerminal() {
   return std::make_optional(std::move(wt));
 }
 
-inline constexpr bool DirSkipFaster(const wchar_t *dir) {
-  return (dir[0] == L'.' && (dir[1] == L'\0' || (dir[1] == L'.' && dir[2] == L'\0')));
-}
-
-class Finder {
-public:
-  Finder() noexcept = default;
-  Finder(const Finder &) = delete;
-  Finder &operator=(const Finder &) = delete;
-  ~Finder() noexcept {
-    if (hFind != INVALID_HANDLE_VALUE) {
-      FindClose(hFind);
-    }
-  }
-  const WIN32_FIND_DATAW &FD() const { return wfd; }
-  bool Ignore() const { return DirSkipFaster(wfd.cFileName); }
-  bool IsDir() const { return (wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0; }
-  std::wstring_view Name() const { return std::wstring_view(wfd.cFileName); }
-  bool Next() { return FindNextFileW(hFind, &wfd) == TRUE; }
-  bool First(std::wstring_view dir, std::wstring_view suffix, bela::error_code &ec) {
-    auto d = bela::StringCat(dir, L"\\", suffix);
-    hFind = FindFirstFileW(d.data(), &wfd);
-    if (hFind == INVALID_HANDLE_VALUE) {
-      ec = bela::make_system_error_code();
-      return false;
-    }
-    return true;
-  }
-
-private:
-  HANDLE hFind{INVALID_HANDLE_VALUE};
-  WIN32_FIND_DATAW wfd;
-};
-
 inline bool search_vs_instances(baulk::vs::vs_instances_t &vsInstances, bela::error_code &ec) {
   baulk::vs::Searcher s;
   return s.Initialize(ec) && s.Search(vsInstances, ec);
 }
 
-bool LookupVirtualEnvironments(std::wstring_view lockfile, std::wstring_view pkgName, EnvNode &node) {
-  bela::error_code ec;
-  auto jo = baulk::parse_json_file(lockfile, ec);
-  if (!jo) {
-    return false;
-  }
-  auto jv = jo->view();
+bool LookupVirtualEnvironments(const nlohmann::json &record, std::wstring_view pkgName, EnvNode &node) {
+  baulk::json_view jv(record);
   auto version = jv.fetch("version");
   if (auto sv = jv.subview("venv"); sv) {
     node.Value = pkgName;
@@ -88,23 +50,15 @@ bool MainWindow::InitializeBase(bela::error_code &ec) {
     return false;
   }
   search_vs_instances(vsInstances, ec);
-  Finder finder;
-  if (finder.First(vfs::AppLocks(), L"*.json", ec)) {
-    do {
-      if (finder.Ignore()) {
-        continue;
-      }
-      auto pkgname = finder.Name();
-      if (!bela::EndsWithIgnoreCase(pkgname, L".json")) {
-        continue;
-      }
-      auto lockfile = bela::StringCat(vfs::AppLocks(), L"\\", pkgname);
-      pkgname.remove_suffix(5);
-      baulk::dock::EnvNode node;
-      if (LookupVirtualEnvironments(lockfile, pkgname, node)) {
-        tables.Append(std::move(node));
-      }
-    } while (finder.Next());
+  baulk::installed::Database installed;
+  if (!installed.Load(ec)) {
+    return true;
+  }
+  for (const auto &pkgname : installed.Names()) {
+    baulk::dock::EnvNode node;
+    if (LookupVirtualEnvironments(*installed.Find(pkgname), pkgname, node)) {
+      tables.Append(std::move(node));
+    }
   }
   return true;
 }
@@ -12,16 +12,16 @@ int wmain(int argc, wchar_t **argv) {
     bela::FPrintF(stderr, L"unable detect launcher target: %s\n", ec);
     return 1;
   }
-  baulk::DbgPrint(L"resolve target: %s", *target);
-  auto isconsole = IsSubsytemConsole(*target);
+  baulk::DbgPrint(L"resolve target: %s console: %b", target->path, target->console);
+  auto isconsole = target->console;
   std::wstring newcmd(GetCommandLineW());
   STARTUPINFOW si;
   PROCESS_INFORMATION pi;
   SecureZeroMemory(&si, sizeof(si));
   SecureZeroMemory(&pi, sizeof(pi));
   si.cb = sizeof(si);
-  if (CreateProcessW(target->data(), newcmd.data(), nullptr, nullptr, FALSE, CREATE_UNICODE_ENVIRONMENT, nullptr,
-                     nullptr, &si, &pi) != TRUE) {
+  if (CreateProcessW(target->path.data(), newcmd.data(), nullptr, nullptr, FALSE, CREATE_UNICODE_ENVIRONMENT,
+                     nullptr, nullptr, &si, &pi) != TRUE) {
     auto ec = bela::make_system_error_code();
     bela::FPrintF(stderr, L"baulk-lnk, unable create lnk process: %s\n", ec);
     return -1;
@@ -12,6 +12,7 @@
 #include <filesystem>
 #include <baulk/json_utils.hpp>
 #include <baulk/debug.hpp>
+#include <baulk/linkindex.hpp>
 
 namespace fs = std::filesystem;
 
@@ -28,7 +29,28 @@ inline bool IsTrue(std::wstring_view b) {
   return bela::EqualsIgnoreCase(b, L"true") || bela::EqualsIgnoreCase(b, L"yes") || b == L"1";
 }
 
-inline std::optional<std::wstring> ResolveTarget(bela::error_code &ec) {
+struct LinkTarget {
+  std::wstring path;
+  bool console{false};
+};
+
+// ResolveTargetFromIndex looks the launcher up in the link index, worked out by baulk when it wrote the metadata
+inline std::optional<LinkTarget> ResolveTargetFromIndex(const std::filesystem::path &folder,
+                                                        const std::filesystem::path &command) {
+  bela::error_code ec;
+  baulk::linkindex::Reader index;
+  if (!index.Open(folder.native(), ec)) {
+    baulk::DbgPrint(L"resolve link index: %v, fall back to link metadata", ec);
+    return std::nullopt;
+  }
+  auto i = index.Find(command.native());
+  if (!i) {
+    return std::nullopt;
+  }
+  return std::make_optional(LinkTarget{.path = std::wstring(index.Target(*i)), .console = index.Console(*i)});
+}
+
+inline std::optional<LinkTarget> ResolveTarget(bela::error_code &ec) {
   auto arg0 = bela::Executable(ec); // do not resolve symlink !
   if (!arg0) {
     return std::nullopt;
@@ -37,6 +59,9 @@ inline std::optional<std::wstring> ResolveTarget(bela::error_code &ec) {
   std::filesystem::path fsArg0(*arg0);
   auto command = fsArg0.filename();
   baulk::DbgPrint(L"resolve launcher: %v", command);
+  if (auto target = ResolveTargetFromIndex(fsArg0.parent_path(), command); target) {
+    return target;
+  }
   auto linkMeta = fsArg0.parent_path() / L"baulk.linkmeta.json";
   baulk::DbgPrint(L"resolve link metadata: %v", linkMeta);
   auto jo = baulk::parse_json_file(linkMeta.native(), ec);
@@ -57,7 +82,9 @@ inline std::optional<std::wstring> ResolveTarget(bela::error_code &ec) {
     return std::nullopt;
   }
   auto appPackagePath = jv.fetch("app_packages_root");
-  return std::make_optional<>(bela::StringCat(appPackagePath, L"\\", tv[0], L"\\", tv[1]));
+  LinkTarget target{.path = bela::StringCat(appPackagePath, L"\\", tv[0], L"\\", tv[1])};
+  target.console = IsSubsytemConsole(target.path);
+  return std::make_optional(std::move(target));
 }
 
 #endif
\ No newline at end of file
@@ -12,16 +12,16 @@ int WINAPI wWinMain(HINSTANCE /*unused*/, HINSTANCE /*unused*/, LPWSTR /*unused*
     bela::BelaMessageBox(nullptr, L"unable detect launcher target:", ec.message.data(), nullptr, bela::mbs_t::FATAL);
     return 1;
   }
-  baulk::DbgPrint(L"resolve target: %s", *target);
-  auto isconsole = IsSubsytemConsole(*target);
+  baulk::DbgPrint(L"resolve target: %s console: %b", target->path, target->console);
+  auto isconsole = target->console;
   std::wstring newcmd(GetCommandLineW());
   STARTUPINFOW si;
   PROCESS_INFORMATION pi;
   SecureZeroMemory(&si, sizeof(si));
   SecureZeroMemory(&pi, sizeof(pi));
   si.cb = sizeof(si);
-  if (CreateProcessW(target->data(), newcmd.data(), nullptr, nullptr, FALSE, CREATE_UNICODE_ENVIRONMENT, nullptr,
-                     nullptr, &si, &pi) != TRUE) {
+  if (CreateProcessW(target->path.data(), newcmd.data(), nullptr, nullptr, FALSE, CREATE_UNICODE_ENVIRONMENT,
+                     nullptr, nullptr, &si, &pi) != TRUE) {
     auto ec = bela::make_system_error_code();
     bela::BelaMessageBox(nullptr, L"unable create process:", ec.message.data(), nullptr, bela::mbs_t::FATAL);
     return -1;
@@ -1,9 +1,11 @@
 #include <bela/path.hpp>
 #include <baulk/argv.hpp>
 #include <baulk/net.hpp>
+#include <baulk/vfs.hpp>
 #include <objbase.h>
 #include "baulk.hpp"
 #include "commands.hpp"
+#include "manifest.hpp"
 
 namespace baulk {
 bool IsDebugMode = false;
@@ -11,6 +13,7 @@ bool IsForceMode = false;
 bool IsForceDelete = false;
 bool IsQuietMode = false;
 bool IsTraceMode = false;
+std::wstring ListenAddress;
 
 int cmd_uninitialized(const baulk::commands::argv_t & /*unused*/) {
   bela::FPrintF(stderr, L"baulk uninitialized command\n");
@@ -41,6 +44,7 @@ std::optional<command_t> ParseArgv(int argc, wchar_t **argv) {
       .Add(L"insecure", cli::no_argument, 'k')
       .Add(L"https-proxy", cli::required_argument, 1001) // option
       .Add(L"force-delete", cli::no_argument, 1002)
+      .Add(L"listen", cli::required_argument, 1003)
       .Add(L"trace", cli::no_argument, 'T')
       .Add(L"bucket");
 
@@ -85,6 +89,9 @@ std::optional<command_t> ParseArgv(int argc, wchar_t **argv) {
         case 1002:
           IsForceDelete = true;
           break;
+        case 1003:
+          ListenAddress = oa;
+          break;
         default:
           return false;
         }
@@ -124,6 +131,7 @@ std::optional<command_t> ParseArgv(int argc, wchar_t **argv) {
       {L"freeze", baulk::commands::cmd_freeze, true},         // freeze
       {L"unfreeze", baulk::commands::cmd_unfreeze, true},     // unfreeze
       {L"cleancache", baulk::commands::cmd_cleancache, true}, // cleancache
+      {L"serve", baulk::commands::cmd_serve, true},           // serve download cache to peers
       {L"bucket", baulk::commands::cmd_bucket, true},         // bucket command
       {L"b3sum", baulk::commands::cmd_b3sum, false},          // b3sum
       {L"sha256sum", baulk::commands::cmd_sha256sum, false},  // sha256sum
@@ -142,6 +150,14 @@ std::optional<command_t> ParseArgv(int argc, wchar_t **argv) {
           return std::nullopt;
         }
         net::HttpClient::DefaultClient().InitializeProxyFromEnv();
+        if (!net::LoadLatencyStats(bela::StringCat(vfs::AppTemp(), L"\\latency.json"), ec)) {
+          DbgPrint(L"baulk load mirror latency stats: %s\n", ec);
+        }
+        if (!net::HttpClient::DefaultClient().EnableResponseCache(
+                bela::StringCat(vfs::AppTemp(), L"\\httpcache"), ec)) {
+          DbgPrint(L"baulk load http response cache: %s\n", ec);
+        }
+        net::HttpClient::DefaultClient().SetPeers(baulk::Peers());
       }
       return std::make_optional<command_t>(command_t{
           .argv = commands::argv_t(pa.Argv().begin() + 1, pa.Argv().end()),
@@ -171,7 +187,9 @@ public:
 int wmain(int argc, wchar_t **argv) {
   dotcom_global_initializer di;
   if (auto cmd = baulk::ParseArgv(argc, argv); cmd) {
-    return (*cmd)();
+    auto exitcode = (*cmd)();
+    baulk::manifest::Summarize();
+    return exitcode;
   }
   return 1;
 }
\ No newline at end of file
@@ -12,6 +12,7 @@ extern bool IsForceMode;
 extern bool IsForceDelete;
 extern bool IsQuietMode;
 extern bool IsTraceMode;
+extern std::wstring ListenAddress; // --listen, the address 'baulk serve' binds, loopback when empty
 
 /// defines
 [[maybe_unused]] constexpr std::wstring_view BucketsDirName = L"buckets";
@@ -66,6 +67,7 @@ struct Bucket {
   int weights{99};
   BucketObserveMode mode{BucketObserveMode::Github};
   BucketVariant variant{BucketVariant::Native};
+  bool bundled{false}; // "bundle": kept as one dictionary-compressed file, see bundled.hpp
 };
 using Buckets = std::vector<Bucket>;
 
@@ -74,6 +76,8 @@ bool InitializeContext(std::wstring_view profile, bela::error_code &ec);
 bool InitializeExecutor(bela::error_code &ec);
 std::wstring_view Profile();
 std::wstring_view LocaleName();
+// LAN peers running 'baulk serve' (profile "peers"), asked for packages before their origin
+const std::vector<std::wstring> &Peers();
 Buckets &LoadedBuckets();
 compiler::Executor &LinkExecutor();
 bool IsFrozenedPackage(std::wstring_view pkgName);
@@ -168,6 +172,7 @@ struct Package {
   std::vector<std::wstring> urls;
   std::vector<std::wstring> forceDeletes; // uninstall delete dirs
   std::vector<std::wstring> suggest;
+  std::vector<std::wstring> depends; // prerequisites, see baulk/depends.hpp
   std::vector<LinkMeta> links;
   std::vector<LinkMeta> launchers;
   PackageEnv venv;
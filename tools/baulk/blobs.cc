@@ -0,0 +1,279 @@
+//
+#include <bela/io.hpp>
+#include <bela/time.hpp>
+#include <bela/phmap.hpp>
+#include <baulk/vfs.hpp>
+#include <baulk/hash.hpp>
+#include <baulk/json_utils.hpp>
+#include <mutex>
+#include "baulk.hpp"
+#include "blobs.hpp"
+
+namespace baulk::blobs {
+namespace {
+constexpr int64_t blob_expires = 30LL * 24 * 3600; // seconds since last use, the age cleancache removes downloads at
+
+struct blob_entry {
+  int64_t size{0};
+  int64_t mtime{0};
+  int64_t used{0}; // unix seconds
+};
+
+bool blob_stat(const std::filesystem::path &file, blob_entry &entry) {
+  std::error_code e;
+  auto size = std::filesystem::file_size(file, e);
+  if (e) {
+    return false;
+  }
+  auto mtime = std::filesystem::last_write_time(file, e);
+  if (e) {
+    return false;
+  }
+  entry.size = static_cast<int64_t>(size);
+  entry.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+  return true;
+}
+
+// link_file hard links source to target, volumes without hard links get a copy
+bool link_file(const std::filesystem::path &source, const std::filesystem::path &target, bela::error_code &ec) {
+  std::error_code e;
+  if (std::filesystem::equivalent(source, target, e)) {
+    return true;
+  }
+  std::filesystem::remove(target, e);
+  if (std::filesystem::create_hard_link(source, target, e); !e) {
+    return true;
+  }
+  if (std::filesystem::copy_file(source, target, std::filesystem::copy_options::overwrite_existing, e); e) {
+    ec = e;
+    return false;
+  }
+  return true;
+}
+
+class blob_store {
+public:
+  static blob_store &Instance() {
+    static blob_store store;
+    return store;
+  }
+  std::optional<std::filesystem::path> Lookup(std::wstring_view url, std::wstring_view hash_value,
+                                              const std::filesystem::path &downloads, std::wstring_view filename) {
+    bela::error_code ec;
+    auto key = baulk::hash::HashKey(hash_value, ec);
+    if (!key) {
+      DbgPrint(L"blobs: %s", ec);
+      return std::nullopt;
+    }
+    std::scoped_lock lock(mu);
+    load();
+    auto blob = verified(*key, hash_value);
+    if (!blob) {
+      blob = alias(url, *key, hash_value);
+    }
+    if (!blob) {
+      return std::nullopt;
+    }
+    auto archive_file = downloads / filename;
+    if (!link_file(*blob, archive_file, ec)) {
+      DbgPrint(L"blobs: link %s to %s: %s", *blob, archive_file, ec);
+      return std::nullopt;
+    }
+    blobs[*key].used = bela::ToUnixSeconds(bela::Now());
+    urls.insert_or_assign(std::wstring(url), *key);
+    if (!save(ec)) {
+      DbgPrint(L"blobs: save index: %s", ec);
+    }
+    DbgPrint(L"blobs: %s hit %s", filename, *key);
+    return std::make_optional(std::move(archive_file));
+  }
+  bool Insert(std::wstring_view url, std::wstring_view hash_value, const std::filesystem::path &file,
+              bela::error_code &ec) {
+    auto key = baulk::hash::HashKey(hash_value, ec);
+    if (!key) {
+      return false;
+    }
+    std::scoped_lock lock(mu);
+    load();
+    std::error_code e;
+    if (std::filesystem::create_directories(root, e); e) {
+      ec = e;
+      return false;
+    }
+    auto blob = root / *key;
+    blob_entry entry;
+    if (auto it = blobs.find(*key); it != blobs.end() && blob_stat(blob, entry) && entry.size == it->second.size &&
+                                    entry.mtime == it->second.mtime) {
+      // the same content downloaded under another name: the download becomes a link of the blob
+      DbgPrint(L"blobs: %s already stored as %s", file.filename(), *key);
+      if (bela::error_code lec; !link_file(blob, file, lec)) {
+        DbgPrint(L"blobs: link %s to %s: %s", blob, file, lec);
+      }
+    } else if (!link_file(file, blob, ec) || !blob_stat(blob, entry)) {
+      if (!ec) {
+        ec = bela::make_error_code(bela::ErrGeneral, L"unable to stat blob ", *key);
+      }
+      return false;
+    }
+    entry.used = bela::ToUnixSeconds(bela::Now());
+    blobs.insert_or_assign(*key, entry);
+    urls.insert_or_assign(std::wstring(url), *key);
+    return save(ec);
+  }
+  size_t Sweep(bool all, bela::error_code &ec) {
+    std::scoped_lock lock(mu);
+    load();
+    auto now = bela::ToUnixSeconds(bela::Now());
+    size_t removed = 0;
+    std::error_code e;
+    for (auto it = blobs.begin(); it != blobs.end();) {
+      auto blob = root / it->first;
+      if (all || now - it->second.used > blob_expires || !std::filesystem::exists(blob, e)) {
+        std::filesystem::remove(blob, e);
+        blobs.erase(it++);
+        removed++;
+        continue;
+      }
+      ++it;
+    }
+    for (auto it = urls.begin(); it != urls.end();) {
+      if (blobs.contains(it->second)) {
+        ++it;
+        continue;
+      }
+      urls.erase(it++);
+    }
+    // files the index does not know: an interrupted insert or an index that was lost
+    for (const auto &p : std::filesystem::directory_iterator{root, e}) {
+      if (auto name = p.path().filename().native(); name != L"index.json" && !blobs.contains(name)) {
+        std::filesystem::remove_all(p.path(), e);
+        removed++;
+      }
+    }
+    save(ec);
+    return removed;
+  }
+
+private:
+  blob_store() : root(std::filesystem::path(vfs::AppTemp()) / L"blobs") {}
+  // verified returns the blob of key when it still has the size and write time recorded at insert, a blob that
+  // changed is hashed again and dropped when it no longer matches
+  std::optional<std::filesystem::path> verified(const std::wstring &key, std::wstring_view hash_value) {
+    auto it = blobs.find(key);
+    if (it == blobs.end()) {
+      return std::nullopt;
+    }
+    auto blob = root / key;
+    blob_entry entry;
+    if (!blob_stat(blob, entry)) {
+      blobs.erase(it);
+      return std::nullopt;
+    }
+    if (entry.size == it->second.size && entry.mtime == it->second.mtime) {
+      return std::make_optional(std::move(blob));
+    }
+    bela::error_code ec;
+    if (!baulk::hash::HashEqual(blob, hash_value, ec)) {
+      DbgPrint(L"blobs: %s damaged: %s", key, ec);
+      std::error_code e;
+      std::filesystem::remove(blob, e);
+      blobs.erase(it);
+      return std::nullopt;
+    }
+    it->second.size = entry.size;
+    it->second.mtime = entry.mtime;
+    return std::make_optional(std::move(blob));
+  }
+  // alias: a manifest may name the blob url delivered before by another digest method, once its content matches the
+  // blob is linked under key too
+  std::optional<std::filesystem::path> alias(std::wstring_view url, const std::wstring &key,
+                                             std::wstring_view hash_value) {
+    auto it = urls.find(std::wstring(url));
+    if (it == urls.end() || it->second == key || !blobs.contains(it->second)) {
+      return std::nullopt;
+    }
+    auto source = root / it->second;
+    bela::error_code ec;
+    if (!baulk::hash::HashEqual(source, hash_value, ec)) {
+      return std::nullopt;
+    }
+    auto blob = root / key;
+    blob_entry entry;
+    if (!link_file(source, blob, ec) || !blob_stat(blob, entry)) {
+      return std::nullopt;
+    }
+    blobs.insert_or_assign(key, entry);
+    return std::make_optional(std::move(blob));
+  }
+  void load() {
+    if (loaded) {
+      return;
+    }
+    loaded = true;
+    FILE *fd = nullptr;
+    if (auto eo = _wfopen_s(&fd, (root / L"index.json").c_str(), L"rb"); eo != 0) {
+      return;
+    }
+    auto closer = bela::finally([&] { fclose(fd); });
+    try {
+      auto j = nlohmann::json::parse(fd, nullptr, true, true);
+      for (const auto &[key, o] : j.at("blobs").items()) {
+        blobs.insert_or_assign(bela::encode_into<char, wchar_t>(key),
+                               blob_entry{.size = o.value("size", static_cast<int64_t>(0)),
+                                          .mtime = o.value("mtime", static_cast<int64_t>(0)),
+                                          .used = o.value("used", static_cast<int64_t>(0))});
+      }
+      for (const auto &[url, key] : j.at("urls").items()) {
+        urls.insert_or_assign(bela::encode_into<char, wchar_t>(url),
+                              bela::encode_into<char, wchar_t>(key.get<std::string_view>()));
+      }
+    } catch (const std::exception &e) {
+      // a damaged index is only a cache, unknown blobs are swept
+      blobs.clear();
+      urls.clear();
+      DbgPrint(L"blobs: load index: %s", bela::encode_into<char, wchar_t>(e.what()));
+    }
+  }
+  bool save(bela::error_code &ec) {
+    try {
+      nlohmann::json bj = nlohmann::json::object();
+      for (const auto &[key, b] : blobs) {
+        bj[bela::encode_into<wchar_t, char>(key)] = {{"size", b.size}, {"mtime", b.mtime}, {"used", b.used}};
+      }
+      nlohmann::json uj = nlohmann::json::object();
+      for (const auto &[url, key] : urls) {
+        uj[bela::encode_into<wchar_t, char>(url)] = bela::encode_into<wchar_t, char>(key);
+      }
+      nlohmann::json j{{"version", 1}, {"blobs", std::move(bj)}, {"urls", std::move(uj)}};
+      std::error_code e;
+      std::filesystem::create_directories(root, e);
+      if (!bela::io::AtomicWriteText((root / L"index.json").native(), bela::io::as_bytes<char>(j.dump(4)), ec)) {
+        return false;
+      }
+    } catch (const std::exception &e) {
+      ec = bela::make_error_code(bela::ErrGeneral, bela::encode_into<char, wchar_t>(e.what()));
+      return false;
+    }
+    return true;
+  }
+  std::mutex mu;
+  std::filesystem::path root;
+  bela::flat_hash_map<std::wstring, blob_entry> blobs;
+  bela::flat_hash_map<std::wstring, std::wstring> urls;
+  bool loaded{false};
+};
+} // namespace
+
+std::optional<std::filesystem::path> Lookup(std::wstring_view url, std::wstring_view hash_value,
+                                            const std::filesystem::path &downloads, std::wstring_view filename) {
+  return blob_store::Instance().Lookup(url, hash_value, downloads, filename);
+}
+
+bool Insert(std::wstring_view url, std::wstring_view hash_value, const std::filesystem::path &file,
+            bela::error_code &ec) {
+  return blob_store::Instance().Insert(url, hash_value, file, ec);
+}
+
+size_t Sweep(bool all, bela::error_code &ec) { return blob_store::Instance().Sweep(all, ec); }
+
+} // namespace baulk::blobs
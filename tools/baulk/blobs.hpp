@@ -0,0 +1,23 @@
+//
+#ifndef BAULK_BLOBS_HPP
+#define BAULK_BLOBS_HPP
+#include <bela/base.hpp>
+#include <filesystem>
+
+namespace baulk::blobs {
+// The blob store keeps each downloaded package once, named by its manifest digest ('sha256-<hex>') under
+// AppTemp()\blobs. index.json maps the digests to the size and write time seen when they were stored, so a blob is
+// only hashed again when it changed, and download urls to the digest they delivered last
+
+// Lookup finds the blob of hash_value, or the blob url delivered before when it has the same content, and hard links
+// it into downloads under filename
+std::optional<std::filesystem::path> Lookup(std::wstring_view url, std::wstring_view hash_value,
+                                            const std::filesystem::path &downloads, std::wstring_view filename);
+// Insert adds a verified download to the store, a blob with the same digest is kept instead
+bool Insert(std::wstring_view url, std::wstring_view hash_value, const std::filesystem::path &file,
+            bela::error_code &ec);
+// Sweep removes blobs unused for 30 days (all of them when all is set) and returns how many were removed
+size_t Sweep(bool all, bela::error_code &ec);
+} // namespace baulk::blobs
+
+#endif
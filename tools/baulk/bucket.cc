@@ -3,16 +3,29 @@
 #include <bela/process.hpp>
 #include <bela/str_split_narrow.hpp>
 #include <bela/semver.hpp>
+#include <bela/ascii.hpp>
+#include <bela/phmap.hpp>
 #include <baulk/json_utils.hpp>
 #include <baulk/vfs.hpp>
 #include <baulk/net.hpp>
 #include <baulk/fs.hpp>
 #include <xml.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include "baulk.hpp"
 #include "bucket.hpp"
+#include "bundled.hpp"
 #include "extractor.hpp"
+#include "index.hpp"
+#include "snapshot.hpp"
+#include "manifest.hpp"
+#include "localdb.hpp"
 
 namespace baulk {
+constexpr size_t scan_jobs = 8; // installed packages compared with the buckets at the same time
+
 // BucketNewestWithGithub github archive style bucket check latest
 std::optional<std::wstring> BucketNewestWithGithub(std::wstring_view bucketurl, bela::error_code &ec) {
   // default branch atom
@@ -73,38 +86,65 @@ std::optional<std::wstring> BucketNewest(const baulk::Bucket &bucket, bela::erro
   return BucketRepoNewest(bucket.url, ec);
 }
 
-bool BucketRepoUpdate(const baulk::Bucket &bucket, bela::error_code &ec) {
+// BucketRepoFetch fetches an existing clone, the merge waits for BucketCommit. A new bucket is cloned into staging
+bool BucketRepoFetch(const baulk::Bucket &bucket, std::wstring &staging, bela::error_code &ec) {
   auto bucketDir = bela::StringCat(baulk::vfs::AppBuckets(), L"\\", bucket.name);
   bela::process::Process process;
   if (bela::PathExists(bucketDir)) {
     process.Chdir(bucketDir);
     // Force update
-    if (process.Execute(L"git", L"pull", L"--force", bucket.url) != 0) {
+    if (process.Execute(L"git", L"fetch", L"--force", bucket.url) != 0) {
       ec = process.ErrorCode();
       return false;
     }
     return true;
   }
-  if (process.Execute(L"git", L"clone", L"--depth=1", bucket.url, bucketDir) != 0) {
+  auto bucketTemp = bela::StringCat(baulk::vfs::AppTemp(), L"\\", bucket.name);
+  if (bela::PathExists(bucketTemp)) {
+    bela::fs::ForceDeleteFolders(bucketTemp, ec);
+  }
+  if (process.Execute(L"git", L"clone", L"--depth=1", bucket.url, bucketTemp) != 0) {
     ec = process.ErrorCode();
     return false;
   }
+  staging = std::move(bucketTemp);
   return true;
 }
 
-bool BucketUpdate(const baulk::Bucket &bucket, std::wstring_view id, bela::error_code &ec) {
+bool BucketFetch(const baulk::Bucket &bucket, std::wstring_view base, std::wstring_view id, bool quiet,
+                 BucketStaging &staging, bela::error_code &ec) {
+  staging = BucketStaging{};
   if (bucket.mode == baulk::BucketObserveMode::Git) {
-    return BucketRepoUpdate(bucket, ec);
+    return BucketRepoFetch(bucket, staging.path, ec);
   }
   if (bucket.mode != baulk::BucketObserveMode::Github) {
     ec = bela::make_error_code(bela::ErrGeneral, L"Unsupported bucket mode: ", static_cast<int>(bucket.mode));
     return false;
   }
+  auto bucketTemp = bela::StringCat(baulk::vfs::AppTemp(), L"\\", bucket.name);
+  // a bundle has no files to patch, bundled buckets download the archive
+  if (!base.empty() && !bucket.bundled) {
+    auto changes = bela::StringCat(bucketTemp, L".diff");
+    bela::error_code dec;
+    if (baulk::snapshot::Fetch(bucket, base, id, changes, dec)) {
+      staging.path = std::move(changes);
+      staging.incremental = true;
+      return true;
+    }
+    baulk::DbgPrint(L"bucket %s: download the archive, changed files unavailable: %s", bucket.name, dec);
+    bela::fs::ForceDeleteFolders(changes, dec);
+  }
   // https://github.com/baulk/bucket/archive/master.zip
   auto master = bela::StringCat(bucket.url, L"/archive/", id, L".zip");
-  if (!baulk::fs::MakeDirectories(baulk::vfs::AppTemp(), ec)) {
+  // each bucket downloads into its own folder, buckets of one repository share archive names
+  auto downloads = bela::StringCat(baulk::vfs::AppTemp(), L"\\", bucket.name, L".download");
+  if (!baulk::fs::MakeDirectories(downloads, ec)) {
     return false;
   }
+  auto deleter = bela::finally([&] {
+    bela::error_code ec_;
+    bela::fs::ForceDeleteFolders(downloads, ec_);
+  });
   std::optional<std::filesystem::path> archive_file;
   bela::FPrintF(stderr, L"baulk: download \x1b[36m%s\x1b[0m metadata\nurl: \x1b[36m%s\x1b[0m\n", bucket.name, master);
   for (int i = 0; i < 4; i++) {
@@ -116,8 +156,9 @@ bool BucketUpdate(const baulk::Bucket &bucket, std::wstring_view id, bela::error
     if (archive_file = baulk::net::WinGet(master,
                                           {
                                               .hash_value = L"",
-                                              .cwd = baulk::vfs::AppTemp(),
+                                              .cwd = downloads,
                                               .force_overwrite = true,
+                                              .quiet = quiet,
                                           },
                                           ec);
         archive_file) {
@@ -127,38 +168,99 @@ bool BucketUpdate(const baulk::Bucket &bucket, std::wstring_view id, bela::error
   if (!archive_file) {
     return false;
   }
-
-  auto deleter = bela::finally([&] {
-    std::error_code e_;
-    std::filesystem::remove(*archive_file, e_);
-  });
-
-  auto bucketTemp = bela::StringCat(baulk::vfs::AppTemp(), L"\\", bucket.name);
-  if (!baulk::extract_zip(*archive_file, bucketTemp, ec)) {
+  if (bela::PathExists(bucketTemp)) {
+    bela::fs::ForceDeleteFolders(bucketTemp, ec);
+  }
+  // archive entries are under '<repo>-<id>/', exactly that level is stripped: flattening would also collapse the
+  // 'bucket' folder when it is all that is selected
+  auto manifests = std::string("*/").append(BucketManifests);
+  baulk::archive::ExtractorOptions opts{.selection = {manifests}};
+  if (!baulk::extract_zip(*archive_file, bucketTemp, opts, ec) || !baulk::fs::MakeStripped(bucketTemp, ec)) {
     bela::FPrintF(stderr, L"baulk extract bucket '%v' archive: %v\n", bucket.name, ec);
     return false;
   }
+  if (bucket.bundled) {
+    staging.path = std::move(bucketTemp);
+    return true;
+  }
+  // without a snapshot the next update downloads the archive again
+  if (auto snapshot = bela::StringCat(bucketTemp, L".snapshot.json");
+      baulk::snapshot::Build(bucketTemp, id, snapshot, ec)) {
+    staging.snapshot = std::move(snapshot);
+  } else {
+    baulk::DbgPrint(L"bucket %s: snapshot %s", bucket.name, ec);
+    ec.clear();
+  }
+  staging.path = std::move(bucketTemp);
+  return true;
+}
+
+bool BucketCommit(const baulk::Bucket &bucket, const BucketStaging &staging, bela::error_code &ec) {
+  if (!baulk::snapshot::Recover(bucket, ec)) {
+    return false;
+  }
+  if (staging.incremental) {
+    return baulk::snapshot::Apply(bucket, staging.path, ec);
+  }
   auto bucketReal = bela::StringCat(baulk::vfs::AppBuckets(), L"\\", bucket.name);
+  if (staging.path.empty()) {
+    // a fetched clone: what 'git pull' merges
+    bela::process::Process process;
+    process.Chdir(bucketReal);
+    if (process.Execute(L"git", L"merge", L"FETCH_HEAD") != 0) {
+      ec = process.ErrorCode();
+      return false;
+    }
+    return true;
+  }
   if (bela::PathExists(bucketReal)) {
     bela::fs::ForceDeleteFolders(bucketReal, ec);
   }
-  if (MoveFileW(bucketTemp.data(), bucketReal.data()) != TRUE) {
+  if (bucket.bundled && bucket.mode == baulk::BucketObserveMode::Github) {
+    baulk::snapshot::Remove(bucket);
+    return baulk::bundle::Pack(bucket, staging.path, ec);
+  }
+  if (MoveFileW(staging.path.data(), bucketReal.data()) != TRUE) {
     ec = bela::make_system_error_code(L"MoveFileW() ");
     return false;
   }
+  baulk::bundle::Remove(bucket);
+  if (bela::error_code sec; staging.snapshot.empty() || !baulk::snapshot::Install(bucket, staging.snapshot, sec)) {
+    baulk::snapshot::Remove(bucket);
+  }
   return true;
 }
 
+bool BucketPackUp(const baulk::Bucket &bucket, bela::error_code &ec) {
+  if (!bucket.bundled || bucket.mode != baulk::BucketObserveMode::Github || baulk::bundle::Lookup(bucket) != nullptr) {
+    return true;
+  }
+  auto bucketReal = bela::StringCat(baulk::vfs::AppBuckets(), L"\\", bucket.name);
+  if (!bela::PathExists(bucketReal)) {
+    return true;
+  }
+  if (!baulk::bundle::Pack(bucket, bucketReal, ec)) {
+    return false;
+  }
+  baulk::snapshot::Remove(bucket);
+  return true;
+}
+
+bool BucketUpdate(const baulk::Bucket &bucket, std::wstring_view id, bela::error_code &ec) {
+  BucketStaging staging;
+  return BucketFetch(bucket, L"", id, false, staging, ec) && BucketCommit(bucket, staging, ec);
+}
+
 // installed package meta;
 std::optional<baulk::Package> PackageLocalMeta(std::wstring_view pkgName, bela::error_code &ec) {
-  auto pkglock = bela::StringCat(baulk::vfs::AppLocks(), L"\\", pkgName, L".json");
-  auto pkj = baulk::parse_json_file(pkglock, ec);
-  if (!pkj) {
+  auto record = localdb::Find(pkgName);
+  if (!record) {
+    ec = bela::make_error_code(ENOENT, L"'", pkgName, L"' not installed");
     return std::nullopt;
   }
-  auto jv = pkj->view();
+  baulk::json_view jv(*record);
   Package pkg{
-      .name = std::wstring(pkgName),
+      .name = jv.fetch("name", pkgName),
       .version = jv.fetch("version"),
       .bucket = jv.fetch("bucket"),
       .mask = static_cast<PackageMask>(jv.fetch_as_integer("mask", bela::integral_cast(MaskNone))), // install mask
@@ -171,64 +273,181 @@ std::optional<baulk::Package> PackageLocalMeta(std::wstring_view pkgName, bela::
   return std::make_optional(std::move(pkg));
 }
 
-bool PackageUpdatableMeta(const baulk::Package &pkgLocal, baulk::Package &pkg) {
-  // initialize version from installed version
-  bela::version pkgVersion(pkgLocal.version);
-  auto weights = pkgLocal.weights;
-  bool updated{false};
+// bucket_catalog is what a lookup knows of a bucket before opening manifests
+struct bucket_catalog {
+  const Bucket *bucket{nullptr};
+  const index::BucketIndex *idx{nullptr};
+  const bundle::Reader *bundled{nullptr};  // the names of a bundled bucket are known without listing
+  bela::flat_hash_set<std::wstring> names; // lower case manifest names of an unindexed bucket
+  bool listed{false};                       // names is complete, a package not in it is not probed
+  bool Has(std::wstring_view pkgName) const {
+    if (bundled != nullptr) {
+      return bundled->Find(pkgName).has_value();
+    }
+    return !listed || names.contains(bela::AsciiStrToLower(pkgName));
+  }
+};
+
+// bucket_catalogs: listed catalogs cost one folder listing per unindexed bucket and pay off when many packages are
+// looked up, a single lookup probes the manifest instead
+std::vector<bucket_catalog> bucket_catalogs(bool listed) {
+  std::vector<bucket_catalog> catalogs;
   for (const auto &bucket : baulk::LoadedBuckets()) {
+    auto &c = catalogs.emplace_back(
+        bucket_catalog{.bucket = &bucket, .idx = index::Lookup(bucket), .bundled = bundle::Lookup(bucket)});
+    if (c.idx != nullptr || c.bundled != nullptr || !listed) {
+      continue;
+    }
+    bela::fs::Finder finder;
     bela::error_code ec;
-    auto pkgN = PackageMeta(bucket, pkgLocal.name, ec);
-    if (!pkgN) {
-      if (ec && ec.code != ENOENT) {
-        bela::FPrintF(stderr, L"baulk: parse package meta error: %s\n", ec);
+    c.listed = true;
+    if (!finder.First(bela::StringCat(vfs::AppBuckets(), L"\\", bucket.name, L"\\bucket"), L"*.json", ec)) {
+      continue;
+    }
+    do {
+      if (finder.Ignore() || finder.IsDir()) {
+        continue;
       }
+      auto pkgName = finder.Name();
+      pkgName.remove_suffix(5);
+      c.names.emplace(bela::AsciiStrToLower(pkgName));
+    } while (finder.Next());
+  }
+  return catalogs;
+}
+
+// PackageNewest finds the bucket with a version of pkgName newer than pkgVersion, the weights break version ties.
+// Indexed buckets are compared without parsing their manifests, only the manifest of the newest package is loaded
+std::optional<baulk::Package> PackageNewest(std::wstring_view pkgName, const std::vector<bucket_catalog> &catalogs,
+                                            bela::version &pkgVersion, int &weights, size_t &matched,
+                                            bela::error_code &ec) {
+  const Bucket *newest = nullptr;
+  std::optional<baulk::Package> pkg;
+  for (const auto &c : catalogs) {
+    const auto &bucket = *c.bucket;
+    std::optional<baulk::Package> pkgN;
+    std::wstring version;
+    if (c.idx != nullptr) {
+      auto e = c.idx->Find(pkgName);
+      if (!e) {
+        continue;
+      }
+      version = e->version;
+      if (!e->Ported()) {
+        version.clear();
+      }
+    } else if (!c.Has(pkgName)) {
       continue;
     }
-    pkgN->bucket = bucket.name;
-    pkgN->weights = bucket.weights;
-    bela::version newVersion(pkgN->version);
+    if (version.empty()) {
+      bela::error_code pec;
+      if (pkgN = PackageMeta(bucket, pkgName, pec); !pkgN) {
+        if (pec && pec.code != ENOENT) {
+          bela::FPrintF(stderr, L"baulk: parse package meta error: %s\n", pec);
+        }
+        continue;
+      }
+      version = pkgN->version;
+    }
+    matched++;
+    bela::version newVersion(version);
     // compare version newVersion is > oldversion
     // newVersion == oldversion and strversion not equail compare weights
-    if (newVersion > pkgVersion || (newVersion == pkgVersion && weights < pkgN->weights)) {
-      pkg = std::move(*pkgN);
+    if (newVersion > pkgVersion || (newVersion == pkgVersion && weights < bucket.weights)) {
+      newest = &bucket;
+      pkg = std::move(pkgN);
       pkgVersion = newVersion;
-      weights = pkgN->weights;
-      updated = true;
+      weights = bucket.weights;
     }
   }
-  return updated;
+  if (newest == nullptr) {
+    return std::nullopt;
+  }
+  if (!pkg) {
+    if (pkg = PackageMeta(*newest, pkgName, ec); !pkg) {
+      return std::nullopt;
+    }
+  }
+  pkg->bucket = newest->name;
+  pkg->weights = newest->weights;
+  return pkg;
 }
+
+bool PackageUpdatableMeta(const baulk::Package &pkgLocal, const std::vector<bucket_catalog> &catalogs,
+                          baulk::Package &pkg) {
+  // initialize version from installed version
+  bela::version pkgVersion(pkgLocal.version);
+  auto weights = pkgLocal.weights;
+  size_t matched = 0;
+  bela::error_code ec;
+  auto pkgN = PackageNewest(pkgLocal.name, catalogs, pkgVersion, weights, matched, ec);
+  if (!pkgN) {
+    if (ec) {
+      bela::FPrintF(stderr, L"baulk: parse package meta error: %s\n", ec);
+    }
+    return false;
+  }
+  pkg = std::move(*pkgN);
+  return true;
+}
+
+bool PackageUpdatableMeta(const baulk::Package &pkgLocal, baulk::Package &pkg) {
+  return PackageUpdatableMeta(pkgLocal, bucket_catalogs(false), pkg);
+}
+
+std::vector<PackageUpgrade> PackageUpgradable() {
+  auto begin = std::chrono::steady_clock::now();
+  auto pkgNames = localdb::Names();
+  auto catalogs = bucket_catalogs(true);
+  std::vector<std::optional<PackageUpgrade>> results(pkgNames.size());
+  std::atomic_size_t next{0};
+  std::vector<std::thread> workers;
+  auto jobs = (std::min)({scan_jobs, static_cast<size_t>((std::max)(std::thread::hardware_concurrency(), 1u)),
+                          pkgNames.size()});
+  for (size_t i = 0; i < jobs; i++) {
+    workers.emplace_back([&] {
+      for (size_t index = next++; index < pkgNames.size(); index = next++) {
+        bela::error_code lec;
+        auto pkgLocal = PackageLocalMeta(pkgNames[index], lec);
+        if (!pkgLocal) {
+          continue;
+        }
+        baulk::Package pkg;
+        if (PackageUpdatableMeta(*pkgLocal, catalogs, pkg)) {
+          results[index] = PackageUpgrade{.local = std::move(*pkgLocal), .newest = std::move(pkg)};
+        }
+      }
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  std::vector<PackageUpgrade> upgrades;
+  for (auto &r : results) {
+    if (r) {
+      upgrades.emplace_back(std::move(*r));
+    }
+  }
+  std::sort(upgrades.begin(), upgrades.end(), [](const PackageUpgrade &a, const PackageUpgrade &b) {
+    return bela::AsciiStrToLower(a.local.name) < bela::AsciiStrToLower(b.local.name);
+  });
+  DbgPrint(L"scan %d installed packages in %d buckets with %d workers: %.1fms", pkgNames.size(), catalogs.size(), jobs,
+           std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+  return upgrades;
+}
+
 // package metadata
 std::optional<baulk::Package> PackageMetaEx(std::wstring_view pkgName, bela::error_code &ec) {
   ec.clear();
   bela::version pkgVersion; // 0.0.0.0
-  baulk::Package pkg;
+  int weights = 0;
   size_t pkgSame = 0;
-  for (const auto &bucket : baulk::LoadedBuckets()) {
-    auto pkgN = PackageMeta(bucket, pkgName, ec);
-    if (!pkgN) {
-      if (ec && ec.code != ENOENT) {
-        bela::FPrintF(stderr, L"baulk: parse package meta error: %s\n", ec);
-      }
-      continue;
-    }
-    pkgSame++;
-    pkgN->bucket = bucket.name;
-    pkgN->weights = bucket.weights;
-    bela::version newVersion(pkgN->version);
-    // compare version newVersion is > oldversion
-    // newVersion == oldversion and strversion not equail compare weights
-    if (newVersion > pkgVersion || (newVersion == pkgVersion && pkg.weights < pkgN->weights)) {
-      pkg = std::move(*pkgN);
-      pkgVersion = newVersion;
-    }
-  }
-  if (pkgSame == 0) {
+  auto pkg = PackageNewest(pkgName, bucket_catalogs(false), pkgVersion, weights, pkgSame, ec);
+  if (pkgSame == 0 || (!pkg && !ec)) {
     ec = bela::make_error_code(ErrPackageNotYetPorted, L"'", pkgName, L"' not yet ported.");
     return std::nullopt;
   }
-  return std::make_optional(std::move(pkg));
+  return pkg;
 }
 
 bool PackageIsUpdatable(std::wstring_view pkgName, baulk::Package &pkg) {
@@ -4,6 +4,7 @@
 #include <string>
 #include <optional>
 #include <functional>
+#include <vector>
 #include <bela/base.hpp>
 #include "baulk.hpp"
 
@@ -12,8 +13,30 @@ constexpr long ErrPackageNotYetPorted = bela::ErrUnimplemented + 1000;
 
 std::optional<std::wstring> BucketNewest(const baulk::Bucket &bucket, bela::error_code &ec);
 bool BucketUpdate(const baulk::Bucket &bucket, std::wstring_view id, bela::error_code &ec);
+// BucketManifests is all a github bucket keeps of its archive, manifests are the only files baulk reads
+constexpr std::string_view BucketManifests = "bucket/*.json";
+// BucketStaging is a fetched bucket waiting for BucketCommit
+struct BucketStaging {
+  std::wstring path;       // extracted archive, new clone or changed files; empty for a fetched clone
+  std::wstring snapshot;   // snapshot of the extracted archive
+  bool incremental{false}; // path holds only the files changed since base
+};
+// BucketFetch brings bucket from base to id without touching AppBuckets(): github buckets download the files changed
+// since base when the snapshot allows it, otherwise the archive is downloaded and extracted into staging. git clones
+// are fetched (new buckets cloned into staging). Buckets fetch concurrently, BucketCommit then moves them into place
+// one at a time
+bool BucketFetch(const baulk::Bucket &bucket, std::wstring_view base, std::wstring_view id, bool quiet,
+                 BucketStaging &staging, bela::error_code &ec);
+bool BucketCommit(const baulk::Bucket &bucket, const BucketStaging &staging, bela::error_code &ec);
+// BucketPackUp bundles a bucket configured with "bundle" that is still a folder, BucketCommit bundles updated ones
+bool BucketPackUp(const baulk::Bucket &bucket, bela::error_code &ec);
 // PackageMeta from file
 std::optional<baulk::Package> PackageMeta(const Bucket &bucket, std::wstring_view pkgName, bela::error_code &ec);
+class lazy_json_view;
+// PackageResolveArchitecture resolves the urls and hash of a parsed manifest for arch ("64bit", "arm64" or "32bit")
+// the way PackageMeta does on a host of that architecture
+void PackageResolveArchitecture(const Bucket &bucket, const baulk::lazy_json_view &jv,
+                                std::string_view arch, Package &pkg);
 
 using OnPattern = std::function<bool(std::wstring_view pkgName)>;
 using OnMatched = std::function<bool(const Bucket &bucket, std::wstring_view pkgName)>;
@@ -26,6 +49,14 @@ std::optional<baulk::Package> PackageMetaEx(std::wstring_view pkgName, bela::err
 std::optional<baulk::Package> PackageLocalMeta(std::wstring_view pkgName, bela::error_code &ec);
 bool PackageUpdatableMeta(const baulk::Package &pkgLocal, baulk::Package &pkg);
 
+struct PackageUpgrade {
+  baulk::Package local;
+  baulk::Package newest;
+};
+// PackageUpgradable compares every installed package with the buckets on a pool of workers, each bucket is listed or
+// its index opened once for the whole scan. The upgrades are sorted by package name
+std::vector<PackageUpgrade> PackageUpgradable();
+
 bool PackageIsUpdatable(std::wstring_view pkgName, baulk::Package &pkg);
 } // namespace baulk
 
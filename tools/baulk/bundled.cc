@@ -0,0 +1,91 @@
+//
+#include <bela/io.hpp>
+#include <bela/path.hpp>
+#include <bela/fs.hpp>
+#include <bela/phmap.hpp>
+#include <baulk/vfs.hpp>
+#include <mutex>
+#include "bundled.hpp"
+
+namespace baulk::bundle {
+namespace {
+// bundle_cache keeps the bundles this process mapped, buckets without a bundle are remembered as nullptr
+class bundle_cache {
+public:
+  static bundle_cache &Instance() {
+    static bundle_cache cache;
+    return cache;
+  }
+  const Reader *Lookup(const Bucket &bucket) {
+    std::scoped_lock lock(mu);
+    if (auto it = bundles.find(bucket.name); it != bundles.end()) {
+      return it->second.get();
+    }
+    auto &b = bundles[bucket.name];
+    auto file = Path(bucket);
+    if (!bela::PathExists(file)) {
+      return nullptr;
+    }
+    auto r = std::make_unique<Reader>();
+    if (bela::error_code ec; !r->Open(file, ec)) {
+      DbgPrint(L"bucket %s bundle: %s", bucket.name, ec);
+      return nullptr;
+    }
+    b = std::move(r);
+    return b.get();
+  }
+  // Release closes the bundle of bucket so its file can be replaced
+  void Release(const Bucket &bucket) {
+    std::scoped_lock lock(mu);
+    bundles.erase(bucket.name);
+  }
+
+private:
+  std::mutex mu;
+  bela::flat_hash_map<std::wstring, std::unique_ptr<Reader>> bundles;
+};
+} // namespace
+
+std::wstring Path(const Bucket &bucket) { return bela::StringCat(vfs::AppBuckets(), L"\\", bucket.name, L".bundle"); }
+
+const Reader *Lookup(const Bucket &bucket) { return bundle_cache::Instance().Lookup(bucket); }
+
+bool Pack(const Bucket &bucket, std::wstring_view folder, bela::error_code &ec) {
+  auto manifestsFolder = bela::StringCat(folder, L"\\bucket");
+  std::vector<Manifest> manifests;
+  bela::fs::Finder finder;
+  // a bucket without manifests is an empty bundle
+  if (finder.First(manifestsFolder, L"*.json", ec)) {
+    do {
+      if (finder.Ignore() || finder.IsDir()) {
+        continue;
+      }
+      auto pkgName = finder.Name();
+      pkgName.remove_suffix(5);
+      auto &m = manifests.emplace_back(Manifest{.name = std::wstring(pkgName)});
+      if (!bela::io::ReadFile(bela::StringCat(manifestsFolder, L"\\", finder.Name()), m.content, ec)) {
+        return false;
+      }
+    } while (finder.Next());
+  } else if (ec.code != ERROR_FILE_NOT_FOUND && ec.code != ERROR_PATH_NOT_FOUND) {
+    return false;
+  }
+  ec.clear();
+  bundle_cache::Instance().Release(bucket);
+  if (!Write(manifests, Path(bucket), ec)) {
+    return false;
+  }
+  DbgPrint(L"bucket %s bundle: %d manifests", bucket.name, manifests.size());
+  if (bela::error_code dec; !bela::fs::ForceDeleteFolders(folder, dec)) {
+    DbgPrint(L"bucket %s bundle: remove %s: %s", bucket.name, folder, dec);
+  }
+  return true;
+}
+
+void Remove(const Bucket &bucket) {
+  bundle_cache::Instance().Release(bucket);
+  auto file = Path(bucket);
+  DeleteFileW(file.data());
+}
+
+} // namespace baulk::bundle
@@ -0,0 +1,25 @@
+//
+#ifndef BAULK_BUNDLED_HPP
+#define BAULK_BUNDLED_HPP
+#include <bela/base.hpp>
+#include <baulk/bundle.hpp>
+#include "baulk.hpp"
+
+namespace baulk::bundle {
+// A github bucket configured with "bundle": true is kept as AppBuckets()\<bucket>.bundle instead of a folder of
+// manifests: one file to list, map and scan instead of thousands. 'baulk update' packs the extracted archive into
+// the bundle and removes the folder, bundled buckets always download the full archive. git buckets stay folders,
+// git needs its clone. A bucket with a bundle is read from it whatever its configuration says
+
+// Path of the bundle of bucket
+std::wstring Path(const Bucket &bucket);
+// Lookup returns the bundle of bucket, nullptr when the bucket is a folder
+const Reader *Lookup(const Bucket &bucket);
+// Pack bundles the manifests under folder\bucket and removes folder, bundles of this process mapping the old file are
+// closed first
+bool Pack(const Bucket &bucket, std::wstring_view folder, bela::error_code &ec);
+// Remove deletes the bundle of a bucket
+void Remove(const Bucket &bucket);
+} // namespace baulk::bundle
+
+#endif
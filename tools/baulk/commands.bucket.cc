@@ -9,6 +9,9 @@
 #include <baulk/json_utils.hpp>
 #include <baulk/vfs.hpp>
 #include "baulk.hpp"
+#include "bundled.hpp"
+#include "index.hpp"
+#include "snapshot.hpp"
 #include "commands.hpp"
 
 namespace baulk::commands {
@@ -20,13 +23,15 @@ inline void displayBucket(const Bucket &bk) {
                 L"url:         \x1b[36m%v\x1b[0m\n"    //
                 L"variant:     \x1b[36m%v\x1b[0m\n"    //
                 L"mode:        \x1b[36m%v\x1b[0m\n"    //
-                L"weights:     \x1b[36m%v\x1b[0m\n",   //
+                L"weights:     \x1b[36m%v\x1b[0m\n"    //
+                L"bundled:     \x1b[36m%b\x1b[0m\n",   //
                 bk.name,                               //
                 bk.description,                        //
                 bk.url,                                //
                 baulk::BucketVariantName(bk.variant),  //
                 baulk::BucketObserveModeName(bk.mode), //
-                bk.weights);
+                bk.weights,                            //
+                bk.bundled);
 }
 
 // Bucket Modifier
@@ -90,6 +95,9 @@ bool BucketModifier::GetBucket(std::wstring_view bucketName, baulk::Bucket &buck
           bucket.mode = BucketObserveMode::Git;
         }
       }
+      if (auto it = b.find("bundle"); it != b.end()) {
+        bucket.bundled = it.value().get<bool>();
+      }
       return true;
     }
   } catch (const std::exception &e) {
@@ -130,6 +138,9 @@ int BucketModifier::List(std::wstring_view bucketName) {
         variant = static_cast<BucketVariant>(it.value().get<int>());
       }
       Bucket bucket(desc, name, url, weights, mode, variant);
+      if (auto it = b.find("bundle"); it != b.end()) {
+        bucket.bundled = it.value().get<bool>();
+      }
       displayBucket(bucket);
     }
   } catch (const std::exception &e) {
@@ -202,6 +213,9 @@ int BucketModifier::Add(const baulk::Bucket &bucket, bool replace) {
     jbk["mode"] = static_cast<int>(nbk.mode);
     jbk["weights"] = nbk.weights;
     jbk["variant"] = nbk.variant;
+    if (nbk.bundled) {
+      jbk["bundle"] = true;
+    }
     buckets.emplace_back(std::move(jbk));
     meta["bucket"] = buckets;
     if (!Apply()) {
@@ -254,6 +268,9 @@ bool PruneBucket(const baulk::Bucket &bucket) {
   }
   auto buckets = bela::StringCat(vfs::AppBuckets(), L"\\", bucket.name);
   bela::fs::ForceDeleteFolders(buckets, ec);
+  baulk::index::Remove(bucket);
+  baulk::snapshot::Remove(bucket);
+  baulk::bundle::Remove(bucket);
   return true;
 }
 
@@ -303,6 +320,7 @@ Add, delete or list buckets.
   -M|--mode           set bucket mode (Git/Github)
   -A|--variant        set bucket variant (native/scoop)
   -D|--description    set bucket description
+  -B|--bundle         keep the bucket as one compressed file (Github mode only)
   -R|--replace        replace bucket with new attributes ('bucket add' support only)
 
 Option:
@@ -323,6 +341,7 @@ Example:
   baulk bucket add baulk git@github.com:baulk/bucket.git
   baulk bucket add baulk-mirror https://gitee.com/baulk/bucket.git -MGit -W102
   baulk bucket add scoop git@github.com:ScoopInstaller/Main.git -MGit -Ascoop
+  baulk bucket add scoop-main https://github.com/ScoopInstaller/Main -Ascoop --bundle
 
 )");
 }
@@ -345,6 +364,7 @@ int cmd_bucket(const argv_t &argv) {
       .Add(L"mode", baulk::cli::required_argument, L'M')
       .Add(L"variant", baulk::cli::required_argument, L'A')
       .Add(L"description", baulk::cli::required_argument, L'D')
+      .Add(L"bundle", baulk::cli::no_argument, L'B')
       .Add(L"replace", baulk::cli::no_argument, L'R')
       .Add(L"force", baulk::cli::no_argument, L'F');
   baulk::Bucket bucket;
@@ -402,6 +422,9 @@ int cmd_bucket(const argv_t &argv) {
         case L'D':
           bucket.description = oa;
           break;
+        case L'B':
+          bucket.bundled = true;
+          break;
         case L'R':
           replace = true;
           break;
@@ -4,6 +4,7 @@
 #include <baulk/vfs.hpp>
 #include "baulk.hpp"
 #include "commands.hpp"
+#include "blobs.hpp"
 
 namespace baulk::commands {
 
@@ -57,9 +58,15 @@ int cmd_cleancache(const argv_t & /*unused*/) {
   ULARGE_INTEGER ul;
   ul.LowPart = fnow.dwLowDateTime;
   ul.HighPart = fnow.dwHighDateTime;
+  // the blob store ages by last use rather than by creation time
+  auto removed = blobs::Sweep(baulk::IsForceMode, ec);
+  DbgPrint(L"blobs: %d removed", removed);
   std::error_code e;
   for (const auto &p : std::filesystem::directory_iterator{vfs::AppTemp(), e}) {
     auto path_ = p.path();
+    if (path_.filename() == L"blobs") {
+      continue;
+    }
     if (baulk::IsForceMode || p.is_directory()) {
       bela::fs::ForceDeleteFolders(path_.native(), ec);
       continue;
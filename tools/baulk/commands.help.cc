@@ -21,6 +21,7 @@ Usage: baulk [option] <command> [<args>]
   -T|--trace       Turn on trace mode. track baulk execution details.
   --https-proxy    Use this proxy. Equivalent to setting the environment variable 'HTTPS_PROXY'
   --force-delete   When uninstalling the package, forcefully delete the related directories
+  --listen         Address 'baulk serve' listens on. default: 127.0.0.1
 
 Command:
   version          Show version number and quit
@@ -36,6 +37,7 @@ Command:
   b3sum            Calculate the BLAKE3 checksum of a file
   sha256sum        Calculate the SHA256 checksum of a file
   cleancache       Cleanup download cache
+  serve            Serve the download cache to LAN peers
   bucket           Add, delete or list buckets
   untar            Extract files in a tar archive. support: tar.xz tar.bz2 tar.gz tar.zstd
   unzip            Extract compressed files in a ZIP archive
@@ -91,6 +93,7 @@ int cmd_help(const baulk::commands::argv_t &argv) {
       {L"b3sum", baulk::commands::usage_b3sum},           // b3sum
       {L"sha256sum", baulk::commands::usage_sha256sum},   // sha256sum
       {L"cleancache", baulk::commands::usage_cleancache}, // cleancache
+      {L"serve", baulk::commands::usage_serve},           // serve
       {L"bucket", baulk::commands::usage_bucket},         // bucket command
       {L"untar", baulk::commands::usage_untar},           // untar
       {L"unzip", baulk::commands::usage_unzip},           // unzip
@@ -1,11 +1,17 @@
 //
 #include <bela/terminal.hpp>
+#include <bela/ascii.hpp>
+#include <bela/match.hpp>
 #include <baulk/vfs.hpp>
 #include <baulk/fsmutex.hpp>
+#include <baulk/depends.hpp>
+#include <baulk/json_utils.hpp>
 #include "pkg.hpp"
 #include "commands.hpp"
 #include "baulk.hpp"
 #include "bucket.hpp"
+#include "launcher.hpp"
+#include "localdb.hpp"
 
 namespace baulk::commands {
 // https://docs.microsoft.com/en-us/cpp/preprocessor/predefined-macros
@@ -28,10 +34,13 @@ public:
   PackageInstaller() = default;
   PackageInstaller(const PackageInstaller &) = delete;
   PackageInstaller &operator=(const PackageInstaller &) = delete;
-  bool Install(std::wstring_view pkgname);
+  std::optional<depends::candidate> Lookup(const depends::requirement &r, bela::error_code &ec);
+  const baulk::Package &Get(std::wstring_view name) const { return packages.at(bela::AsciiStrToLower(name)); }
 
 private:
+  std::optional<baulk::Package> Resolve(const depends::requirement &r, bela::error_code &ec);
   void Update(std::wstring_view name);
+  bela::flat_hash_map<std::wstring, baulk::Package> packages; // lower case name: resolved package
   bool updated{false};
 };
 
@@ -46,34 +55,65 @@ void PackageInstaller::Update(std::wstring_view name) {
   updated = true;
 }
 
-bool PackageInstaller::Install(std::wstring_view name) {
-  bela::error_code ec;
-  auto pkg = baulk::PackageMetaEx(name, ec);
+std::optional<baulk::Package> PackageInstaller::Resolve(const depends::requirement &r, bela::error_code &ec) {
+  if (r.bucket.empty()) {
+    return baulk::PackageMetaEx(r.name, ec);
+  }
+  for (const auto &bucket : LoadedBuckets()) {
+    if (!bela::EqualsIgnoreCase(bucket.name, r.bucket)) {
+      continue;
+    }
+    auto pkg = baulk::PackageMeta(bucket, r.name, ec);
+    if (!pkg) {
+      ec = bela::make_error_code(ErrPackageNotYetPorted, L"'", r.name, L"' not yet ported to ", r.bucket);
+      return std::nullopt;
+    }
+    pkg->weights = bucket.weights;
+    return pkg;
+  }
+  ec = bela::make_error_code(bela::ErrGeneral, L"bucket '", r.bucket, L"' not found");
+  return std::nullopt;
+}
+
+std::optional<depends::candidate> PackageInstaller::Lookup(const depends::requirement &r, bela::error_code &ec) {
+  auto pkg = Resolve(r, ec);
   if (!pkg) {
     if (ec.code != baulk::ErrPackageNotYetPorted) {
-      bela::FPrintF(stderr, L"\x1b[31mbaulk: %s\x1b[0m\n", ec);
-      return false;
+      return std::nullopt;
     }
-    Update(name);
-    if (pkg = baulk::PackageMetaEx(name, ec); !pkg) {
-      bela::FPrintF(stderr, L"\x1b[31mbaulk: %s\x1b[0m\n", ec);
-      return false;
+    Update(r.name);
+    if (pkg = Resolve(r, ec); !pkg) {
+      return std::nullopt;
     }
   }
   if (pkg->urls.empty()) {
-    bela::FPrintF(stderr, L"baulk: '%s' not support \x1b[31m%s\x1b[0m\n", name, architecture());
-    return false;
+    ec = bela::make_error_code(bela::ErrGeneral, L"'", r.name, L"' not support ", architecture());
+    return std::nullopt;
   }
-  return baulk::package::PackageInstall(*pkg);
+  depends::candidate c{.name = pkg->name, .bucket = pkg->bucket, .version = pkg->version, .depends = pkg->depends};
+  packages.insert_or_assign(bela::AsciiStrToLower(pkg->name), std::move(*pkg));
+  return std::make_optional(std::move(c));
+}
+
+std::optional<std::wstring> InstalledVersion(std::wstring_view name) {
+  auto record = baulk::localdb::Find(name);
+  if (!record) {
+    return std::nullopt;
+  }
+  return std::make_optional(baulk::json_view(*record).fetch("version"));
 }
 
 void usage_install() {
   bela::FPrintF(stderr, LR"(Usage: baulk install [package]...
 Install specific packages. upgrade if already installed. (alias: i)
+Prerequisites listed in 'depends' of a manifest are installed first.
+Tar packages (tar, tar.gz, tar.bz2, tar.xz, tar.zst) are extracted while they download, zip, 7z, exe and msi
+packages once the download is complete.
 
 Example:
   baulk install wget
   baulk i wget
+  baulk install "python>=3.10.0"
 
 )");
 }
@@ -89,12 +129,50 @@ int cmd_install(const argv_t &argv) {
     bela::FPrintF(stderr, L"baulk install: \x1b[31mbaulk %s\x1b[0m\n", ec);
     return 1;
   }
+  LinkBatch links;
   if (!InitializeExecutor(ec)) {
     DbgPrint(L"baulk install: unable initialize compiler executor: %s", ec);
   }
   PackageInstaller installer;
-  for (auto pkg : argv) {
-    installer.Install(pkg);
+  depends::Resolver resolver(
+      [&](const depends::requirement &r, bela::error_code &ec_) { return installer.Lookup(r, ec_); },
+      InstalledVersion);
+  for (auto name : argv) {
+    if (!resolver.Add(name, ec)) {
+      bela::FPrintF(stderr, L"\x1b[31mbaulk: %s\x1b[0m\n", ec);
+    }
+  }
+  auto waves = resolver.Resolve(ec);
+  if (!waves) {
+    bela::FPrintF(stderr, L"\x1b[31mbaulk: %s\x1b[0m\n", ec);
+    return 1;
+  }
+  // a wave is installed once the packages it depends on are, a package whose prerequisite failed is skipped
+  bela::flat_hash_set<std::wstring> failed;
+  for (size_t i = 0; i < waves->size(); i++) {
+    std::vector<baulk::Package> pkgs;
+    for (const auto &c : (*waves)[i]) {
+      const auto &pkg = installer.Get(c.name);
+      auto blocked = std::find_if(pkg.depends.begin(), pkg.depends.end(), [&](const std::wstring &spec) {
+        depends::requirement r;
+        bela::error_code lec;
+        return depends::ParseRequirement(spec, r, lec) && failed.contains(bela::AsciiStrToLower(r.name));
+      });
+      if (blocked != pkg.depends.end()) {
+        bela::FPrintF(stderr, L"\x1b[31mbaulk: skip '%s', prerequisite '%s' not installed\x1b[0m\n", pkg.name,
+                      *blocked);
+        failed.emplace(bela::AsciiStrToLower(pkg.name));
+        continue;
+      }
+      pkgs.emplace_back(pkg);
+    }
+    DbgPrint(L"baulk install wave %d: %d packages", i, pkgs.size());
+    baulk::package::PackageInstall(pkgs);
+    for (const auto &pkg : pkgs) {
+      if (auto version = InstalledVersion(pkg.name); !version || *version != pkg.version) {
+        failed.emplace(bela::AsciiStrToLower(pkg.name));
+      }
+    }
   }
   return 0;
 }
@@ -4,43 +4,32 @@
 #include <baulk/fsmutex.hpp>
 #include "baulk.hpp"
 #include "bucket.hpp"
+#include "localdb.hpp"
 #include "commands.hpp"
 
 namespace baulk::commands {
 
 // check upgradable
 int cmd_list_all() {
-  bela::fs::Finder finder;
   bela::error_code ec;
   size_t upgradable = 0;
-  if (finder.First(vfs::AppLocks(), L"*.json", ec)) {
-    do {
-      if (finder.Ignore()) {
-        continue;
-      }
-      auto pkgName = finder.Name();
-      if (!bela::EndsWithIgnoreCase(pkgName, L".json")) {
-        continue;
-      }
-      pkgName.remove_suffix(5);
-      auto localMeta = baulk::PackageLocalMeta(pkgName, ec);
-      if (!localMeta) {
-        continue;
-      }
-      baulk::Package pkg;
-      if (baulk::PackageUpdatableMeta(*localMeta, pkg)) {
-        upgradable++;
-        bela::FPrintF(stderr,
-                      L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m %s --> "
-                      L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m%s%s\n",
-                      localMeta->name, localMeta->bucket, localMeta->version, pkg.version, pkg.bucket,
-                      baulk::IsFrozenedPackage(pkgName) ? L" \x1b[33m(frozen)\x1b[0m" : L"",
-                      StringCategory(*localMeta));
-        continue;
-      }
-      bela::FPrintF(stderr, L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m %s%s\n", localMeta->name, localMeta->bucket,
-                    localMeta->version, StringCategory(*localMeta));
-    } while (finder.Next());
+  for (const auto &pkgName : baulk::localdb::Names()) {
+    auto localMeta = baulk::PackageLocalMeta(pkgName, ec);
+    if (!localMeta) {
+      continue;
+    }
+    baulk::Package pkg;
+    if (baulk::PackageUpdatableMeta(*localMeta, pkg)) {
+      upgradable++;
+      bela::FPrintF(stderr,
+                    L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m %s --> "
+                    L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m%s%s\n",
+                    localMeta->name, localMeta->bucket, localMeta->version, pkg.version, pkg.bucket,
+                    baulk::IsFrozenedPackage(pkgName) ? L" \x1b[33m(frozen)\x1b[0m" : L"", StringCategory(*localMeta));
+      continue;
+    }
+    bela::FPrintF(stderr, L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m %s%s\n", localMeta->name, localMeta->bucket,
+                  localMeta->version, StringCategory(*localMeta));
   }
   bela::FPrintF(stderr, L"\x1b[32m%d packages can be updated.\x1b[0m\n", upgradable);
   return 0;
@@ -1,26 +1,58 @@
 #include <bela/fnmatch.hpp>
 #include <bela/ascii.hpp>
+#include <bela/match.hpp>
+#include <bela/phmap.hpp>
 #include <baulk/fs.hpp>
 #include <baulk/vfs.hpp>
 #include <baulk/fsmutex.hpp>
+#include <baulk/trigram.hpp>
+#include <algorithm>
 #include "baulk.hpp"
 #include "bucket.hpp"
+#include "index.hpp"
 #include "commands.hpp"
 
 namespace baulk::commands {
 
 void usage_search() {
   bela::FPrintF(stderr, LR"(Usage: baulk search [package]...
-Search in package descriptions.
+Search in package names and descriptions.
+Words match anywhere in names and descriptions, best matches first. Patterns
+with wildcards match package names.
 
 Example:
   baulk search wget
+  baulk search compress
   baulk search win*
   baulk search *
 
 )");
 }
 
+// displayIndexed prints a package the way cmd_search does without loading its manifest
+bool displayIndexed(const Bucket &bucket, const index::Entry &e) {
+  if (baulk::IsDebugMode) {
+    bela::FPrintF(stderr, L"\x1b[33m* %v urls:\x1b[0m\n  \x1b[33m%v\x1b[0m\n", e.name,
+                  bela::StrJoin(e.URLs(), L"\x1b[0m\n  \x1b[33m"));
+  }
+  std::wstring category;
+  if (!e.category.empty()) {
+    category = bela::StringCat(L" \x1b[36m[", e.category, L"]\x1b[0m");
+  }
+  bela::error_code ec;
+  auto pkgLocal = baulk::PackageLocalMeta(e.name, ec);
+  if (pkgLocal && bela::EndsWithIgnoreCase(pkgLocal->bucket, bucket.name)) {
+    bela::FPrintF(stderr,
+                  L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m %s [installed "
+                  L"\x1b[33m%s\x1b[0m]%s\n  %s\n",
+                  e.name, bucket.name, e.version, pkgLocal->version, category, e.description);
+    return true;
+  }
+  bela::FPrintF(stderr, L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m %s%s\n  %s\n", e.name, bucket.name, e.version, category,
+                e.description);
+  return true;
+}
+
 int cmd_search(const argv_t &argv) {
   if (argv.empty()) {
     usage_search();
@@ -28,10 +60,16 @@ int cmd_search(const argv_t &argv) {
   }
 
   std::vector<std::wstring> pattern;
+  std::vector<std::wstring> terms;
   for (const auto a : argv) {
-    pattern.emplace_back(bela::AsciiStrToLower(a));
+    auto p = bela::AsciiStrToLower(a);
+    if (p.find_first_of(L"*?[") != std::wstring::npos) {
+      pattern.emplace_back(std::move(p));
+      continue;
+    }
+    terms.emplace_back(std::move(p));
   }
-  auto isMatched = [&](std::wstring_view pkgName) -> bool {
+  auto isPatternMatched = [&](std::wstring_view pkgName) -> bool {
     for (const auto &a : pattern) {
       if (bela::FnMatch(a, pkgName)) {
         return true;
@@ -39,10 +77,70 @@ int cmd_search(const argv_t &argv) {
     }
     return false;
   };
+  auto isMatched = [&](std::wstring_view pkgName) -> bool {
+    for (const auto &t : terms) {
+      if (bela::EqualsIgnoreCase(t, pkgName)) {
+        return true;
+      }
+    }
+    return isPatternMatched(pkgName);
+  };
+  // words are ranked over the trigram indexes of the buckets, buckets without an index still match names below
+  bela::flat_hash_set<std::wstring> displayed;
+  auto displayKey = [](const Bucket &bucket, std::wstring_view pkgName) {
+    return bela::AsciiStrToLower(bela::StringCat(bucket.name, L"/", pkgName));
+  };
+  if (!terms.empty()) {
+    struct search_hit {
+      const Bucket *bucket;
+      index::Entry entry;
+      int score;
+    };
+    std::vector<search_hit> hits;
+    for (const auto &bucket : LoadedBuckets()) {
+      const auto *idx = index::Lookup(bucket);
+      if (idx == nullptr) {
+        continue;
+      }
+      bela::flat_hash_map<size_t, int> scores;
+      for (const auto &t : terms) {
+        for (auto i : idx->Search(t)) {
+          auto e = idx->At(i);
+          scores[i] += trigram::Score(e.name, e.description, t);
+        }
+      }
+      for (const auto &[i, score] : scores) {
+        if (auto e = idx->At(i); e.Ported()) {
+          hits.emplace_back(search_hit{.bucket = &bucket, .entry = e, .score = score});
+        }
+      }
+    }
+    std::sort(hits.begin(), hits.end(), [](const search_hit &a, const search_hit &b) {
+      if (a.score != b.score) {
+        return a.score > b.score;
+      }
+      if (a.bucket->weights != b.bucket->weights) {
+        return a.bucket->weights > b.bucket->weights;
+      }
+      return a.entry.name < b.entry.name;
+    });
+    for (const auto &h : hits) {
+      displayed.emplace(displayKey(*h.bucket, h.entry.name));
+      displayIndexed(*h.bucket, h.entry);
+    }
+  }
   // lldb/kali-rolling 1:9.0-49.1 amd64
   //   Next generation, high-performance debugger
-  auto onMatched = [](const Bucket &bucket, std::wstring_view pkgName) -> bool {
+  auto onMatched = [&](const Bucket &bucket, std::wstring_view pkgName) -> bool {
     bela::error_code ec;
+    if (const auto *idx = index::Lookup(bucket); idx != nullptr) {
+      if (!isPatternMatched(pkgName) || displayed.contains(displayKey(bucket, pkgName))) {
+        return false;
+      }
+      if (auto e = idx->Find(pkgName); e && e->Ported()) {
+        return displayIndexed(bucket, *e);
+      }
+    }
     auto pkg = baulk::PackageMeta(bucket, pkgName, ec);
     if (!pkg) {
       bela::FPrintF(stderr, L"baulk search: parse package meta error: \x1b[31m%s\x1b[0m\n", ec);
@@ -0,0 +1,49 @@
+// serve command: share the download cache with LAN peers
+#include <bela/terminal.hpp>
+#include <bela/numbers.hpp>
+#include <baulk/vfs.hpp>
+#include <baulk/net/peer.hpp>
+#include "baulk.hpp"
+#include "commands.hpp"
+
+namespace baulk::commands {
+constexpr int default_peer_port = 8484;
+
+void usage_serve() {
+  bela::FPrintF(stderr, LR"(Usage: baulk serve [port]
+Serve the download cache to other baulk installations on the LAN (default port %d)
+Only this machine can connect unless --listen sets an address other hosts reach, such as 0.0.0.0.
+Clients list this machine in the "peers" array of their baulk.json, e.g. "http://192.168.1.10:%d".
+
+Example:
+  baulk serve
+  baulk serve --listen 0.0.0.0 9000
+
+)",
+                default_peer_port, default_peer_port);
+}
+
+int cmd_serve(const argv_t &argv) {
+  // the blob store is private to this machine until the user asks for a LAN address
+  std::wstring_view address = ListenAddress.empty() ? std::wstring_view{L"127.0.0.1"} : ListenAddress;
+  int port = default_peer_port;
+  if (!argv.empty() && (!bela::SimpleAtoi(argv[0], &port) || port <= 0 || port > 65535)) {
+    bela::FPrintF(stderr, L"baulk serve: invalid port '\x1b[31m%s\x1b[0m'\n", argv[0]);
+    return 1;
+  }
+  bela::error_code ec;
+  auto l = baulk::net::Listen(address, port, ec);
+  if (!l) {
+    bela::FPrintF(stderr, L"baulk serve: listen %s:%d error: \x1b[31m%s\x1b[0m\n", address, port, ec);
+    return 1;
+  }
+  std::filesystem::path blobs(vfs::AppTemp());
+  blobs /= L"blobs";
+  bela::FPrintF(stderr, L"baulk serve \x1b[36m%s\x1b[0m on \x1b[32mhttp://%s:%d/blobs/\x1b[0m\n", blobs, address,
+                l->Port());
+  baulk::net::PeerServer server(blobs);
+  server.Serve(*l);
+  return 0;
+}
+
+} // namespace baulk::commands
@@ -6,13 +6,13 @@
 #include "baulk.hpp"
 #include "pkg.hpp"
 #include "launcher.hpp"
+#include "localdb.hpp"
 #include "commands.hpp"
 
 namespace baulk::commands {
 int uninstall_package(std::wstring_view pkgName) {
-  auto metaLock = bela::StringCat(vfs::AppLocks(), L"\\", pkgName, L".json");
   bela::error_code ec;
-  if (!bela::PathExists(metaLock) && !baulk::IsForceMode) {
+  if (!baulk::localdb::Contains(pkgName) && !baulk::IsForceMode) {
     bela::FPrintF(stderr, L"No local metadata found, \x1b[34m%s\x1b[0m may not be installed.\n", pkgName);
     return 1;
   }
@@ -24,7 +24,10 @@ int uninstall_package(std::wstring_view pkgName) {
   if (!baulk::RemovePackageLinks(pkgName, ec)) {
     bela::FPrintF(stderr, L"baulk uninstall '%s' links: \x1b[31m%s\x1b[0m\n", pkgName, ec);
   }
-  bela::fs::ForceDeleteFolders(metaLock, ec);
+  if (!baulk::localdb::Remove(pkgName, ec)) {
+    bela::FPrintF(stderr, L"baulk uninstall '%s' record: \x1b[31m%s\x1b[0m\n", pkgName, ec);
+    return 1;
+  }
   auto packageRoot = vfs::AppPackageFolder(pkgName);
   if (!bela::fs::ForceDeleteFolders(packageRoot, ec)) {
     bela::FPrintF(stderr, L"baulk uninstall '%s' error: \x1b[31m%s\x1b[0m\n", pkgName, ec);
@@ -56,6 +59,7 @@ int cmd_uninstall(const argv_t &argv) {
     bela::FPrintF(stderr, L"baulk uninstall: \x1b[31mbaulk %s\x1b[0m\n", ec);
     return 1;
   }
+  LinkBatch links;
   for (auto a : argv) {
     uninstall_package(a);
   }
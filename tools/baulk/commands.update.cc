@@ -9,7 +9,10 @@
 #include <baulk/net.hpp>
 #include <baulk/fs.hpp>
 #include <baulk/json_utils.hpp>
+#include <atomic>
+#include <thread>
 #include "bucket.hpp"
+#include "index.hpp"
 
 #include "commands.hpp"
 
@@ -19,6 +22,18 @@ struct bucket_metadata {
   std::string updated;
 };
 
+constexpr size_t update_jobs = 4; // buckets checked and downloaded at the same time
+
+// bucket_fetch is what the concurrent phase of 'baulk update' leaves for the commit phase
+struct bucket_fetch {
+  const baulk::Bucket *bucket{nullptr};
+  std::optional<std::wstring> latest;
+  baulk::BucketStaging staging;
+  bela::error_code ec;
+  bool changed{false};
+  bool fetched{false};
+};
+
 class BucketUpdater {
 public:
   using bucket_status_t =
@@ -29,9 +44,13 @@ public:
   BucketUpdater &operator=(const BucketUpdater &) = delete;
   bool Initialize();
   bool Immobilized();
-  bool Update(const baulk::Bucket &bucket);
+  // Fetch checks the newest commit of a bucket and downloads it, buckets are fetched concurrently
+  void Fetch(bucket_fetch &f, bool quiet) const;
+  // Commit moves a fetched bucket into place and records it, it runs on one thread in configuration order
+  bool Commit(bucket_fetch &f);
 
 private:
+  void Compile(const baulk::Bucket &bucket, std::wstring_view latest);
   bucket_status_t status;
   std::wstring lockfile;
   bool updated{false};
@@ -88,60 +107,66 @@ bool BucketUpdater::Immobilized() {
   return true;
 }
 
-bool BucketUpdater::Update(const baulk::Bucket &bucket) {
-  bela::error_code ec;
-  auto latest = baulk::BucketNewest(bucket, ec);
-  if (!latest) {
-    bela::FPrintF(stderr, L"baulk update \x1b[34m%s\x1b[0m error: \x1b[31m%s\x1b[0m\n", bucket.name, ec);
-    return false;
+void BucketUpdater::Fetch(bucket_fetch &f, bool quiet) const {
+  const auto &bucket = *f.bucket;
+  if (f.latest = baulk::BucketNewest(bucket, f.ec); !f.latest) {
+    return;
   }
   auto it = status.find(bucket.name);
-  if (it != status.end() && bela::EqualsIgnoreCase(it->second.latest, *latest)) {
-    baulk::DbgPrint(L"bucket: %s is up to date. id: %s", bucket.name, *latest);
+  if (it != status.end() && bela::EqualsIgnoreCase(it->second.latest, *f.latest)) {
+    return;
+  }
+  f.changed = true;
+  std::wstring_view base = it != status.end() ? std::wstring_view(it->second.latest) : std::wstring_view();
+  f.fetched = baulk::BucketFetch(bucket, base, *f.latest, quiet, f.staging, f.ec);
+}
+
+bool BucketUpdater::Commit(bucket_fetch &f) {
+  const auto &bucket = *f.bucket;
+  if (!f.latest) {
+    bela::FPrintF(stderr, L"baulk update \x1b[34m%s\x1b[0m error: \x1b[31m%s\x1b[0m\n", bucket.name, f.ec);
+    return false;
+  }
+  if (!f.changed) {
+    baulk::DbgPrint(L"bucket: %s is up to date. id: %s", bucket.name, *f.latest);
+    if (bela::error_code ec; !baulk::BucketPackUp(bucket, ec)) {
+      bela::FPrintF(stderr, L"baulk update: bundle \x1b[34m%s\x1b[0m error: \x1b[31m%s\x1b[0m\n", bucket.name, ec);
+    }
+    if (!baulk::index::IsFresh(bucket, *f.latest)) {
+      Compile(bucket, *f.latest);
+    }
     return true;
   }
-  baulk::DbgPrint(L"bucket: %s latest id: %s", bucket.name, *latest);
-  if (!baulk::BucketUpdate(bucket, *latest, ec)) {
-    bela::FPrintF(stderr, L"bucke download \x1b[34m%s\x1b[0m error: \x1b[31m%s\x1b[0m\n", bucket.name, ec);
+  baulk::DbgPrint(L"bucket: %s latest id: %s", bucket.name, *f.latest);
+  if (!f.fetched || !baulk::BucketCommit(bucket, f.staging, f.ec)) {
+    bela::FPrintF(stderr, L"bucke download \x1b[34m%s\x1b[0m error: \x1b[31m%s\x1b[0m\n", bucket.name, f.ec);
     return false;
   }
-  bela::FPrintF(stderr, L"\x1b[32m'%s' is up to date: %s\x1b[0m\n", bucket.name, *latest);
-  status[bucket.name] = bucket_metadata{*latest, bela::FormatTime<char>(bela::Now())};
+  bela::FPrintF(stderr, L"\x1b[32m'%s' is up to date: %s\x1b[0m\n", bucket.name, *f.latest);
+  status[bucket.name] = bucket_metadata{*f.latest, bela::FormatTime<char>(bela::Now())};
   updated = true;
+  Compile(bucket, *f.latest);
   return true;
 }
 
-bool PackageScanUpdatable() {
-  bela::fs::Finder finder;
+// Compile failures only cost speed: lookups probe the manifests of a bucket without a current index
+void BucketUpdater::Compile(const baulk::Bucket &bucket, std::wstring_view latest) {
   bela::error_code ec;
-  size_t upgradable = 0;
-  if (finder.First(vfs::AppLocks(), L"*.json", ec)) {
-    do {
-      if (finder.Ignore()) {
-        continue;
-      }
-      auto pkgName = finder.Name();
-      if (!bela::EndsWithIgnoreCase(pkgName, L".json")) {
-        continue;
-      }
-      pkgName.remove_suffix(5);
-      auto localMeta = baulk::PackageLocalMeta(pkgName, ec);
-      if (!localMeta) {
-        continue;
-      }
-      baulk::Package pkg;
-      if (baulk::PackageUpdatableMeta(*localMeta, pkg)) {
-        upgradable++;
-        bela::FPrintF(stderr,
-                      L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m %s --> "
-                      L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m%s%s\n",
-                      localMeta->name, localMeta->bucket, localMeta->version, pkg.version, pkg.bucket,
-                      IsFrozenedPackage(pkgName) ? L" \x1b[33m(frozen)\x1b[0m" : L"", StringCategory(pkg));
-        continue;
-      }
-    } while (finder.Next());
+  if (!baulk::index::Compile(bucket, latest, ec)) {
+    bela::FPrintF(stderr, L"baulk update: index \x1b[34m%s\x1b[0m error: \x1b[31m%s\x1b[0m\n", bucket.name, ec);
   }
-  bela::FPrintF(stderr, L"\x1b[32m%d packages can be updated.\x1b[0m\n", upgradable);
+}
+
+bool PackageScanUpdatable() {
+  auto upgrades = baulk::PackageUpgradable();
+  for (const auto &u : upgrades) {
+    bela::FPrintF(stderr,
+                  L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m %s --> "
+                  L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m%s%s\n",
+                  u.local.name, u.local.bucket, u.local.version, u.newest.version, u.newest.bucket,
+                  IsFrozenedPackage(u.local.name) ? L" \x1b[33m(frozen)\x1b[0m" : L"", StringCategory(u.newest));
+  }
+  bela::FPrintF(stderr, L"\x1b[32m%d packages can be updated.\x1b[0m\n", upgrades.size());
   return true;
 }
 
@@ -157,9 +182,30 @@ int UpdateBucket(bool showUpdatable) {
   if (!updater.Initialize()) {
     return 1;
   }
-  for (const auto &bucket : baulk::LoadedBuckets()) {
-    updater.Update(bucket);
+  const auto &buckets = baulk::LoadedBuckets();
+  std::vector<bucket_fetch> fetches(buckets.size());
+  for (size_t i = 0; i < buckets.size(); i++) {
+    fetches[i].bucket = &buckets[i];
+  }
+  // checks and downloads overlap, the buckets are moved into place and recorded in configuration order
+  auto quiet = fetches.size() > 1;
+  std::atomic_size_t next{0};
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < (std::min)(update_jobs, fetches.size()); i++) {
+    workers.emplace_back([&] {
+      for (size_t index = next++; index < fetches.size(); index = next++) {
+        updater.Fetch(fetches[index], quiet);
+      }
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  for (auto &f : fetches) {
+    updater.Commit(f);
   }
+  auto stats = baulk::net::HttpClient::DefaultClient().CacheStats();
+  baulk::DbgPrint(L"bucket feeds not modified: %d fetched: %d", stats.hits, stats.misses);
   if (!updater.Immobilized()) {
     return 1;
   }
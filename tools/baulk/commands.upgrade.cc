@@ -9,6 +9,7 @@
 #include "baulk.hpp"
 #include "bucket.hpp"
 #include "pkg.hpp"
+#include "launcher.hpp"
 
 namespace baulk::commands {
 void usage_upgrade() {
@@ -41,32 +42,16 @@ int cmd_upgrade(const argv_t &argv) {
     bela::FPrintF(stderr, L"baulk upgrade: \x1b[31mbaulk %s\x1b[0m\n", ec);
     return 1;
   }
+  LinkBatch links;
   if (!InitializeExecutor(ec)) {
     baulk::DbgPrint(L"baulk upgrade: unable initialize compiler executor: %s", ec);
   }
 
-  bela::fs::Finder finder;
-  if (finder.First(vfs::AppLocks(), L"*.json", ec)) {
-    do {
-      if (finder.Ignore()) {
-        continue;
-      }
-      auto pkgName = finder.Name();
-      if (!bela::EndsWithIgnoreCase(pkgName, L".json")) {
-        continue;
-      }
-      pkgName.remove_suffix(5);
-      auto localMeta = baulk::PackageLocalMeta(pkgName, ec);
-      if (!localMeta) {
-        continue;
-      }
-      baulk::Package pkg;
-      if (baulk::PackageUpdatableMeta(*localMeta, pkg)) {
-        baulk::package::PackageInstall(pkg);
-        continue;
-      }
-    } while (finder.Next());
+  std::vector<baulk::Package> pkgs;
+  for (auto &u : baulk::PackageUpgradable()) {
+    pkgs.emplace_back(std::move(u.newest));
   }
+  baulk::package::PackageInstall(pkgs);
   return 0;
 }
 int cmd_update_and_upgrade(const argv_t &argv) {
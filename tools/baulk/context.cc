@@ -43,6 +43,7 @@ public:
   }
   std::wstring_view LocaleName() const { return localeName; }
   std::wstring_view Profile() const { return profile; }
+  const std::vector<std::wstring> &Peers() const { return peers; }
   auto &LoadedBuckets() { return buckets; }
   auto &LinkExecutor() { return executor; }
 
@@ -53,6 +54,7 @@ private:
   std::wstring profile;
   Buckets buckets;
   std::vector<std::wstring> pkgs;
+  std::vector<std::wstring> peers; // LAN peers running 'baulk serve'
   compiler::Executor executor;
 };
 
@@ -91,12 +93,14 @@ bool Context::initializeInternal(const std::wstring &profile_, bela::error_code
         sv.fetch("description"), sv.fetch("name"), sv.fetch("url"), sv.fetch_as_integer("weights", 100),
         static_cast<BucketObserveMode>(sv.fetch_as_integer("mode", static_cast<int>(BucketObserveMode::Github))),
         static_cast<BucketVariant>(sv.fetch_as_integer("variant", static_cast<int>(BucketVariant::Native))));
+    buckets.back().bundled = sv.fetch_as_boolean("bundle", false);
     if (IsDebugMode) {
       auto bk = buckets.back();
       DbgPrint(L"Add bucket '%s': %s", bk.name, bk.description);
       DbgPrint(L"    url:      %s", bk.url);
       DbgPrint(L"    mode:     %s", BucketObserveModeName(bk.mode));
       DbgPrint(L"    variant:  %s", BucketVariantName(bk.variant));
+      DbgPrint(L"    bundled:  %b", bk.bundled);
     }
   }
   if (jv.fetch_strings_checked("freeze", pkgs) && !pkgs.empty() && IsDebugMode) {
@@ -104,6 +108,11 @@ bool Context::initializeInternal(const std::wstring &profile_, bela::error_code
       DbgPrint(L"Freeze package %s", p);
     }
   }
+  if (jv.fetch_strings_checked("peers", peers) && !peers.empty() && IsDebugMode) {
+    for (const auto &p : peers) {
+      DbgPrint(L"Peer %s", p);
+    }
+  }
   return true;
 }
 
@@ -144,6 +153,7 @@ bool InitializeContext(std::wstring_view profile, bela::error_code &ec) {
 bool InitializeExecutor(bela::error_code &ec) { return Context::Instance().InitializeExecutor(ec); }
 std::wstring_view LocaleName() { return Context::Instance().LocaleName(); }
 std::wstring_view Profile() { return Context::Instance().Profile(); }
+const std::vector<std::wstring> &Peers() { return Context::Instance().Peers(); }
 Buckets &LoadedBuckets() { return Context::Instance().LoadedBuckets(); }
 compiler::Executor &LinkExecutor() { return Context::Instance().LinkExecutor(); }
 bool IsFrozenedPackage(std::wstring_view pkgName) { return Context::Instance().IsFrozenedPackage(pkgName); }
@@ -15,6 +15,9 @@
 #include <baulk/indicators.hpp>
 #include <baulk/debug.hpp>
 #include "baulk.hpp"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 
 namespace baulk {
 
@@ -82,6 +85,10 @@ bool ZipExtractor::Extract(bela::error_code &ec) {
   if (!baulk::IsDebugMode && !baulk::IsQuietMode) {
     bela::FPrintF(stderr, L"\n");
   }
+  if (extractor.Skipped() != 0) {
+    baulk::DbgPrint(L"%v: %d entries extracted, %d skipped", archive_file.filename(), extractor.Extracted(),
+                    extractor.Skipped());
+  }
   return true;
 }
 
@@ -405,6 +412,12 @@ bool extract_msi(const std::filesystem::path &archive_file, const std::filesyste
 
 bool extract_zip(const std::filesystem::path &archive_file, const std::filesystem::path &destination,
                  bela::error_code &ec) {
+  return extract_zip(archive_file, destination, baulk::archive::ExtractorOptions{}, ec) &&
+         baulk::fs::MakeFlattened(destination, ec);
+}
+
+bool extract_zip(const std::filesystem::path &archive_file, const std::filesystem::path &destination,
+                 const ExtractorOptions &opts, bela::error_code &ec) {
   baulk::archive::file_format_t afmt{};
   int64_t baseOffset = 0;
   auto fd = archive::OpenFile(archive_file.native(), baseOffset, afmt, ec);
@@ -417,14 +430,11 @@ bool extract_zip(const std::filesystem::path &archive_file, const std::filesyste
                   baulk::archive::FormatToMIME(afmt));
     return false;
   }
-  ZipExtractor extractor(std::move(*fd), archive_file, destination, baulk::archive::ExtractorOptions{});
+  ZipExtractor extractor(std::move(*fd), archive_file, destination, opts);
   if (!extractor.Initialize(bela::SizeUnInitialized, baseOffset, ec)) {
     return false;
   }
-  if (!extractor.Extract(ec)) {
-    return false;
-  }
-  return baulk::fs::MakeFlattened(destination, ec);
+  return extractor.Extract(ec);
 }
 
 bool extract_7z(const std::filesystem::path &archive_file, const std::filesystem::path &destination,
@@ -488,6 +498,190 @@ bool extract_command_auto(const std::filesystem::path &archive_file, const std::
   return baulk::fs::MakeFlattened(destination, ec);
 }
 
+constexpr size_t stream_head_size = 1024;            // enough to tell the archive format
+constexpr size_t stream_pipe_capacity = 8 * 1024 * 1024; // bytes buffered before the download waits for extraction
+
+// stream_pipe hands downloaded bytes to the extraction thread
+class stream_pipe final : public baulk::archive::tar::ExtractReader {
+public:
+  // Push returns false once the reader gave up
+  bool Push(const void *data, size_t len) {
+    std::unique_lock lock(mu);
+    cv.wait(lock, [&] { return buffered < stream_pipe_capacity || canceled; });
+    if (canceled) {
+      return false;
+    }
+    chunks.emplace_back(static_cast<const char *>(data), len);
+    buffered += len;
+    cv.notify_all();
+    return true;
+  }
+  // Close ends the stream, the reader sees an error instead of the end when the download did not complete
+  void Close(bool completed) {
+    std::scoped_lock lock(mu);
+    closed = true;
+    truncated = !completed;
+    cv.notify_all();
+  }
+  // Cancel stops the writer, called by the reader
+  void Cancel() {
+    std::scoped_lock lock(mu);
+    canceled = true;
+    chunks.clear();
+    buffered = 0;
+    cv.notify_all();
+  }
+  ssize_t Read(void *buffer, size_t len, bela::error_code &ec) override {
+    std::unique_lock lock(mu);
+    cv.wait(lock, [&] { return !chunks.empty() || closed; });
+    if (chunks.empty()) {
+      if (truncated) {
+        ec = bela::make_error_code(bela::ErrGeneral, L"download interrupted");
+        return -1;
+      }
+      return 0;
+    }
+    auto &chunk = chunks.front();
+    auto n = (std::min)(len, chunk.size() - pos);
+    memcpy(buffer, chunk.data() + pos, n);
+    pos += n;
+    buffered -= n;
+    if (pos == chunk.size()) {
+      chunks.pop_front();
+      pos = 0;
+    }
+    cv.notify_all();
+    return static_cast<ssize_t>(n);
+  }
+  bool Discard(int64_t len, bela::error_code &ec) override {
+    char buffer[8192];
+    while (len > 0) {
+      auto n = Read(buffer, static_cast<size_t>((std::min)(len, static_cast<int64_t>(sizeof(buffer)))), ec);
+      if (n <= 0) {
+        if (n == 0) {
+          ec = bela::make_error_code(bela::ErrEnded, L"End of file");
+        }
+        return false;
+      }
+      len -= n;
+    }
+    return true;
+  }
+  bool WriteTo(const baulk::archive::tar::Writer &w, int64_t filesize, int64_t &extracted,
+               bela::error_code &ec) override {
+    char buffer[8192];
+    while (filesize > 0) {
+      auto n = Read(buffer, static_cast<size_t>((std::min)(filesize, static_cast<int64_t>(sizeof(buffer)))), ec);
+      if (n <= 0) {
+        if (n == 0) {
+          ec = bela::make_error_code(bela::ErrEnded, L"End of file");
+        }
+        return false;
+      }
+      filesize -= n;
+      extracted += n;
+      if (!w(buffer, static_cast<size_t>(n), ec)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+private:
+  std::mutex mu;
+  std::condition_variable cv;
+  std::deque<std::string> chunks;
+  size_t pos{0};
+  size_t buffered{0};
+  bool closed{false};
+  bool truncated{false};
+  bool canceled{false};
+};
+
+StreamExtractor::~StreamExtractor() {
+  if (worker.joinable()) {
+    pipe->Close(false);
+    worker.join();
+  }
+}
+
+void StreamExtractor::start() {
+  auto afmt = baulk::archive::AnalyzeFormat(bela::bytes_view(head.data(), head.size()));
+  switch (afmt) {
+  case baulk::archive::file_format_t::tar:
+  case baulk::archive::file_format_t::gz:
+  case baulk::archive::file_format_t::bz2:
+  case baulk::archive::file_format_t::xz:
+  case baulk::archive::file_format_t::zstd:
+    break;
+  default:
+    // zip is not streamed: only its central directory, at the end of the file, lists the entries and their names, and
+    // local headers may defer sizes to a data descriptor. 7z needs random access too, exe and msi the whole file
+    declined = true;
+    return;
+  }
+  DbgPrint(L"streaming extraction to %v", destination);
+  pipe = std::make_shared<stream_pipe>();
+  worker = std::thread([this, afmt] {
+    std::shared_ptr<baulk::archive::tar::ExtractReader> decompressor;
+    baulk::archive::tar::ExtractReader *reader = pipe.get();
+    if (afmt != baulk::archive::file_format_t::tar) {
+      if (decompressor = baulk::archive::tar::MakeReader(pipe.get(), afmt, extractEc); !decompressor) {
+        pipe->Cancel();
+        return;
+      }
+      reader = decompressor.get();
+    }
+    baulk::archive::tar::Extractor extractor(reader, ExtractorOptions{});
+    if (!extractor.InitializeExtractor(destination, extractEc) || !extractor.Extract(nullptr, nullptr, extractEc)) {
+      // a compressed single file (ErrAnotherWay) or a damaged archive, the downloaded file is extracted instead
+      pipe->Cancel();
+      return;
+    }
+    extracted = true;
+    // the end-of-archive blocks have been read, trailing padding is not needed
+    pipe->Cancel();
+  });
+  if (!pipe->Push(head.data(), head.size())) {
+    declined = true;
+  }
+  head.clear();
+}
+
+void StreamExtractor::Write(const void *data, size_t len) {
+  if (declined) {
+    return;
+  }
+  if (!pipe) {
+    head.append(static_cast<const char *>(data), len);
+    if (head.size() >= stream_head_size) {
+      start();
+    }
+    return;
+  }
+  if (!pipe->Push(data, len)) {
+    declined = true;
+  }
+}
+
+bool StreamExtractor::Finish(bela::error_code &ec) {
+  if (!pipe && !declined) {
+    // archives smaller than the head
+    start();
+  }
+  if (!pipe) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"not a streamable archive");
+    return false;
+  }
+  pipe->Close(true);
+  worker.join();
+  if (!extracted) {
+    ec = extractEc ? extractEc : bela::make_error_code(bela::ErrGeneral, L"streaming extraction incomplete");
+    return false;
+  }
+  return baulk::fs::MakeFlattened(destination, ec);
+}
+
 std::optional<std::filesystem::path> make_unqiue_extracted_destination(const std::filesystem::path &archive_file,
                                                                        std::filesystem::path &strict_folder) {
   std::error_code e;
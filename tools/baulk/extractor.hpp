@@ -6,6 +6,7 @@
 #include <bela/io.hpp>
 #include <bela/terminal.hpp>
 #include <filesystem>
+#include <thread>
 #include <baulk/archive/extractor.hpp>
 
 namespace baulk {
@@ -25,6 +26,10 @@ bool extract_msi(const std::filesystem::path &archive_file, const std::filesyste
                  bela::error_code &ec);
 bool extract_zip(const std::filesystem::path &archive_file, const std::filesystem::path &destination,
                  bela::error_code &ec);
+// extract_zip with options: entries outside opts.selection are not decompressed, the entries keep their archive
+// layout (no flattening)
+bool extract_zip(const std::filesystem::path &archive_file, const std::filesystem::path &destination,
+                 const ExtractorOptions &opts, bela::error_code &ec);
 bool extract_7z(const std::filesystem::path &archive_file, const std::filesystem::path &destination,
                 bela::error_code &ec);
 bool extract_tar(const std::filesystem::path &archive_file, const std::filesystem::path &destination,
@@ -38,6 +43,30 @@ bool extract_command_auto(const std::filesystem::path &archive_file, const std::
 std::optional<std::filesystem::path> make_unqiue_extracted_destination(const std::filesystem::path &archive_file,
                                                                        std::filesystem::path &strict_folder);
 
+class stream_pipe;
+// StreamExtractor extracts a tar archive, plain or compressed, while it is still being downloaded. Write feeds the
+// body in order; other formats, zip included, are declined and the caller extracts the downloaded file as usual
+class StreamExtractor {
+public:
+  explicit StreamExtractor(const std::filesystem::path &destination_) : destination(destination_) {}
+  StreamExtractor(const StreamExtractor &) = delete;
+  StreamExtractor &operator=(const StreamExtractor &) = delete;
+  ~StreamExtractor();
+  void Write(const void *data, size_t len);
+  // Finish waits for the extraction, true when destination holds the complete and flattened archive
+  bool Finish(bela::error_code &ec);
+
+private:
+  void start();
+  std::filesystem::path destination;
+  std::string head;
+  std::shared_ptr<stream_pipe> pipe;
+  std::thread worker;
+  bela::error_code extractEc;
+  bool declined{false};
+  bool extracted{false};
+};
+
 using extract_method_t = decltype(&extract_exe);
 
 inline auto resolve_extract_handle(const std::wstring_view extension) -> extract_method_t {
@@ -0,0 +1,417 @@
+//
+#include <bela/io.hpp>
+#include <bela/ascii.hpp>
+#include <bela/phmap.hpp>
+#include <bela/str_split.hpp>
+#include <baulk/vfs.hpp>
+#include <baulk/json_lazy.hpp>
+#include <baulk/trigram.hpp>
+#include <algorithm>
+#include <mutex>
+#include "bucket.hpp"
+#include "bundled.hpp"
+#include "index.hpp"
+
+namespace baulk::index {
+namespace {
+constexpr uint32_t index_magic = 0x58494B42; // 'BKIX'
+constexpr uint32_t index_version = 2;
+constexpr std::string_view arch_names[ArchCount] = {"64bit", "arm64", "32bit"};
+
+struct string_ref {
+  uint32_t offset; // in wchar_t
+  uint32_t size;
+};
+
+// little endian: header | records sorted by name | trigram lists | trigram postings | wchar_t strings. The trigrams
+// cover names and descriptions, their postings are record numbers
+struct index_header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t variant;
+  uint32_t count;
+  uint32_t records; // byte offset
+  uint32_t strings; // byte offset
+  uint32_t strings_size;
+  string_ref commit;
+  uint32_t trigrams; // byte offset, 8-byte aligned
+  uint32_t trigrams_count;
+  uint32_t postings; // byte offset
+  uint32_t postings_count;
+  uint32_t reserved;
+};
+static_assert(sizeof(index_header) == 56);
+
+struct index_record {
+  string_ref name;
+  string_ref version;
+  string_ref description;
+  string_ref category;
+  string_ref source;
+  string_ref urls[ArchCount];
+  string_ref hash[ArchCount];
+};
+static_assert(sizeof(index_record) == 88);
+
+// names compare by ascii case, the way Windows finds the manifest files
+int compare_name(std::wstring_view a, std::wstring_view b) {
+  auto n = (std::min)(a.size(), b.size());
+  for (size_t i = 0; i < n; i++) {
+    auto ca = bela::ascii_tolower(a[i]);
+    auto cb = bela::ascii_tolower(b[i]);
+    if (ca != cb) {
+      return ca < cb ? -1 : 1;
+    }
+  }
+  return a.size() == b.size() ? 0 : (a.size() < b.size() ? -1 : 1);
+}
+
+std::wstring index_path(const Bucket &bucket) {
+  return bela::StringCat(vfs::AppBuckets(), L"\\", bucket.name, L".index");
+}
+
+// index_builder collects the manifests of a bucket and lays them out
+class index_builder {
+public:
+  void Add(const Bucket &bucket, std::wstring_view pkgName, const baulk::lazy_json_view &jv) {
+    auto &r = packages.emplace_back();
+    r.name = pkgName;
+    r.version = jv.fetch("version");
+    r.description = jv.fetch("description");
+    if (bucket.variant == BucketVariant::Native) {
+      if (auto sv = jv.subview("venv"); sv) {
+        r.category = sv->fetch("category");
+      }
+    }
+    r.source = bela::StringCat(L"bucket\\", pkgName, L".json");
+    for (size_t i = 0; i < ArchCount; i++) {
+      Package pkg;
+      PackageResolveArchitecture(bucket, jv, arch_names[i], pkg);
+      for (const auto &u : pkg.urls) {
+        bela::StrAppend(&r.urls[i], u, L"\n");
+      }
+      r.hash[i] = std::move(pkg.hash);
+    }
+  }
+  std::string Encode(const Bucket &bucket, std::wstring_view commit) {
+    std::sort(packages.begin(), packages.end(),
+              [](const package_source &a, const package_source &b) { return compare_name(a.name, b.name) < 0; });
+    std::vector<index_record> records;
+    records.reserve(packages.size());
+    trigram::Builder tb;
+    for (const auto &p : packages) {
+      // the separator keeps trigrams from spanning name and description
+      tb.Add(static_cast<uint32_t>(records.size()), bela::StringCat(p.name, L"\n", p.description));
+      auto &r = records.emplace_back();
+      r.name = add(p.name);
+      r.version = add(p.version);
+      r.description = add(p.description);
+      r.category = add(p.category);
+      r.source = add(p.source);
+      for (size_t i = 0; i < ArchCount; i++) {
+        r.urls[i] = add(p.urls[i]);
+        r.hash[i] = add(p.hash[i]);
+      }
+    }
+    std::vector<trigram::posting_list> lists;
+    std::vector<uint32_t> postings;
+    tb.Encode(lists, postings);
+    // header and records are multiples of 8 bytes, the trigram lists stay aligned
+    index_header h{
+        .magic = index_magic,
+        .version = index_version,
+        .variant = static_cast<uint32_t>(bucket.variant),
+        .count = static_cast<uint32_t>(records.size()),
+        .records = static_cast<uint32_t>(sizeof(index_header)),
+        .commit = add(commit),
+        .trigrams = static_cast<uint32_t>(sizeof(index_header) + records.size() * sizeof(index_record)),
+        .trigrams_count = static_cast<uint32_t>(lists.size()),
+        .postings_count = static_cast<uint32_t>(postings.size()),
+    };
+    h.postings = static_cast<uint32_t>(h.trigrams + lists.size() * sizeof(trigram::posting_list));
+    h.strings = static_cast<uint32_t>(h.postings + postings.size() * sizeof(uint32_t));
+    h.strings_size = static_cast<uint32_t>(strings.size());
+    std::string buffer;
+    buffer.reserve(h.strings + strings.size() * sizeof(wchar_t));
+    buffer.append(reinterpret_cast<const char *>(&h), sizeof(h));
+    buffer.append(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(index_record));
+    buffer.append(reinterpret_cast<const char *>(lists.data()), lists.size() * sizeof(trigram::posting_list));
+    buffer.append(reinterpret_cast<const char *>(postings.data()), postings.size() * sizeof(uint32_t));
+    buffer.append(reinterpret_cast<const char *>(strings.data()), strings.size() * sizeof(wchar_t));
+    return buffer;
+  }
+  size_t Size() const { return packages.size(); }
+
+private:
+  struct package_source {
+    std::wstring name;
+    std::wstring version;
+    std::wstring description;
+    std::wstring category;
+    std::wstring source;
+    std::wstring urls[ArchCount];
+    std::wstring hash[ArchCount];
+  };
+  string_ref add(std::wstring_view s) {
+    string_ref ref{.offset = static_cast<uint32_t>(strings.size()), .size = static_cast<uint32_t>(s.size())};
+    strings.append(s);
+    return ref;
+  }
+  std::vector<package_source> packages;
+  std::wstring strings;
+};
+
+// index_cache keeps the indexes this process mapped and the commits of buckets.lock.json
+class index_cache {
+public:
+  static index_cache &Instance() {
+    static index_cache cache;
+    return cache;
+  }
+  const BucketIndex *Lookup(const Bucket &bucket) {
+    std::scoped_lock lock(mu);
+    if (auto it = indexes.find(bucket.name); it != indexes.end()) {
+      return it->second.get();
+    }
+    load_commits();
+    auto &idx = indexes[bucket.name];
+    auto it = commits.find(bucket.name);
+    if (it == commits.end()) {
+      return nullptr;
+    }
+    auto bi = std::make_unique<BucketIndex>();
+    if (bela::error_code ec; !bi->Open(index_path(bucket), bucket, it->second, ec)) {
+      DbgPrint(L"bucket %s index: %s", bucket.name, ec);
+      return nullptr;
+    }
+    idx = std::move(bi);
+    return idx.get();
+  }
+  // Release closes the index of bucket so its file can be replaced, the next Lookup expects commit
+  void Release(const Bucket &bucket, std::wstring_view commit) {
+    std::scoped_lock lock(mu);
+    load_commits();
+    indexes.erase(bucket.name);
+    if (commit.empty()) {
+      commits.erase(bucket.name);
+      return;
+    }
+    commits.insert_or_assign(bucket.name, std::wstring(commit));
+  }
+
+private:
+  void load_commits() {
+    if (loaded) {
+      return;
+    }
+    loaded = true;
+    bela::error_code ec;
+    auto jo = parse_json_file(bela::StringCat(vfs::AppBuckets(), L"\\buckets.lock.json"), ec);
+    if (!jo) {
+      return;
+    }
+    try {
+      for (const auto &a : jo->obj) {
+        if (!a.is_object()) {
+          continue;
+        }
+        commits.insert_or_assign(bela::encode_into<char, wchar_t>(a["name"].get<std::string_view>()),
+                                 bela::encode_into<char, wchar_t>(a["latest"].get<std::string_view>()));
+      }
+    } catch (const std::exception &e) {
+      DbgPrint(L"bucket index: decode buckets.lock.json: %s", bela::encode_into<char, wchar_t>(e.what()));
+    }
+  }
+  std::mutex mu;
+  bela::flat_hash_map<std::wstring, std::unique_ptr<BucketIndex>> indexes;
+  bela::flat_hash_map<std::wstring, std::wstring> commits;
+  bool loaded{false};
+};
+} // namespace
+
+std::vector<std::wstring> Entry::URLs(arch_t arch) const {
+  std::vector<std::wstring> v;
+  for (auto u : bela::StrSplit(urls[arch], bela::ByChar('\n'))) {
+    v.emplace_back(u);
+  }
+  // each url is terminated, the split leaves an empty tail
+  if (!v.empty()) {
+    v.pop_back();
+  }
+  return v;
+}
+
+bool BucketIndex::Open(const std::filesystem::path &file, const Bucket &bucket, std::wstring_view commit_,
+                       bela::error_code &ec) {
+  if (!mf.Open(file, ec)) {
+    return false;
+  }
+  auto bytes = mf.Bytes();
+  if (bytes.size() < sizeof(index_header)) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"index too short");
+    return false;
+  }
+  const auto *h = reinterpret_cast<const index_header *>(bytes.data());
+  if (h->magic != index_magic || h->version != index_version) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"index format ", h->version, L" not supported");
+    return false;
+  }
+  if (h->variant != static_cast<uint32_t>(bucket.variant)) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"index compiled for another bucket variant");
+    return false;
+  }
+  if (h->records % 8 != 0 || h->trigrams % 8 != 0 || h->postings % 4 != 0 || h->strings % 4 != 0 ||
+      h->records < sizeof(index_header) ||
+      static_cast<uint64_t>(h->records) + static_cast<uint64_t>(h->count) * sizeof(index_record) > h->trigrams ||
+      static_cast<uint64_t>(h->trigrams) + static_cast<uint64_t>(h->trigrams_count) * sizeof(trigram::posting_list) >
+          h->postings ||
+      static_cast<uint64_t>(h->postings) + static_cast<uint64_t>(h->postings_count) * sizeof(uint32_t) > h->strings ||
+      static_cast<uint64_t>(h->strings) + static_cast<uint64_t>(h->strings_size) * sizeof(wchar_t) > bytes.size()) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"index damaged");
+    return false;
+  }
+  records = bytes.data() + h->records;
+  postings = trigram::Postings(
+      {reinterpret_cast<const trigram::posting_list *>(bytes.data() + h->trigrams), h->trigrams_count},
+      {reinterpret_cast<const uint32_t *>(bytes.data() + h->postings), h->postings_count});
+  strings = reinterpret_cast<const wchar_t *>(bytes.data() + h->strings);
+  count = h->count;
+  strings_size = h->strings_size;
+  commit = string_at(h->commit.offset, h->commit.size);
+  if (!bela::EqualsIgnoreCase(commit, commit_)) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"index compiled at ", commit, L" bucket is at ", commit_);
+    mf.Close();
+    return false;
+  }
+  return true;
+}
+
+std::wstring_view BucketIndex::string_at(uint32_t offset, uint32_t size) const {
+  // a damaged string reads as empty, the offsets are never trusted
+  if (static_cast<uint64_t>(offset) + size > strings_size) {
+    return {};
+  }
+  return {strings + offset, size};
+}
+
+std::wstring_view BucketIndex::name_at(size_t i) const {
+  const auto &r = reinterpret_cast<const index_record *>(records)[i];
+  return string_at(r.name.offset, r.name.size);
+}
+
+Entry BucketIndex::At(size_t i) const {
+  const auto &r = reinterpret_cast<const index_record *>(records)[i];
+  Entry e{
+      .name = string_at(r.name.offset, r.name.size),
+      .version = string_at(r.version.offset, r.version.size),
+      .description = string_at(r.description.offset, r.description.size),
+      .category = string_at(r.category.offset, r.category.size),
+      .source = string_at(r.source.offset, r.source.size),
+  };
+  for (size_t a = 0; a < ArchCount; a++) {
+    e.urls[a] = string_at(r.urls[a].offset, r.urls[a].size);
+    e.hash[a] = string_at(r.hash[a].offset, r.hash[a].size);
+  }
+  return e;
+}
+
+std::optional<Entry> BucketIndex::Find(std::wstring_view pkgName) const {
+  size_t lo = 0;
+  size_t hi = count;
+  while (lo < hi) {
+    auto mid = lo + (hi - lo) / 2;
+    auto c = compare_name(name_at(mid), pkgName);
+    if (c == 0) {
+      return std::make_optional(At(mid));
+    }
+    if (c < 0) {
+      lo = mid + 1;
+      continue;
+    }
+    hi = mid;
+  }
+  return std::nullopt;
+}
+
+std::vector<size_t> BucketIndex::Search(std::wstring_view term) const {
+  std::vector<size_t> matched;
+  auto verify = [&](size_t i) {
+    const auto &r = reinterpret_cast<const index_record *>(records)[i];
+    if (trigram::ContainsIgnoreCase(string_at(r.name.offset, r.name.size), term) ||
+        trigram::ContainsIgnoreCase(string_at(r.description.offset, r.description.size), term)) {
+      matched.emplace_back(i);
+    }
+  };
+  std::vector<uint32_t> candidates;
+  if (!postings.Candidates(term, candidates)) {
+    for (size_t i = 0; i < count; i++) {
+      verify(i);
+    }
+    return matched;
+  }
+  for (auto i : candidates) {
+    if (i < count) {
+      verify(i);
+    }
+  }
+  return matched;
+}
+
+const BucketIndex *Lookup(const Bucket &bucket) { return index_cache::Instance().Lookup(bucket); }
+
+bool IsFresh(const Bucket &bucket, std::wstring_view commit) {
+  BucketIndex bi;
+  bela::error_code ec;
+  return bi.Open(index_path(bucket), bucket, commit, ec);
+}
+
+bool Compile(const Bucket &bucket, std::wstring_view commit, bela::error_code &ec) {
+  index_builder builder;
+  auto add = [&](std::wstring_view pkgName, std::optional<lazy_json_container> &&pkj, const bela::error_code &pec) {
+    if (!pkj) {
+      // 'baulk install' reports the broken manifest, the index leaves it out
+      DbgPrint(L"bucket %s index: skip %s: %s", bucket.name, pkgName, pec);
+      return;
+    }
+    auto jv = pkj->view();
+    builder.Add(bucket, pkgName, jv);
+  };
+  if (const auto *b = bundle::Lookup(bucket); b != nullptr) {
+    for (size_t i = 0; i < b->Size(); i++) {
+      bela::error_code pec;
+      std::string text;
+      auto pkj = b->Read(i, text, pec) ? baulk::parse_json_lazy(std::move(text), b->Name(i), pec) : std::nullopt;
+      add(b->Name(i), std::move(pkj), pec);
+    }
+  } else {
+    auto folder = bela::StringCat(vfs::AppBuckets(), L"\\", bucket.name, L"\\bucket");
+    bela::fs::Finder finder;
+    if (!finder.First(folder, L"*.json", ec)) {
+      return false;
+    }
+    do {
+      if (finder.Ignore() || finder.IsDir()) {
+        continue;
+      }
+      auto pkgName = finder.Name();
+      pkgName.remove_suffix(5);
+      bela::error_code pec;
+      add(pkgName, baulk::parse_json_file_lazy(bela::StringCat(folder, L"\\", finder.Name()), pec), pec);
+    } while (finder.Next());
+  }
+  auto buffer = builder.Encode(bucket, commit);
+  index_cache::Instance().Release(bucket, commit);
+  if (!bela::io::AtomicWriteText(index_path(bucket), bela::io::as_bytes<char>(buffer), ec)) {
+    return false;
+  }
+  DbgPrint(L"bucket %s index: %d packages at %s", bucket.name, builder.Size(), commit);
+  return true;
+}
+
+void Remove(const Bucket &bucket) {
+  index_cache::Instance().Release(bucket, L"");
+  auto file = index_path(bucket);
+  DeleteFileW(file.data());
+}
+
+} // namespace baulk::index
@@ -0,0 +1,81 @@
+//
+#ifndef BAULK_INDEX_HPP
+#define BAULK_INDEX_HPP
+#include <bela/base.hpp>
+#include <baulk/fs.hpp>
+#include <baulk/trigram.hpp>
+#include "baulk.hpp"
+
+namespace baulk::index {
+// 'baulk update' compiles every bucket into AppBuckets()\<bucket>.index, a memory-mapped table of its manifests
+// sorted by package name. A package is found by binary search and its version, description and urls are read
+// without parsing json, the manifest is only loaded for the package that is installed or shown. The index records
+// the bucket commit it was compiled at and is ignored once buckets.lock.json names another commit. A trigram index
+// over names and descriptions answers 'baulk search' terms
+enum arch_t : uint32_t {
+  ArchX64 = 0, // "64bit"
+  ArchARM64 = 1,
+  ArchX86 = 2, // "32bit"
+  ArchCount = 3,
+};
+#if defined(_M_X64)
+constexpr arch_t host_arch = ArchX64;
+#elif defined(_M_ARM64)
+constexpr arch_t host_arch = ArchARM64;
+#else
+constexpr arch_t host_arch = ArchX86;
+#endif
+
+// Entry views a package of an index, the views are valid as long as the index is
+struct Entry {
+  std::wstring_view name;
+  std::wstring_view version;
+  std::wstring_view description;
+  std::wstring_view category;
+  std::wstring_view source;          // manifest path relative to the bucket folder
+  std::wstring_view urls[ArchCount]; // every url is terminated by '\n'
+  std::wstring_view hash[ArchCount];
+  // Ported: the manifest has urls for the host, PackageMeta would fail otherwise
+  bool Ported() const { return !urls[host_arch].empty(); }
+  std::vector<std::wstring> URLs(arch_t arch = host_arch) const;
+};
+
+class BucketIndex {
+public:
+  BucketIndex() = default;
+  BucketIndex(const BucketIndex &) = delete;
+  BucketIndex &operator=(const BucketIndex &) = delete;
+  // Open maps file and checks it was compiled for bucket at commit
+  bool Open(const std::filesystem::path &file, const Bucket &bucket, std::wstring_view commit, bela::error_code &ec);
+  std::optional<Entry> Find(std::wstring_view pkgName) const;
+  // Search returns the entries whose name or description contains term, ascii case ignored
+  std::vector<size_t> Search(std::wstring_view term) const;
+  size_t Size() const { return count; }
+  Entry At(size_t i) const;
+  std::wstring_view Commit() const { return commit; }
+
+private:
+  std::wstring_view string_at(uint32_t offset, uint32_t size) const;
+  std::wstring_view name_at(size_t i) const;
+  fs::MappedFile mf;
+  const uint8_t *records{nullptr};
+  trigram::Postings postings;
+  const wchar_t *strings{nullptr};
+  size_t count{0};
+  size_t strings_size{0};
+  std::wstring_view commit;
+};
+
+// Lookup returns the index of bucket when it was compiled at the commit 'baulk update' recorded last, nullptr when
+// the bucket has to be probed file by file
+const BucketIndex *Lookup(const Bucket &bucket);
+// IsFresh reports whether the index of bucket was compiled at commit
+bool IsFresh(const Bucket &bucket, std::wstring_view commit);
+// Compile parses every manifest of bucket once and writes its index for commit, indexes of this process mapping the
+// old file are closed first
+bool Compile(const Bucket &bucket, std::wstring_view commit, bela::error_code &ec);
+// Remove deletes the index of a bucket that is no longer configured
+void Remove(const Bucket &bucket);
+} // namespace baulk::index
+
+#endif
@@ -11,91 +11,127 @@
 #include <baulk/fs.hpp>
 #include <baulk/vfs.hpp>
 #include <baulk/json_utils.hpp>
+#include <baulk/linkmeta.hpp>
+#include <baulk/linkindex.hpp>
 #include <baulk/hash.hpp>
 #include "launcher.hpp"
 #include "generated.hpp"
 
 namespace baulk {
 
-bool LinkMetaStore(const std::vector<LinkMeta> &metas, const Package &pkg, bela::error_code &ec) {
-  if (metas.empty()) {
-    return true;
-  }
-  auto linkMeta = bela::StringCat(vfs::AppLinks(), L"\\baulk.linkmeta.json");
-  nlohmann::json obj;
-  if (auto jv = parse_json_file(linkMeta, ec); jv) {
-    obj = std::move(jv->obj);
-  }
-  try {
-    nlohmann::json newlinks;
-    if (auto it = obj.find("links"); it != obj.end()) {
-      for (const auto &item : it.value().items()) {
-        if (item.value().is_string()) {
-          newlinks[item.key()] = item.value().get<std::string>();
-        }
+// link_store: the link metadata of AppLinks() for the whole command, a LinkBatch defers its commit to the end
+class link_store {
+public:
+  link_store(const link_store &) = delete;
+  link_store &operator=(const link_store &) = delete;
+  static link_store &Instance() {
+    static link_store inst;
+    return inst;
+  }
+  linkmeta::Store *Open(bela::error_code &ec) {
+    if (!opened) {
+      if (!store.Open(vfs::AppLinks(), ec)) {
+        return nullptr;
+      }
+      opened = true;
+      if (store.Replayed() != 0) {
+        DbgPrint(L"link meta: replay %d changes of an interrupted command", store.Replayed());
       }
     }
-    for (const auto &lm : metas) {
-      auto meta = bela::encode_into<wchar_t, char>(bela::StringCat(pkg.name, L"@", lm.path, L"@", pkg.version));
-      newlinks[bela::encode_into<wchar_t, char>(lm.alias)] = meta; // "7z.exe":"7z@7z.exe@19.01"
+    return &store;
+  }
+  // Commit writes the changes unless a batch is open, they are then written when the batch ends
+  bool Commit(bela::error_code &ec) {
+    if (batches != 0 || !opened || !store.Dirty()) {
+      return true;
+    }
+    DbgPrint(L"write link meta: %v", linkmeta::MetaPath(vfs::AppLinks()));
+    if (!store.Commit(vfs::AppPackages(), ec)) {
+      return false;
+    }
+    // baulk-lnk falls back to the metadata while the index is missing or stale, a failure here only costs launch time
+    bela::error_code iec;
+    if (!WriteIndex(iec)) {
+      DbgPrint(L"write link index: %v", iec);
+    }
+    return true;
+  }
+  void Begin() { batches++; }
+  bool End(bela::error_code &ec) {
+    if (batches > 0) {
+      batches--;
     }
-    obj["links"] = newlinks;
-    obj["updated"] = bela::FormatTime<char>(bela::Now());
-    obj["app_packages_root"] = bela::encode_into<wchar_t, char>(vfs::AppPackages());
-    DbgPrint(L"write link meta: %v", linkMeta);
-    if (!bela::io::AtomicWriteText(linkMeta, bela::io::as_bytes<char>(obj.dump(4)), ec)) {
+    return Commit(ec);
+  }
+
+private:
+  link_store() = default;
+  bool WriteIndex(bela::error_code &ec) {
+    auto appLinks = vfs::AppLinks();
+    linkindex::identity id;
+    if (!linkindex::Identify(linkmeta::MetaPath(appLinks), id, ec)) {
       return false;
     }
-  } catch (const std::exception &e) {
-    ec = bela::make_error_code(bela::ErrGeneral, bela::encode_into<char, wchar_t>(e.what()));
+    std::vector<linkindex::Link> links;
+    for (const auto &[alias, meta] : store.Links()) {
+      if (auto link = linkindex::Resolve(alias, meta, vfs::AppPackages()); link) {
+        links.emplace_back(std::move(*link));
+      }
+    }
+    DbgPrint(L"write link index: %d links", links.size());
+    return linkindex::Write(links, id, linkindex::IndexPath(appLinks), ec);
+  }
+  linkmeta::Store store;
+  size_t batches{0};
+  bool opened{false};
+};
+
+LinkBatch::LinkBatch() { link_store::Instance().Begin(); }
+LinkBatch::~LinkBatch() {
+  bela::error_code ec;
+  if (!link_store::Instance().End(ec)) {
+    bela::FPrintF(stderr, L"\x1b[31mbaulk: write link metadata %s\x1b[0m\n", ec);
+  }
+}
+
+bool LinkMetaStore(const std::vector<LinkMeta> &metas, const Package &pkg, bela::error_code &ec) {
+  if (metas.empty()) {
+    return true;
+  }
+  auto *store = link_store::Instance().Open(ec);
+  if (store == nullptr) {
     return false;
   }
-  return true;
+  std::vector<std::pair<std::wstring, std::wstring>> aliases;
+  for (const auto &lm : metas) {
+    // "7z.exe":"7z@7z.exe@19.01"
+    aliases.emplace_back(lm.alias, bela::StringCat(pkg.name, L"@", lm.path, L"@", pkg.version));
+  }
+  if (!store->Put(aliases, ec)) {
+    return false;
+  }
+  return link_store::Instance().Commit(ec);
 }
 
 bool RemovePackageLinks(std::wstring_view pkgName, bela::error_code &ec) {
-  auto linkMeta = bela::StringCat(vfs::AppLinks(), L"\\baulk.linkmeta.json");
-  auto appLinks = vfs::AppLinks();
-  nlohmann::json obj;
-  if (auto jv = parse_json_file(linkMeta, ec); jv) {
-    obj = std::move(jv->obj);
+  auto *store = link_store::Instance().Open(ec);
+  if (store == nullptr) {
+    return false;
   }
-  std::string newjson;
+  auto aliases = store->Remove(pkgName, ec);
+  if (!aliases) {
+    return false;
+  }
+  auto appLinks = vfs::AppLinks();
   std::error_code e;
-  try {
-    auto it = obj.find("links");
-    if (it == obj.end()) {
-      return true;
+  for (const auto &alias : *aliases) {
+    auto file = bela::StringCat(appLinks, L"\\", alias);
+    if (!std::filesystem::remove(file, e)) {
+      auto le = bela::make_error_code_from_std(e);
+      baulk::DbgPrint(L"baulk remove link %s error: %s\n", file, le.message);
     }
-    nlohmann::json newlinks;
-    auto links = it.value();
-    for (auto link = links.begin(); link != links.end(); ++link) {
-      auto raw = link.value().get<std::string>();
-      auto value = bela::encode_into<char, wchar_t>(raw);
-      std::vector<std::wstring_view> mv = bela::StrSplit(value, bela::ByChar('@'), bela::SkipEmpty());
-      if (mv.size() < 2) {
-        continue;
-      }
-      if (mv[0] != pkgName) {
-        newlinks[link.key()] = raw;
-        continue;
-      }
-      auto file = bela::StringCat(appLinks, L"\\", bela::encode_into<char, wchar_t>(link.key()));
-      if (!std::filesystem::remove(file, e)) {
-        auto le = bela::make_error_code_from_std(e);
-        baulk::DbgPrint(L"baulk remove link %s error: %s\n", file, le.message);
-      }
-    }
-    obj["updated"] = bela::FormatTime<char>(bela::Now());
-    obj["links"] = newlinks;
-    if (!bela::io::AtomicWriteText(linkMeta, bela::io::as_bytes<char>(obj.dump(4)), ec)) {
-      return false;
-    }
-  } catch (const std::exception &e) {
-    ec = bela::make_error_code(bela::ErrGeneral, bela::encode_into<char, wchar_t>(e.what()));
-    return false;
   }
-  return true;
+  return link_store::Instance().Commit(ec);
 }
 
 class Builder {
@@ -6,6 +6,15 @@
 namespace baulk {
 bool MakePackageLinks(const baulk::Package &pkg, bool forceoverwrite, bela::error_code &ec);
 bool RemovePackageLinks(std::wstring_view pkg, bela::error_code &ec);
+// LinkBatch: link metadata changed while a batch is open is written once, when the outermost batch ends. Commands
+// open one after taking the fs mutex
+class LinkBatch {
+public:
+  LinkBatch();
+  LinkBatch(const LinkBatch &) = delete;
+  LinkBatch &operator=(const LinkBatch &) = delete;
+  ~LinkBatch();
+};
 } // namespace baulk
 
 #endif
\ No newline at end of file
@@ -0,0 +1,78 @@
+//
+#include <mutex>
+#include "baulk.hpp"
+#include "localdb.hpp"
+
+namespace baulk::localdb {
+namespace {
+class local_database {
+public:
+  static local_database &Instance() {
+    static local_database db;
+    return db;
+  }
+  std::optional<nlohmann::json> Find(std::wstring_view pkgName) {
+    std::scoped_lock lock(mu);
+    load();
+    if (const auto *record = db.Find(pkgName); record != nullptr) {
+      return std::make_optional(*record);
+    }
+    return std::nullopt;
+  }
+  bool Contains(std::wstring_view pkgName) {
+    std::scoped_lock lock(mu);
+    load();
+    return db.Contains(pkgName);
+  }
+  std::vector<std::wstring> Names() {
+    std::scoped_lock lock(mu);
+    load();
+    return db.Names();
+  }
+  bool Put(std::wstring_view pkgName, nlohmann::json &&record, bela::error_code &ec) {
+    std::scoped_lock lock(mu);
+    return open(ec) && db.Put(pkgName, std::move(record), ec);
+  }
+  bool Remove(std::wstring_view pkgName, bela::error_code &ec) {
+    std::scoped_lock lock(mu);
+    return open(ec) && db.Remove(pkgName, ec);
+  }
+
+private:
+  std::mutex mu;
+  installed::Database db;
+  bool loaded{false};
+  bool opened{false};
+  void load() {
+    if (loaded) {
+      return;
+    }
+    loaded = true;
+    if (bela::error_code ec; !db.Load(ec)) {
+      bela::FPrintF(stderr, L"baulk: load installed packages: \x1b[31m%s\x1b[0m\n", ec);
+    }
+  }
+  bool open(bela::error_code &ec) {
+    if (opened) {
+      return true;
+    }
+    if (!db.Open(ec)) {
+      return false;
+    }
+    DbgPrint(L"installed packages: %d in %s", db.Size(), installed::DatabasePath());
+    loaded = opened = true;
+    return true;
+  }
+};
+} // namespace
+
+std::optional<nlohmann::json> Find(std::wstring_view pkgName) { return local_database::Instance().Find(pkgName); }
+bool Contains(std::wstring_view pkgName) { return local_database::Instance().Contains(pkgName); }
+std::vector<std::wstring> Names() { return local_database::Instance().Names(); }
+bool Put(std::wstring_view pkgName, nlohmann::json record, bela::error_code &ec) {
+  return local_database::Instance().Put(pkgName, std::move(record), ec);
+}
+bool Remove(std::wstring_view pkgName, bela::error_code &ec) {
+  return local_database::Instance().Remove(pkgName, ec);
+}
+} // namespace baulk::localdb
@@ -0,0 +1,16 @@
+//
+#ifndef BAULK_LOCALDB_HPP
+#define BAULK_LOCALDB_HPP
+#include <baulk/installed.hpp>
+
+namespace baulk::localdb {
+// The installed package database of this process, loaded on first use and safe to share between threads. Put and
+// Remove open it for writing, the caller holds the baulk fs mutex
+std::optional<nlohmann::json> Find(std::wstring_view pkgName);
+bool Contains(std::wstring_view pkgName);
+std::vector<std::wstring> Names();
+bool Put(std::wstring_view pkgName, nlohmann::json record, bela::error_code &ec);
+bool Remove(std::wstring_view pkgName, bela::error_code &ec);
+} // namespace baulk::localdb
+
+#endif
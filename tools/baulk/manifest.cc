@@ -0,0 +1,102 @@
+//
+#include <bela/ascii.hpp>
+#include <bela/phmap.hpp>
+#include <mutex>
+#include "manifest.hpp"
+
+namespace baulk::manifest {
+namespace {
+struct file_identity {
+  uint64_t volume{0};
+  uint64_t index{0};
+  uint64_t size{0};
+  uint64_t mtime{0};
+  bool operator==(const file_identity &) const = default;
+};
+
+constexpr uint64_t make_uint64(DWORD high, DWORD low) { return (static_cast<uint64_t>(high) << 32) | low; }
+
+bool identify(const std::wstring &file, file_identity &id) {
+  auto FileHandle = CreateFileW(file.data(), FILE_READ_ATTRIBUTES,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (FileHandle == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  auto closer = bela::finally([&] { CloseHandle(FileHandle); });
+  BY_HANDLE_FILE_INFORMATION fi;
+  if (GetFileInformationByHandle(FileHandle, &fi) != TRUE) {
+    return false;
+  }
+  id.volume = fi.dwVolumeSerialNumber;
+  id.index = make_uint64(fi.nFileIndexHigh, fi.nFileIndexLow);
+  id.size = make_uint64(fi.nFileSizeHigh, fi.nFileSizeLow);
+  id.mtime = make_uint64(fi.ftLastWriteTime.dwHighDateTime, fi.ftLastWriteTime.dwLowDateTime);
+  return true;
+}
+
+// manifest_cache keeps the packages this process parsed
+class manifest_cache {
+public:
+  static manifest_cache &Instance() {
+    static manifest_cache cache;
+    return cache;
+  }
+  std::optional<Package> Load(std::wstring_view scope, std::wstring_view pkgName, const std::wstring &file,
+                              const loader_t &load, bela::error_code &ec) {
+    file_identity id;
+    if (!identify(file, id)) {
+      return load(ec); // missing or unreadable, load reports it
+    }
+    auto key = bela::AsciiStrToLower(bela::StringCat(scope, L"/", pkgName));
+    {
+      std::scoped_lock lock(mu);
+      if (auto it = packages.find(key); it != packages.end() && it->second.id == id) {
+        counters.reused++;
+        return std::make_optional(it->second.pkg);
+      }
+    }
+    auto pkg = load(ec);
+    if (!pkg) {
+      return std::nullopt;
+    }
+    std::scoped_lock lock(mu);
+    counters.parsed++;
+    if (auto it = packages.find(key); it != packages.end() && it->second.id == id) {
+      counters.redundant++;
+    }
+    packages.insert_or_assign(std::move(key), entry{.id = id, .pkg = *pkg});
+    return pkg;
+  }
+  statistics Statistics() {
+    std::scoped_lock lock(mu);
+    return counters;
+  }
+
+private:
+  struct entry {
+    file_identity id;
+    Package pkg;
+  };
+  std::mutex mu;
+  bela::flat_hash_map<std::wstring, entry> packages;
+  statistics counters;
+};
+} // namespace
+
+std::optional<Package> Load(std::wstring_view scope, std::wstring_view pkgName, const std::wstring &file,
+                            const loader_t &load, bela::error_code &ec) {
+  return manifest_cache::Instance().Load(scope, pkgName, file, load, ec);
+}
+
+statistics Statistics() { return manifest_cache::Instance().Statistics(); }
+
+void Summarize() {
+  auto s = Statistics();
+  if (s.parsed + s.reused == 0) {
+    return;
+  }
+  DbgPrint(L"manifests: %d parsed, %d reused, %d redundant", s.parsed, s.reused, s.redundant);
+}
+
+} // namespace baulk::manifest
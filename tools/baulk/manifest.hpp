@@ -0,0 +1,27 @@
+//
+#ifndef BAULK_MANIFEST_HPP
+#define BAULK_MANIFEST_HPP
+#include <bela/base.hpp>
+#include <functional>
+#include "baulk.hpp"
+
+namespace baulk::manifest {
+// Manifests parsed in this process are kept as packages, keyed by scope (the bucket), package name and the identity
+// of the file: volume, file index, size and last write time. A file rewritten or replaced gets another identity and
+// is parsed again. Failed loads are not kept
+using loader_t = std::function<std::optional<Package>(bela::error_code &ec)>;
+// Load returns the package parsed from file, calling load only when file is not cached with its current identity
+std::optional<Package> Load(std::wstring_view scope, std::wstring_view pkgName, const std::wstring &file,
+                            const loader_t &load, bela::error_code &ec);
+
+struct statistics {
+  size_t parsed{0};
+  size_t reused{0};
+  size_t redundant{0}; // parsed although the same file was already cached: concurrent loads of one manifest
+};
+statistics Statistics();
+// Summarize prints the statistics in verbose mode
+void Summarize();
+} // namespace baulk::manifest
+
+#endif
@@ -1,10 +1,13 @@
 // load package metadata
-#include <baulk/json_utils.hpp>
+#include <baulk/json_lazy.hpp>
 #include <baulk/vfs.hpp>
 #include <bela/fnmatch.hpp>
 #include <bela/ascii.hpp>
 #include <baulk/fs.hpp>
 #include "bucket.hpp"
+#include "bundled.hpp"
+#include "index.hpp"
+#include "manifest.hpp"
 
 namespace baulk {
 
@@ -22,11 +25,36 @@ constexpr std::string_view host_architecture = "32bit";
 constexpr std::wstring_view host_architecture_name = L"x86";
 #endif
 
+// PackageMetaOpen reads the manifest of pkgName from the bundle of bucket, from pkgMeta when the bucket is a folder
+std::optional<lazy_json_container> PackageMetaOpen(const Bucket &bucket, std::wstring_view pkgName,
+                                                   const std::wstring &pkgMeta, bela::error_code &ec) {
+  const auto *b = bundle::Lookup(bucket);
+  if (b == nullptr) {
+    return baulk::parse_json_file_lazy(pkgMeta, ec);
+  }
+  auto i = b->Find(pkgName);
+  if (!i) {
+    ec = bela::make_error_code(ENOENT, L"'", pkgName, L"' not found in bundle ", bucket.name);
+    return std::nullopt;
+  }
+  std::string text;
+  if (!b->Read(*i, text, ec)) {
+    return std::nullopt;
+  }
+  return baulk::parse_json_lazy(std::move(text), bela::StringCat(bucket.name, L"/", pkgName), ec);
+}
+
+// PackageMetaSource is the file identifying the manifest for manifest::Load
+inline std::wstring PackageMetaSource(const Bucket &bucket, std::wstring pkgMeta) {
+  return bundle::Lookup(bucket) != nullptr ? bundle::Path(bucket) : pkgMeta;
+}
+
 constexpr std::string_view arm64_architecture = "arm64";
 constexpr std::string_view x64bit_architecture = "64bit";
 constexpr std::string_view x32bit_architecture = "32bit";
 
-inline void PackageResolveURL(Package &pkg, baulk::json_view &jv) {
+inline void PackageResolveURL(Package &pkg, const baulk::lazy_json_view &jv,
+                              std::string_view arch = host_architecture) {
   using namespace std::string_view_literals;
   auto __ = bela::finally([&] {
     if (pkg.links.empty()) {
@@ -40,7 +68,7 @@ inline void PackageResolveURL(Package &pkg, baulk::json_view &jv) {
       pkg.hash = jv.fetch("hash");
     }
   });
-  auto fnload = [&](baulk::json_view &jv_, const std::string_view arch) -> bool {
+  auto fnload = [&](const baulk::lazy_json_view &jv_, const std::string_view arch) -> bool {
     if (auto av = jv_.subview(arch); av) {
       pkg.urls.emplace_back(av->fetch("url"));
       pkg.hash = av->fetch("hash");
@@ -51,10 +79,10 @@ inline void PackageResolveURL(Package &pkg, baulk::json_view &jv) {
     return false;
   };
   if (auto sv = jv.subview("architecture"); sv) {
-    if (fnload(*sv, host_architecture)) {
+    if (fnload(*sv, arch)) {
       return;
     }
-    if constexpr (host_architecture != x64bit_architecture) {
+    if (arch != x64bit_architecture) {
       if (fnload(*sv, x64bit_architecture)) {
         return;
       }
@@ -63,14 +91,14 @@ inline void PackageResolveURL(Package &pkg, baulk::json_view &jv) {
       return;
     }
   }
-  if constexpr (host_architecture == x64bit_architecture) {
+  if (arch == x64bit_architecture) {
     jv.fetch_strings_checked("url64", pkg.urls);
     pkg.hash = jv.fetch("url64.hash");
     jv.fetch_paths_checked("links64", pkg.links);
     jv.fetch_paths_checked("launchers64", pkg.launchers);
     return;
   }
-  if constexpr (host_architecture == arm64_architecture) {
+  if (arch == arm64_architecture) {
     jv.fetch_strings_checked("urlarm64", pkg.urls);
     pkg.hash = jv.fetch("urlarm64.hash");
     jv.fetch_paths_checked("linksarm64", pkg.links);
@@ -80,7 +108,7 @@ inline void PackageResolveURL(Package &pkg, baulk::json_view &jv) {
 
 std::optional<baulk::Package> PackageMetaNative(const Bucket &bucket, std::wstring_view pkgName, bela::error_code &ec) {
   auto pkgMeta = PackageMetaJoinNative(bucket, pkgName);
-  auto pkj = baulk::parse_json_file(pkgMeta, ec);
+  auto pkj = PackageMetaOpen(bucket, pkgName, pkgMeta, ec);
   if (!pkj) {
     return std::nullopt;
   }
@@ -96,6 +124,7 @@ std::optional<baulk::Package> PackageMetaNative(const Bucket &bucket, std::wstri
       .license = jv.fetch("license"),
   };
   jv.fetch_strings_checked("suggest", pkg.suggest);
+  jv.fetch_strings_checked("depends", pkg.depends);
   jv.fetch_paths_checked("force_delete", pkg.forceDeletes);
   PackageResolveURL(pkg, jv);
   if (pkg.urls.empty()) {
@@ -119,13 +148,25 @@ inline auto PackageMetaJoinScoop(const Bucket &bucket, std::wstring_view pkgName
   return bela::StringCat(vfs::AppBuckets(), L"\\", bucket.name, L"\\bucket\\", pkgName, L".json");
 }
 
+inline void PackageResolveScoopURL(Package &pkg, const baulk::lazy_json_view &jv) {
+  if (auto sv = jv.subview("architecture"); sv) {
+    if (auto av = sv->subview("64bit"); av) {
+      pkg.urls.emplace_back(av->fetch("url"));
+      pkg.hash = av->fetch("hash");
+      return;
+    }
+  }
+  pkg.urls.emplace_back(jv.fetch("url"));
+  pkg.hash = jv.fetch("hash");
+}
+
 // Not support multi file and ....
 std::optional<baulk::Package> PackageMetaScoop(const Bucket &bucket, std::wstring_view pkgName, bela::error_code &ec) {
 #if !defined(_M_X64) && !defined(_M_ARM64)
   return std::nullopt;
 #endif
   auto pkgMeta = PackageMetaJoinNative(bucket, pkgName);
-  auto pkj = baulk::parse_json_file(pkgMeta, ec);
+  auto pkj = PackageMetaOpen(bucket, pkgName, pkgMeta, ec);
   if (!pkj) {
     return std::nullopt;
   }
@@ -142,25 +183,35 @@ std::optional<baulk::Package> PackageMetaScoop(const Bucket &bucket, std::wstrin
   };
   pkg.variant = BucketVariant::Scoop;
   jv.fetch_paths_checked("bin", pkg.launchers);
+  jv.fetch_strings_checked("depends", pkg.depends);
+  PackageResolveScoopURL(pkg, jv);
+  return std::make_optional(std::move(pkg));
+}
 
-  if (auto sv = jv.subview("architecture"); sv) {
-    if (auto av = sv->subview("64bit"); av) {
-      pkg.urls.emplace_back(av->fetch("url"));
-      pkg.hash = av->fetch("hash");
-      return std::make_optional(std::move(pkg));
+void PackageResolveArchitecture(const Bucket &bucket, const baulk::lazy_json_view &jv, std::string_view arch,
+                                Package &pkg) {
+  switch (bucket.variant) {
+  case BucketVariant::Native:
+    PackageResolveURL(pkg, jv, arch);
+    break;
+  case BucketVariant::Scoop:
+    if (arch != x32bit_architecture) {
+      PackageResolveScoopURL(pkg, jv);
     }
+    break;
+  default:
+    break;
   }
-  pkg.urls.emplace_back(jv.fetch("url"));
-  pkg.hash = jv.fetch("hash");
-  return std::make_optional(std::move(pkg));
 }
 
 std::optional<baulk::Package> PackageMeta(const Bucket &bucket, std::wstring_view pkgName, bela::error_code &ec) {
   switch (bucket.variant) {
   case BucketVariant::Native:
-    return PackageMetaNative(bucket, pkgName, ec);
+    return manifest::Load(bucket.name, pkgName, PackageMetaSource(bucket, PackageMetaJoinNative(bucket, pkgName)),
+                          [&](bela::error_code &ec_) { return PackageMetaNative(bucket, pkgName, ec_); }, ec);
   case BucketVariant::Scoop:
-    return PackageMetaScoop(bucket, pkgName, ec);
+    return manifest::Load(bucket.name, pkgName, PackageMetaSource(bucket, PackageMetaJoinScoop(bucket, pkgName)),
+                          [&](bela::error_code &ec_) { return PackageMetaScoop(bucket, pkgName, ec_); }, ec);
   default:
     break;
   }
@@ -192,6 +243,24 @@ bool PackageMatchedInternal(const Bucket &bucket, std::wstring_view pkgMetaFolde
 
 bool PackageMatched(const OnPattern &op, const OnMatched &om) {
   for (const auto &bucket : LoadedBuckets()) {
+    if (const auto *idx = index::Lookup(bucket); idx != nullptr) {
+      DbgPrint(L"search bucket: %s, index at %s", bucket.name, idx->Commit());
+      for (size_t i = 0; i < idx->Size(); i++) {
+        if (auto pkgName = idx->At(i).name; op(pkgName)) {
+          om(bucket, pkgName);
+        }
+      }
+      continue;
+    }
+    if (const auto *b = bundle::Lookup(bucket); b != nullptr) {
+      DbgPrint(L"search bucket: %s, bundle of %d manifests", bucket.name, b->Size());
+      for (size_t i = 0; i < b->Size(); i++) {
+        if (auto pkgName = b->Name(i); op(pkgName)) {
+          om(bucket, pkgName);
+        }
+      }
+      continue;
+    }
     switch (bucket.variant) {
     case BucketVariant::Native: {
       auto pkgMetaFolder = bela::StringCat(vfs::AppBuckets(), L"\\", bucket.name, L"\\bucket\\");
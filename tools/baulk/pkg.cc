@@ -10,10 +10,16 @@
 #include <baulk/json_utils.hpp>
 #include <baulk/net.hpp>
 #include <baulk/hash.hpp>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 #include "bucket.hpp"
 #include "launcher.hpp"
 #include "pkg.hpp"
 #include "extractor.hpp"
+#include "blobs.hpp"
+#include "localdb.hpp"
 
 namespace baulk::package {
 
@@ -47,13 +53,8 @@ bool PackageLocalMetaWrite(const baulk::Package &pkg, bela::error_code &ec) {
       AddArray(venv, "dependencies", pkg.venv.dependencies); // venv dependencies
       j["venv"] = std::move(venv);
     }
-    std::wstring file(vfs::AppLocks());
-    if (!baulk::fs::MakeDirectories(file, ec)) {
-      return false;
-    }
-    bela::StrAppend(&file, L"\\", pkg.name, L".json");
-    DbgPrint(L"write %s lock: %s", pkg.name, file);
-    return bela::io::AtomicWriteText(file, bela::io::as_bytes<char>(j.dump(4)), ec);
+    DbgPrint(L"record %s %s installed", pkg.name, pkg.version);
+    return baulk::localdb::Put(pkg.name, std::move(j), ec);
   } catch (const std::exception &e) {
     ec = bela::make_error_code(bela::ErrGeneral, bela::encode_into<char, wchar_t>(e.what()));
   }
@@ -176,26 +177,9 @@ bool expand_fallback_exe(const baulk::Package &pkg, const std::filesystem::path
   return PackageMakeLinks(pkgCopy);
 }
 
-bool PackageExpand(const baulk::Package &pkg, const std::filesystem::path &archive_file) {
-  auto fn = baulk::resolve_extract_handle(pkg.extension);
-  if (!fn) {
-    bela::FPrintF(stderr, L"baulk unsupport package extension: %s\n", pkg.extension);
-    return false;
-  }
-  std::filesystem::path strict_folder;
-  auto destination = baulk::make_unqiue_extracted_destination(archive_file, strict_folder);
-  if (!destination) {
-    bela::FPrintF(stderr, L"destination '%v' already exists\n", strict_folder);
-    return false;
-  }
+// PackageCommit moves an extracted package into the packages folder and links it
+bool PackageCommit(const baulk::Package &pkg, const std::filesystem::path &extracted) {
   bela::error_code ec;
-  if (!fn(archive_file, *destination, ec)) {
-    if (ec == baulk::archive::ErrNoOverlayArchive) {
-      return expand_fallback_exe(pkg, archive_file);
-    }
-    bela::FPrintF(stderr, L"baulk extract: %v error: %v\n", archive_file.filename(), ec);
-    return false;
-  }
   std::filesystem::path packages(baulk::vfs::AppPackages());
   auto pkgRoot = packages / pkg.name;
   std::error_code e;
@@ -209,8 +193,8 @@ bool PackageExpand(const baulk::Package &pkg, const std::filesystem::path &archi
             return false;
           }
         }
-        if (std::filesystem::rename(*destination, pkgRoot, e); e) {
-          bela::FPrintF(stderr, L"baulk rename %s to %s error: \x1b[31m%s\x1b[0m\n", *destination, pkgRoot, ec);
+        if (std::filesystem::rename(extracted, pkgRoot, e); e) {
+          bela::FPrintF(stderr, L"baulk rename %s to %s error: \x1b[31m%s\x1b[0m\n", extracted, pkgRoot, ec);
           if (!oldPath.empty()) {
             std::filesystem::rename(oldPath, pkgRoot, e);
           }
@@ -231,10 +215,32 @@ bool PackageExpand(const baulk::Package &pkg, const std::filesystem::path &archi
   return PackageMakeLinks(pkg);
 }
 
+bool PackageExpand(const baulk::Package &pkg, const std::filesystem::path &archive_file) {
+  auto fn = baulk::resolve_extract_handle(pkg.extension);
+  if (!fn) {
+    bela::FPrintF(stderr, L"baulk unsupport package extension: %s\n", pkg.extension);
+    return false;
+  }
+  std::filesystem::path strict_folder;
+  auto destination = baulk::make_unqiue_extracted_destination(archive_file, strict_folder);
+  if (!destination) {
+    bela::FPrintF(stderr, L"destination '%v' already exists\n", strict_folder);
+    return false;
+  }
+  bela::error_code ec;
+  if (!fn(archive_file, *destination, ec)) {
+    if (ec == baulk::archive::ErrNoOverlayArchive) {
+      return expand_fallback_exe(pkg, archive_file);
+    }
+    bela::FPrintF(stderr, L"baulk extract: %v error: %v\n", archive_file.filename(), ec);
+    return false;
+  }
+  return PackageCommit(pkg, *destination);
+}
+
 bool DependenciesExists(const std::vector<std::wstring_view> &dv) {
   for (const auto d : dv) {
-    auto pkglock = bela::StringCat(vfs::AppLocks(), L"\\", d, L".json");
-    if (bela::PathFileIsExists(pkglock)) {
+    if (baulk::localdb::Contains(d)) {
       return true;
     }
   }
@@ -249,8 +255,25 @@ void DisplayDependencies(const baulk::Package &pkg) {
                 bela::StrJoin(pkg.venv.dependencies, L"\n    "));
 }
 
-bool PackageInstall(const baulk::Package &pkg) {
+namespace {
+constexpr size_t download_jobs = 4;          // packages downloaded at the same time
+constexpr size_t download_jobs_per_host = 2; // of which at most this many from the same host
+
+struct install_task {
+  baulk::Package pkg;
+  std::wstring url;
+  std::wstring host;
+  std::wstring filename;
+  std::filesystem::path downloads; // AppTemp()\downloads\<package>, packages with the same file name do not collide
+  std::optional<std::filesystem::path> archive_file;
+  std::optional<std::filesystem::path> staged; // extracted while downloading, hash verified
+};
+
+// PackagePrepare checks the installed version and chooses a mirror. It returns nullopt when there is nothing to
+// install: the package is up to date, frozen or failed (result tells which)
+std::optional<install_task> PackagePrepare(const baulk::Package &pkg, bool &result) {
   bela::error_code ec;
+  result = true;
   auto pkgLocal = baulk::PackageLocalMeta(pkg.name, ec);
   if (pkgLocal) {
     bela::version pkgVersion(pkg.version);
@@ -262,9 +285,10 @@ bool PackageInstall(const baulk::Package &pkg) {
                       L"baulk already installed \x1b[35m%s\x1b[0m/\x1b[34m%s\x1b[0m version \x1b[32m%s\x1b[0m "
                       L"[\x1b[36mCompatibility Mode\x1b[0m]\n",
                       pkg.name, pkg.bucket, pkgLocal->version);
-        return true;
+        return std::nullopt;
       }
-      return PackageMakeLinks(pkg);
+      result = PackageMakeLinks(pkg);
+      return std::nullopt;
     }
     if (baulk::IsFrozenedPackage(pkg.name) && !baulk::IsForceMode) {
       // Since the metadata has been updated, we cannot rebuild the frozen
@@ -275,7 +299,7 @@ bool PackageInstall(const baulk::Package &pkg) {
                     L"\x1b[33m%s\x1b[0m@\x1b[34m%s\x1b[0m to "
                     L"\x1b[32m%s\x1b[0m@\x1b[34m%s\x1b[0m.\n",
                     pkg.name, pkgLocal->version, pkgLocal->bucket, pkg.version, pkg.bucket);
-      return true;
+      return std::nullopt;
     }
     bela::FPrintF(stderr,
                   L"baulk will upgrade \x1b[35m%s\x1b[0m from "
@@ -286,52 +310,143 @@ bool PackageInstall(const baulk::Package &pkg) {
   auto url = baulk::net::BestUrl(pkg.urls, LocaleName());
   if (url.empty()) {
     bela::FPrintF(stderr, L"baulk: \x1b[31m%s\x1b[0m no valid url\n", pkg.name);
-    return false;
+    result = false;
+    return std::nullopt;
   }
   DbgPrint(L"baulk '%s/%s' url: '%s'\n", pkg.name, pkg.version, url);
-  std::filesystem::path downloads(vfs::AppTemp());
-  auto filename = net::url_path_name(url);
+  install_task task{.pkg = pkg,
+                    .url = std::wstring(url),
+                    .host = net::url_host(url),
+                    .filename = net::url_path_name(url),
+                    .downloads = std::filesystem::path(vfs::AppTemp()) / L"downloads" / pkg.name};
   if (!pkg.hash.empty()) {
-    DbgPrint(L"baulk '%s/%s' filename: '%s'\n", pkg.name, pkg.version, filename);
-    if (auto archive_file = PackageCached(downloads, filename, pkg.hash); archive_file) {
-      return PackageExpand(pkg, *archive_file);
+    DbgPrint(L"baulk '%s/%s' filename: '%s'\n", pkg.name, pkg.version, task.filename);
+    // the blob store first: it finds the package under any name it was downloaded with before
+    if (task.archive_file = blobs::Lookup(task.url, pkg.hash, task.downloads, task.filename); !task.archive_file) {
+      if (task.archive_file = PackageCached(task.downloads, task.filename, pkg.hash); task.archive_file) {
+        bela::error_code ec;
+        blobs::Insert(task.url, pkg.hash, *task.archive_file, ec);
+      }
     }
   }
-  if (!baulk::fs::MakeDirectories(downloads, ec)) {
-    bela::FPrintF(stderr, L"baulk: unable make %s error: %s\n", downloads, ec);
+  return std::make_optional(std::move(task));
+}
+
+// streamed_download tees the response body into the hash verifier and, for tar packages, into an extraction in a
+// staging directory, so the archive is neither read again for the hash nor before extraction
+class streamed_download {
+public:
+  explicit streamed_download(const install_task &task) {
+    bela::error_code ec;
+    if (!verifier.Initialize(task.pkg.hash, ec)) {
+      DbgPrint(L"baulk '%s' hash: %s", task.pkg.name, ec);
+      return;
+    }
+    enabled = true;
+    if (task.pkg.extension != L"tar" && task.pkg.extension != L"auto") {
+      return;
+    }
+    std::filesystem::path strict_folder;
+    if (auto d = baulk::make_unqiue_extracted_destination(task.downloads / task.filename, strict_folder); d) {
+      staging = std::move(*d);
+      extractor = std::make_unique<baulk::StreamExtractor>(staging);
+    }
+  }
+  streamed_download(const streamed_download &) = delete;
+  streamed_download &operator=(const streamed_download &) = delete;
+  ~streamed_download() {
+    extractor.reset();
+    if (!committed && !staging.empty()) {
+      std::error_code e;
+      std::filesystem::remove_all(staging, e);
+    }
+  }
+  bool Enabled() const { return enabled; }
+  net::body_sink_t Sink() {
+    return [this](const void *data, size_t len, bela::error_code &) {
+      verifier.Update(data, len);
+      if (extractor) {
+        extractor->Write(data, len);
+      }
+      return true;
+    };
+  }
+  bool HashEqual(bela::error_code &ec) { return verifier.Equal(ec); }
+  // Staged returns the extracted package once the hash matched, nullopt when the archive has to be extracted
+  std::optional<std::filesystem::path> Staged() {
+    if (!extractor) {
+      return std::nullopt;
+    }
+    if (bela::error_code ec; !extractor->Finish(ec)) {
+      DbgPrint(L"baulk streaming extraction: %s", ec);
+      return std::nullopt;
+    }
+    committed = true;
+    return std::make_optional(staging);
+  }
+
+private:
+  baulk::hash::Verifier verifier;
+  std::unique_ptr<baulk::StreamExtractor> extractor;
+  std::filesystem::path staging;
+  bool enabled{false};
+  bool committed{false};
+};
+
+bool PackageDownload(install_task &task, bool quiet) {
+  const auto &pkg = task.pkg;
+  bela::error_code ec;
+  if (!baulk::fs::MakeDirectories(task.downloads, ec)) {
+    bela::FPrintF(stderr, L"baulk: unable make %s error: %s\n", task.downloads, ec);
     return false;
   }
-  bela::FPrintF(stderr, L"baulk: download '\x1b[36m%s\x1b[0m' \nurl: \x1b[36m%s\x1b[0m\n", filename, url);
-  std::optional<std::filesystem::path> archive_file;
+  bela::FPrintF(stderr, L"baulk: download '\x1b[36m%s\x1b[0m' \nurl: \x1b[36m%s\x1b[0m\n", task.filename, task.url);
   for (int i = 0; i < 4; i++) {
     if (i != 0) {
-      bela::FPrintF(stderr, L"baulk: download '\x1b[33m%s\x1b[0m' retries: \x1b[33m%d\x1b[0m\n", filename, i);
+      bela::FPrintF(stderr, L"baulk: download '\x1b[33m%s\x1b[0m' retries: \x1b[33m%d\x1b[0m\n", task.filename, i);
+    }
+    std::optional<streamed_download> streamed;
+    if (!pkg.hash.empty()) {
+      streamed.emplace(task);
     }
     //  downloads, pkg.hash, true
-    if (archive_file = baulk::net::WinGet(url,
-                                          {
-                                              .hash_value = pkg.hash,
-                                              .cwd = downloads,
-                                              .force_overwrite = true,
-                                          },
-                                          ec);
-        !archive_file) {
-      bela::FPrintF(stderr, L"baulk: download '%s' error: \x1b[31m%s\x1b[0m\n", filename, ec);
+    if (task.archive_file = baulk::net::WinGet(task.url,
+                                               {
+                                                   .hash_value = pkg.hash,
+                                                   .cwd = task.downloads,
+                                                   .force_overwrite = true,
+                                                   .quiet = quiet,
+                                                   .sink = streamed && streamed->Enabled() ? streamed->Sink()
+                                                                                           : net::body_sink_t{},
+                                               },
+                                               ec);
+        !task.archive_file) {
+      bela::FPrintF(stderr, L"baulk: download '%s' error: \x1b[31m%s\x1b[0m\n", task.filename, ec);
       continue;
     }
     // hash not check
-    if (pkg.hash.empty()) {
-      break;
-    }
-    if (hash::HashEqual(*archive_file, pkg.hash, ec)) {
-      break;
+    if (pkg.hash.empty() || (streamed->Enabled() ? streamed->HashEqual(ec)
+                                                 : hash::HashEqual(*task.archive_file, pkg.hash, ec))) {
+      if (streamed) {
+        task.staged = streamed->Staged();
+      }
+      if (!pkg.hash.empty() && !blobs::Insert(task.url, pkg.hash, *task.archive_file, ec)) {
+        DbgPrint(L"baulk '%s' unable to store the download: %s", pkg.name, ec);
+      }
+      if (quiet) {
+        bela::FPrintF(stderr, L"baulk: download '\x1b[32m%s\x1b[0m' completed\n", task.filename);
+      }
+      return true;
     }
-    bela::FPrintF(stderr, L"baulk download '%s' error: \x1b[31m%s\x1b[0m\n", archive_file->filename(), ec);
+    bela::FPrintF(stderr, L"baulk download '%s' error: \x1b[31m%s\x1b[0m\n", task.archive_file->filename(), ec);
+    task.archive_file.reset();
   }
-  if (!archive_file) {
-    return false;
-  }
-  if (!PackageExpand(pkg, *archive_file)) {
+  return false;
+}
+
+bool PackageFinish(const install_task &task) {
+  const auto &pkg = task.pkg;
+  if (!(task.staged ? PackageCommit(pkg, *task.staged) : PackageExpand(pkg, *task.archive_file))) {
     return false;
   }
   if (!pkg.suggest.empty()) {
@@ -344,4 +459,106 @@ bool PackageInstall(const baulk::Package &pkg) {
   DisplayDependencies(pkg);
   return true;
 }
+
+// download_scheduler hands pending downloads to workers within the global and per host limits and queues finished
+// downloads for the installing thread in the order they complete
+class download_scheduler {
+public:
+  explicit download_scheduler(std::vector<install_task> &tasks_) : tasks(tasks_), started(tasks_.size(), false) {}
+  bool Next(size_t &index) {
+    std::unique_lock lock(mu);
+    for (;;) {
+      bool pending = false;
+      for (size_t i = 0; i < tasks.size(); i++) {
+        if (started[i]) {
+          continue;
+        }
+        pending = true;
+        if (auto &n = active[tasks[i].host]; n < download_jobs_per_host) {
+          n++;
+          started[i] = true;
+          index = i;
+          return true;
+        }
+      }
+      if (!pending) {
+        return false;
+      }
+      cv.wait(lock);
+    }
+  }
+  void Done(size_t index) {
+    std::scoped_lock lock(mu);
+    active[tasks[index].host]--;
+    finished.emplace_back(index);
+    cv.notify_all();
+  }
+  // Take waits for the next finished download, it returns false once every download has been taken
+  bool Take(size_t &index) {
+    std::unique_lock lock(mu);
+    cv.wait(lock, [&] { return !finished.empty() || taken == tasks.size(); });
+    if (finished.empty()) {
+      return false;
+    }
+    index = finished.front();
+    finished.pop_front();
+    taken++;
+    return true;
+  }
+
+private:
+  std::mutex mu;
+  std::condition_variable cv;
+  std::vector<install_task> &tasks;
+  std::vector<bool> started;
+  bela::flat_hash_map<std::wstring, size_t> active;
+  std::deque<size_t> finished;
+  size_t taken{0};
+};
+} // namespace
+
+size_t PackageInstall(const std::vector<baulk::Package> &pkgs) {
+  size_t failures = 0;
+  // resolve every package first, cached archives are installed once the downloads are under way
+  std::vector<install_task> cached;
+  std::vector<install_task> tasks;
+  for (const auto &pkg : pkgs) {
+    bool result = true;
+    auto task = PackagePrepare(pkg, result);
+    if (!task) {
+      failures += result ? 0 : 1;
+      continue;
+    }
+    (task->archive_file ? cached : tasks).emplace_back(std::move(*task));
+  }
+  // concurrent progress bars would overwrite each other, as would installation output
+  auto quiet = tasks.size() + cached.size() > 1;
+  download_scheduler scheduler(tasks);
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < (std::min)(download_jobs, tasks.size()); i++) {
+    workers.emplace_back([&] {
+      for (size_t index = 0; scheduler.Next(index);) {
+        PackageDownload(tasks[index], quiet);
+        scheduler.Done(index);
+      }
+    });
+  }
+  // extraction starts as soon as an archive arrives, this thread alone writes package folders, links and env so
+  // those writes stay serialized
+  for (const auto &task : cached) {
+    failures += PackageFinish(task) ? 0 : 1;
+  }
+  for (size_t index = 0; scheduler.Take(index);) {
+    if (!tasks[index].archive_file || !PackageFinish(tasks[index])) {
+      failures++;
+    }
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  if (bela::error_code lec; !net::SaveLatencyStats(lec)) {
+    DbgPrint(L"baulk save mirror latency stats: %s\n", lec);
+  }
+  return failures;
+}
 } // namespace baulk::package
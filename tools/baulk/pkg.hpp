@@ -4,7 +4,9 @@
 #include "baulk.hpp"
 
 namespace baulk::package {
-bool PackageInstall(const baulk::Package &pkg);
+// PackageInstall resolves all packages first, then downloads them concurrently and installs each one as soon as its
+// download completes. It returns the number of packages that failed
+size_t PackageInstall(const std::vector<baulk::Package> &pkgs);
 bool PackageForceDelete(std::wstring_view pkgname, bela::error_code &ec);
 }; // namespace baulk::package
 
@@ -0,0 +1,377 @@
+//
+#include <bela/io.hpp>
+#include <bela/fs.hpp>
+#include <bela/ascii.hpp>
+#include <bela/hash.hpp>
+#include <bela/phmap.hpp>
+#include <bela/str_split.hpp>
+#include <bela/strip.hpp>
+#include <bela/fnmatch.hpp>
+#include <baulk/vfs.hpp>
+#include <baulk/fs.hpp>
+#include <baulk/net.hpp>
+#include <baulk/json_utils.hpp>
+#include "bucket.hpp"
+#include "index.hpp"
+#include "snapshot.hpp"
+
+namespace baulk::snapshot {
+namespace {
+constexpr size_t compare_files_limit = 300; // github lists at most this many files of a comparison
+
+struct snapshot_t {
+  std::wstring commit;
+  bela::flat_hash_map<std::wstring, std::wstring> files; // '/' separated path relative to the bucket: blob id
+};
+
+std::wstring snapshot_path(const Bucket &bucket) {
+  return bela::StringCat(vfs::AppBuckets(), L"\\", bucket.name, L".snapshot.json");
+}
+
+std::wstring bucket_path(const Bucket &bucket) { return bela::StringCat(vfs::AppBuckets(), L"\\", bucket.name); }
+
+// previous_path: where Apply parks the bucket folder it replaces until the new one is in place
+std::wstring previous_path(const Bucket &bucket) {
+  return bela::StringCat(vfs::AppBuckets(), L"\\", bucket.name, L".previous");
+}
+
+// link_file puts the unchanged file source into the new tree, a hard link when both are on one volume
+bool link_file(const std::filesystem::path &source, const std::filesystem::path &target, bela::error_code &ec) {
+  if (CreateHardLinkW(target.c_str(), source.c_str(), nullptr) == TRUE ||
+      CopyFileW(source.c_str(), target.c_str(), TRUE) == TRUE) {
+    return true;
+  }
+  ec = bela::make_system_error_code(L"CopyFileW() ");
+  return false;
+}
+
+// blob_id is the git object id of content: sha1 over 'blob <size>\0' and the content
+std::wstring blob_id(std::string_view content) {
+  bela::hash::sha1::Hasher h;
+  h.Initialize();
+  auto header = bela::encode_into<wchar_t, char>(bela::StringCat(L"blob ", content.size()));
+  h.Update(header.data(), header.size() + 1); // the terminating NUL is part of the header
+  h.Update(content.data(), content.size());
+  return h.Finalize();
+}
+
+bool file_blob_id(const std::filesystem::path &file, std::wstring &id, bela::error_code &ec) {
+  std::string content;
+  if (!bela::io::ReadFile(file.native(), content, ec, 64 * 1024 * 1024)) {
+    return false;
+  }
+  id = blob_id(content);
+  return true;
+}
+
+bool load(const std::filesystem::path &file, snapshot_t &s, bela::error_code &ec) {
+  auto jo = parse_json_file(file.native(), ec);
+  if (!jo) {
+    return false;
+  }
+  try {
+    s.commit = bela::encode_into<char, wchar_t>(jo->obj.at("commit").get<std::string_view>());
+    for (const auto &[path, id] : jo->obj.at("files").items()) {
+      s.files.insert_or_assign(bela::encode_into<char, wchar_t>(path),
+                               bela::encode_into<char, wchar_t>(id.get<std::string_view>()));
+    }
+  } catch (const std::exception &e) {
+    ec = bela::make_error_code(bela::ErrGeneral, bela::encode_into<char, wchar_t>(e.what()));
+    return false;
+  }
+  return true;
+}
+
+bool save(const std::filesystem::path &file, const snapshot_t &s, bela::error_code &ec) {
+  try {
+    nlohmann::json files = nlohmann::json::object();
+    for (const auto &[path, id] : s.files) {
+      files[bela::encode_into<wchar_t, char>(path)] = bela::encode_into<wchar_t, char>(id);
+    }
+    nlohmann::json j{
+        {"version", 1}, {"commit", bela::encode_into<wchar_t, char>(s.commit)}, {"files", std::move(files)}};
+    return bela::io::AtomicWriteText(file.native(), bela::io::as_bytes<char>(j.dump()), ec);
+  } catch (const std::exception &e) {
+    ec = bela::make_error_code(bela::ErrGeneral, bela::encode_into<char, wchar_t>(e.what()));
+  }
+  return false;
+}
+
+// github_repo: 'https://github.com/owner/repo' as 'owner/repo'
+std::optional<std::wstring> github_repo(std::wstring_view url) {
+  constexpr std::wstring_view prefix = L"https://github.com/";
+  if (!bela::StartsWithIgnoreCase(url, prefix)) {
+    return std::nullopt;
+  }
+  url.remove_prefix(prefix.size());
+  url = bela::StripSuffix(bela::StripSuffix(url, L"/"), L".git");
+  std::vector<std::wstring_view> parts = bela::StrSplit(url, bela::ByChar('/'), bela::SkipEmpty());
+  if (parts.size() != 2) {
+    return std::nullopt;
+  }
+  return std::make_optional(bela::StringCat(parts[0], L"/", parts[1]));
+}
+
+std::optional<std::string> fetch_content(std::wstring_view url, bela::error_code &ec) {
+  auto resp = baulk::net::RestGet(url, ec);
+  if (!resp) {
+    return std::nullopt;
+  }
+  if (resp->StatusCode() != 200) {
+    ec = bela::make_error_code(bela::ErrGeneral, url, L" status: ", resp->StatusCode());
+    return std::nullopt;
+  }
+  return std::make_optional<std::string>(resp->Content());
+}
+} // namespace
+
+bool Build(const std::filesystem::path &root, std::wstring_view commit, const std::filesystem::path &file,
+           bela::error_code &ec) {
+  snapshot_t s{.commit = std::wstring(commit)};
+  std::error_code e;
+  for (const auto &p : std::filesystem::recursive_directory_iterator{root, e}) {
+    if (!p.is_regular_file(e)) {
+      continue;
+    }
+    std::wstring id;
+    if (!file_blob_id(p.path(), id, ec)) {
+      return false;
+    }
+    s.files.insert_or_assign(p.path().lexically_relative(root).generic_wstring(), std::move(id));
+  }
+  if (e) {
+    ec = bela::make_error_code_from_std(e);
+    return false;
+  }
+  return save(file, s, ec);
+}
+
+bool Fetch(const Bucket &bucket, std::wstring_view base, std::wstring_view commit, const std::filesystem::path &staging,
+           bela::error_code &ec) {
+  auto repo = github_repo(bucket.url);
+  if (!repo) {
+    ec = bela::make_error_code(bela::ErrGeneral, bucket.url, L" is not a github repository");
+    return false;
+  }
+  snapshot_t s;
+  if (!load(snapshot_path(bucket), s, ec)) {
+    return false;
+  }
+  if (!bela::EqualsIgnoreCase(s.commit, base)) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"snapshot taken at ", s.commit, L" bucket at ", base);
+    return false;
+  }
+  auto content =
+      fetch_content(bela::StringCat(L"https://api.github.com/repos/", *repo, L"/compare/", base, L"...", commit), ec);
+  if (!content) {
+    return false;
+  }
+  auto bucketDir = std::filesystem::path(vfs::AppBuckets()) / bucket.name;
+  // local_matches: the bucket file is still what the snapshot recorded
+  auto local_matches = [&](const std::wstring &path) {
+    auto it = s.files.find(path);
+    std::wstring id;
+    bela::error_code lec;
+    return it != s.files.end() && file_blob_id(bucketDir / std::filesystem::path(path).make_preferred(), id, lec) &&
+           id == it->second;
+  };
+  std::error_code e;
+  std::filesystem::remove_all(staging, e);
+  auto files = staging / L"files";
+  if (!baulk::fs::MakeDirectories(files, ec)) {
+    return false;
+  }
+  nlohmann::json journal = nlohmann::json::array();
+  try {
+    auto j = nlohmann::json::parse(*content);
+    auto status = j.value("status", "");
+    if (status != "ahead" && status != "identical") {
+      ec = bela::make_error_code(bela::ErrGeneral, commit, L" is ", bela::encode_into<char, wchar_t>(status),
+                                 L" of ", base);
+      return false;
+    }
+    auto it = j.find("files");
+    if (it != j.end() && it->size() >= compare_files_limit) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"more than ", compare_files_limit, L" files changed");
+      return false;
+    }
+    // selected: the bucket keeps this file, see BucketManifests
+    auto selected = [](std::string_view name) { return bela::FnMatch(BucketManifests, name, bela::fnmatch::PathName); };
+    for (const auto &f : (it != j.end() ? *it : nlohmann::json::array())) {
+      auto filename = f.at("filename").get<std::string>();
+      auto path = bela::encode_into<char, wchar_t>(filename);
+      auto action = f.at("status").get<std::string_view>();
+      if (action == "renamed") {
+        if (auto previous = f.at("previous_filename").get<std::string>(); selected(previous)) {
+          auto wprevious = bela::encode_into<char, wchar_t>(previous);
+          if (!local_matches(wprevious)) {
+            ec = bela::make_error_code(bela::ErrGeneral, wprevious, L" changed locally");
+            return false;
+          }
+          journal.push_back({{"action", "remove"}, {"path", previous}});
+          s.files.erase(wprevious);
+        }
+      }
+      if (!selected(filename)) {
+        continue;
+      }
+      if (action == "removed") {
+        if (!local_matches(path)) {
+          ec = bela::make_error_code(bela::ErrGeneral, path, L" changed locally");
+          return false;
+        }
+        journal.push_back({{"action", "remove"}, {"path", filename}});
+        s.files.erase(path);
+        continue;
+      }
+      if (action == "modified" || action == "changed") {
+        if (!local_matches(path)) {
+          ec = bela::make_error_code(bela::ErrGeneral, path, L" changed locally");
+          return false;
+        }
+      } else if (action != "added" && action != "copied" && action != "renamed") {
+        ec = bela::make_error_code(bela::ErrGeneral, path, L" ", bela::encode_into<char, wchar_t>(action),
+                                   L" cannot be applied");
+        return false;
+      }
+      auto id = bela::encode_into<char, wchar_t>(f.at("sha").get<std::string_view>());
+      auto raw = fetch_content(bela::encode_into<char, wchar_t>(f.at("raw_url").get<std::string_view>()), ec);
+      if (!raw) {
+        return false;
+      }
+      if (blob_id(*raw) != id) {
+        ec = bela::make_error_code(bela::ErrGeneral, path, L" does not match blob ", id);
+        return false;
+      }
+      auto target = files / std::filesystem::path(path).make_preferred();
+      if (!baulk::fs::MakeParentDirectories(target, ec) ||
+          !bela::io::WriteText(target.native(), bela::io::as_bytes<char>(*raw), ec)) {
+        return false;
+      }
+      journal.push_back({{"action", "write"}, {"path", filename}});
+      s.files.insert_or_assign(path, std::move(id));
+    }
+  } catch (const std::exception &e) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"compare ", base, L"...", commit, L": ",
+                               bela::encode_into<char, wchar_t>(e.what()));
+    return false;
+  }
+  s.commit = commit;
+  if (!save(staging / L"snapshot.json", s, ec)) {
+    return false;
+  }
+  DbgPrint(L"bucket %s: %d files changed from %s to %s", bucket.name, journal.size(), base, commit);
+  return bela::io::AtomicWriteText((staging / L"changes.json").native(), bela::io::as_bytes<char>(journal.dump()), ec);
+}
+
+bool Recover(const Bucket &bucket, bela::error_code &ec) {
+  auto previous = previous_path(bucket);
+  if (!bela::PathExists(previous)) {
+    return true;
+  }
+  if (auto bucketDir = bucket_path(bucket); !bela::PathExists(bucketDir)) {
+    if (MoveFileW(previous.data(), bucketDir.data()) != TRUE) {
+      ec = bela::make_system_error_code(L"MoveFileW() ");
+      return false;
+    }
+    return true;
+  }
+  return bela::fs::ForceDeleteFolders(previous, ec);
+}
+
+bool Apply(const Bucket &bucket, const std::filesystem::path &staging, bela::error_code &ec) {
+  auto jo = parse_json_file((staging / L"changes.json").native(), ec);
+  if (!jo) {
+    return false;
+  }
+  bela::flat_hash_set<std::wstring> changed; // lower case '/' separated paths written or removed
+  std::vector<std::filesystem::path> written;
+  try {
+    for (const auto &c : jo->obj) {
+      auto path = bela::encode_into<char, wchar_t>(c.at("path").get<std::string_view>());
+      changed.emplace(bela::AsciiStrToLower(path));
+      if (c.at("action").get<std::string_view>() != "remove") {
+        written.emplace_back(std::filesystem::path(path).make_preferred());
+      }
+    }
+  } catch (const std::exception &ex) {
+    ec = bela::make_error_code(bela::ErrGeneral, bela::encode_into<char, wchar_t>(ex.what()));
+    return false;
+  }
+  // the new tree: every file the changes leave alone, then the staged files
+  std::filesystem::path bucketDir(bucket_path(bucket));
+  auto tree = staging / L"tree";
+  std::error_code e;
+  for (std::filesystem::recursive_directory_iterator it(bucketDir, e), end; !e && it != end; it.increment(e)) {
+    if (std::error_code fe; !it->is_regular_file(fe)) {
+      continue;
+    }
+    auto relative = it->path().lexically_relative(bucketDir);
+    if (changed.contains(bela::AsciiStrToLower(relative.generic_wstring()))) {
+      continue;
+    }
+    if (!baulk::fs::MakeParentDirectories(tree / relative, ec) || !link_file(it->path(), tree / relative, ec)) {
+      return false;
+    }
+  }
+  if (e) {
+    ec = bela::make_error_code_from_std(e, L"walk bucket: ");
+    return false;
+  }
+  for (const auto &path : written) {
+    auto source = staging / L"files" / path;
+    auto target = tree / path;
+    if (!baulk::fs::MakeParentDirectories(target, ec)) {
+      return false;
+    }
+    if (MoveFileExW(source.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING) != TRUE) {
+      ec = bela::make_system_error_code(L"MoveFileExW() ");
+      return false;
+    }
+  }
+  if (!baulk::fs::MakeDirectories(tree, ec)) {
+    return false;
+  }
+  // an index compiled at the old commit must not vouch for the new files, the update compiles it again
+  index::Remove(bucket);
+  // the swap: the old folder is parked, the new tree renamed into its place. Recover puts the old folder back when
+  // the new tree never arrived
+  auto previous = previous_path(bucket);
+  if (MoveFileW(bucketDir.c_str(), previous.data()) != TRUE) {
+    ec = bela::make_system_error_code(L"MoveFileW() ");
+    return false;
+  }
+  if (MoveFileW(tree.c_str(), bucketDir.c_str()) != TRUE) {
+    ec = bela::make_system_error_code(L"MoveFileW() ");
+    MoveFileW(previous.data(), bucketDir.c_str());
+    return false;
+  }
+  // without the new snapshot the next update downloads the archive
+  if (bela::error_code sec; !Install(bucket, staging / L"snapshot.json", sec)) {
+    DbgPrint(L"bucket %s: snapshot %s", bucket.name, sec);
+    Remove(bucket);
+  }
+  if (bela::error_code dec; !bela::fs::ForceDeleteFolders(previous, dec)) {
+    bela::FPrintF(stderr, L"baulk update: remove %s error: \x1b[31m%s\x1b[0m\n", previous, dec);
+  }
+  if (bela::error_code dec; !bela::fs::ForceDeleteFolders(staging.native(), dec)) {
+    bela::FPrintF(stderr, L"baulk update: remove %s error: \x1b[31m%s\x1b[0m\n", staging.native(), dec);
+  }
+  return true;
+}
+
+bool Install(const Bucket &bucket, const std::filesystem::path &file, bela::error_code &ec) {
+  auto target = snapshot_path(bucket);
+  if (MoveFileExW(file.c_str(), target.data(), MOVEFILE_COPY_ALLOWED | MOVEFILE_REPLACE_EXISTING) != TRUE) {
+    ec = bela::make_system_error_code(L"MoveFileExW() ");
+    return false;
+  }
+  return true;
+}
+
+void Remove(const Bucket &bucket) {
+  auto file = snapshot_path(bucket);
+  DeleteFileW(file.data());
+}
+
+} // namespace baulk::snapshot
@@ -0,0 +1,35 @@
+//
+#ifndef BAULK_SNAPSHOT_HPP
+#define BAULK_SNAPSHOT_HPP
+#include <bela/base.hpp>
+#include <filesystem>
+#include "baulk.hpp"
+
+namespace baulk::snapshot {
+// A github bucket keeps AppBuckets()\<bucket>.snapshot.json: the commit it was extracted from and the git blob id of
+// every file it keeps. An update from that commit asks the github compare api for the changed files, downloads those
+// matching BucketManifests, checks each against its blob id and stages them with a journal of writes and removals.
+// Any doubt (another host, a force push, more files than the api lists, local edits) leaves the full archive download
+// to the caller
+
+// Build hashes the files of an extracted bucket at commit into a snapshot written to file
+bool Build(const std::filesystem::path &root, std::wstring_view commit, const std::filesystem::path &file,
+           bela::error_code &ec);
+// Fetch stages the changes of bucket from base to commit under staging, the new snapshot included
+bool Fetch(const Bucket &bucket, std::wstring_view base, std::wstring_view commit, const std::filesystem::path &staging,
+           bela::error_code &ec);
+// Apply builds the new bucket folder under staging, the unchanged files linked and the staged ones moved in, drops the
+// index of the bucket and swaps the folders: the old one is parked as <bucket>.previous, the new one renamed into
+// place, the snapshot replaced last. A crash after the swap leaves files that no longer match the snapshot and the
+// next update downloads the full archive
+bool Apply(const Bucket &bucket, const std::filesystem::path &staging, bela::error_code &ec);
+// Recover finishes a swap that Apply did not: a parked folder is renamed back when the bucket folder is missing and
+// deleted otherwise
+bool Recover(const Bucket &bucket, bela::error_code &ec);
+// Install moves a snapshot built by Build next to the bucket
+bool Install(const Bucket &bucket, const std::filesystem::path &file, bela::error_code &ec);
+// Remove deletes the snapshot of a bucket
+void Remove(const Bucket &bucket);
+} // namespace baulk::snapshot
+
+#endif
@@ -1,8 +1,16 @@
 // A simple program download network resource
 #include <bela/parseargv.hpp>
+#include <bela/hash.hpp>
+#include <bela/fs.hpp>
+#include <bela/path.hpp>
 #include <filesystem>
+#include <atomic>
+#include <algorithm>
+#include <mutex>
+#include <thread>
 #include <baulk/hash.hpp>
 #include <baulk/net/client.hpp>
+#include <baulk/indicators.hpp>
 #include <baulk/debug.hpp>
 #include <version.hpp>
 
@@ -22,9 +30,12 @@ Usage: wind [option]... [url]...
   -A|--user-agent  Send User-Agent <name> to server
   --https-proxy    Use this proxy. Equivalent to setting the environment variable 'HTTPS_PROXY'
   --no-cache       Download directly without caching
+  --segments       Download large files over N parallel connections (byte ranges)
+  -j|--jobs        Download up to N urls at the same time (default 4)
 
 Example:
   wind https://aka.ms/win32-x64-user-stable
+  wind -j8 -W D:\mirror https://example.com/a.zip https://example.com/b.zip
 
 )";
   bela::terminal::WriteAuto(stderr, usage);
@@ -59,6 +70,8 @@ private:
   std::vector<std::wstring> urls;
   std::filesystem::path cwd;
   std::filesystem::path destination;
+  uint32_t segments{0};
+  uint32_t jobs{4};
   bool replace{false};
 };
 
@@ -86,7 +99,9 @@ bool Executor::ParseArgv(int argc, wchar_t **argv) {
       .Add(L"output", bela::required_argument, L'O')
       .Add(L"user-agent", bela::required_argument, 'A')
       .Add(L"https-proxy", bela::required_argument, 1001)
-      .Add(L"no-cache", bela::no_argument, 1002); // option
+      .Add(L"no-cache", bela::no_argument, 1002)
+      .Add(L"segments", bela::required_argument, 1003)
+      .Add(L"jobs", bela::required_argument, L'j'); // option
   bela::error_code ec;
   auto ret = pa.Execute(
       [&](int val, const wchar_t *oa, const wchar_t *) {
@@ -125,6 +140,18 @@ bool Executor::ParseArgv(int argc, wchar_t **argv) {
         case 1002:
           HttpClient::DefaultClient().SetNoCache(true);
           break;
+        case 1003:
+          if (!bela::SimpleAtoi(oa, &segments)) {
+            bela::FPrintF(stderr, L"wind: invalid segments '%s'\n", oa);
+            segments = 0;
+          }
+          break;
+        case 'j':
+          if (!bela::SimpleAtoi(oa, &jobs) || jobs == 0) {
+            bela::FPrintF(stderr, L"wind: invalid jobs '%s'\n", oa);
+            jobs = 4;
+          }
+          break;
         default:
           break;
         }
@@ -159,6 +186,7 @@ int Executor::single_download() {
                                      .cwd = cwd,
                                      .destination = destination,
                                      .force_overwrite = replace,
+                                     .segments = segments,
                                  },
                                  ec);
   if (!file) {
@@ -169,25 +197,142 @@ int Executor::single_download() {
   bela::FPrintF(stdout, L"\x1b[32m'%s' saved\x1b[0m\n", file->native());
   return 0;
 }
+
+namespace {
+// download_result is what multi_download reports for one url
+struct download_result {
+  std::wstring url;
+  std::optional<std::filesystem::path> file;
+  std::wstring sha256sum;
+  std::wstring blake3sum;
+  bela::error_code ec;
+};
+
+// body_sums hashes a download while it is received, so the file is not read again
+struct body_sums {
+  bela::hash::sha256::Hasher sha256;
+  bela::hash::blake3::Hasher blake3;
+  body_sums() {
+    sha256.Initialize();
+    blake3.Initialize();
+  }
+};
+} // namespace
+
+// multi_download runs up to jobs downloads at a time behind one progress bar counting finished files. Every url
+// downloads into a folder of its own under cwd, whatever name the server gives the file, and the finished file is
+// moved into cwd under one lock: a name another download already took gets a '-(N)' suffix unless --replace, so no
+// two downloads ever write the same file
 int Executor::multi_download() {
+  std::vector<download_result> results(urls.size());
+  std::atomic_size_t next{0};
+  std::atomic_size_t finished{0};
+  std::mutex placing;
+  baulk::ProgressBar bar;
+  bar.FileName(bela::StringCat(urls.size(), L" files"));
+  bar.Maximum(urls.size());
+  bar.Execute();
+  // place moves a finished download from its own folder into cwd
+  auto place = [&](download_result &r) {
+    std::scoped_lock lock(placing);
+    auto filename = r.file->filename();
+    auto target = cwd / filename;
+    std::error_code e;
+    for (int i = 1; !replace && std::filesystem::exists(target, e) && i < 100; i++) {
+      target = cwd / bela::StringCat(filename.stem().native(), L"-(", i, L")", filename.extension().native());
+    }
+    if (MoveFileExW(r.file->c_str(), target.c_str(), replace ? MOVEFILE_REPLACE_EXISTING : 0) != TRUE) {
+      r.ec = bela::make_system_error_code(bela::StringCat(L"move to '", target.native(), L"': "));
+      r.file.reset();
+      return;
+    }
+    r.file = std::move(target);
+  };
+  auto fetch = [&](size_t index) {
+    auto &r = results[index];
+    r.url = urls[index];
+    auto folder = cwd / bela::StringCat(L".wind-", GetCurrentProcessId(), L"-", index);
+    auto closer = bela::finally([&] {
+      bar.Update(++finished);
+      bela::error_code ec;
+      if (bela::PathExists(folder.native()) && !bela::fs::ForceDeleteFolders(folder.native(), ec)) {
+        bela::FPrintF(stderr, L"wind: remove '%s' error: %s\n", folder.native(), ec);
+      }
+    });
+    if (std::error_code e; !std::filesystem::create_directories(folder, e) && e) {
+      r.ec = bela::make_error_code_from_std(e, L"create download folder: ");
+      return;
+    }
+    // segmented downloads cannot be teed, their files are hashed afterwards
+    std::optional<body_sums> sums;
+    if (segments <= 1) {
+      sums.emplace();
+    }
+    r.file = baulk::net::WinGet(r.url,
+                                {
+                                    .hash_value = L"",
+                                    .cwd = folder,
+                                    .segments = segments,
+                                    .quiet = true,
+                                    .sink = sums ? baulk::net::body_sink_t{[&](const void *data, size_t len,
+                                                                               bela::error_code &) {
+                                      sums->sha256.Update(data, len);
+                                      sums->blake3.Update(data, len);
+                                      return true;
+                                    }}
+                                                 : baulk::net::body_sink_t{},
+                                },
+                                r.ec);
+    if (!r.file) {
+      return;
+    }
+    if (sums) {
+      r.sha256sum = sums->sha256.Finalize();
+      r.blake3sum = sums->blake3.Finalize();
+    } else if (auto hs = baulk::hash::HashSums(*r.file, r.ec); hs) {
+      r.sha256sum = std::move(hs->sha256sum);
+      r.blake3sum = std::move(hs->blake3sum);
+    }
+    place(r);
+  };
+  auto worker = [&] {
+    for (size_t index = next++; index < urls.size(); index = next++) {
+      fetch(index);
+    }
+  };
+  std::vector<std::thread> threads;
+  auto n = (std::min)(static_cast<size_t>(jobs), urls.size());
+  for (size_t i = 1; i < n; i++) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto &t : threads) {
+    t.join();
+  }
   size_t success = 0;
-  bela::error_code ec;
-  for (const auto &u : urls) {
-    auto file = baulk::net::WinGet(u,
-                                   {
-                                       .hash_value = L"",
-                                       .cwd = cwd,
-                                       .force_overwrite = replace,
-                                   },
-                                   ec);
-    if (!file) {
-      bela::FPrintF(stderr, L"download failed: \x1b[31m%s\x1b[0m\n", ec);
+  for (const auto &r : results) {
+    success += r.file ? 1 : 0;
+  }
+  if (success == results.size()) {
+    bar.MarkCompleted();
+  } else {
+    bar.MarkFault();
+  }
+  bar.Finish();
+  for (const auto &r : results) {
+    if (!r.file) {
+      bela::FPrintF(stderr, L"download '%s' failed: \x1b[31m%s\x1b[0m\n", r.url, r.ec);
       continue;
     }
-    baulk::verify_file(*file);
-    bela::FPrintF(stdout, L"\x1b[32m'%s' saved\x1b[0m\n", *file);
+    auto filename = r.file->filename();
+    if (!r.sha256sum.empty()) {
+      bela::FPrintF(stderr, L"\x1b[34mSHA256:%s %s\x1b[0m\n", r.sha256sum, filename.native());
+      bela::FPrintF(stderr, L"\x1b[34mBLAKE3:%s %s\x1b[0m\n", r.blake3sum, filename.native());
+    }
+    bela::FPrintF(stdout, L"\x1b[32m'%s' saved\x1b[0m\n", *r.file);
   }
-  return success == urls.size() ? 0 : 1;
+  bela::FPrintF(stderr, L"wind: %d of %d downloads completed\n", success, results.size());
+  return success == results.size() ? 0 : 1;
 }
 
 } // namespace baulk